@@ -0,0 +1,261 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "serial_cli.hpp"
+#include "serial_cli_commands.h"
+
+namespace {
+
+void noopWrite(void *, const char *, size_t) {}
+
+void noopCommand(SerialCLI *, int, const char **) {}
+
+struct CommandSet {
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  std::vector<std::string> names;
+  std::vector<SerialCLI_CommandEntry> entries;
+
+  explicit CommandSet(size_t count) : names(count), entries(count) {
+    SerialCLI_InitWithStorage(&cli, &storage.storage, noopWrite, nullptr);
+    for (size_t i = 0; i < count; ++i) {
+      names[i] = "command_" + std::to_string(i);
+      entries[i] = {};
+      entries[i].command = noopCommand;
+      entries[i].commandName = names[i].c_str();
+    }
+  }
+
+  void registerAll() {
+    for (auto &entry : entries) {
+      SerialCLI_RegisterCommand(&cli, &entry);
+    }
+  }
+};
+
+// Reference implementation of the lookup before the command index was introduced
+SerialCLI_CommandEntry *listWalkLookup(SerialCLI *cli, const char *commandName) {
+  SerialCLI_CommandEntry *current = &cli->helpEntry;
+  while (NULL != current) {
+    if (0 == strncmp(current->commandName, commandName, SERIAL_CLI_COMMAND_MAX_ARG_LENGTH)) {
+      return current;
+    }
+    current = current->next;
+  }
+  return NULL;
+}
+
+// Reference implementation of the registration before the command index was introduced
+void listWalkRegister(SerialCLI_CommandEntry *head, SerialCLI_CommandEntry *command) {
+  SerialCLI_CommandEntry *current = head;
+  while (NULL != current->next) {
+    if (current->next == command) {
+      return;
+    }
+    current = current->next;
+  }
+  command->next = NULL;
+  current->next = command;
+}
+
+// Reference implementation of the tab completion before the prefix trie was introduced
+const char *listWalkResolvePartial(SerialCLI *cli, const char *partialName) {
+  SerialCLI_CommandEntry *current = &cli->helpEntry;
+  size_t matchCount = 0;
+
+  const char *command = NULL;
+  size_t partialLen = strlen(partialName);
+  while (NULL != current) {
+    if ((partialLen < strlen(current->commandName)) && (0 == strncmp(partialName, current->commandName, partialLen))) {
+      command = current->commandName;
+      ++matchCount;
+    }
+    current = current->next;
+  }
+  return (1 == matchCount) ? command : NULL;
+}
+
+std::vector<std::string> makePartialNames(const CommandSet &set) {
+  std::vector<std::string> partialNames;
+  for (const auto &name : set.names) {
+    partialNames.push_back(name.substr(0, name.size() - 1));
+  }
+  return partialNames;
+}
+
+void BM_ListWalkLookup(benchmark::State &state) {
+  CommandSet set((size_t)state.range(0));
+  set.registerAll();
+
+  size_t idx = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(listWalkLookup(&set.cli, set.names[idx].c_str()));
+    idx = (idx + 1) % set.names.size();
+  }
+}
+
+void BM_GetCommandEntry(benchmark::State &state) {
+  CommandSet set((size_t)state.range(0));
+  set.registerAll();
+
+  size_t idx = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SerialCLI_GetCommandEntry(&set.cli, set.names[idx].c_str()));
+    idx = (idx + 1) % set.names.size();
+  }
+}
+
+void BM_ListWalkRegisterAll(benchmark::State &state) {
+  CommandSet set((size_t)state.range(0));
+
+  for (auto _ : state) {
+    SerialCLI_CommandEntry head{};
+    for (auto &entry : set.entries) {
+      listWalkRegister(&head, &entry);
+    }
+    benchmark::DoNotOptimize(head.next);
+  }
+}
+
+void BM_RegisterAll(benchmark::State &state) {
+  CommandSet set((size_t)state.range(0));
+
+  for (auto _ : state) {
+    SerialCLI_InitWithStorage(&set.cli, &set.storage.storage, noopWrite, nullptr);
+    set.registerAll();
+    benchmark::DoNotOptimize(set.cli.commands.commandsTail);
+  }
+}
+
+// Startup of an instance sharing the commands instead of registering them
+void BM_AttachRegistry(benchmark::State &state) {
+  CommandSet set((size_t)state.range(0));
+  SerialCLI_Registry registry;
+  SerialCLI_InitRegistry(&registry);
+  for (auto &entry : set.entries) {
+    SerialCLI_RegistryAddCommand(&registry, &entry);
+  }
+  SerialCLI_SealRegistry(&registry);
+
+  for (auto _ : state) {
+    SerialCLI_InitWithStorage(&set.cli, &set.storage.storage, noopWrite, nullptr);
+    SerialCLI_AttachRegistry(&set.cli, &registry);
+    benchmark::DoNotOptimize(set.cli.registry);
+  }
+}
+
+void BM_ListWalkResolvePartial(benchmark::State &state) {
+  CommandSet set((size_t)state.range(0));
+  set.registerAll();
+  auto partialNames = makePartialNames(set);
+
+  size_t idx = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(listWalkResolvePartial(&set.cli, partialNames[idx].c_str()));
+    idx = (idx + 1) % partialNames.size();
+  }
+}
+
+void BM_ResolvePartialCommand(benchmark::State &state) {
+  CommandSet set((size_t)state.range(0));
+  set.registerAll();
+  auto partialNames = makePartialNames(set);
+
+  size_t idx = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SerialCLI_ResolvePartialCommand(&set.cli, partialNames[idx].c_str()));
+    idx = (idx + 1) % partialNames.size();
+  }
+}
+
+// The leaves spread over ten groups
+struct CommandTree {
+  static constexpr size_t groupCount = 10;
+
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  std::vector<std::string> groupNames;
+  std::vector<std::string> leafNames;
+  std::vector<SerialCLI_CommandGroup> groups;
+  std::vector<SerialCLI_CommandEntry> leaves;
+
+  explicit CommandTree(size_t leafCount)
+      : groupNames(groupCount), leafNames(leafCount), groups(groupCount), leaves(leafCount) {
+    SerialCLI_InitWithStorage(&cli, &storage.storage, noopWrite, nullptr);
+    for (size_t i = 0; i < groupCount; ++i) {
+      groupNames[i] = "group_" + std::to_string(i);
+      groups[i] = {};
+      groups[i].entry.commandName = groupNames[i].c_str();
+      SerialCLI_RegisterGroup(&cli, nullptr, &groups[i]);
+    }
+    for (size_t i = 0; i < leafCount; ++i) {
+      leafNames[i] = "command_" + std::to_string(i);
+      leaves[i] = {};
+      leaves[i].command = noopCommand;
+      leaves[i].commandName = leafNames[i].c_str();
+      SerialCLI_RegisterSubcommand(&cli, &groups[i % groupCount], &leaves[i]);
+    }
+  }
+};
+
+void BM_FindSubcommand(benchmark::State &state) {
+  CommandTree tree((size_t)state.range(0));
+
+  size_t idx = 0;
+  for (auto _ : state) {
+    // One lookup per level, the group and then its subcommand
+    auto *group = (SerialCLI_CommandGroup *)SerialCLI_GetCommandEntry(
+        &tree.cli, tree.groupNames[idx % CommandTree::groupCount].c_str());
+    const std::string &name = tree.leafNames[idx];
+    benchmark::DoNotOptimize(SerialCLI_FindCommand(&group->trie, name.c_str(), name.size()));
+    idx = (idx + 1) % tree.leaves.size();
+  }
+}
+
+// The table SERIAL_CLI_COMMAND entries are linked into, sorted by name
+struct StaticTable {
+  std::vector<std::string> names;
+  std::vector<std::string> sortedNames;
+  std::vector<SerialCLI_StaticCommand> commands;
+
+  explicit StaticTable(size_t count) : names(count), commands(count) {
+    for (size_t i = 0; i < count; ++i) {
+      names[i] = "command_" + std::to_string(i);
+    }
+    sortedNames = names;
+    std::sort(sortedNames.begin(), sortedNames.end());
+    for (size_t i = 0; i < count; ++i) {
+      commands[i] = {};
+      commands[i].command = noopCommand;
+      commands[i].commandName = sortedNames[i].c_str();
+    }
+  }
+};
+
+void BM_SearchStaticCommands(benchmark::State &state) {
+  StaticTable table((size_t)state.range(0));
+
+  size_t idx = 0;
+  for (auto _ : state) {
+    const std::string &name = table.names[idx];
+    benchmark::DoNotOptimize(
+        SerialCLI_SearchStaticCommands(table.commands.data(), table.commands.size(), name.c_str(), name.size()));
+    idx = (idx + 1) % table.names.size();
+  }
+}
+
+} // namespace
+
+BENCHMARK(BM_ListWalkLookup)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_GetCommandEntry)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_ListWalkRegisterAll)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_RegisterAll)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_AttachRegistry)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_ListWalkResolvePartial)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_ResolvePartialCommand)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_FindSubcommand)->Arg(10)->Arg(100)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_SearchStaticCommands)->Arg(10)->Arg(100)->Arg(1000)->Arg(10000);
@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "serial_cli.hpp"
+#include "serial_cli_capture.h"
+#include "serial_cli_host.h"
+
+namespace {
+
+void pongCommand(SerialCLI *cli, int, const char **) { SerialCLI_WriteString(cli, "pong"); }
+
+// Time from writing a command line to receiving its output over a unix socket
+void BM_HostTurnaround(benchmark::State &state) {
+  static serial_cli::DefaultStorage storage;
+  static SerialCLI cli;
+  static SerialCLI_Host host;
+  static SerialCLI_CommandEntry commandEntry;
+
+  int fds[2];
+  if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, fds)) {
+    state.SkipWithError("socketpair failed");
+    return;
+  }
+
+  std::thread hostThread([&]() {
+    SerialCLI_HostAttach(&host, &cli, fds[0], fds[0]);
+    SerialCLI_InitWithStorage(&cli, &storage.storage, SerialCLI_HostWrite, &host);
+    // Only the command output is sent back
+    SerialCLI_SetPrompt(&cli, "");
+    commandEntry = {};
+    commandEntry.command = pongCommand;
+    commandEntry.commandName = "p";
+    SerialCLI_RegisterCommand(&cli, &commandEntry);
+    SerialCLI_HostRun(&host);
+  });
+
+  const std::string request = "p\r";
+  char response[64];
+  for (auto _ : state) {
+    (void)write(fds[1], request.data(), request.size());
+    size_t received = 0;
+    std::string_view output;
+    while (output.find("pong") == std::string_view::npos) {
+      ssize_t length = read(fds[1], &response[received], sizeof(response) - received);
+      if (length <= 0) {
+        state.SkipWithError("read failed");
+        break;
+      }
+      received += (size_t)length;
+      output = std::string_view(response, received);
+    }
+  }
+
+  SerialCLI_HostStop(&host);
+  hostThread.join();
+  SerialCLI_HostClose(&host);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void registerPong(SerialCLI *cli, SerialCLI_CommandEntry *commandEntry) {
+  *commandEntry = {};
+  commandEntry->command = pongCommand;
+  commandEntry->commandName = "p";
+  SerialCLI_RegisterCommand(cli, commandEntry);
+}
+
+// Replays a recorded session of typed lines as fast as possible
+void BM_Replay(benchmark::State &state) {
+  static serial_cli::DefaultStorage storage;
+  static SerialCLI cli;
+  static SerialCLI_Capture capture;
+  static SerialCLI_CommandEntry commandEntry;
+  const std::string path = "/tmp/serial_cli_bench_capture." + std::to_string(getpid());
+
+  SerialCLI_InitWithStorage(&cli, &storage.storage, [](void *, const char *, size_t) {}, nullptr);
+  registerPong(&cli, &commandEntry);
+  if (!SerialCLI_CaptureOpen(&capture, &cli, path.c_str())) {
+    state.SkipWithError("capture failed");
+    return;
+  }
+  const std::string line = "p\r";
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    // Typed one character per chunk, like a terminal sends it
+    for (char ch : line) {
+      SerialCLI_Read(&cli, &ch, 1);
+    }
+    SerialCLI_Process(&cli);
+  }
+  SerialCLI_CaptureClose(&capture);
+  SerialCLI_Deinit(&cli);
+
+  SerialCLI_ReplayResult result{};
+  for (auto _ : state) {
+    SerialCLI_InitWithStorage(&cli, &storage.storage, [](void *, const char *, size_t) {}, nullptr);
+    registerPong(&cli, &commandEntry);
+    if (!SerialCLI_Replay(&cli, path.c_str(), false, &result)) {
+      state.SkipWithError("replay differs");
+    }
+    SerialCLI_Deinit(&cli);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetBytesProcessed(state.iterations() * (int64_t)result.inputBytes);
+  state.counters["p99_us"] = (double)SerialCLI_ReplayGetPercentile(&result, 99);
+  unlink(path.c_str());
+}
+
+} // namespace
+
+BENCHMARK(BM_HostTurnaround)->UseRealTime();
+BENCHMARK(BM_Replay)->Arg(1000);
@@ -0,0 +1,240 @@
+// Load generator for the multi-session server.
+//
+// Connects an increasing number of unix socket clients to a server running on
+// its own thread. Every client keeps one command in flight and measures the
+// time until its output arrives. With --work-us every command spins for that
+// long, with --workers the commands run on an executor of that many threads.
+//
+// Usage: serial_cli_loadgen [--sessions 1,10,100,1000] [--duration-ms 1000] [--work-us 0] [--workers 0] [--json]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "serial_cli.h"
+#include "serial_cli_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::vector<size_t> sessionCounts{1, 10, 100, 1000};
+  int durationMs = 1000;
+  int workUs = 0;
+  size_t workerCount = 0;
+  bool isJson = false;
+};
+
+struct Client {
+  int fd = -1;
+  Clock::time_point sentAt;
+  std::string received;
+};
+
+struct Result {
+  size_t sessionCount;
+  double commandsPerSecond;
+  double p50Us;
+  double p99Us;
+};
+
+const char request[] = "ping\r";
+int workUs = 0;
+
+// Busy waits instead of sleeping, so the command keeps a core occupied
+void pingCommand(SerialCLI *cli, int, const char **) {
+  const auto end = Clock::now() + std::chrono::microseconds(workUs);
+  while (Clock::now() < end) {
+  }
+  SerialCLI_WriteString(cli, "pong\r\n");
+}
+
+Options parseOptions(int argc, char **argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if ((argument == "--sessions") && (i + 1 < argc)) {
+      options.sessionCounts.clear();
+      std::string list = argv[++i];
+      for (size_t start = 0; start < list.size();) {
+        size_t end = std::min(list.find(',', start), list.size());
+        options.sessionCounts.push_back(std::stoul(list.substr(start, end - start)));
+        start = end + 1;
+      }
+    } else if ((argument == "--duration-ms") && (i + 1 < argc)) {
+      options.durationMs = std::stoi(argv[++i]);
+    } else if ((argument == "--work-us") && (i + 1 < argc)) {
+      options.workUs = std::stoi(argv[++i]);
+    } else if ((argument == "--workers") && (i + 1 < argc)) {
+      options.workerCount = std::stoul(argv[++i]);
+    } else if (argument == "--json") {
+      options.isJson = true;
+    } else {
+      std::fprintf(stderr, "Usage: %s [--sessions 1,10,100] [--duration-ms 1000] [--work-us 0] [--workers 0] [--json]\n", argv[0]);
+      std::exit(1);
+    }
+  }
+  return options;
+}
+
+// Two descriptors per session, one on each side
+void raiseDescriptorLimit() {
+  struct rlimit limit;
+  if (0 == getrlimit(RLIMIT_NOFILE, &limit)) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+bool sendRequest(Client &client) {
+  client.sentAt = Clock::now();
+  return write(client.fd, request, sizeof(request) - 1) == (ssize_t)(sizeof(request) - 1);
+}
+
+Result runRound(const struct sockaddr_un &address, size_t sessionCount, int durationMs) {
+  std::vector<Client> clients(sessionCount);
+  int epollFd = epoll_create1(0);
+  for (size_t i = 0; i < sessionCount; ++i) {
+    clients[i].fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (0 != connect(clients[i].fd, (const struct sockaddr *)&address, sizeof(address))) {
+      std::perror("connect");
+      std::exit(1);
+    }
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = i;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, clients[i].fd, &event);
+  }
+
+  for (auto &client : clients) {
+    sendRequest(client);
+  }
+
+  std::vector<double> latenciesUs;
+  std::vector<struct epoll_event> events(sessionCount);
+  const auto start = Clock::now();
+  const auto end = start + std::chrono::milliseconds(durationMs);
+  while (Clock::now() < end) {
+    int eventCount = epoll_wait(epollFd, events.data(), (int)events.size(), 100);
+    for (int i = 0; i < eventCount; ++i) {
+      Client &client = clients[events[(size_t)i].data.u64];
+      char buffer[256];
+      ssize_t length = read(client.fd, buffer, sizeof(buffer));
+      if (length <= 0) {
+        std::fprintf(stderr, "session closed by the server\n");
+        std::exit(1);
+      }
+      client.received.append(buffer, (size_t)length);
+
+      size_t position = client.received.find("pong");
+      if (position != std::string::npos) {
+        auto latency = std::chrono::duration<double, std::micro>(Clock::now() - client.sentAt);
+        latenciesUs.push_back(latency.count());
+        client.received.erase(0, position + strlen("pong"));
+        sendRequest(client);
+      }
+    }
+  }
+  const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  for (auto &client : clients) {
+    close(client.fd);
+  }
+  close(epollFd);
+
+  Result result{sessionCount, 0.0, 0.0, 0.0};
+  if (!latenciesUs.empty()) {
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+    result.commandsPerSecond = (double)latenciesUs.size() / elapsedSeconds;
+    result.p50Us = latenciesUs[latenciesUs.size() / 2];
+    result.p99Us = latenciesUs[(latenciesUs.size() * 99) / 100];
+  }
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options = parseOptions(argc, argv);
+  raiseDescriptorLimit();
+  workUs = options.workUs;
+
+  size_t sessionCapacity = *std::max_element(options.sessionCounts.begin(), options.sessionCounts.end());
+  std::vector<SerialCLI_Session> sessions(sessionCapacity);
+  static SerialCLI_CommandEntry ping;
+  ping.command = pingCommand;
+  ping.commandName = "ping";
+  static SerialCLI_Registry registry;
+  SerialCLI_InitRegistry(&registry);
+  SerialCLI_RegistryAddCommand(&registry, &ping);
+  SerialCLI_SealRegistry(&registry);
+
+  static SerialCLI_Server server;
+  std::string path = "/tmp/serial_cli_loadgen." + std::to_string(getpid());
+  if (!SerialCLI_ServerInit(&server, sessions.data(), sessions.size(), &registry) ||
+      !SerialCLI_ServerListenUnix(&server, path.c_str())) {
+    std::fprintf(stderr, "Failed to start the server\n");
+    return 1;
+  }
+
+  // Every session has at most one command in flight
+  static SerialCLI_Executor executor;
+  std::vector<SerialCLI_Worker> workers(options.workerCount);
+  std::vector<SerialCLI_Job> jobs(std::min(sessionCapacity, options.workerCount * SERIAL_CLI_EXECUTOR_QUEUE_SIZE));
+  if ((options.workerCount > 0) &&
+      (!SerialCLI_ExecutorInit(&executor, workers.data(), workers.size(), jobs.data(), jobs.size()) ||
+       !SerialCLI_ServerSetExecutor(&server, &executor))) {
+    std::fprintf(stderr, "Failed to start the executor\n");
+    return 1;
+  }
+  std::thread serverThread([]() { SerialCLI_ServerRun(&server); });
+
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+  std::vector<Result> results;
+  for (size_t sessionCount : options.sessionCounts) {
+    results.push_back(runRound(address, sessionCount, options.durationMs));
+
+    // Let the server close the sessions of the round before the next one connects
+    while (__atomic_load_n(&server.sessionCount, __ATOMIC_RELAXED) > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  SerialCLI_ServerStop(&server);
+  serverThread.join();
+  SerialCLI_ServerClose(&server);
+  if (options.workerCount > 0) {
+    SerialCLI_ExecutorClose(&executor);
+  }
+
+  if (options.isJson) {
+    std::printf("[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+      std::printf("  {\"sessions\": %zu, \"commands_per_second\": %.0f, \"p50_us\": %.1f, \"p99_us\": %.1f}%s\n",
+                  results[i].sessionCount, results[i].commandsPerSecond, results[i].p50Us, results[i].p99Us,
+                  (i + 1 < results.size()) ? "," : "");
+    }
+    std::printf("]\n");
+  } else {
+    std::printf("%10s %14s %10s %10s\n", "sessions", "commands/s", "p50 us", "p99 us");
+    for (const auto &result : results) {
+      std::printf("%10zu %14.0f %10.1f %10.1f\n", result.sessionCount, result.commandsPerSecond, result.p50Us,
+                  result.p99Us);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+
+#include "serial_cli.hpp"
+
+namespace {
+
+void noopWrite(void *, const char *, size_t) {}
+
+void BM_WriteStringLiteral(benchmark::State &state) {
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  SerialCLI_InitWithStorage(&cli, &storage.storage, noopWrite, nullptr);
+
+  for (auto _ : state) {
+    SerialCLI_WriteString(&cli, "Available commands:\r\n");
+  }
+  SerialCLI_Deinit(&cli);
+}
+
+void BM_WriteStringFormatted(benchmark::State &state) {
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  SerialCLI_InitWithStorage(&cli, &storage.storage, noopWrite, nullptr);
+
+  int value = 0;
+  for (auto _ : state) {
+    SerialCLI_WriteString(&cli, "  %s - %d/%u 0x%08x\r\n", "adc", value, 4095U, 0xdeadbeefU);
+    ++value;
+  }
+  SerialCLI_Deinit(&cli);
+}
+
+// Lines of half the TX buffer size regularly miss the free space and take the fallback path
+void BM_WriteStringLong(benchmark::State &state) {
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  SerialCLI_InitWithStorage(&cli, &storage.storage, noopWrite, nullptr);
+  const char *text = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+  for (auto _ : state) {
+    SerialCLI_WriteString(&cli, "%s\r\n", text);
+  }
+  SerialCLI_Deinit(&cli);
+}
+
+// Transport taking at most the given number of bytes per call, like a UART FIFO
+size_t partialWrite(void *context, const char *, size_t len) {
+  size_t fifoSize = *static_cast<size_t *>(context);
+  return (len < fifoSize) ? len : fifoSize;
+}
+
+// Output streamed through the TX ring, the transport takes it in FIFO sized pieces
+void BM_WriteNonBlocking(benchmark::State &state) {
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  static char txRing[1024];
+  size_t fifoSize = (size_t)state.range(0);
+  SerialCLI_InitNonBlocking(&cli, &storage.storage, partialWrite, &fifoSize, txRing, sizeof(txRing));
+
+  for (auto _ : state) {
+    while (SerialCLI_GetTxSpace(&cli) < 32) {
+      SerialCLI_TxReady(&cli);
+    }
+    SerialCLI_WriteString(&cli, "  %s - %d\r\n", "adc", 4095);
+    SerialCLI_Flush(&cli);
+  }
+  SerialCLI_Deinit(&cli);
+}
+
+} // namespace
+
+BENCHMARK(BM_WriteStringLiteral);
+BENCHMARK(BM_WriteStringFormatted);
+BENCHMARK(BM_WriteStringLong);
+BENCHMARK(BM_WriteNonBlocking)->Arg(16)->Arg(1024);
@@ -0,0 +1,47 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "serial_cli.hpp"
+#include "serial_cli_parser.h"
+
+namespace {
+
+void noopWrite(void *, const char *, size_t) {}
+
+std::string makeLine(int64_t argumentCount, bool isQuoted) {
+  std::string line = "command";
+  for (int64_t i = 0; i < argumentCount; ++i) {
+    line += isQuoted ? " \"quoted argument\"" : " argument";
+  }
+  return line;
+}
+
+using Parser = const char *(*)(SerialCLI *, char *, size_t);
+
+void parseLines(benchmark::State &state, bool isQuoted, Parser parse = SerialCLI_ParseInput) {
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  SerialCLI_InitWithStorage(&cli, &storage.storage, noopWrite, nullptr);
+  const std::string line = makeLine(state.range(0), isQuoted);
+  std::string buffer = line;
+
+  for (auto _ : state) {
+    // The parser splits in place, every iteration starts from a fresh copy
+    buffer.assign(line);
+    benchmark::DoNotOptimize(parse(&cli, buffer.data(), buffer.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * (int64_t)line.size());
+}
+
+void BM_ParseInput(benchmark::State &state) { parseLines(state, false); }
+
+void BM_ParseInputQuoted(benchmark::State &state) { parseLines(state, true); }
+
+void BM_ParseInputReference(benchmark::State &state) { parseLines(state, false, SerialCLI_ParseInputReference); }
+
+} // namespace
+
+BENCHMARK(BM_ParseInput)->DenseRange(0, SERIAL_CLI_COMMAND_MAX_ARGS - 1, 1);
+BENCHMARK(BM_ParseInputQuoted)->DenseRange(0, SERIAL_CLI_COMMAND_MAX_ARGS - 1, 1);
+BENCHMARK(BM_ParseInputReference)->DenseRange(0, SERIAL_CLI_COMMAND_MAX_ARGS - 1, 1);
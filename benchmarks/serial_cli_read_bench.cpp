@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "serial_cli.hpp"
+
+namespace {
+
+void noopWrite(void *, const char *, size_t) {}
+
+void noopCommand(SerialCLI *, int, const char **) {}
+
+class ReadFixture : public benchmark::Fixture {
+public:
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  SerialCLI_CommandEntry commandEntry{};
+
+  void SetUp(const benchmark::State &) override {
+    SerialCLI_InitWithStorage(&cli, &storage.storage, noopWrite, nullptr);
+    commandEntry.command = noopCommand;
+    commandEntry.commandName = "set";
+    SerialCLI_RegisterCommand(&cli, &commandEntry);
+  }
+
+  void TearDown(const benchmark::State &) override { SerialCLI_Deinit(&cli); }
+
+  void processAll() {
+    while (SerialCLI_IsCommandPending(&cli)) {
+      SerialCLI_Process(&cli);
+    }
+  }
+};
+
+const std::string line = "set gpio 12 high\r";
+
+// Interrupt driven UARTs hand over one byte at a time
+BENCHMARK_F(ReadFixture, BM_ReadByteAtATime)(benchmark::State &state) {
+  for (auto _ : state) {
+    for (char ch : line) {
+      SerialCLI_Read(&cli, &ch, 1);
+    }
+    processAll();
+  }
+  state.SetBytesProcessed(state.iterations() * (int64_t)line.size());
+}
+
+// DMA driven UARTs hand over a whole buffer of lines at once
+BENCHMARK_DEFINE_F(ReadFixture, BM_ReadBulk)(benchmark::State &state) {
+  std::string chunk;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    chunk += line;
+  }
+
+  for (auto _ : state) {
+    SerialCLI_Read(&cli, chunk.data(), chunk.size());
+    processAll();
+  }
+  state.SetBytesProcessed(state.iterations() * (int64_t)chunk.size());
+}
+BENCHMARK_REGISTER_F(ReadFixture, BM_ReadBulk)->Arg(1)->Arg(8)->Arg(32);
+
+// Provisioning scripts run without echo and prompt
+BENCHMARK_DEFINE_F(ReadFixture, BM_ExecuteBatch)(benchmark::State &state) {
+  std::string script;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    script += line;
+  }
+
+  for (auto _ : state) {
+    SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), false, nullptr);
+  }
+  state.SetBytesProcessed(state.iterations() * (int64_t)script.size());
+}
+BENCHMARK_REGISTER_F(ReadFixture, BM_ExecuteBatch)->Arg(32);
+
+// Walking up and down a full history ring, each step costs the same
+BENCHMARK_F(ReadFixture, BM_HistoryRecall)(benchmark::State &state) {
+  for (int i = 0; i < 32; ++i) {
+    std::string input = "set gpio " + std::to_string(i) + " high\r";
+    SerialCLI_Read(&cli, input.data(), input.size());
+    processAll();
+  }
+
+  const std::string keys = "\x1b[A\x1b[A\x1b[A\x1b[A\x1b[B\x1b[B\x1b[B\x1b[B";
+  for (auto _ : state) {
+    SerialCLI_Read(&cli, keys.data(), keys.size());
+  }
+  state.SetItemsProcessed(state.iterations() * 8);
+}
+
+// Correcting a typo at the start of a long line, the counters show the bytes a 9600 baud link carries
+BENCHMARK_F(ReadFixture, BM_EditMidLine)(benchmark::State &state) {
+  const std::string typed = "set gpio 12 high";
+  SerialCLI_Read(&cli, typed.data(), typed.size());
+
+  const std::string keys = "\x1b[H\x1b[C\x1b[3~e\x1b[F";
+  for (auto _ : state) {
+    SerialCLI_Read(&cli, keys.data(), keys.size());
+  }
+
+  SerialCLI_EditStats stats;
+  SerialCLI_GetEditStats(&cli, &stats);
+  state.counters["bytes_per_edit"] = (double)stats.bytesWritten / (double)stats.editCount;
+  state.counters["redraw_bytes_per_edit"] = (double)(stats.bytesWritten + stats.bytesSaved) / (double)stats.editCount;
+}
+
+} // namespace
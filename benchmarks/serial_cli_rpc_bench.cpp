@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include "serial_cli.hpp"
+#include "serial_cli_rpc.h"
+
+namespace {
+
+void noopWrite(void *, const char *, size_t) {}
+
+void okCommand(SerialCLI *cli, int, const char **) { SerialCLI_WriteString(cli, "ok"); }
+
+class RpcFixture : public benchmark::Fixture {
+public:
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli{};
+  SerialCLI_CommandEntry commandEntry{};
+
+  void SetUp(const benchmark::State &) override {
+    SerialCLI_InitWithStorage(&cli, &storage.storage, noopWrite, nullptr);
+    commandEntry.command = okCommand;
+    commandEntry.commandName = "set";
+    SerialCLI_RegisterCommand(&cli, &commandEntry);
+  }
+
+  void TearDown(const benchmark::State &) override { SerialCLI_Deinit(&cli); }
+
+  void processAll() {
+    while (SerialCLI_IsCommandPending(&cli)) {
+      SerialCLI_Process(&cli);
+    }
+  }
+};
+
+// The same command as text with echo and prompt and as pipelined RPC requests
+BENCHMARK_DEFINE_F(RpcFixture, BM_TextCommands)(benchmark::State &state) {
+  std::string chunk;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    chunk += "set gpio 12 high\r";
+  }
+
+  for (auto _ : state) {
+    SerialCLI_Read(&cli, chunk.data(), chunk.size());
+    processAll();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_REGISTER_F(RpcFixture, BM_TextCommands)->Arg(1)->Arg(8);
+
+BENCHMARK_DEFINE_F(RpcFixture, BM_RpcRequests)(benchmark::State &state) {
+  SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_RPC);
+  uint32_t setId = 0;
+  SerialCLI_RpcGetCommandId(&cli, "set", &setId);
+  const char *argv[] = {"gpio", "12", "high"};
+  std::string chunk;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    char frame[64];
+    size_t length = SerialCLI_RpcEncodeRequest(frame, sizeof(frame), (uint16_t)i, setId, 3, argv);
+    chunk.append(frame, length);
+  }
+
+  for (auto _ : state) {
+    SerialCLI_Read(&cli, chunk.data(), chunk.size());
+    processAll();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_REGISTER_F(RpcFixture, BM_RpcRequests)->Arg(1)->Arg(8);
+
+} // namespace
@@ -1,58 +1,23 @@
-#include "serial_cli.h"
+#include "serial_cli.hpp"
+#include "serial_cli_capture.h"
+#include "serial_cli_host.h"
 
-#include <atomic>
-#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
-#include <mutex>
-#include <stdio.h>
-#include <string>
 #include <termios.h>
-#include <thread>
-#include <unistd.h>
-
-using namespace std::chrono_literals;
 
 namespace {
 
+serial_cli::DefaultStorage storage;
 SerialCLI cli;
+SerialCLI_Host host;
+SerialCLI_Capture capture;
 SerialCLI_CommandEntry commandEntry;
 
-// Global flag to signal threads to stop
-std::atomic<bool> stopFlag(false);
-std::mutex mutex;
-
-// Structures to save the terminal settings for original settings & raw mode
-struct termios originalStdin;
-struct termios rawStdin;
-
-void consoleWrite(const char *str, size_t len) { write(STDOUT_FILENO, str, len); }
-
-void consoleRead(void) {
-  while (!stopFlag) {
-    char c;
-    if (read(STDIN_FILENO, &c, 1) > 0) {
-      // Exit the program when Ctrl+C is pressed (ASCII ETX character)
-      constexpr int CTRL_C = 3;
-      if (c == CTRL_C) {
-        std::cout << "\nReceived Ctrl+C, shutting down..." << std::endl;
-        stopFlag = true;
-      }
-
-      if (std::unique_lock<std::mutex> lock(mutex, std::try_to_lock); lock.owns_lock()) {
-        SerialCLI_Read(&cli, &c, 1);
-      }
-    }
-  }
-}
-
-void process(void) {
-  while (!stopFlag) {
-    if (std::unique_lock<std::mutex> lock(mutex, std::try_to_lock); lock.owns_lock()) {
-      SerialCLI_Process(&cli);
-    }
-    std::this_thread::sleep_for(10ms);
-  }
-}
+// Ctrl+C raises SIGINT, which ends the event loop
+void onInterrupt(int) { SerialCLI_HostStop(&host); }
 
 void exampleCommand(SerialCLI *cli, int argc, const char **argv) {
   if (argc <= 1) {
@@ -66,48 +31,93 @@ void exampleCommand(SerialCLI *cli, int argc, const char **argv) {
   SerialCLI_WriteString(cli, "\r\n");
 }
 
-} // namespace
+void registerCommands() {
+  commandEntry.command = exampleCommand;
+  commandEntry.commandName = "example";
+  commandEntry.commandDescription = "Example command.";
+  SerialCLI_RegisterCommand(&cli, &commandEntry);
+}
 
-int main() {
-  // Backup the terminal settings, and switch to raw mode
-  if (tcgetattr(STDIN_FILENO, &originalStdin) != 0) {
-    std::cerr << "Failed to get terminal attributes" << std::endl;
+// Feeds a capture through a fresh instance with the same commands and reports the differences
+int replay(const char *path, bool isPaced) {
+  SerialCLI_InitWithStorage(&cli, &storage.storage, [](void *, const char *, size_t) {}, nullptr);
+  registerCommands();
+
+  SerialCLI_ReplayResult result;
+  bool isMatching = SerialCLI_Replay(&cli, path, isPaced, &result);
+  SerialCLI_Deinit(&cli);
+
+  double seconds = (double)result.elapsedUs / 1e6;
+  std::cout << result.lineCount << " lines, " << result.inputBytes << " bytes in " << seconds << " s, "
+            << ((seconds > 0.0) ? ((double)result.lineCount / seconds) : 0.0) << " lines/s\n"
+            << "latency p50 " << SerialCLI_ReplayGetPercentile(&result, 50) << " us, p99 "
+            << SerialCLI_ReplayGetPercentile(&result, 99) << " us, max " << result.latencyMaxUs << " us\n";
+  if (!isMatching && (SIZE_MAX == result.mismatchOffset)) {
+    std::cout << "Cannot read the capture " << path << "\n";
+    return 1;
+  }
+  if (!isMatching) {
+    std::cout << "Output differs at byte " << result.mismatchOffset << " of " << result.expectedOutputBytes << "\n";
     return 1;
   }
+  return 0;
+}
 
-  rawStdin = originalStdin;
-  cfmakeraw(&rawStdin);
+} // namespace
 
-  if (tcsetattr(STDIN_FILENO, TCSANOW, &rawStdin) != 0) {
-    std::cerr << "Failed to set terminal to raw mode" << std::endl;
-    return 1;
+// Usage: serial_cli_examples [--capture <file> | --replay <file> [--paced]]
+int main(int argc, char **argv) {
+  const char *capturePath = nullptr;
+  const char *replayPath = nullptr;
+  bool isPaced = false;
+  for (int i = 1; i < argc; ++i) {
+    if ((std::strcmp(argv[i], "--capture") == 0) && (i + 1 < argc)) {
+      capturePath = argv[++i];
+    } else if ((std::strcmp(argv[i], "--replay") == 0) && (i + 1 < argc)) {
+      replayPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--paced") == 0) {
+      isPaced = true;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--capture <file> | --replay <file> [--paced]]" << std::endl;
+      return 2;
+    }
+  }
+  if (nullptr != replayPath) {
+    return replay(replayPath, isPaced);
   }
 
-  int ret = 0;
-  try {
-    std::cout << "Press CTRL+c to exit" << std::endl;
+  // Open the controlling terminal in raw mode, the settings are restored by SerialCLI_HostClose
+  if (!SerialCLI_HostOpenTTY(&host, &cli, "/dev/tty", 115200)) {
+    std::cerr << "Failed to open the terminal" << std::endl;
+    return 1;
+  }
 
-    SerialCLI_Init(&cli, consoleWrite);
+  // Keep Ctrl+C as a signal in raw mode
+  struct termios settings;
+  if (tcgetattr(host.ownedFd, &settings) == 0) {
+    settings.c_lflag |= ISIG;
+    tcsetattr(host.ownedFd, TCSANOW, &settings);
+  }
+  std::signal(SIGINT, onInterrupt);
 
-    commandEntry.command = exampleCommand;
-    commandEntry.commandName = "example";
-    commandEntry.commandDescription = "Example command.";
-    SerialCLI_RegisterCommand(&cli, &commandEntry);
+  std::cout << "Press CTRL+c to exit" << std::endl;
 
-    std::thread consoleReadThread(consoleRead);
-    std::thread processThread(process);
+  SerialCLI_InitWithStorage(&cli, &storage.storage, SerialCLI_HostWrite, &host);
+  registerCommands();
 
-    consoleReadThread.join();
-    processThread.join();
-  } catch (const std::exception &ex) {
-    std::cerr << "Exception: " << ex.what() << std::endl;
-    ret = 1;
-  } catch (...) {
-    std::cerr << "Unknown exception occurred." << std::endl;
-    ret = 1;
+  // Records the session for --replay
+  if ((nullptr != capturePath) && !SerialCLI_CaptureOpen(&capture, &cli, capturePath)) {
+    std::cerr << "Failed to open the capture" << std::endl;
   }
 
-  // Restore terminal settings
-  tcsetattr(STDIN_FILENO, TCSANOW, &originalStdin);
-  return ret;
+  // Sleeps in epoll until input arrives, commands run as soon as their line is complete
+  SerialCLI_HostRun(&host);
+
+  if (nullptr != capturePath) {
+    SerialCLI_CaptureClose(&capture);
+  }
+  SerialCLI_Deinit(&cli);
+  SerialCLI_HostClose(&host);
+  std::cout << "\r\nShutting down..." << std::endl;
+  return 0;
 }
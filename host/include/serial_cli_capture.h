@@ -0,0 +1,132 @@
+#ifndef SERIAL_CLI_CAPTURE_H
+#define SERIAL_CLI_CAPTURE_H
+
+#include "serial_cli.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  SERIAL_CLI_CAPTURE_BUFFER_SIZE = 4096, ///< Records collected before they are written to the file.
+  SERIAL_CLI_REPLAY_BUCKET_COUNT = 32,   ///< Latency histogram buckets, see @ref SerialCLI_ReplayResult.
+};
+
+/*
+ * Capture file of the bytes crossing the link of one instance.
+ *
+ * The file starts with the 8 byte magic "SCLICAP1" followed by one record
+ * per input chunk and output write:
+ *
+ * Record: direction (1) | time delta (varint) | length (varint) | bytes
+ *
+ * The direction is a @ref SerialCLI_MonitorDirection, the time delta is the
+ * number of microseconds since the previous record on the monotonic clock.
+ * Varints are unsigned LEB128, so a record of a typed character takes 4 bytes.
+ */
+
+/**
+ * Recorder writing the traffic of a SerialCLI instance to a capture file.
+ */
+typedef struct SerialCLI_Capture {
+  SerialCLI *cli;                              ///< The recorded instance.
+  int fd;                                      ///< The capture file.
+  uint64_t lastTimestampUs;                    ///< Monotonic time of the previous record.
+  size_t recordCount;                          ///< Records captured so far.
+  size_t length;                               ///< The number of bytes in the buffer.
+  bool isFailed;                               ///< Flag indicating if a write to the file failed.
+  char buffer[SERIAL_CLI_CAPTURE_BUFFER_SIZE]; ///< Records not written to the file yet.
+} SerialCLI_Capture;
+
+/**
+ * Summary of a replay, see @ref SerialCLI_Replay.
+ *
+ * The latency of a line is measured from the input completing it, or from
+ * the end of the previous line, until its outcome is reported. Bucket n
+ * counts the lines that took less than 2^n microseconds and do not fit a
+ * lower bucket, the last bucket counts all longer lines.
+ */
+typedef struct SerialCLI_ReplayResult {
+  size_t inputBytes;                                       ///< Bytes fed to @ref SerialCLI_Read.
+  size_t outputBytes;                                      ///< Bytes written by the replayed instance.
+  size_t expectedOutputBytes;                              ///< Output bytes in the capture.
+  size_t mismatchOffset;                                   ///< First differing output byte, SIZE_MAX if none.
+  size_t lineCount;                                        ///< Lines executed.
+  uint64_t elapsedUs;                                      ///< Duration of the replay.
+  uint64_t latencyTotalUs;                                 ///< Sum of the line latencies.
+  uint64_t latencyMaxUs;                                   ///< Longest line latency.
+  size_t latencyHistogram[SERIAL_CLI_REPLAY_BUCKET_COUNT]; ///< Lines per latency bucket.
+} SerialCLI_ReplayResult;
+
+/**
+ * Start recording a SerialCLI instance into a capture file.
+ *
+ * The file is created or truncated. Open the capture right after the
+ * instance is initialized, the recording replaces its monitor.
+ *
+ * @param capture The capture instance.
+ * @param cli The SerialCLI instance.
+ * @param path Path of the capture file.
+ *
+ * @return true if the capture was opened successfully, false otherwise.
+ */
+bool SerialCLI_CaptureOpen(SerialCLI_Capture *capture, SerialCLI *cli, const char *path);
+
+/**
+ * Write the buffered records to the capture file.
+ *
+ * @param capture The capture instance.
+ *
+ * @return true if every record so far reached the file, false otherwise.
+ */
+bool SerialCLI_CaptureFlush(SerialCLI_Capture *capture);
+
+/**
+ * Stop recording, write the buffered records and close the file.
+ *
+ * @param capture The capture instance.
+ *
+ * @return true if every record reached the file, false otherwise.
+ */
+bool SerialCLI_CaptureClose(SerialCLI_Capture *capture);
+
+/**
+ * Feed a capture file back through a SerialCLI instance.
+ *
+ * The instance must be set up like the recorded one, with the same commands
+ * and mode, and must not have received input yet. Every input chunk is
+ * passed to @ref SerialCLI_Read, the lines are executed and the output is
+ * compared with the recorded one. Paced, each chunk is fed at its recorded
+ * time while a deferred command keeps running. Otherwise a chunk is fed as
+ * soon as the instance is idle or, while a deferred command is running, once
+ * the output recorded before the chunk was written or differs, so the result
+ * does not depend on the speed of the machine.
+ *
+ * @param cli The SerialCLI instance.
+ * @param path Path of the capture file.
+ * @param isPaced Keep the recorded timing, otherwise replay as fast as possible.
+ * @param result The summary to fill, may be NULL.
+ *
+ * @return true if the capture was read and the output matches it, false otherwise.
+ */
+bool SerialCLI_Replay(SerialCLI *cli, const char *path, bool isPaced, SerialCLI_ReplayResult *result);
+
+/**
+ * Estimate a percentile of the line latencies of a replay.
+ *
+ * @param result The summary filled by @ref SerialCLI_Replay.
+ * @param percent The percentile, 1 to 100.
+ *
+ * @return The upper bound of the bucket holding the percentile in microseconds, 0 without lines.
+ */
+uint64_t SerialCLI_ReplayGetPercentile(const SerialCLI_ReplayResult *result, unsigned percent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_CAPTURE_H
@@ -0,0 +1,174 @@
+#ifndef SERIAL_CLI_EXECUTOR_H
+#define SERIAL_CLI_EXECUTOR_H
+
+#include "serial_cli.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  SERIAL_CLI_EXECUTOR_QUEUE_SIZE = 64,    ///< Jobs waiting in the queue of one worker.
+  SERIAL_CLI_EXECUTOR_OUTPUT_SIZE = 1024, ///< Output a job buffers until its instance takes it.
+};
+
+// Forward declaration
+typedef struct SerialCLI_Executor SerialCLI_Executor;
+
+/**
+ * One command handed to the executor.
+ *
+ * The arguments are copied, the line they point into is gone once the
+ * command is deferred. The output waits in a ring until the instance the
+ * command was started from takes it, so every instance receives the output
+ * of its commands in order however many workers run.
+ */
+typedef struct SerialCLI_Job {
+  struct SerialCLI_Job *next;                        ///< Next free or ready job.
+  SerialCLI_Executor *executor;                      ///< The executor owning the job.
+  SerialCLI *cli;                                    ///< The instance the command was started from.
+  void *context;                                     ///< The context of the instance, handed to the command.
+  SerialCLI_Command command;                         ///< The command function.
+  int argc;                                          ///< The number of arguments.
+  const char *argv[SERIAL_CLI_COMMAND_MAX_ARGS + 1]; ///< Arguments, pointing into arguments.
+  char arguments[SERIAL_CLI_INPUT_BUFFER_SIZE + 1];  ///< Copies of the arguments.
+  char output[SERIAL_CLI_EXECUTOR_OUTPUT_SIZE];      ///< Output not taken by the instance yet.
+  size_t outputStart;                                ///< Ring offset of the oldest output byte.
+  size_t outputLength;                               ///< The number of output bytes.
+  bool isDone;                                       ///< Flag indicating if the command returned.
+  bool isFailed;                                     ///< Flag indicating if the command reported an error.
+  bool isReady;                                      ///< Flag indicating if the job is in the ready list.
+  bool isAbandoned;                                  ///< Flag indicating if the instance no longer waits.
+} SerialCLI_Job;
+
+/**
+ * Thread of the executor with its own queue of jobs.
+ *
+ * Every command runs on a private SerialCLI instance of the worker that
+ * shares the user context of the instance the command was started from.
+ */
+typedef struct SerialCLI_Worker {
+  SerialCLI_Executor *executor;                         ///< The executor owning the worker.
+  pthread_t thread;                                     ///< The thread of the worker.
+  pthread_mutex_t queueLock;                            ///< Guards the queue, taken by the owner and by thieves.
+  SerialCLI_Job *queue[SERIAL_CLI_EXECUTOR_QUEUE_SIZE]; ///< Ring of waiting jobs.
+  size_t queueStart;                                    ///< Ring offset of the oldest job.
+  size_t queueLength;                                   ///< The number of waiting jobs.
+  SerialCLI_Job *job;                                   ///< The running job, NULL if none.
+  SerialCLI cli;                                        ///< The instance the commands run on.
+  char inputBuffer[3];                                  ///< Only takes the Ctrl+C cancelling a deferred command.
+  const char *argv[2];                                  ///< Argument pointers of the instance.
+  char txBuffer[SERIAL_CLI_TX_BUFFER_SIZE + 1];         ///< Output on its way to the job.
+} SerialCLI_Worker;
+
+/**
+ * Pool of threads running the commands of any number of SerialCLI instances.
+ *
+ * Commands of an attached instance are queued on the workers round robin,
+ * an idle worker steals the oldest job of a busy one. The instance keeps
+ * the command deferred until its job completes and writes the output of the
+ * job from its own thread, lines of one instance run one after another.
+ * Workers and jobs come from caller provided pools, so the executor never
+ * allocates.
+ */
+struct SerialCLI_Executor {
+  SerialCLI_Worker *workers;    ///< Worker pool.
+  size_t workerCount;           ///< Number of workers.
+  size_t nextWorker;            ///< Worker queuing the next job.
+  size_t queuedCount;           ///< Jobs queued but not taken by any worker yet.
+  SerialCLI_Job *freeJobs;      ///< List of free jobs.
+  SerialCLI_Job *readyJobs;     ///< Jobs with new output or completed, oldest first.
+  SerialCLI_Job *readyJobsTail; ///< Last ready job.
+  pthread_mutex_t lock;         ///< Guards everything but the worker queues.
+  pthread_cond_t workAvailable; ///< Signalled when a job is queued.
+  pthread_cond_t outputDrained; ///< Signalled when an instance took output of a job.
+  int eventFd;                  ///< eventfd readable while jobs are ready.
+  size_t startedCount;          ///< Number of worker threads started.
+  bool isStopRequested;         ///< Flag set by @ref SerialCLI_ExecutorClose.
+};
+
+/**
+ * Initialize the executor and start its workers.
+ *
+ * @param executor The executor instance.
+ * @param workers The worker pool, one thread per worker.
+ * @param workerCount The number of workers.
+ * @param jobs The job pool, commands run right away while all jobs are taken.
+ * @param jobCapacity The number of jobs, at most workerCount * SERIAL_CLI_EXECUTOR_QUEUE_SIZE.
+ *
+ * @return true if the workers were started, false otherwise.
+ */
+bool SerialCLI_ExecutorInit(SerialCLI_Executor *executor, SerialCLI_Worker *workers, size_t workerCount,
+                            SerialCLI_Job *jobs, size_t jobCapacity);
+
+/**
+ * Run the commands of a SerialCLI instance on the executor.
+ *
+ * The built-in commands still run right away. Commands on a worker may write
+ * output, fail, defer and read the context with @ref SerialCLI_GetContext,
+ * other calls reach the private instance of the worker. Ctrl+C cancels a
+ * command deferred on the worker.
+ *
+ * @param executor The executor instance.
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if the instance was attached successfully, false otherwise.
+ */
+bool SerialCLI_ExecutorAttach(SerialCLI_Executor *executor, SerialCLI *cli);
+
+/**
+ * Get the descriptor that is readable while jobs are ready.
+ *
+ * Poll it next to the transports, read it and call
+ * @ref SerialCLI_ExecutorTakeReady until it returns NULL.
+ *
+ * @param executor The executor instance.
+ *
+ * @return The eventfd, -1 if executor is NULL.
+ */
+int SerialCLI_ExecutorGetFd(const SerialCLI_Executor *executor);
+
+/**
+ * Take an instance whose job has new output or completed.
+ *
+ * The caller continues it with @ref SerialCLI_Process, which writes the
+ * output and completes the command.
+ *
+ * @param executor The executor instance.
+ *
+ * @return The instance, NULL if no job is ready.
+ */
+SerialCLI *SerialCLI_ExecutorTakeReady(SerialCLI_Executor *executor);
+
+/**
+ * Check if a SerialCLI instance waits for a job of an executor.
+ *
+ * Such an instance needs @ref SerialCLI_Process only once
+ * @ref SerialCLI_ExecutorTakeReady returns it or its output has room again.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if the running command is a job, false otherwise.
+ */
+bool SerialCLI_ExecutorIsWaiting(const SerialCLI *cli);
+
+/**
+ * Stop the workers and wait for them to exit.
+ *
+ * The attached instances must be deinitialized first.
+ *
+ * @param executor The executor instance.
+ *
+ * @return true if the executor was closed successfully, false otherwise.
+ */
+bool SerialCLI_ExecutorClose(SerialCLI_Executor *executor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_EXECUTOR_H
@@ -0,0 +1,162 @@
+#ifndef SERIAL_CLI_HOST_H
+#define SERIAL_CLI_HOST_H
+
+#include "serial_cli.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <termios.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  SERIAL_CLI_HOST_READ_CHUNK_SIZE = 256, ///< Bytes handed to SerialCLI_Read per read() call.
+};
+
+/**
+ * Event loop attaching a SerialCLI to a file descriptor on Linux.
+ *
+ * Input is read in chunks when epoll reports the descriptor readable and
+ * @ref SerialCLI_Process only runs while a complete line is pending, so an
+ * idle CLI does not wake up at all.
+ */
+typedef struct SerialCLI_Host {
+  SerialCLI *cli;                 ///< The attached SerialCLI instance.
+  int inputFd;                    ///< Descriptor the input is read from.
+  int outputFd;                   ///< Descriptor the output is written to.
+  int ownedFd;                    ///< Descriptor opened by the host, -1 if attached.
+  int epollFd;                    ///< The epoll instance.
+  int wakeFd;                     ///< eventfd interrupting @ref SerialCLI_HostPoll.
+  int ptySlaveFd;                 ///< Slave side of an opened PTY, kept open so the master never hangs up.
+  bool isTerminalConfigured;      ///< Flag indicating if originalTermios must be restored.
+  bool isStopRequested;           ///< Flag set by @ref SerialCLI_HostStop.
+  struct termios originalTermios; ///< Terminal settings before the TTY was configured.
+} SerialCLI_Host;
+
+/**
+ * Write callback writing the output to the descriptor of a host.
+ *
+ * Pass it to @ref SerialCLI_InitWithContext with the host as context.
+ *
+ * @param context The host instance.
+ * @param str The string to write.
+ * @param len The length of the string.
+ */
+void SerialCLI_HostWrite(void *context, const char *str, size_t len);
+
+/**
+ * Attach a SerialCLI to already opened descriptors.
+ *
+ * The descriptors are switched to non-blocking mode, they are not closed by
+ * @ref SerialCLI_HostClose.
+ *
+ * @param host The host instance.
+ * @param cli The SerialCLI instance.
+ * @param inputFd Descriptor the input is read from.
+ * @param outputFd Descriptor the output is written to, may equal inputFd.
+ *
+ * @return true if the host was attached successfully, false otherwise.
+ */
+bool SerialCLI_HostAttach(SerialCLI_Host *host, SerialCLI *cli, int inputFd, int outputFd);
+
+/**
+ * Open a TTY in raw mode and attach a SerialCLI to it.
+ *
+ * @param host The host instance.
+ * @param cli The SerialCLI instance.
+ * @param path Path of the TTY device, e.g. "/dev/ttyUSB0".
+ * @param baudRate Baud rate, one of the standard rates from 1200 to 4000000.
+ *
+ * @return true if the TTY was opened successfully, false otherwise.
+ */
+bool SerialCLI_HostOpenTTY(SerialCLI_Host *host, SerialCLI *cli, const char *path, unsigned baudRate);
+
+/**
+ * Open a pseudo terminal and attach a SerialCLI to its master side.
+ *
+ * Terminal programs and test rigs connect to the slave side.
+ *
+ * @param host The host instance.
+ * @param cli The SerialCLI instance.
+ * @param slaveName Buffer receiving the path of the slave side.
+ * @param slaveNameSize The size of the buffer.
+ *
+ * @return true if the PTY was opened successfully, false otherwise.
+ */
+bool SerialCLI_HostOpenPTY(SerialCLI_Host *host, SerialCLI *cli, char *slaveName, size_t slaveNameSize);
+
+/**
+ * Connect to a unix stream socket and attach a SerialCLI to it.
+ *
+ * @param host The host instance.
+ * @param cli The SerialCLI instance.
+ * @param path Path of the socket.
+ *
+ * @return true if the socket was connected successfully, false otherwise.
+ */
+bool SerialCLI_HostConnectUnix(SerialCLI_Host *host, SerialCLI *cli, const char *path);
+
+/**
+ * Wait for input and process all lines completed by it.
+ *
+ * While a deferred command is running the call does not wait, it continues
+ * the command once after checking for input.
+ *
+ * @param host The host instance.
+ * @param timeoutMs Maximum time to wait in milliseconds, -1 waits indefinitely.
+ *
+ * @return true if the host is still usable, false on error, end of input or stop request.
+ */
+bool SerialCLI_HostPoll(SerialCLI_Host *host, int timeoutMs);
+
+/**
+ * Run @ref SerialCLI_HostPoll until the input ends or a stop is requested.
+ *
+ * @param host The host instance.
+ *
+ * @return true if the loop was stopped by @ref SerialCLI_HostStop, false otherwise.
+ */
+bool SerialCLI_HostRun(SerialCLI_Host *host);
+
+/**
+ * Request @ref SerialCLI_HostRun to return.
+ *
+ * Safe to call from other threads and from signal handlers.
+ *
+ * @param host The host instance.
+ *
+ * @return true if the stop was requested successfully, false otherwise.
+ */
+bool SerialCLI_HostStop(SerialCLI_Host *host);
+
+/**
+ * Execute a script file with @ref SerialCLI_ExecuteBatch.
+ *
+ * The file is mapped into memory instead of being copied, so scripts of any
+ * size run without an intermediate buffer.
+ *
+ * @param cli The SerialCLI instance.
+ * @param path Path of the script file.
+ * @param isStopOnError Stop after the first line that fails.
+ * @param result The summary to fill, may be NULL.
+ *
+ * @return true if the file was read and every line succeeded, false otherwise.
+ */
+bool SerialCLI_HostRunScript(SerialCLI *cli, const char *path, bool isStopOnError, SerialCLI_BatchResult *result);
+
+/**
+ * Restore the terminal settings and release the descriptors opened by the host.
+ *
+ * @param host The host instance.
+ *
+ * @return true if the host was closed successfully, false otherwise.
+ */
+bool SerialCLI_HostClose(SerialCLI_Host *host);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_HOST_H
@@ -0,0 +1,222 @@
+#ifndef SERIAL_CLI_SERVER_H
+#define SERIAL_CLI_SERVER_H
+
+#include "serial_cli.h"
+#include "serial_cli_executor.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/un.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+  SERIAL_CLI_SERVER_TX_RING_SIZE = 1024,   ///< Output a session keeps while its client does not take it.
+  SERIAL_CLI_SERVER_EVENT_BATCH_SIZE = 64, ///< Events handled per epoll_wait call.
+};
+
+// Forward declaration
+typedef struct SerialCLI_Server SerialCLI_Server;
+
+/**
+ * One client of the server with its own SerialCLI instance.
+ *
+ * Commands reach their session through @ref SerialCLI_GetContext. Output
+ * the client does not take right away waits in the TX ring of the session,
+ * so a slow client never stalls the other sessions. The instance works on
+ * the default sized buffers of the session, so the server also runs in
+ * builds without SERIAL_CLI_EMBEDDED_STORAGE.
+ */
+typedef struct SerialCLI_Session {
+  SerialCLI cli;                  ///< The SerialCLI instance of the session.
+  SerialCLI_Server *server;       ///< The server owning the session.
+  struct SerialCLI_Session *next; ///< Next free or running session, set automatically.
+  int fd;                         ///< Descriptor of the client, -1 if the session is free.
+  int ptySlaveFd;                 ///< Slave side of a PTY opened by the server, -1 otherwise.
+  bool isClosing;                 ///< Flag indicating if the output failed and the session is closed after the event.
+  bool isRunning;                 ///< Flag indicating if the session is in the list of running sessions.
+  void *userContext;              ///< Free for use by the commands.
+  uint32_t events;                ///< Events the session is polled for.
+
+  char txRing[SERIAL_CLI_SERVER_TX_RING_SIZE];         ///< Output the client did not take yet.
+  char inputBuffer[SERIAL_CLI_INPUT_BUFFER_SIZE + 1];  ///< Queued lines and current line of the instance.
+  const char *argv[SERIAL_CLI_COMMAND_MAX_ARGS + 1];   ///< Argument pointers of the instance.
+  char txBuffer[SERIAL_CLI_TX_BUFFER_SIZE + 1];        ///< Output on its way to the TX ring.
+  char historyBuffer[SERIAL_CLI_HISTORY_SIZE];         ///< History ring of the instance.
+  char filterLine[SERIAL_CLI_FILTER_LINE_SIZE];        ///< Output line collected for the filters.
+  char filterPatterns[SERIAL_CLI_FILTER_PATTERN_SIZE]; ///< grep patterns of the running command.
+} SerialCLI_Session;
+
+/**
+ * Callback function notified when a session is opened or closed.
+ *
+ * @param context The context passed to @ref SerialCLI_ServerInit.
+ * @param session The session.
+ */
+typedef void (*SerialCLI_SessionCallback)(void *context, SerialCLI_Session *session);
+
+/**
+ * Event loop serving many SerialCLI sessions on a single thread.
+ *
+ * Sessions come from a caller provided pool, so the server never allocates.
+ */
+struct SerialCLI_Server {
+  SerialCLI_Session *sessions;            ///< Session pool.
+  size_t sessionCapacity;                 ///< Number of sessions in the pool.
+  size_t sessionCount;                    ///< Number of open sessions.
+  SerialCLI_Session *freeSessions;        ///< List of free sessions.
+  SerialCLI_Session *runningSessions;     ///< List of sessions running a deferred command.
+  SerialCLI_SessionCallback onOpen;       ///< Called once a session is opened, may be NULL.
+  SerialCLI_SessionCallback onClose;      ///< Called before a session is closed, may be NULL.
+  void *context;                          ///< Context of the callbacks.
+  int epollFd;                            ///< The epoll instance.
+  int wakeFd;                             ///< eventfd interrupting @ref SerialCLI_ServerPoll.
+  int listenFd;                           ///< Listening unix socket, -1 if none.
+  bool isStopRequested;                   ///< Flag set by @ref SerialCLI_ServerStop.
+  struct sockaddr_un listenAddress;       ///< Address of the listening socket.
+  SerialCLI_Executor *executor;           ///< Runs the commands of the sessions, NULL if they run on the loop.
+  const SerialCLI_Registry *registry;     ///< Commands attached to every session, NULL if none.
+};
+
+/**
+ * Initialize the server.
+ *
+ * Every session attaches the registry of the caller, so opening a session
+ * does not register any command, whatever the number of shared commands.
+ * Sessions may register their own commands in the onOpen callback. The
+ * registry must remain valid until the server is closed.
+ *
+ * @param server The server instance.
+ * @param sessions The session pool.
+ * @param sessionCapacity The number of sessions in the pool.
+ * @param registry The sealed registry of the commands of every session, NULL if none.
+ *
+ * @return true if the initialization was successful, false otherwise, also if the registry is not sealed.
+ */
+bool SerialCLI_ServerInit(SerialCLI_Server *server, SerialCLI_Session *sessions, size_t sessionCapacity,
+                          const SerialCLI_Registry *registry);
+
+/**
+ * Set the callbacks notified when sessions are opened and closed.
+ *
+ * @param server The server instance.
+ * @param onOpen Called once a session is opened, may be NULL.
+ * @param onClose Called before a session is closed, may be NULL.
+ * @param context The context passed to the callbacks.
+ *
+ * @return true if the callbacks were set successfully, false otherwise.
+ */
+bool SerialCLI_ServerSetCallbacks(SerialCLI_Server *server, SerialCLI_SessionCallback onOpen,
+                                  SerialCLI_SessionCallback onClose, void *context);
+
+/**
+ * Run the commands of all sessions on a worker pool.
+ *
+ * The loop keeps reading input and writing output while the workers run
+ * the commands, each session receives the output of its commands in order.
+ * The executor must be closed after the server.
+ *
+ * @param server The server instance.
+ * @param executor The initialized executor.
+ *
+ * @return true if the executor was set successfully, false if one is set already.
+ */
+bool SerialCLI_ServerSetExecutor(SerialCLI_Server *server, SerialCLI_Executor *executor);
+
+/**
+ * Listen on a unix stream socket, every accepted client gets a session.
+ *
+ * An existing file at the path is replaced. Clients exceeding the pool are
+ * disconnected right away.
+ *
+ * @param server The server instance.
+ * @param path Path of the socket.
+ *
+ * @return true if the socket is listening, false otherwise.
+ */
+bool SerialCLI_ServerListenUnix(SerialCLI_Server *server, const char *path);
+
+/**
+ * Open a session on a connected descriptor.
+ *
+ * The server takes ownership of the descriptor and closes it with the session.
+ *
+ * @param server The server instance.
+ * @param fd The descriptor, used for input and output.
+ *
+ * @return The session, or NULL if the pool is exhausted or the descriptor cannot be polled.
+ */
+SerialCLI_Session *SerialCLI_ServerOpenSession(SerialCLI_Server *server, int fd);
+
+/**
+ * Open a session on a new pseudo terminal.
+ *
+ * @param server The server instance.
+ * @param slaveName Buffer receiving the path of the slave side.
+ * @param slaveNameSize The size of the buffer.
+ *
+ * @return The session, or NULL on failure.
+ */
+SerialCLI_Session *SerialCLI_ServerOpenPTY(SerialCLI_Server *server, char *slaveName, size_t slaveNameSize);
+
+/**
+ * Close a session and return it to the pool.
+ *
+ * @param server The server instance.
+ * @param session The session.
+ *
+ * @return true if the session was closed successfully, false otherwise.
+ */
+bool SerialCLI_ServerCloseSession(SerialCLI_Server *server, SerialCLI_Session *session);
+
+/**
+ * Wait for input and process all lines completed by it.
+ *
+ * While sessions run deferred commands the call does not wait, it continues
+ * each of them once after checking for input. A session whose client does
+ * not take its output is not read from until the output is written.
+ *
+ * @param server The server instance.
+ * @param timeoutMs Maximum time to wait in milliseconds, -1 waits indefinitely.
+ *
+ * @return true if the server is still running, false on error or stop request.
+ */
+bool SerialCLI_ServerPoll(SerialCLI_Server *server, int timeoutMs);
+
+/**
+ * Run @ref SerialCLI_ServerPoll until a stop is requested.
+ *
+ * @param server The server instance.
+ *
+ * @return true if the loop was stopped by @ref SerialCLI_ServerStop, false otherwise.
+ */
+bool SerialCLI_ServerRun(SerialCLI_Server *server);
+
+/**
+ * Request @ref SerialCLI_ServerRun to return.
+ *
+ * Safe to call from other threads and from signal handlers.
+ *
+ * @param server The server instance.
+ *
+ * @return true if the stop was requested successfully, false otherwise.
+ */
+bool SerialCLI_ServerStop(SerialCLI_Server *server);
+
+/**
+ * Close all sessions and the listening socket.
+ *
+ * @param server The server instance.
+ *
+ * @return true if the server was closed successfully, false otherwise.
+ */
+bool SerialCLI_ServerClose(SerialCLI_Server *server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_SERVER_H
@@ -0,0 +1,116 @@
+#ifndef SERIAL_CLI_HOST_INTERNAL_H_
+#define SERIAL_CLI_HOST_INTERNAL_H_
+
+#include "serial_cli.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <termios.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Function to switch a descriptor to non-blocking mode.
+ *
+ * @param fd The descriptor.
+ * @return true if the mode was set successfully, false otherwise.
+ */
+bool SerialCLI_HostSetNonBlocking(int fd);
+
+/**
+ * Function to switch a terminal to raw mode.
+ *
+ * @param fd The terminal descriptor.
+ * @param original Receives the previous settings, may be NULL.
+ * @return true if the settings were applied successfully, false otherwise.
+ */
+bool SerialCLI_HostMakeRaw(int fd, struct termios *original);
+
+/**
+ * Function to open a pseudo terminal with a raw slave side.
+ *
+ * @param masterFd Receives the master side.
+ * @param slaveFd Receives the slave side, keeping it open stops the master from hanging up.
+ * @param slaveName Buffer receiving the path of the slave side.
+ * @param slaveNameSize The size of the buffer.
+ * @return true if the PTY was opened successfully, false otherwise.
+ */
+bool SerialCLI_HostOpenPTYPair(int *masterFd, int *slaveFd, char *slaveName, size_t slaveNameSize);
+
+/**
+ * Function to advance a SerialCLI without new input.
+ *
+ * Calls the continuation of a running command once, then executes queued
+ * lines until none is left, one of them keeps running or the output is blocked.
+ *
+ * @param cli The SerialCLI instance.
+ */
+void SerialCLI_HostProcess(SerialCLI *cli);
+
+/**
+ * Function to read all available input of a descriptor into a SerialCLI.
+ *
+ * Every completed line is processed before the next chunk is read. While a
+ * deferred command is running or the output is blocked the input is left in
+ * the descriptor after the first chunk, it is read again on the next poll.
+ *
+ * @param cli The SerialCLI instance.
+ * @param fd The non-blocking descriptor.
+ * @return true once the descriptor is drained or a command is running, false at the end of the input or on error.
+ */
+bool SerialCLI_HostReadInput(SerialCLI *cli, int fd);
+
+/**
+ * Function to write as many bytes as a non-blocking descriptor takes without waiting.
+ *
+ * @param fd The descriptor.
+ * @param data The bytes.
+ * @param length The number of bytes.
+ * @param written Receives the number of bytes written, 0 if the descriptor is full.
+ * @return true if the bytes were written or the descriptor is full, false on error.
+ */
+bool SerialCLI_HostWriteSome(int fd, const char *data, size_t length, size_t *written);
+
+/**
+ * Function to write all bytes to a non-blocking descriptor.
+ *
+ * @param fd The descriptor.
+ * @param data The bytes.
+ * @param length The number of bytes.
+ * @param timeoutMs Maximum time to wait for the descriptor to become writable, -1 waits indefinitely.
+ * @return true if all bytes were written, false on error or timeout.
+ */
+bool SerialCLI_HostWriteAll(int fd, const char *data, size_t length, int timeoutMs);
+
+/**
+ * Function to map a file read-only into memory.
+ *
+ * @param path Path of the file.
+ * @param data Receives the contents, NULL for an empty file.
+ * @param length Receives the length of the file.
+ * @return true if the file was mapped or is empty, false otherwise.
+ */
+bool SerialCLI_HostMapFile(const char *path, const char **data, size_t *length);
+
+/**
+ * Function to unmap a file mapped by @ref SerialCLI_HostMapFile.
+ *
+ * @param data The contents, NULL for an empty file.
+ * @param length The length of the file.
+ */
+void SerialCLI_HostUnmapFile(const char *data, size_t length);
+
+/**
+ * Function to close a descriptor and mark it as closed.
+ *
+ * @param fd The descriptor, set to -1.
+ */
+void SerialCLI_HostCloseDescriptor(int *fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_HOST_INTERNAL_H_
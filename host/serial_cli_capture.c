@@ -0,0 +1,333 @@
+#include "serial_cli_capture.h"
+#include "serial_cli_host_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+  MAGIC_LENGTH = 8,
+  VARINT_MAX_LENGTH = 10, ///< Bytes of a 64 bit value in LEB128.
+};
+
+static const char captureMagic[MAGIC_LENGTH] = {'S', 'C', 'L', 'I', 'C', 'A', 'P', '1'};
+
+typedef struct {
+  uint8_t direction;
+  uint64_t deltaUs;
+  const char *data;
+  size_t length;
+} Record;
+
+typedef struct {
+  SerialCLI *cli;
+  SerialCLI_ReplayResult *result;
+  const char *capture;
+  size_t captureLength;
+  size_t expectedPosition; ///< Capture offset of the record following the expected output.
+  const char *expected;    ///< Recorded output not compared yet.
+  size_t expectedLength;
+  uint64_t lineStartUs;
+  SerialCLI_LineResultCallback userCallback;
+  void *userContext;
+} Replay;
+
+static uint64_t getTimeUs(void) {
+  struct timespec now;
+  (void)clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000U) + ((uint64_t)now.tv_nsec / 1000U);
+}
+
+static void sleepUntil(uint64_t timeUs) {
+  struct timespec deadline = {.tv_sec = (time_t)(timeUs / 1000000U), .tv_nsec = (long)((timeUs % 1000000U) * 1000U)};
+  while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)) {
+  }
+}
+
+static size_t encodeVarint(uint64_t value, char *out) {
+  size_t length = 0;
+  while (value >= 0x80U) {
+    out[length++] = (char)((value & 0x7FU) | 0x80U);
+    value >>= 7;
+  }
+  out[length++] = (char)value;
+  return length;
+}
+
+static bool decodeVarint(const char *data, size_t length, size_t *position, uint64_t *value) {
+  *value = 0;
+  for (unsigned shift = 0; (shift < 64U) && (*position < length); shift += 7U) {
+    uint8_t byte = (uint8_t)data[(*position)++];
+    *value |= (uint64_t)(byte & 0x7FU) << shift;
+    if (0U == (byte & 0x80U)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns false at the end of the capture and on a truncated record, position stays at the record
+static bool readRecord(const char *capture, size_t length, size_t *position, Record *record) {
+  size_t next = *position;
+  if (next >= length) {
+    return false;
+  }
+
+  uint64_t recordLength = 0;
+  record->direction = (uint8_t)capture[next++];
+  if ((record->direction > SERIAL_CLI_MONITOR_OUTPUT) || !decodeVarint(capture, length, &next, &record->deltaUs) ||
+      !decodeVarint(capture, length, &next, &recordLength) || (recordLength > (length - next))) {
+    return false;
+  }
+
+  record->data = &capture[next];
+  record->length = (size_t)recordLength;
+  *position = next + record->length;
+  return true;
+}
+
+static void appendBytes(SerialCLI_Capture *capture, const char *data, size_t length) {
+  if (length > (sizeof(capture->buffer) - capture->length)) {
+    (void)SerialCLI_CaptureFlush(capture);
+
+    // Chunks larger than the buffer are written directly
+    if (length > sizeof(capture->buffer)) {
+      capture->isFailed = !SerialCLI_HostWriteAll(capture->fd, data, length, -1) || capture->isFailed;
+      return;
+    }
+  }
+
+  memcpy(&capture->buffer[capture->length], data, length);
+  capture->length += length;
+}
+
+static void captureRecord(void *context, SerialCLI_MonitorDirection direction, const char *data, size_t length) {
+  SerialCLI_Capture *capture = (SerialCLI_Capture *)context;
+  uint64_t now = getTimeUs();
+
+  char header[1 + (2 * VARINT_MAX_LENGTH)];
+  size_t headerLength = 0;
+  header[headerLength++] = (char)direction;
+  headerLength += encodeVarint(now - capture->lastTimestampUs, &header[headerLength]);
+  headerLength += encodeVarint(length, &header[headerLength]);
+  capture->lastTimestampUs = now;
+  ++capture->recordCount;
+
+  appendBytes(capture, header, headerLength);
+  appendBytes(capture, data, length);
+}
+
+bool SerialCLI_CaptureOpen(SerialCLI_Capture *capture, SerialCLI *cli, const char *path) {
+  if ((NULL == capture) || (NULL == cli) || (NULL == path)) {
+    return false;
+  }
+
+  capture->cli = cli;
+  capture->lastTimestampUs = getTimeUs();
+  capture->recordCount = 0;
+  capture->isFailed = false;
+  capture->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (capture->fd < 0) {
+    return false;
+  }
+
+  memcpy(capture->buffer, captureMagic, MAGIC_LENGTH);
+  capture->length = MAGIC_LENGTH;
+  return SerialCLI_SetMonitor(cli, captureRecord, capture);
+}
+
+bool SerialCLI_CaptureFlush(SerialCLI_Capture *capture) {
+  if ((NULL == capture) || (capture->fd < 0)) {
+    return false;
+  }
+
+  if (capture->length > 0) {
+    capture->isFailed = !SerialCLI_HostWriteAll(capture->fd, capture->buffer, capture->length, -1) || capture->isFailed;
+    capture->length = 0;
+  }
+  return !capture->isFailed;
+}
+
+bool SerialCLI_CaptureClose(SerialCLI_Capture *capture) {
+  if ((NULL == capture) || (capture->fd < 0)) {
+    return false;
+  }
+
+  if (capture->cli->monitorContext == capture) {
+    (void)SerialCLI_SetMonitor(capture->cli, NULL, NULL);
+  }
+
+  bool isComplete = SerialCLI_CaptureFlush(capture);
+  isComplete = (0 == close(capture->fd)) && isComplete;
+  capture->fd = -1;
+  return isComplete;
+}
+
+static size_t getBucket(uint64_t latencyUs) {
+  size_t bucket = 0;
+  while ((bucket < (SERIAL_CLI_REPLAY_BUCKET_COUNT - 1)) && (latencyUs >= ((uint64_t)1 << bucket))) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+static bool takeExpectedOutput(Replay *replay) {
+  Record record;
+  while (readRecord(replay->capture, replay->captureLength, &replay->expectedPosition, &record)) {
+    if ((SERIAL_CLI_MONITOR_OUTPUT == record.direction) && (record.length > 0)) {
+      replay->expected = record.data;
+      replay->expectedLength = record.length;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Compares the output with the recorded one, the write boundaries may differ
+static void replayMonitor(void *context, SerialCLI_MonitorDirection direction, const char *data, size_t length) {
+  Replay *replay = (Replay *)context;
+  SerialCLI_ReplayResult *result = replay->result;
+  if (SERIAL_CLI_MONITOR_OUTPUT != direction) {
+    return;
+  }
+
+  size_t offset = result->outputBytes;
+  result->outputBytes += length;
+  while ((length > 0) && (SIZE_MAX == result->mismatchOffset)) {
+    if ((0 == replay->expectedLength) && !takeExpectedOutput(replay)) {
+      result->mismatchOffset = offset;
+      return;
+    }
+
+    size_t compareLength = (length < replay->expectedLength) ? length : replay->expectedLength;
+    for (size_t i = 0; i < compareLength; ++i) {
+      if (data[i] != replay->expected[i]) {
+        result->mismatchOffset = offset + i;
+        return;
+      }
+    }
+    data += compareLength;
+    length -= compareLength;
+    offset += compareLength;
+    replay->expected += compareLength;
+    replay->expectedLength -= compareLength;
+  }
+}
+
+static void replayLineResult(void *context, SerialCLI_LineStatus status) {
+  Replay *replay = (Replay *)context;
+  SerialCLI_ReplayResult *result = replay->result;
+
+  uint64_t now = getTimeUs();
+  uint64_t latencyUs = now - replay->lineStartUs;
+  replay->lineStartUs = now;
+  ++result->lineCount;
+  result->latencyTotalUs += latencyUs;
+  if (latencyUs > result->latencyMaxUs) {
+    result->latencyMaxUs = latencyUs;
+  }
+  ++result->latencyHistogram[getBucket(latencyUs)];
+
+  if (NULL != replay->userCallback) {
+    replay->userCallback(replay->userContext, status);
+  }
+}
+
+// Runs the queued lines, then continues a deferred command until the next chunk is due. Paced, the chunk is due at
+// its recorded time, otherwise once the output recorded before it was reproduced or can no longer match.
+static void runUntil(Replay *replay, uint64_t deadlineUs, size_t expectedOutputBytes, bool isPaced) {
+  const SerialCLI_ReplayResult *result = replay->result;
+  SerialCLI_HostProcess(replay->cli);
+  while (SerialCLI_IsCommandRunning(replay->cli)) {
+    bool isDue = isPaced ? (getTimeUs() >= deadlineUs)
+                         : ((result->outputBytes >= expectedOutputBytes) || (SIZE_MAX != result->mismatchOffset));
+    if (isDue) {
+      return;
+    }
+    SerialCLI_HostProcess(replay->cli);
+  }
+}
+
+bool SerialCLI_Replay(SerialCLI *cli, const char *path, bool isPaced, SerialCLI_ReplayResult *result) {
+  if ((NULL == cli) || (NULL == path)) {
+    return false;
+  }
+
+  SerialCLI_ReplayResult summary;
+  memset(&summary, 0, sizeof(summary));
+  summary.mismatchOffset = SIZE_MAX;
+  const char *capture = NULL;
+  size_t length = 0;
+  if (!SerialCLI_HostMapFile(path, &capture, &length)) {
+    if (NULL != result) {
+      *result = summary;
+    }
+    return false;
+  }
+  Replay replay = {cli, &summary, capture, length, MAGIC_LENGTH, NULL, 0, 0, cli->onLineResult, cli->lineResultContext};
+  SerialCLI_Monitor userMonitor = cli->monitor;
+  void *userMonitorContext = cli->monitorContext;
+  (void)SerialCLI_SetMonitor(cli, replayMonitor, &replay);
+  (void)SerialCLI_SetLineResultCallback(cli, replayLineResult, &replay);
+
+  // The chunks are fed at the time they were recorded, or as soon as the recorded output is reproduced
+  bool isValid = (length >= MAGIC_LENGTH) && (0 == memcmp(capture, captureMagic, MAGIC_LENGTH));
+  const uint64_t startUs = getTimeUs();
+  uint64_t recordTimeUs = 0;
+  size_t position = MAGIC_LENGTH;
+  Record record;
+  while (isValid && readRecord(capture, length, &position, &record)) {
+    recordTimeUs += record.deltaUs;
+    if (SERIAL_CLI_MONITOR_OUTPUT == record.direction) {
+      summary.expectedOutputBytes += record.length;
+      continue;
+    }
+
+    uint64_t deadlineUs = startUs + recordTimeUs;
+    runUntil(&replay, deadlineUs, summary.expectedOutputBytes, isPaced);
+    if (isPaced) {
+      sleepUntil(deadlineUs);
+    }
+
+    if (!SerialCLI_IsCommandRunning(cli) && !SerialCLI_IsCommandPending(cli)) {
+      replay.lineStartUs = getTimeUs();
+    }
+    (void)SerialCLI_Read(cli, record.data, record.length);
+    summary.inputBytes += record.length;
+  }
+  isValid = isValid && (position == length);
+
+  // Output recorded after the last chunk
+  runUntil(&replay, startUs + recordTimeUs, summary.expectedOutputBytes, isPaced);
+  summary.elapsedUs = getTimeUs() - startUs;
+  if ((SIZE_MAX == summary.mismatchOffset) && (summary.outputBytes < summary.expectedOutputBytes)) {
+    summary.mismatchOffset = summary.outputBytes;
+  }
+
+  (void)SerialCLI_SetMonitor(cli, userMonitor, userMonitorContext);
+  (void)SerialCLI_SetLineResultCallback(cli, replay.userCallback, replay.userContext);
+  SerialCLI_HostUnmapFile(capture, length);
+  if (NULL != result) {
+    *result = summary;
+  }
+  return isValid && (SIZE_MAX == summary.mismatchOffset);
+}
+
+uint64_t SerialCLI_ReplayGetPercentile(const SerialCLI_ReplayResult *result, unsigned percent) {
+  if ((NULL == result) || (0 == result->lineCount) || (0U == percent) || (percent > 100U)) {
+    return 0;
+  }
+
+  size_t rank = ((result->lineCount * percent) + 99U) / 100U;
+  size_t count = 0;
+  for (size_t bucket = 0; bucket < SERIAL_CLI_REPLAY_BUCKET_COUNT; ++bucket) {
+    count += result->latencyHistogram[bucket];
+    if ((count >= rank) && (bucket < (SERIAL_CLI_REPLAY_BUCKET_COUNT - 1))) {
+      uint64_t upperBoundUs = (uint64_t)1 << bucket;
+      return (upperBoundUs < result->latencyMaxUs) ? upperBoundUs : result->latencyMaxUs;
+    }
+  }
+  return result->latencyMaxUs;
+}
@@ -0,0 +1,405 @@
+#define _GNU_SOURCE
+
+#include "serial_cli_executor.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+enum {
+  DRAIN_CHUNK_SIZE = 256, // Output moved from a job to its instance at once
+};
+
+static const char cancelCharacter = 3; // ASCII ETX, sent by Ctrl+C
+
+// Worker of the calling thread, its private instance writes to the running job
+static _Thread_local SerialCLI_Worker *currentWorker = NULL;
+
+static inline size_t getMin(size_t a, size_t b) { return (a < b) ? a : b; }
+
+static void signalLoop(SerialCLI_Executor *executor) {
+  uint64_t count = 1;
+  ssize_t written;
+  do {
+    written = write(executor->eventFd, &count, sizeof(count));
+  } while ((written < 0) && (EINTR == errno));
+}
+
+static void freeJob(SerialCLI_Executor *executor, SerialCLI_Job *job) {
+  job->next = executor->freeJobs;
+  executor->freeJobs = job;
+}
+
+// Called with the lock held. Returns true if the loop has to be woken up.
+static bool markReady(SerialCLI_Executor *executor, SerialCLI_Job *job) {
+  if (job->isReady || job->isAbandoned) {
+    return false;
+  }
+
+  job->isReady = true;
+  job->next = NULL;
+  bool wasEmpty = (NULL == executor->readyJobs);
+  if (wasEmpty) {
+    executor->readyJobs = job;
+  } else {
+    executor->readyJobsTail->next = job;
+  }
+  executor->readyJobsTail = job;
+  return wasEmpty;
+}
+
+// Called with the lock held once the instance stops waiting, the last side to let go frees the job
+static void releaseJob(SerialCLI_Executor *executor, SerialCLI_Job *job) {
+  __atomic_store_n(&job->isAbandoned, true, __ATOMIC_RELEASE);
+  if (job->isDone && !job->isReady) {
+    freeJob(executor, job);
+  }
+}
+
+static void writeJobOutput(void *context, const char *str, size_t len) {
+  (void)context;
+  SerialCLI_Worker *worker = currentWorker;
+  SerialCLI_Job *job = worker->job;
+  // Nothing but the command writes to the job
+  if (NULL == job) {
+    return;
+  }
+
+  SerialCLI_Executor *executor = worker->executor;
+  bool isSignalled = false;
+  (void)pthread_mutex_lock(&executor->lock);
+  while ((len > 0) && !job->isAbandoned && !executor->isStopRequested) {
+    size_t room = SERIAL_CLI_EXECUTOR_OUTPUT_SIZE - job->outputLength;
+    if (0 == room) {
+      // A full ring waits for the instance, the output of a command is never dropped
+      (void)pthread_cond_wait(&executor->outputDrained, &executor->lock);
+      continue;
+    }
+
+    size_t end = (job->outputStart + job->outputLength) % SERIAL_CLI_EXECUTOR_OUTPUT_SIZE;
+    size_t length = getMin(getMin(room, len), SERIAL_CLI_EXECUTOR_OUTPUT_SIZE - end);
+    memcpy(&job->output[end], str, length);
+    job->outputLength += length;
+    str += length;
+    len -= length;
+    isSignalled = markReady(executor, job) || isSignalled;
+  }
+  (void)pthread_mutex_unlock(&executor->lock);
+
+  if (isSignalled) {
+    signalLoop(executor);
+  }
+}
+
+static void finishJob(SerialCLI_Executor *executor, SerialCLI_Job *job, bool isFailed) {
+  (void)pthread_mutex_lock(&executor->lock);
+  job->isDone = true;
+  job->isFailed = isFailed;
+  bool isSignalled = markReady(executor, job);
+  if (job->isAbandoned && !job->isReady) {
+    freeJob(executor, job);
+  }
+  (void)pthread_mutex_unlock(&executor->lock);
+
+  if (isSignalled) {
+    signalLoop(executor);
+  }
+}
+
+static void runJob(SerialCLI_Worker *worker, SerialCLI_Job *job) {
+  SerialCLI_Storage storage;
+  memset(&storage, 0, sizeof(storage));
+  storage.inputBuffer = worker->inputBuffer;
+  storage.inputBufferSize = sizeof(worker->inputBuffer) - 1;
+  storage.argv = worker->argv;
+  storage.maxArgs = (sizeof(worker->argv) / sizeof(worker->argv[0])) - 1;
+  storage.txBuffer = worker->txBuffer;
+  storage.txBufferSize = sizeof(worker->txBuffer) - 1;
+
+  // The private instance takes the context of the job, the prompt it writes meanwhile goes nowhere
+  worker->job = NULL;
+  (void)SerialCLI_InitWithStorage(&worker->cli, &storage, writeJobOutput, job->context);
+  (void)SerialCLI_SetMode(&worker->cli, SERIAL_CLI_MODE_BATCH);
+  worker->job = job;
+
+  job->command(&worker->cli, job->argc, job->argv);
+
+  // A command deferred on the worker is continued right here, Ctrl+C reaches it once the instance gives up
+  bool isCancelSent = false;
+  while (SerialCLI_IsCommandRunning(&worker->cli)) {
+    if (!isCancelSent && __atomic_load_n(&job->isAbandoned, __ATOMIC_ACQUIRE)) {
+      (void)SerialCLI_Read(&worker->cli, &cancelCharacter, 1);
+      isCancelSent = true;
+    }
+    (void)SerialCLI_Process(&worker->cli);
+  }
+
+  bool isFailed = worker->cli.isCommandFailed;
+  (void)SerialCLI_Flush(&worker->cli);
+  worker->job = NULL;
+  finishJob(worker->executor, job, isFailed);
+}
+
+static SerialCLI_Job *popJob(SerialCLI_Worker *worker) {
+  SerialCLI_Job *job = NULL;
+  (void)pthread_mutex_lock(&worker->queueLock);
+  if (worker->queueLength > 0) {
+    job = worker->queue[worker->queueStart];
+    worker->queueStart = (worker->queueStart + 1) % SERIAL_CLI_EXECUTOR_QUEUE_SIZE;
+    --worker->queueLength;
+  }
+  (void)pthread_mutex_unlock(&worker->queueLock);
+  return job;
+}
+
+static bool pushJob(SerialCLI_Worker *worker, SerialCLI_Job *job) {
+  (void)pthread_mutex_lock(&worker->queueLock);
+  bool hasRoom = worker->queueLength < SERIAL_CLI_EXECUTOR_QUEUE_SIZE;
+  if (hasRoom) {
+    worker->queue[(worker->queueStart + worker->queueLength) % SERIAL_CLI_EXECUTOR_QUEUE_SIZE] = job;
+    ++worker->queueLength;
+  }
+  (void)pthread_mutex_unlock(&worker->queueLock);
+  return hasRoom;
+}
+
+// Every taken ticket stands for a queued job, so the worker finds one in its own queue or steals it
+static SerialCLI_Job *findJob(SerialCLI_Worker *worker) {
+  SerialCLI_Executor *executor = worker->executor;
+  size_t self = (size_t)(worker - executor->workers);
+  for (;;) {
+    for (size_t i = 0; i < executor->workerCount; ++i) {
+      SerialCLI_Job *job = popJob(&executor->workers[(self + i) % executor->workerCount]);
+      if (NULL != job) {
+        return job;
+      }
+    }
+  }
+}
+
+static void *runWorker(void *argument) {
+  SerialCLI_Worker *worker = (SerialCLI_Worker *)argument;
+  SerialCLI_Executor *executor = worker->executor;
+  currentWorker = worker;
+
+  for (;;) {
+    (void)pthread_mutex_lock(&executor->lock);
+    while ((0 == executor->queuedCount) && !executor->isStopRequested) {
+      (void)pthread_cond_wait(&executor->workAvailable, &executor->lock);
+    }
+    if (executor->isStopRequested) {
+      (void)pthread_mutex_unlock(&executor->lock);
+      return NULL;
+    }
+    --executor->queuedCount;
+    (void)pthread_mutex_unlock(&executor->lock);
+
+    runJob(worker, findJob(worker));
+  }
+}
+
+static bool continueJob(SerialCLI *cli, void *state, bool isCancelled) {
+  SerialCLI_Job *job = (SerialCLI_Job *)state;
+  SerialCLI_Executor *executor = job->executor;
+  if (isCancelled) {
+    (void)pthread_mutex_lock(&executor->lock);
+    releaseJob(executor, job);
+    (void)pthread_cond_broadcast(&executor->outputDrained);
+    (void)pthread_mutex_unlock(&executor->lock);
+    return true;
+  }
+
+  // Output moves to the instance as far as its TX ring has room, the rest waits for the next call
+  char chunk[DRAIN_CHUNK_SIZE];
+  bool isComplete = false;
+  bool isFailed = false;
+  size_t length;
+  do {
+    size_t room = SerialCLI_GetTxSpace(cli);
+    (void)pthread_mutex_lock(&executor->lock);
+    length = getMin(getMin(job->outputLength, sizeof(chunk)), room);
+    size_t firstLength = getMin(length, SERIAL_CLI_EXECUTOR_OUTPUT_SIZE - job->outputStart);
+    memcpy(chunk, &job->output[job->outputStart], firstLength);
+    memcpy(&chunk[firstLength], job->output, length - firstLength);
+    job->outputStart = (job->outputStart + length) % SERIAL_CLI_EXECUTOR_OUTPUT_SIZE;
+    job->outputLength -= length;
+    if (length > 0) {
+      (void)pthread_cond_broadcast(&executor->outputDrained);
+    }
+
+    isComplete = job->isDone && (0 == job->outputLength);
+    if (isComplete) {
+      isFailed = job->isFailed;
+      releaseJob(executor, job);
+    }
+    (void)pthread_mutex_unlock(&executor->lock);
+
+    (void)SerialCLI_WriteBytes(cli, chunk, length);
+  } while (!isComplete && (length > 0));
+
+  if (isFailed) {
+    (void)SerialCLI_FailCommand(cli);
+  }
+  return isComplete;
+}
+
+static bool runOnWorker(void *context, SerialCLI *cli, SerialCLI_Command command, int argc, const char **argv) {
+  SerialCLI_Executor *executor = (SerialCLI_Executor *)context;
+  if ((argc < 0) || ((size_t)argc > SERIAL_CLI_COMMAND_MAX_ARGS)) {
+    return false;
+  }
+
+  (void)pthread_mutex_lock(&executor->lock);
+  SerialCLI_Job *job = executor->freeJobs;
+  size_t workerIndex = executor->nextWorker;
+  if (NULL != job) {
+    executor->freeJobs = job->next;
+    executor->nextWorker = (workerIndex + 1) % executor->workerCount;
+  }
+  (void)pthread_mutex_unlock(&executor->lock);
+  // Without a free job the command runs right away
+  if (NULL == job) {
+    return false;
+  }
+
+  size_t offset = 0;
+  bool isCopied = true;
+  for (int i = 0; isCopied && (i < argc); ++i) {
+    size_t length = strlen(argv[i]) + 1;
+    isCopied = (offset + length) <= sizeof(job->arguments);
+    if (isCopied) {
+      memcpy(&job->arguments[offset], argv[i], length);
+      job->argv[i] = &job->arguments[offset];
+      offset += length;
+    }
+  }
+  if (!isCopied || !SerialCLI_Defer(cli, continueJob, job)) {
+    (void)pthread_mutex_lock(&executor->lock);
+    freeJob(executor, job);
+    (void)pthread_mutex_unlock(&executor->lock);
+    return false;
+  }
+
+  job->argv[argc] = NULL;
+  job->argc = argc;
+  job->executor = executor;
+  job->cli = cli;
+  job->context = SerialCLI_GetContext(cli);
+  job->command = command;
+  job->outputStart = 0;
+  job->outputLength = 0;
+  job->isDone = false;
+  job->isFailed = false;
+  job->isReady = false;
+  job->isAbandoned = false;
+
+  // The queues hold every job, one of them has room
+  while (!pushJob(&executor->workers[workerIndex], job)) {
+    workerIndex = (workerIndex + 1) % executor->workerCount;
+  }
+
+  (void)pthread_mutex_lock(&executor->lock);
+  ++executor->queuedCount;
+  (void)pthread_cond_signal(&executor->workAvailable);
+  (void)pthread_mutex_unlock(&executor->lock);
+  return true;
+}
+
+bool SerialCLI_ExecutorInit(SerialCLI_Executor *executor, SerialCLI_Worker *workers, size_t workerCount,
+                            SerialCLI_Job *jobs, size_t jobCapacity) {
+  if ((NULL == executor) || (NULL == workers) || (0 == workerCount) || (NULL == jobs) || (0 == jobCapacity) ||
+      (jobCapacity > (workerCount * SERIAL_CLI_EXECUTOR_QUEUE_SIZE))) {
+    return false;
+  }
+
+  memset(executor, 0, sizeof(*executor));
+  executor->workers = workers;
+  executor->workerCount = workerCount;
+  (void)pthread_mutex_init(&executor->lock, NULL);
+  (void)pthread_cond_init(&executor->workAvailable, NULL);
+  (void)pthread_cond_init(&executor->outputDrained, NULL);
+  for (size_t i = jobCapacity; i > 0; --i) {
+    freeJob(executor, &jobs[i - 1]);
+  }
+
+  executor->eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  bool isStarted = executor->eventFd >= 0;
+  for (size_t i = 0; isStarted && (i < workerCount); ++i) {
+    SerialCLI_Worker *worker = &workers[i];
+    worker->executor = executor;
+    worker->queueStart = 0;
+    worker->queueLength = 0;
+    worker->job = NULL;
+    (void)pthread_mutex_init(&worker->queueLock, NULL);
+    isStarted = 0 == pthread_create(&worker->thread, NULL, runWorker, worker);
+    executor->startedCount += isStarted ? 1U : 0U;
+  }
+
+  if (!isStarted) {
+    (void)SerialCLI_ExecutorClose(executor);
+    return false;
+  }
+  return true;
+}
+
+bool SerialCLI_ExecutorAttach(SerialCLI_Executor *executor, SerialCLI *cli) {
+  if (NULL == executor) {
+    return false;
+  }
+  return SerialCLI_SetCommandRunner(cli, runOnWorker, executor);
+}
+
+int SerialCLI_ExecutorGetFd(const SerialCLI_Executor *executor) { return (NULL != executor) ? executor->eventFd : -1; }
+
+SerialCLI *SerialCLI_ExecutorTakeReady(SerialCLI_Executor *executor) {
+  if (NULL == executor) {
+    return NULL;
+  }
+
+  // Jobs the instance gave up on leave the list on the way
+  SerialCLI *cli = NULL;
+  (void)pthread_mutex_lock(&executor->lock);
+  while ((NULL == cli) && (NULL != executor->readyJobs)) {
+    SerialCLI_Job *job = executor->readyJobs;
+    executor->readyJobs = job->next;
+    job->isReady = false;
+    if (!job->isAbandoned) {
+      cli = job->cli;
+    } else if (job->isDone) {
+      freeJob(executor, job);
+    }
+  }
+  (void)pthread_mutex_unlock(&executor->lock);
+  return cli;
+}
+
+bool SerialCLI_ExecutorIsWaiting(const SerialCLI *cli) { return (NULL != cli) && (continueJob == cli->continuation); }
+
+bool SerialCLI_ExecutorClose(SerialCLI_Executor *executor) {
+  if (NULL == executor) {
+    return false;
+  }
+
+  (void)pthread_mutex_lock(&executor->lock);
+  executor->isStopRequested = true;
+  (void)pthread_cond_broadcast(&executor->workAvailable);
+  (void)pthread_cond_broadcast(&executor->outputDrained);
+  (void)pthread_mutex_unlock(&executor->lock);
+
+  for (size_t i = 0; i < executor->startedCount; ++i) {
+    (void)pthread_join(executor->workers[i].thread, NULL);
+    (void)pthread_mutex_destroy(&executor->workers[i].queueLock);
+  }
+  executor->startedCount = 0;
+
+  if (executor->eventFd >= 0) {
+    (void)close(executor->eventFd);
+    executor->eventFd = -1;
+  }
+  (void)pthread_cond_destroy(&executor->outputDrained);
+  (void)pthread_cond_destroy(&executor->workAvailable);
+  (void)pthread_mutex_destroy(&executor->lock);
+  return true;
+}
@@ -0,0 +1,235 @@
+#include "serial_cli_host.h"
+#include "serial_cli_host_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef struct {
+  unsigned baudRate;
+  speed_t speed;
+} BaudRate;
+
+static const BaudRate baudRates[] = {
+    {1200, B1200},       {2400, B2400},       {4800, B4800},       {9600, B9600},       {19200, B19200},
+    {38400, B38400},     {57600, B57600},     {115200, B115200},   {230400, B230400},   {460800, B460800},
+    {500000, B500000},   {576000, B576000},   {921600, B921600},   {1000000, B1000000}, {1152000, B1152000},
+    {1500000, B1500000}, {2000000, B2000000}, {2500000, B2500000}, {3000000, B3000000}, {3500000, B3500000},
+    {4000000, B4000000},
+};
+
+static bool getSpeed(unsigned baudRate, speed_t *speed) {
+  for (size_t i = 0; i < (sizeof(baudRates) / sizeof(baudRates[0])); ++i) {
+    if (baudRates[i].baudRate == baudRate) {
+      *speed = baudRates[i].speed;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void resetHost(SerialCLI_Host *host) {
+  memset(host, 0, sizeof(*host));
+  host->inputFd = -1;
+  host->outputFd = -1;
+  host->ownedFd = -1;
+  host->epollFd = -1;
+  host->wakeFd = -1;
+  host->ptySlaveFd = -1;
+}
+
+static bool addToEpoll(int epollFd, int fd) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  return 0 == epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+void SerialCLI_HostWrite(void *context, const char *str, size_t len) {
+  SerialCLI_Host *host = (SerialCLI_Host *)context;
+  if ((NULL == host) || (host->outputFd < 0)) {
+    return;
+  }
+
+  // Output to a peer that is gone is dropped
+  (void)SerialCLI_HostWriteAll(host->outputFd, str, len, -1);
+}
+
+static bool attachDescriptors(SerialCLI_Host *host, SerialCLI *cli, int inputFd, int outputFd) {
+  host->cli = cli;
+  host->inputFd = inputFd;
+  host->outputFd = outputFd;
+  host->epollFd = epoll_create1(EPOLL_CLOEXEC);
+  host->wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  bool isAttached = (NULL != cli) && (host->epollFd >= 0) && (host->wakeFd >= 0) && SerialCLI_HostSetNonBlocking(inputFd) &&
+                    SerialCLI_HostSetNonBlocking(outputFd) && addToEpoll(host->epollFd, inputFd) &&
+                    addToEpoll(host->epollFd, host->wakeFd);
+  if (!isAttached) {
+    (void)SerialCLI_HostClose(host);
+    return false;
+  }
+
+  return true;
+}
+
+bool SerialCLI_HostAttach(SerialCLI_Host *host, SerialCLI *cli, int inputFd, int outputFd) {
+  if ((NULL == host) || (inputFd < 0) || (outputFd < 0)) {
+    return false;
+  }
+
+  resetHost(host);
+  return attachDescriptors(host, cli, inputFd, outputFd);
+}
+
+bool SerialCLI_HostOpenTTY(SerialCLI_Host *host, SerialCLI *cli, const char *path, unsigned baudRate) {
+  speed_t speed;
+  if ((NULL == host) || (NULL == path) || !getSpeed(baudRate, &speed)) {
+    return false;
+  }
+
+  resetHost(host);
+  host->ownedFd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (host->ownedFd < 0) {
+    return false;
+  }
+
+  struct termios settings;
+  bool isConfigured = SerialCLI_HostMakeRaw(host->ownedFd, &host->originalTermios);
+  host->isTerminalConfigured = isConfigured;
+  isConfigured = isConfigured && (0 == tcgetattr(host->ownedFd, &settings)) && (0 == cfsetispeed(&settings, speed)) &&
+                 (0 == cfsetospeed(&settings, speed)) && (0 == tcsetattr(host->ownedFd, TCSANOW, &settings));
+  if (!isConfigured) {
+    (void)SerialCLI_HostClose(host);
+    return false;
+  }
+
+  return attachDescriptors(host, cli, host->ownedFd, host->ownedFd);
+}
+
+bool SerialCLI_HostOpenPTY(SerialCLI_Host *host, SerialCLI *cli, char *slaveName, size_t slaveNameSize) {
+  if ((NULL == host) || (NULL == slaveName) || (0 == slaveNameSize)) {
+    return false;
+  }
+
+  resetHost(host);
+  if (!SerialCLI_HostOpenPTYPair(&host->ownedFd, &host->ptySlaveFd, slaveName, slaveNameSize)) {
+    (void)SerialCLI_HostClose(host);
+    return false;
+  }
+
+  return attachDescriptors(host, cli, host->ownedFd, host->ownedFd);
+}
+
+bool SerialCLI_HostConnectUnix(SerialCLI_Host *host, SerialCLI *cli, const char *path) {
+  struct sockaddr_un address;
+  if ((NULL == host) || (NULL == path) || (strlen(path) >= sizeof(address.sun_path))) {
+    return false;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+
+  resetHost(host);
+  host->ownedFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if ((host->ownedFd < 0) || (0 != connect(host->ownedFd, (const struct sockaddr *)&address, sizeof(address)))) {
+    (void)SerialCLI_HostClose(host);
+    return false;
+  }
+
+  return attachDescriptors(host, cli, host->ownedFd, host->ownedFd);
+}
+
+bool SerialCLI_HostPoll(SerialCLI_Host *host, int timeoutMs) {
+  if ((NULL == host) || (host->epollFd < 0)) {
+    return false;
+  }
+
+  // A running command is continued between checks for input instead of waiting
+  bool isRunning = SerialCLI_IsCommandRunning(host->cli);
+  struct epoll_event events[2];
+  int eventCount = epoll_wait(host->epollFd, events, 2, isRunning ? 0 : timeoutMs);
+  if (eventCount < 0) {
+    return (EINTR == errno) && !__atomic_load_n(&host->isStopRequested, __ATOMIC_ACQUIRE);
+  }
+
+  bool isUsable = true;
+  for (int i = 0; i < eventCount; ++i) {
+    if (events[i].data.fd == host->wakeFd) {
+      uint64_t count;
+      (void)read(host->wakeFd, &count, sizeof(count));
+    } else if (0U != (events[i].events & EPOLLIN)) {
+      isUsable = SerialCLI_HostReadInput(host->cli, host->inputFd) && isUsable;
+    } else {
+      // Hang-up or error without pending input
+      isUsable = false;
+    }
+  }
+
+  if (isRunning) {
+    SerialCLI_HostProcess(host->cli);
+  }
+  return isUsable && !__atomic_load_n(&host->isStopRequested, __ATOMIC_ACQUIRE);
+}
+
+bool SerialCLI_HostRun(SerialCLI_Host *host) {
+  if (NULL == host) {
+    return false;
+  }
+
+  while (SerialCLI_HostPoll(host, -1)) {
+  }
+  return __atomic_load_n(&host->isStopRequested, __ATOMIC_ACQUIRE);
+}
+
+bool SerialCLI_HostStop(SerialCLI_Host *host) {
+  if ((NULL == host) || (host->wakeFd < 0)) {
+    return false;
+  }
+
+  __atomic_store_n(&host->isStopRequested, true, __ATOMIC_RELEASE);
+  uint64_t count = 1;
+  return sizeof(count) == write(host->wakeFd, &count, sizeof(count));
+}
+
+bool SerialCLI_HostRunScript(SerialCLI *cli, const char *path, bool isStopOnError, SerialCLI_BatchResult *result) {
+  if ((NULL == cli) || (NULL == path)) {
+    return false;
+  }
+
+  // An empty file is an empty script
+  const char *script = NULL;
+  size_t length = 0;
+  if (!SerialCLI_HostMapFile(path, &script, &length)) {
+    return false;
+  }
+
+  bool isSuccessful = SerialCLI_ExecuteBatch(cli, script, length, isStopOnError, result);
+  SerialCLI_HostUnmapFile(script, length);
+  return isSuccessful;
+}
+
+bool SerialCLI_HostClose(SerialCLI_Host *host) {
+  if (NULL == host) {
+    return false;
+  }
+
+  if (host->isTerminalConfigured && (host->ownedFd >= 0)) {
+    (void)tcsetattr(host->ownedFd, TCSANOW, &host->originalTermios);
+  }
+
+  SerialCLI_HostCloseDescriptor(&host->epollFd);
+  SerialCLI_HostCloseDescriptor(&host->wakeFd);
+  SerialCLI_HostCloseDescriptor(&host->ptySlaveFd);
+  SerialCLI_HostCloseDescriptor(&host->ownedFd);
+  resetHost(host);
+  return true;
+}
@@ -0,0 +1,187 @@
+#define _GNU_SOURCE
+
+#include "serial_cli_host.h"
+#include "serial_cli_host_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool SerialCLI_HostSetNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  return (flags >= 0) && (0 == fcntl(fd, F_SETFL, flags | O_NONBLOCK));
+}
+
+bool SerialCLI_HostMakeRaw(int fd, struct termios *original) {
+  struct termios settings;
+  if (0 != tcgetattr(fd, &settings)) {
+    return false;
+  }
+  if (NULL != original) {
+    *original = settings;
+  }
+
+  cfmakeraw(&settings);
+  settings.c_cflag |= (CLOCAL | CREAD);
+  settings.c_cc[VMIN] = 1;
+  settings.c_cc[VTIME] = 0;
+  return 0 == tcsetattr(fd, TCSANOW, &settings);
+}
+
+bool SerialCLI_HostOpenPTYPair(int *masterFd, int *slaveFd, char *slaveName, size_t slaveNameSize) {
+  *slaveFd = -1;
+  *masterFd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  bool isOpened = (*masterFd >= 0) && (0 == grantpt(*masterFd)) && (0 == unlockpt(*masterFd)) &&
+                  (0 == ptsname_r(*masterFd, slaveName, slaveNameSize));
+  if (isOpened) {
+    // Without the line discipline the bytes pass unchanged in both directions
+    *slaveFd = open(slaveName, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    isOpened = (*slaveFd >= 0) && SerialCLI_HostMakeRaw(*slaveFd, NULL);
+  }
+  if (!isOpened) {
+    SerialCLI_HostCloseDescriptor(slaveFd);
+    SerialCLI_HostCloseDescriptor(masterFd);
+  }
+  return isOpened;
+}
+
+// Lines are executed until one keeps running or its output has no room
+static inline bool canExecuteLine(const SerialCLI *cli) {
+  return SerialCLI_IsCommandPending(cli) && !SerialCLI_IsCommandRunning(cli) && !SerialCLI_IsTxBlocked(cli);
+}
+
+void SerialCLI_HostProcess(SerialCLI *cli) {
+  if (SerialCLI_IsCommandRunning(cli)) {
+    (void)SerialCLI_Process(cli);
+  }
+
+  while (canExecuteLine(cli)) {
+    (void)SerialCLI_Process(cli);
+  }
+}
+
+bool SerialCLI_HostReadInput(SerialCLI *cli, int fd) {
+  char chunk[SERIAL_CLI_HOST_READ_CHUNK_SIZE];
+
+  for (;;) {
+    // Echo is about as long as the input, so half the free TX space keeps it from being dropped
+    size_t chunkLength = SerialCLI_GetTxSpace(cli) / 2;
+    if (chunkLength > sizeof(chunk)) {
+      chunkLength = sizeof(chunk);
+    }
+    if (0 == chunkLength) {
+      return true;
+    }
+
+    ssize_t length = read(fd, chunk, chunkLength);
+    if (length > 0) {
+      (void)SerialCLI_Read(cli, chunk, (size_t)length);
+
+      // Process the completed lines before the next chunk can fill the line queue
+      while (canExecuteLine(cli)) {
+        (void)SerialCLI_Process(cli);
+      }
+
+      // A running command or blocked output leaves the rest of the input to the next poll
+      if (SerialCLI_IsCommandRunning(cli) || SerialCLI_IsTxBlocked(cli)) {
+        return true;
+      }
+      continue;
+    }
+
+    if ((length < 0) && (EINTR == errno)) {
+      continue;
+    }
+    // A closed descriptor ends the input, an empty one is drained
+    return (length < 0) && (EAGAIN == errno);
+  }
+}
+
+static ssize_t writeSome(int fd, const char *data, size_t length) {
+  // A socket whose peer is gone must report EPIPE instead of raising SIGPIPE
+  ssize_t written = send(fd, data, length, MSG_NOSIGNAL);
+  if ((written < 0) && (ENOTSOCK == errno)) {
+    written = write(fd, data, length);
+  }
+  return written;
+}
+
+bool SerialCLI_HostWriteSome(int fd, const char *data, size_t length, size_t *written) {
+  for (;;) {
+    ssize_t result = writeSome(fd, data, length);
+    if (result >= 0) {
+      *written = (size_t)result;
+      return true;
+    }
+    if (EAGAIN == errno) {
+      *written = 0;
+      return true;
+    }
+    if (EINTR != errno) {
+      return false;
+    }
+  }
+}
+
+bool SerialCLI_HostWriteAll(int fd, const char *data, size_t length, int timeoutMs) {
+  while (length > 0) {
+    ssize_t written = writeSome(fd, data, length);
+    if (written > 0) {
+      data += written;
+      length -= (size_t)written;
+    } else if ((written < 0) && (EAGAIN == errno)) {
+      struct pollfd pollFd = {.fd = fd, .events = POLLOUT, .revents = 0};
+      if (poll(&pollFd, 1, timeoutMs) <= 0) {
+        return false;
+      }
+    } else if (!((written < 0) && (EINTR == errno))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SerialCLI_HostCloseDescriptor(int *fd) {
+  if (*fd >= 0) {
+    (void)close(*fd);
+    *fd = -1;
+  }
+}
+
+bool SerialCLI_HostMapFile(const char *path, const char **data, size_t *length) {
+  *data = NULL;
+  *length = 0;
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  struct stat fileStatus;
+  if ((fd < 0) || (0 != fstat(fd, &fileStatus))) {
+    SerialCLI_HostCloseDescriptor(&fd);
+    return false;
+  }
+
+  // An empty file cannot be mapped
+  void *mapping = NULL;
+  if (fileStatus.st_size > 0) {
+    mapping = mmap(NULL, (size_t)fileStatus.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  SerialCLI_HostCloseDescriptor(&fd);
+  if (MAP_FAILED == mapping) {
+    return false;
+  }
+  if (NULL != mapping) {
+    (void)madvise(mapping, (size_t)fileStatus.st_size, MADV_SEQUENTIAL);
+    *data = (const char *)mapping;
+    *length = (size_t)fileStatus.st_size;
+  }
+  return true;
+}
+
+void SerialCLI_HostUnmapFile(const char *data, size_t length) {
+  if (NULL != data) {
+    (void)munmap((void *)data, length);
+  }
+}
@@ -0,0 +1,401 @@
+#define _GNU_SOURCE
+
+#include "serial_cli_server.h"
+#include "serial_cli_host_internal.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static bool addToEpoll(int epollFd, int fd, void *data) {
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.ptr = data;
+  return 0 == epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+static size_t sessionWrite(void *context, const char *str, size_t len) {
+  SerialCLI_Session *session = (SerialCLI_Session *)context;
+  if ((session->fd < 0) || session->isClosing) {
+    return len;
+  }
+
+  // Output the client does not take waits in the TX ring, failed output is discarded
+  size_t written;
+  if (!SerialCLI_HostWriteSome(session->fd, str, len, &written)) {
+    session->isClosing = true;
+    return len;
+  }
+  return written;
+}
+
+// Pending output waits for the client, blocked output also stops reading its input
+static void updateEvents(SerialCLI_Server *server, SerialCLI_Session *session) {
+  uint32_t events = SerialCLI_IsTxBlocked(&session->cli) ? 0U : (uint32_t)EPOLLIN;
+  if (SerialCLI_GetTxPending(&session->cli) > 0) {
+    events |= (uint32_t)EPOLLOUT;
+  }
+  if (events == session->events) {
+    return;
+  }
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = events;
+  event.data.ptr = session;
+  if (0 == epoll_ctl(server->epollFd, EPOLL_CTL_MOD, session->fd, &event)) {
+    session->events = events;
+  }
+}
+
+static SerialCLI_Session *openSession(SerialCLI_Server *server, int fd, int ptySlaveFd) {
+  SerialCLI_Session *session = server->freeSessions;
+  if ((NULL == session) || !SerialCLI_HostSetNonBlocking(fd) || !addToEpoll(server->epollFd, fd, session)) {
+    return NULL;
+  }
+
+  server->freeSessions = session->next;
+  ++server->sessionCount;
+  session->next = NULL;
+  session->fd = fd;
+  session->ptySlaveFd = ptySlaveFd;
+  session->isClosing = false;
+  session->isRunning = false;
+  session->userContext = NULL;
+  session->events = EPOLLIN;
+
+  SerialCLI_Storage storage;
+  memset(&storage, 0, sizeof(storage));
+  storage.inputBuffer = session->inputBuffer;
+  storage.inputBufferSize = sizeof(session->inputBuffer) - 1;
+  storage.argv = session->argv;
+  storage.maxArgs = (sizeof(session->argv) / sizeof(session->argv[0])) - 1;
+  storage.txBuffer = session->txBuffer;
+  storage.txBufferSize = sizeof(session->txBuffer) - 1;
+  storage.historyBuffer = session->historyBuffer;
+  storage.historyBufferSize = sizeof(session->historyBuffer);
+  storage.filterLine = session->filterLine;
+  storage.filterLineSize = sizeof(session->filterLine);
+  storage.filterPatterns = session->filterPatterns;
+  storage.filterPatternSize = sizeof(session->filterPatterns);
+  (void)SerialCLI_InitNonBlocking(&session->cli, &storage, sessionWrite, session, session->txRing,
+                                  sizeof(session->txRing));
+  (void)SerialCLI_AttachRegistry(&session->cli, server->registry);
+  if (NULL != server->executor) {
+    (void)SerialCLI_ExecutorAttach(server->executor, &session->cli);
+  }
+
+  if (NULL != server->onOpen) {
+    server->onOpen(server->context, session);
+  }
+  return session;
+}
+
+static void acceptClients(SerialCLI_Server *server) {
+  for (;;) {
+    int fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (EINTR == errno) {
+        continue;
+      }
+      return;
+    }
+
+    // Clients exceeding the pool are turned away
+    if (NULL == openSession(server, fd, -1)) {
+      (void)close(fd);
+    }
+  }
+}
+
+// Commands on the executor wake the loop through its descriptor instead of being continued on every poll
+static inline bool isPolled(SerialCLI_Session *session) {
+  return SerialCLI_IsCommandRunning(&session->cli) && !SerialCLI_ExecutorIsWaiting(&session->cli);
+}
+
+static void trackRunning(SerialCLI_Server *server, SerialCLI_Session *session) {
+  if (!session->isRunning && isPolled(session)) {
+    session->isRunning = true;
+    session->next = server->runningSessions;
+    server->runningSessions = session;
+  }
+}
+
+static void untrackRunning(SerialCLI_Server *server, SerialCLI_Session *session) {
+  for (SerialCLI_Session **link = &server->runningSessions; NULL != *link; link = &(*link)->next) {
+    if (*link == session) {
+      *link = session->next;
+      session->isRunning = false;
+      return;
+    }
+  }
+}
+
+// Continues every running command once, sessions whose command completed leave the list
+static void continueRunning(SerialCLI_Server *server) {
+  SerialCLI_Session **link = &server->runningSessions;
+  while (NULL != *link) {
+    SerialCLI_Session *session = *link;
+    SerialCLI_HostProcess(&session->cli);
+    if (session->isClosing) {
+      (void)SerialCLI_ServerCloseSession(server, session);
+      continue;
+    }
+
+    updateEvents(server, session);
+    if (isPolled(session)) {
+      link = &session->next;
+    } else {
+      *link = session->next;
+      session->isRunning = false;
+    }
+  }
+}
+
+// Writes the output of the jobs with news and completes the finished ones
+static void continueReady(SerialCLI_Server *server) {
+  uint64_t count;
+  (void)read(SerialCLI_ExecutorGetFd(server->executor), &count, sizeof(count));
+
+  SerialCLI *cli;
+  while (NULL != (cli = SerialCLI_ExecutorTakeReady(server->executor))) {
+    SerialCLI_Session *session = (SerialCLI_Session *)SerialCLI_GetContext(cli);
+    SerialCLI_HostProcess(cli);
+    if (session->isClosing) {
+      (void)SerialCLI_ServerCloseSession(server, session);
+    } else {
+      trackRunning(server, session);
+      updateEvents(server, session);
+    }
+  }
+}
+
+bool SerialCLI_ServerInit(SerialCLI_Server *server, SerialCLI_Session *sessions, size_t sessionCapacity,
+                          const SerialCLI_Registry *registry) {
+  if ((NULL == server) || (NULL == sessions) || (0 == sessionCapacity) ||
+      ((NULL != registry) && !registry->isSealed)) {
+    return false;
+  }
+
+  memset(server, 0, sizeof(*server));
+  server->sessions = sessions;
+  server->sessionCapacity = sessionCapacity;
+  server->registry = registry;
+  server->listenFd = -1;
+  server->epollFd = epoll_create1(EPOLL_CLOEXEC);
+  server->wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  for (size_t i = sessionCapacity; i > 0; --i) {
+    SerialCLI_Session *session = &sessions[i - 1];
+    session->server = server;
+    session->fd = -1;
+    session->ptySlaveFd = -1;
+    session->next = server->freeSessions;
+    server->freeSessions = session;
+  }
+
+  if ((server->epollFd < 0) || (server->wakeFd < 0) || !addToEpoll(server->epollFd, server->wakeFd, &server->wakeFd)) {
+    (void)SerialCLI_ServerClose(server);
+    return false;
+  }
+  return true;
+}
+
+bool SerialCLI_ServerSetCallbacks(SerialCLI_Server *server, SerialCLI_SessionCallback onOpen,
+                                  SerialCLI_SessionCallback onClose, void *context) {
+  if (NULL == server) {
+    return false;
+  }
+
+  server->onOpen = onOpen;
+  server->onClose = onClose;
+  server->context = context;
+  return true;
+}
+
+bool SerialCLI_ServerSetExecutor(SerialCLI_Server *server, SerialCLI_Executor *executor) {
+  if ((NULL == server) || (NULL == executor) || (NULL != server->executor) || (server->epollFd < 0) ||
+      !addToEpoll(server->epollFd, SerialCLI_ExecutorGetFd(executor), executor)) {
+    return false;
+  }
+
+  server->executor = executor;
+  for (size_t i = 0; i < server->sessionCapacity; ++i) {
+    if (server->sessions[i].fd >= 0) {
+      (void)SerialCLI_ExecutorAttach(executor, &server->sessions[i].cli);
+    }
+  }
+  return true;
+}
+
+bool SerialCLI_ServerListenUnix(SerialCLI_Server *server, const char *path) {
+  if ((NULL == server) || (NULL == path) || (server->listenFd >= 0) || (server->epollFd < 0) ||
+      (strlen(path) >= sizeof(server->listenAddress.sun_path))) {
+    return false;
+  }
+
+  memset(&server->listenAddress, 0, sizeof(server->listenAddress));
+  server->listenAddress.sun_family = AF_UNIX;
+  strcpy(server->listenAddress.sun_path, path);
+  (void)unlink(path);
+
+  server->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  bool isListening =
+      (server->listenFd >= 0) &&
+      (0 == bind(server->listenFd, (const struct sockaddr *)&server->listenAddress, sizeof(server->listenAddress))) &&
+      (0 == listen(server->listenFd, SOMAXCONN)) && addToEpoll(server->epollFd, server->listenFd, server);
+  if (!isListening) {
+    SerialCLI_HostCloseDescriptor(&server->listenFd);
+    return false;
+  }
+  return true;
+}
+
+SerialCLI_Session *SerialCLI_ServerOpenSession(SerialCLI_Server *server, int fd) {
+  if ((NULL == server) || (fd < 0) || (server->epollFd < 0)) {
+    return NULL;
+  }
+  return openSession(server, fd, -1);
+}
+
+SerialCLI_Session *SerialCLI_ServerOpenPTY(SerialCLI_Server *server, char *slaveName, size_t slaveNameSize) {
+  int masterFd;
+  int slaveFd;
+  if ((NULL == server) || (NULL == slaveName) || (0 == slaveNameSize) || (server->epollFd < 0) ||
+      !SerialCLI_HostOpenPTYPair(&masterFd, &slaveFd, slaveName, slaveNameSize)) {
+    return NULL;
+  }
+
+  SerialCLI_Session *session = openSession(server, masterFd, slaveFd);
+  if (NULL == session) {
+    SerialCLI_HostCloseDescriptor(&slaveFd);
+    SerialCLI_HostCloseDescriptor(&masterFd);
+  }
+  return session;
+}
+
+bool SerialCLI_ServerCloseSession(SerialCLI_Server *server, SerialCLI_Session *session) {
+  if ((NULL == server) || (NULL == session) || (session->server != server) || (session->fd < 0)) {
+    return false;
+  }
+
+  if (NULL != server->onClose) {
+    server->onClose(server->context, session);
+  }
+
+  if (session->isRunning) {
+    untrackRunning(server, session);
+  }
+
+  // The client may be gone, pending output is discarded
+  session->isClosing = true;
+  (void)SerialCLI_Deinit(&session->cli);
+  (void)epoll_ctl(server->epollFd, EPOLL_CTL_DEL, session->fd, NULL);
+  SerialCLI_HostCloseDescriptor(&session->fd);
+  SerialCLI_HostCloseDescriptor(&session->ptySlaveFd);
+
+  session->next = server->freeSessions;
+  server->freeSessions = session;
+  --server->sessionCount;
+  return true;
+}
+
+bool SerialCLI_ServerPoll(SerialCLI_Server *server, int timeoutMs) {
+  if ((NULL == server) || (server->epollFd < 0)) {
+    return false;
+  }
+
+  // Running commands are continued between checks for input instead of waiting
+  struct epoll_event events[SERIAL_CLI_SERVER_EVENT_BATCH_SIZE];
+  int eventCount = epoll_wait(server->epollFd, events, SERIAL_CLI_SERVER_EVENT_BATCH_SIZE,
+                              (NULL != server->runningSessions) ? 0 : timeoutMs);
+  if (eventCount < 0) {
+    return (EINTR == errno) && !__atomic_load_n(&server->isStopRequested, __ATOMIC_ACQUIRE);
+  }
+
+  bool isAcceptPending = false;
+  for (int i = 0; i < eventCount; ++i) {
+    void *source = events[i].data.ptr;
+    if (source == &server->wakeFd) {
+      uint64_t count;
+      (void)read(server->wakeFd, &count, sizeof(count));
+    } else if (source == server) {
+      isAcceptPending = true;
+    } else if (source == server->executor) {
+      continueReady(server);
+    } else {
+      SerialCLI_Session *session = (SerialCLI_Session *)source;
+      uint32_t sessionEvents = events[i].events;
+      // Room for the output may unblock the lines waiting for it
+      if (0U != (sessionEvents & EPOLLOUT)) {
+        (void)SerialCLI_TxReady(&session->cli);
+        SerialCLI_HostProcess(&session->cli);
+      }
+
+      bool isOpen = true;
+      if (0U != (sessionEvents & EPOLLIN)) {
+        isOpen = SerialCLI_HostReadInput(&session->cli, session->fd);
+      } else if (0U != (sessionEvents & (EPOLLHUP | EPOLLERR))) {
+        isOpen = false;
+      }
+
+      if (!isOpen || session->isClosing) {
+        (void)SerialCLI_ServerCloseSession(server, session);
+      } else {
+        trackRunning(server, session);
+        updateEvents(server, session);
+      }
+    }
+  }
+  continueRunning(server);
+
+  // Accepting last keeps a reused session from receiving events of its previous client
+  if (isAcceptPending) {
+    acceptClients(server);
+  }
+
+  return !__atomic_load_n(&server->isStopRequested, __ATOMIC_ACQUIRE);
+}
+
+bool SerialCLI_ServerRun(SerialCLI_Server *server) {
+  if (NULL == server) {
+    return false;
+  }
+
+  while (SerialCLI_ServerPoll(server, -1)) {
+  }
+  return __atomic_load_n(&server->isStopRequested, __ATOMIC_ACQUIRE);
+}
+
+bool SerialCLI_ServerStop(SerialCLI_Server *server) {
+  if ((NULL == server) || (server->wakeFd < 0)) {
+    return false;
+  }
+
+  __atomic_store_n(&server->isStopRequested, true, __ATOMIC_RELEASE);
+  uint64_t count = 1;
+  return sizeof(count) == write(server->wakeFd, &count, sizeof(count));
+}
+
+bool SerialCLI_ServerClose(SerialCLI_Server *server) {
+  if (NULL == server) {
+    return false;
+  }
+
+  for (size_t i = 0; i < server->sessionCapacity; ++i) {
+    (void)SerialCLI_ServerCloseSession(server, &server->sessions[i]);
+  }
+
+  if (server->listenFd >= 0) {
+    SerialCLI_HostCloseDescriptor(&server->listenFd);
+    (void)unlink(server->listenAddress.sun_path);
+  }
+  SerialCLI_HostCloseDescriptor(&server->wakeFd);
+  SerialCLI_HostCloseDescriptor(&server->epollFd);
+  return true;
+}
@@ -3,6 +3,31 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#ifndef SERIAL_CLI_EMBEDDED_STORAGE
+#define SERIAL_CLI_EMBEDDED_STORAGE 0 ///< Embed default sized buffers used by @ref SerialCLI_Init.
+#endif
+
+#ifndef SERIAL_CLI_ENABLE_METRICS
+#define SERIAL_CLI_ENABLE_METRICS 0 ///< Count traffic and measure commands, see @ref SerialCLI_GetMetrics.
+#endif
+
+#ifndef SERIAL_CLI_ENABLE_FILTERS
+#define SERIAL_CLI_ENABLE_FILTERS 1 ///< Apply the grep, head and count filters after a `|` to the command output.
+#endif
+
+#ifndef SERIAL_CLI_ENABLE_STATIC_COMMANDS
+#define SERIAL_CLI_ENABLE_STATIC_COMMANDS 0 ///< Look up commands placed by @ref SERIAL_CLI_COMMAND.
+#endif
+
+#ifndef SERIAL_CLI_ENABLE_TRACE
+#define SERIAL_CLI_ENABLE_TRACE 0 ///< Compile the trace points in, see @ref SerialCLI_TraceStart.
+#endif
+
+#ifndef SERIAL_CLI_BATCH_MAX_IDLE_STEPS
+#define SERIAL_CLI_BATCH_MAX_IDLE_STEPS 1000 ///< Calls without progress after which @ref SerialCLI_ExecuteBatch stops.
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,10 +38,112 @@ enum {
   SERIAL_CLI_PROMPT_BUFFER_MAX_LENGTH = 32,
   SERIAL_CLI_COMMAND_MAX_ARG_LENGTH = 64,
   SERIAL_CLI_OUTPUT_BUFFER_SIZE = 128,
+  SERIAL_CLI_TX_BUFFER_SIZE = SERIAL_CLI_OUTPUT_BUFFER_SIZE,
+  SERIAL_CLI_RX_RING_SIZE = 64, ///< Size of the embedded receive ring, must be a power of two.
+  SERIAL_CLI_HISTORY_SIZE = 256,
+  SERIAL_CLI_METRICS_BUCKET_COUNT = 8, ///< Latency histogram buckets, see @ref SerialCLI_CommandMetrics.
+  SERIAL_CLI_FILTER_MAX_COUNT = 3,     ///< Filters after one command.
+  SERIAL_CLI_FILTER_PATTERN_SIZE = 64, ///< Bytes of the embedded grep pattern buffer, at most 255.
+  SERIAL_CLI_FILTER_LINE_SIZE = 128,   ///< Bytes of the embedded filter line, longer lines are filtered in pieces.
   SERIAL_CLI_INPUT_BUFFER_SIZE =
       ((SERIAL_CLI_COMMAND_MAX_ARGS * SERIAL_CLI_COMMAND_MAX_ARG_LENGTH) + SERIAL_CLI_COMMAND_MAX_ARG_LENGTH),
 };
 
+/**
+ * Triggers for handing buffered output to the write callback.
+ *
+ * Output is always flushed when the TX buffer is full.
+ */
+typedef enum SerialCLI_FlushPolicy {
+  SERIAL_CLI_FLUSH_EXPLICIT = 0,            ///< Flush only on @ref SerialCLI_Flush.
+  SERIAL_CLI_FLUSH_ON_COMMAND_END = 1 << 0, ///< Flush after each command and each echoed input chunk.
+  SERIAL_CLI_FLUSH_ON_NEWLINE = 1 << 1,     ///< Flush after output containing a line feed.
+  SERIAL_CLI_FLUSH_ON_HIGH_WATER = 1 << 2,  ///< Flush once the buffered output reaches the high-water mark.
+} SerialCLI_FlushPolicy;
+
+/**
+ * Protocols a SerialCLI instance speaks on its link.
+ */
+typedef enum SerialCLI_Mode {
+  SERIAL_CLI_MODE_TEXT = 0,  ///< Interactive lines with echo and prompt.
+  SERIAL_CLI_MODE_RPC = 1,   ///< Framed binary requests and responses, see serial_cli_rpc.h.
+  SERIAL_CLI_MODE_BATCH = 2, ///< Lines executed back to back without echo and prompt.
+} SerialCLI_Mode;
+
+/**
+ * Outcome of an executed line.
+ */
+typedef enum SerialCLI_LineStatus {
+  SERIAL_CLI_LINE_OK = 0,                 ///< The command was executed.
+  SERIAL_CLI_LINE_UNKNOWN_COMMAND = 1,    ///< No command with the name is registered.
+  SERIAL_CLI_LINE_TOO_MANY_ARGUMENTS = 2, ///< The line has more arguments than the instance accepts.
+  SERIAL_CLI_LINE_TOO_LONG = 3,           ///< The line did not fit into the input buffer and was dropped.
+  SERIAL_CLI_LINE_COMMAND_FAILED = 4,     ///< The command reported an error with @ref SerialCLI_FailCommand.
+  SERIAL_CLI_LINE_CANCELLED = 5,          ///< The deferred command was cancelled with Ctrl+C.
+  SERIAL_CLI_LINE_INVALID_FILTER = 6,     ///< A filter after the command is unknown, malformed or not compiled in.
+} SerialCLI_LineStatus;
+
+/**
+ * Directions of the bytes passed to a @ref SerialCLI_Monitor.
+ */
+typedef enum SerialCLI_MonitorDirection {
+  SERIAL_CLI_MONITOR_INPUT = 0,  ///< A chunk passed to @ref SerialCLI_Read.
+  SERIAL_CLI_MONITOR_OUTPUT = 1, ///< Bytes handed to the write callback or the TX ring.
+} SerialCLI_MonitorDirection;
+
+/**
+ * Summary of a batch executed by @ref SerialCLI_ExecuteBatch.
+ */
+typedef struct SerialCLI_BatchResult {
+  size_t lineCount;                       ///< Commands executed, every command of a chained line counts.
+  size_t failedCount;                     ///< Commands that did not end with SERIAL_CLI_LINE_OK.
+  size_t firstFailedLine;                 ///< Line number of the first failure starting at 1, 0 if none.
+  SerialCLI_LineStatus firstFailedStatus; ///< Status of the first failure.
+  bool isStalled;                         ///< The batch stopped at a line that made no progress.
+} SerialCLI_BatchResult;
+
+/**
+ * Bytes written by the line editor, see @ref SerialCLI_GetEditStats.
+ *
+ * Typing at the end of the line is plain echo and not counted as an edit.
+ */
+typedef struct SerialCLI_EditStats {
+  size_t editCount;     ///< Edits shown on the terminal.
+  size_t bytesWritten;  ///< Bytes written to show the edits.
+  size_t bytesSaved;    ///< Bytes saved compared with redrawing the whole line for every edit.
+  size_t lastEditSaved; ///< Bytes saved by the most recent edit.
+} SerialCLI_EditStats;
+
+/**
+ * Counters of a SerialCLI instance, see @ref SerialCLI_GetMetrics.
+ */
+typedef struct SerialCLI_Metrics {
+  size_t bytesIn;           ///< Bytes passed to @ref SerialCLI_Read, including those drained from the receive ring.
+  size_t bytesOut;          ///< Bytes handed to the write callback.
+  size_t linesExecuted;     ///< Lines and RPC requests that ran a command, failed and cancelled ones included.
+  size_t linesRejected;     ///< Lines with an unknown command, too many arguments or a bad filter, bad RPC requests.
+  size_t linesDropped;      ///< Lines and frames dropped because they did not fit into the input buffer.
+  size_t commandsFailed;    ///< Commands that reported an error with @ref SerialCLI_FailCommand.
+  size_t commandsCancelled; ///< Deferred commands that were cancelled.
+  size_t rxDropped;         ///< Bytes the receive ring could not accept.
+  size_t txDropped;         ///< Bytes the TX ring could not accept.
+} SerialCLI_Metrics;
+
+/**
+ * Latencies of one command, see @ref SerialCLI_GetCommandMetrics.
+ *
+ * Bucket n counts the calls that took less than 10^(n + 1) microseconds and
+ * do not fit a lower bucket, the last bucket counts all longer calls.
+ * A deferred command is measured until it completes. Without a clock set
+ * by @ref SerialCLI_SetMetricsClock only callCount is kept.
+ */
+typedef struct SerialCLI_CommandMetrics {
+  size_t callCount;                                  ///< Calls of the command.
+  uint64_t totalTime;                                ///< Sum of the measured calls in microseconds.
+  uint32_t maxTime;                                  ///< Longest measured call in microseconds.
+  size_t histogram[SERIAL_CLI_METRICS_BUCKET_COUNT]; ///< Measured calls per latency bucket.
+} SerialCLI_CommandMetrics;
+
 // Forward declaration
 typedef struct SerialCLI SerialCLI;
 
@@ -36,40 +163,409 @@ typedef void (*SerialCLI_Command)(SerialCLI *cli, int argc, const char **argv);
  */
 typedef void (*SerialCLI_Write)(const char *str, size_t len);
 
+/**
+ * Callback function to write a string to the serial interface of one instance.
+ *
+ * @param context The context passed to @ref SerialCLI_InitWithContext.
+ * @param str The string to write.
+ * @param len The length of the string.
+ */
+typedef void (*SerialCLI_ContextWrite)(void *context, const char *str, size_t len);
+
+/**
+ * Callback function to write to a transport that may not take all bytes.
+ *
+ * Must not block. The bytes not accepted are kept in the TX ring and offered
+ * again by @ref SerialCLI_TxReady.
+ *
+ * @param context The context passed to @ref SerialCLI_InitNonBlocking.
+ * @param str The string to write.
+ * @param len The length of the string.
+ *
+ * @return The number of bytes accepted, 0 if the transport is full.
+ */
+typedef size_t (*SerialCLI_NonBlockingWrite)(void *context, const char *str, size_t len);
+
+/**
+ * Callback function receiving the outcome of each executed line.
+ *
+ * Empty lines are skipped, every command of a chained line is reported on
+ * its own. Lines dropped for their length are reported by
+ * @ref SerialCLI_Read returning false instead.
+ *
+ * @param context The context passed to @ref SerialCLI_SetLineResultCallback.
+ * @param status The outcome of the line.
+ */
+typedef void (*SerialCLI_LineResultCallback)(void *context, SerialCLI_LineStatus status);
+
+/**
+ * Callback function reading a free-running clock for the command latencies.
+ *
+ * Differences are taken modulo 2^32, so the clock may wrap around.
+ *
+ * @param context The context passed to @ref SerialCLI_SetMetricsClock.
+ *
+ * @return The current time in microseconds.
+ */
+typedef uint32_t (*SerialCLI_MetricsClock)(void *context);
+
+/**
+ * Callback function continuing a command deferred with @ref SerialCLI_Defer.
+ *
+ * Each call should do a bounded slice of work. After a cancelled call the
+ * continuation is not called again, it must release its state.
+ *
+ * @param cli The SerialCLI instance.
+ * @param state The state passed to SerialCLI_Defer.
+ * @param isCancelled True if Ctrl+C was received or the instance is deinitialized.
+ *
+ * @return true once the command is complete, false to be called again.
+ */
+typedef bool (*SerialCLI_Continuation)(SerialCLI *cli, void *state, bool isCancelled);
+
+/**
+ * Callback function offered every command before it is called.
+ *
+ * The runner may take over the command, e.g. to run it on another thread,
+ * and then continues it with @ref SerialCLI_Defer. The arguments are only
+ * valid during the call. The built-in commands are never offered.
+ *
+ * @param context The context passed to @ref SerialCLI_SetCommandRunner.
+ * @param cli The SerialCLI instance.
+ * @param command The command function.
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ *
+ * @return true if the runner took over the command, false to call it right away.
+ */
+typedef bool (*SerialCLI_CommandRunner)(void *context, SerialCLI *cli, SerialCLI_Command command, int argc,
+                                        const char **argv);
+
+/**
+ * Callback function observing the bytes crossing the link of an instance.
+ *
+ * Input is observed before it is processed, output once it leaves the TX
+ * buffer. The monitor must not call back into the instance.
+ *
+ * @param context The context passed to @ref SerialCLI_SetMonitor.
+ * @param direction The direction of the bytes.
+ * @param data The bytes.
+ * @param length The number of bytes.
+ */
+typedef void (*SerialCLI_Monitor)(void *context, SerialCLI_MonitorDirection direction, const char *data,
+                                  size_t length);
+
+/**
+ * Node of the crit-bit prefix trie over command names.
+ *
+ * A trie with n commands has n - 1 internal nodes, so every registered
+ * entry carries the storage of one of them.
+ */
+typedef struct SerialCLI_TrieNode {
+  struct SerialCLI_CommandEntry *child[2]; ///< Child entries.
+  uint16_t byte;                           ///< Index of the critical byte.
+  uint8_t otherBits;                       ///< Critical byte mask with all but the critical bit set.
+  uint8_t leafMask;                        ///< Bit n set if child[n] is a leaf rather than an internal node.
+} SerialCLI_TrieNode;
+
+/**
+ * Crit-bit prefix trie over the names of a set of commands.
+ */
+typedef struct SerialCLI_CommandTrie {
+  struct SerialCLI_CommandEntry *root; ///< Root of the trie, NULL if it is empty.
+  uint8_t rootLeafMask;                ///< Set if the root is a leaf.
+} SerialCLI_CommandTrie;
+
 typedef struct SerialCLI_CommandEntry {
-  SerialCLI_Command command;           ///< The command function.
-  const char *commandName;             ///< Name of the command.
-  const char *commandDescription;      ///< Description of the command.
-  struct SerialCLI_CommandEntry *next; ///< Set automatically when registered.
+  SerialCLI_Command command;                   ///< The command function, NULL for the entry of a group.
+  const char *commandName;                     ///< Name of the command.
+  const char *commandDescription;              ///< Description of the command.
+  struct SerialCLI_CommandEntry *next;         ///< Set automatically when registered.
+  struct SerialCLI_CommandEntry *idChild[2];   ///< Entries with a lower and higher ID key. Set automatically.
+  struct SerialCLI_CommandEntry *parent;       ///< Entry of the group of a subcommand. Set automatically.
+  uint32_t commandId;                          ///< RPC command ID, the group's for a subcommand. Set automatically.
+  SerialCLI_TrieNode trieNode;                 ///< Set automatically when registered.
+#if SERIAL_CLI_ENABLE_METRICS
+  SerialCLI_CommandMetrics metrics; ///< Set automatically when executed.
+#endif
 } SerialCLI_CommandEntry;
 
+/**
+ * Group of subcommands, such as gpio in "gpio set 3 1".
+ *
+ * The word after the name of a group selects one of its subcommands, which
+ * may be a group itself. Every group indexes its own subcommands, so a line
+ * is dispatched with one lookup per level however many commands there are.
+ */
+typedef struct SerialCLI_CommandGroup {
+  SerialCLI_CommandEntry entry;         ///< Name and description of the group.
+  SerialCLI_CommandEntry *commands;     ///< Subcommands in registration order. Set automatically when registered.
+  SerialCLI_CommandEntry *commandsTail; ///< Set automatically when registered.
+  SerialCLI_CommandTrie trie;           ///< Set automatically when registered.
+} SerialCLI_CommandGroup;
+
+/**
+ * Command placed in the serial_cli_cmds linker section by @ref SERIAL_CLI_COMMAND.
+ *
+ * The linker collects the commands of all translation units into one table
+ * sorted by name, which every instance searches after its registered
+ * commands. Nothing is written to the record, so it can stay in flash.
+ */
+typedef struct SerialCLI_StaticCommand {
+  SerialCLI_Command command;      ///< The command function.
+  const char *commandName;        ///< Name of the command.
+  const char *commandDescription; ///< Description of the command.
+#if SERIAL_CLI_ENABLE_METRICS
+  SerialCLI_CommandMetrics *metrics; ///< Latencies of the command, shared by all instances.
+#endif
+} SerialCLI_StaticCommand;
+
+#if SERIAL_CLI_ENABLE_STATIC_COMMANDS
+
+// Input section of one command, the linker sorts the table by the section names. Section names that are
+// identifiers keep AddressSanitizer from padding the records apart.
+#define SERIAL_CLI_STATIC_COMMAND_ATTRIBUTES(name)                                                                    \
+  __attribute__((used, section("serial_cli_cmds_" #name), aligned(__alignof__(SerialCLI_StaticCommand))))
+
+/**
+ * Define a command without registering it.
+ *
+ * Places a const @ref SerialCLI_StaticCommand in the serial_cli_cmds linker
+ * section at file scope, such as SERIAL_CLI_COMMAND(reboot, rebootCommand,
+ * "Restarts the device");. The name must be a C identifier and unique among
+ * the static commands, registered commands must not reuse it. The section
+ * is sorted and delimited by serial_cli_cmds.ld, which must be part of the
+ * link. Initializing an instance fails for a table that is not sorted or
+ * that defines help.
+ *
+ * @param name The name of the command, an identifier rather than a string.
+ * @param function The @ref SerialCLI_Command.
+ * @param description The description of the command.
+ */
+#if SERIAL_CLI_ENABLE_METRICS
+#define SERIAL_CLI_COMMAND(name, function, description)                                                               \
+  static SerialCLI_CommandMetrics serialCliCommandMetrics_##name;                                                     \
+  static const SerialCLI_StaticCommand serialCliCommand_##name SERIAL_CLI_STATIC_COMMAND_ATTRIBUTES(name) = {         \
+      (function), #name, (description), &serialCliCommandMetrics_##name}
+#else
+#define SERIAL_CLI_COMMAND(name, function, description)                                                               \
+  static const SerialCLI_StaticCommand serialCliCommand_##name SERIAL_CLI_STATIC_COMMAND_ATTRIBUTES(name) = {         \
+      (function), #name, (description)}
+#endif
+
+#endif
+
+/**
+ * Set of commands shared by any number of SerialCLI instances.
+ *
+ * The registry is built once with @ref SerialCLI_RegistryAddCommand and its
+ * siblings, sealed with @ref SerialCLI_SealRegistry and then attached to the
+ * instances with @ref SerialCLI_AttachRegistry. The instances only read it,
+ * attaching costs one pointer however many commands it holds. The commands
+ * registered with an instance are its overlay and are looked up before the
+ * shared ones.
+ */
+typedef struct SerialCLI_Registry {
+  SerialCLI_CommandEntry *commands;     ///< Top-level commands in registration order, NULL if none.
+  SerialCLI_CommandEntry *commandsTail; ///< Last top-level command.
+
+  SerialCLI_CommandEntry *idRoot;       ///< Search tree over the RPC command IDs, NULL if empty.
+  SerialCLI_CommandTrie commandTrie;    ///< Crit-bit trie over the command names.
+
+  bool isSealed;          ///< Set by @ref SerialCLI_SealRegistry, no commands are added afterwards.
+  uint32_t nextCommandId; ///< RPC command ID of the next top-level command.
+} SerialCLI_Registry;
+
+/**
+ * Buffers of a SerialCLI instance provided by the caller.
+ *
+ * Lets every instance size its buffers instead of using the defaults.
+ */
+typedef struct SerialCLI_Storage {
+  char *inputBuffer;      ///< Queued lines and current line, inputBufferSize + 1 bytes.
+  size_t inputBufferSize; ///< Usable size of the input buffer, at least 2.
+  const char **argv;      ///< Argument pointers, maxArgs + 1 entries.
+  size_t maxArgs;         ///< Maximum number of arguments including the command name.
+  char *txBuffer;           ///< Output waiting for the write callback, txBufferSize + 1 bytes.
+  size_t txBufferSize;      ///< Usable size of the TX buffer.
+  char *historyBuffer;      ///< Byte ring of recent lines, may be NULL.
+  size_t historyBufferSize; ///< Size of the history buffer, 0 disables the history.
+  char *rxRing;             ///< Receive ring of @ref SerialCLI_ReadFromISR, may be NULL.
+  size_t rxRingSize;        ///< Size of the receive ring, a power of two or 0 to drop all interrupt input.
+  char *filterLine;         ///< Output line collected for the filters, may be NULL.
+  size_t filterLineSize;    ///< Size of the filter line buffer, 0 rejects every `|`.
+  char *filterPatterns;     ///< grep patterns of the running command, may be NULL.
+  size_t filterPatternSize; ///< Size of the pattern buffer, at most 255, 0 rejects every grep.
+} SerialCLI_Storage;
+
+/**
+ * Filter applied to the output of a command, see @ref SerialCLI_Process.
+ */
+typedef struct SerialCLI_Filter {
+  uint8_t type;          ///< grep, head or count.
+  bool isInverted;       ///< Flag indicating if grep passes the lines without the pattern.
+  uint8_t patternStart;  ///< Offset of the grep pattern in the pattern buffer.
+  uint8_t patternLength; ///< Length of the grep pattern.
+  size_t count;          ///< Lines head still passes, or lines counted so far.
+} SerialCLI_Filter;
+
 typedef struct SerialCLI {
-  SerialCLI_Write write;           ///< The write callback function.
-  SerialCLI_CommandEntry commands; ///< Linked list of registered commands.
+  SerialCLI_Write write;                       ///< The write callback function.
+  SerialCLI_ContextWrite contextWrite;         ///< The write callback function taking the context.
+  SerialCLI_NonBlockingWrite nonBlockingWrite; ///< The write callback function that may not take all bytes.
+  void *context;                               ///< The user context of the instance.
+  SerialCLI_Mode mode;                         ///< The protocol spoken on the link.
+  SerialCLI_LineResultCallback onLineResult;   ///< Receives the outcome of each executed line.
+  void *lineResultContext;                     ///< The context passed to onLineResult.
+  SerialCLI_CommandRunner commandRunner;       ///< Offered every command before it is called, NULL if none.
+  void *commandRunnerContext;                  ///< The context passed to commandRunner.
+  SerialCLI_Monitor monitor;                   ///< Observes the input and output bytes, NULL if none.
+  void *monitorContext;                        ///< The context passed to monitor.
+  unsigned flushPolicy;                        ///< Combination of @ref SerialCLI_FlushPolicy flags.
+  size_t txHighWaterMark;                      ///< Buffered output size triggering a high-water flush.
+  size_t txLength;                             ///< The number of bytes in the TX buffer.
+  SerialCLI_CommandEntry helpEntry;            ///< The built-in help command.
+  SerialCLI_Registry commands;                 ///< Commands registered with the instance, the help command first.
+  const SerialCLI_Registry *registry;          ///< Commands shared with other instances, NULL if none.
+
+  bool isTabPending;             ///< Flag indicating if the last input character was a TAB.
+  bool isLineDiscarded;          ///< Flag indicating if the current line overflowed and is being dropped.
+  bool isLastCharCarriageReturn; ///< Flag indicating if the last input character was a CR.
+  uint8_t escapeState;           ///< State of the parser for escape sequences sent by terminal keys.
+  uint16_t escapeParameter;      ///< Numeric parameter of the escape sequence being received.
+  size_t queuedLength;           ///< The number of bytes of complete lines at the start of the input buffer.
+  size_t queuedLines;            ///< The number of complete lines waiting to be processed.
+  size_t charCount;              ///< The number of characters in the line being received.
+  size_t cursorPosition;         ///< Position of the terminal cursor within the line being received.
+  size_t tokenCount;             ///< The number of extracted arguments.
+  bool isCommandFailed;          ///< Flag indicating if the running command reported an error.
+  bool isRpcRequestActive;       ///< Flag indicating if output belongs to the RPC request being executed.
+  uint16_t rpcRequestId;         ///< ID of the RPC request being executed.
+
+  uint8_t chainOperator;            ///< Operator before the rest of the first queued line, none at its start.
+  bool isLineBreakWritten;          ///< Flag indicating if the output of the line was moved past the echo.
+  SerialCLI_LineStatus chainStatus; ///< Outcome of the previous command of the line.
+
+  SerialCLI_Continuation continuation; ///< Continuation of the deferred command, NULL if none is running.
+  void *continuationState;             ///< State passed to the continuation.
+  bool isCancelRequested;              ///< Flag indicating if Ctrl+C was received, set by either side of the ring.
+
+  char promptBuffer[SERIAL_CLI_PROMPT_BUFFER_MAX_LENGTH + 1]; ///< The prompt buffer.
+  char *inputBuffer;                                          ///< Queued lines and current line.
+  size_t inputBufferSize;                                     ///< Usable size of the input buffer.
+  const char **argv;                                          ///< Arguments, pointing into the input buffer.
+  size_t maxArgs;                                             ///< Maximum number of arguments.
+  char *txBuffer;                                             ///< Output waiting for the write callback.
+  size_t txBufferSize;                                        ///< Usable size of the TX buffer.
+
+  char *txRing;        ///< Output the non-blocking write callback did not accept yet.
+  size_t txRingSize;   ///< Size of the TX ring.
+  size_t txRingStart;  ///< Ring offset of the oldest pending byte.
+  size_t txRingLength; ///< The number of pending bytes.
+  size_t txDropped;    ///< Bytes dropped because the TX ring was full.
+
+  char *historyBuffer;           ///< Byte ring of recent lines.
+  size_t historySize;            ///< Size of the history ring, 0 if there is no history.
+  size_t historyHead;            ///< Ring offset where the next entry starts.
+  size_t historyLength;          ///< Bytes taken by the entries.
+  size_t historyCursor;          ///< Ring offset of the recalled entry or search match, SIZE_MAX if none.
+  bool isHistorySearching;       ///< Flag indicating if the reverse incremental search is active.
+  SerialCLI_EditStats editStats; ///< Bytes written by the line editor.
 
-  bool isCommandReady; ///< Flag indicating if a command is ready to be processed.
-  size_t charCount;    ///< The number of characters in the input buffer.
-  size_t tokenCount;   ///< The number of extracted tokens.
+  char *rxRing;      ///< Bytes received from interrupt context.
+  size_t rxRingSize; ///< Size of the receive ring, a power of two or 0.
+  size_t rxHead;     ///< Receive ring write index, owned by the producer.
+  size_t rxTail;     ///< Receive ring read index, owned by the consumer.
+  size_t rxDropped;  ///< Bytes the receive ring could not accept, owned by the producer.
 
-  char promptBuffer[SERIAL_CLI_PROMPT_BUFFER_MAX_LENGTH + 1];                      ///< The prompt buffer.
-  char inputBuffer[SERIAL_CLI_INPUT_BUFFER_SIZE + 1];                              ///< The input buffer.
-  char tokens[SERIAL_CLI_COMMAND_MAX_ARGS][SERIAL_CLI_COMMAND_MAX_ARG_LENGTH + 1]; ///< Extracted tokens.
+#if SERIAL_CLI_ENABLE_METRICS
+  SerialCLI_Metrics metrics;              ///< Counters, rxDropped and txDropped hold their values at the last reset.
+  SerialCLI_MetricsClock metricsClock;    ///< Clock measuring the commands, NULL if none.
+  void *metricsClockContext;              ///< The context passed to metricsClock.
+  SerialCLI_CommandMetrics *timedCommand; ///< Latencies of the command being measured, NULL if none.
+  uint32_t timedCommandStart;             ///< Clock value when the measured command started.
+  SerialCLI_CommandEntry statsEntry;      ///< The built-in stats command.
+#endif
+
+#if SERIAL_CLI_ENABLE_TRACE
+  uint32_t traceInstance; ///< Tag of the trace records written by this instance.
+#endif
+
+#if SERIAL_CLI_ENABLE_FILTERS
+  SerialCLI_Filter filters[SERIAL_CLI_FILTER_MAX_COUNT]; ///< Filters of the running command in pipe order.
+  size_t filterCount;                                    ///< The number of filters of the running command.
+  bool isOutputFiltered;                                 ///< Flag indicating if output passes the filters first.
+  char *filterPatterns;                                  ///< grep patterns of the running command.
+  size_t filterPatternSize;                              ///< Size of the pattern buffer.
+  size_t filterPatternLength;                            ///< Bytes taken in the pattern buffer.
+  char *filterLine;                                      ///< Output line collected for the filters.
+  size_t filterLineSize;                                 ///< Size of the line buffer, 0 if there are no filters.
+  size_t filterLineLength;                               ///< The number of bytes in the line buffer.
+#endif
+
+#if SERIAL_CLI_EMBEDDED_STORAGE
+  char embeddedInputBuffer[SERIAL_CLI_INPUT_BUFFER_SIZE + 1]; ///< Default input buffer.
+  const char *embeddedArgv[SERIAL_CLI_COMMAND_MAX_ARGS + 1];  ///< Default argument pointers.
+  char embeddedTxBuffer[SERIAL_CLI_TX_BUFFER_SIZE + 1];       ///< Default TX buffer.
+  char embeddedHistoryBuffer[SERIAL_CLI_HISTORY_SIZE];        ///< Default history ring.
+  char embeddedRxRing[SERIAL_CLI_RX_RING_SIZE];               ///< Default receive ring.
+#if SERIAL_CLI_ENABLE_FILTERS
+  char embeddedFilterPatterns[SERIAL_CLI_FILTER_PATTERN_SIZE]; ///< Default grep pattern buffer.
+  char embeddedFilterLine[SERIAL_CLI_FILTER_LINE_SIZE];        ///< Default filter line buffer.
+#endif
+#endif
 } SerialCLI;
 
 /**
  * Function to read a string from the serial interface.
  *
+ * Accepts chunks of any size. CR, LF and CR LF end a line, complete lines
+ * are queued in the input buffer until @ref SerialCLI_Process executes them.
+ * A line that does not fit into the input buffer is dropped up to its line
+ * ending. In SERIAL_CLI_MODE_TEXT the line can be edited with the left and
+ * right arrow keys, Home, End, Delete, Ctrl+A, Ctrl+E, Ctrl+K, Ctrl+U and
+ * Ctrl+W, the up and down arrow keys recall lines from the history and
+ * Ctrl+R searches it backwards. SERIAL_CLI_MODE_BATCH
+ * neither echoes nor edits lines, in SERIAL_CLI_MODE_RPC a zero byte ends a
+ * frame instead of a line.
+ *
  * @param cli The SerialCLI instance.
  * @param str The buffer to read the string into.
  * @param len The length of the buffer.
  *
- * @return true if the string was read successfully, false otherwise.
+ * @return true if the string was read successfully, false if input was dropped.
  */
 bool SerialCLI_Read(SerialCLI *cli, const char *str, size_t len);
 
+/**
+ * Function to read a string from interrupt context or from a reader thread.
+ *
+ * The bytes are stored in a wait-free single-producer/single-consumer ring
+ * that @ref SerialCLI_Process drains. There must be a single producer, the
+ * consumer is the caller of SerialCLI_Process. Echo and command output are
+ * written from SerialCLI_Process, never from this function. The ring holds
+ * SERIAL_CLI_RX_RING_SIZE bytes or the size given in @ref SerialCLI_Storage,
+ * SerialCLI_Process moves as much of it into the input buffer as fits there,
+ * so the ring only has to take the input arriving between two calls.
+ * Ctrl+C received while a deferred command runs is not stored, it cancels
+ * the command right away, see @ref SerialCLI_Defer.
+ *
+ * @param cli The SerialCLI instance.
+ * @param str The received bytes.
+ * @param len The number of received bytes.
+ *
+ * @return The number of bytes accepted, bytes beyond the free ring space are dropped.
+ */
+size_t SerialCLI_ReadFromISR(SerialCLI *cli, const char *str, size_t len);
+
 /**
  * Initialize the SerialCLI.
  *
+ * Uses the embedded default sized buffers, fails unless SERIAL_CLI_EMBEDDED_STORAGE
+ * is 1. The default build has no embedded buffers and takes them with
+ * @ref SerialCLI_InitWithStorage instead. Like every initialization it also fails if the commands of
+ * @ref SERIAL_CLI_COMMAND are not sorted by name.
+ *
  * @param cli The SerialCLI instance.
  * @param write The write callback function.
  *
@@ -77,6 +573,66 @@ bool SerialCLI_Read(SerialCLI *cli, const char *str, size_t len);
  */
 bool SerialCLI_Init(SerialCLI *cli, SerialCLI_Write write);
 
+/**
+ * Initialize the SerialCLI with a write callback receiving a user context.
+ *
+ * Lets a single callback serve many instances, e.g. one per session. Uses the
+ * embedded default sized buffers, fails unless SERIAL_CLI_EMBEDDED_STORAGE is 1.
+ *
+ * @param cli The SerialCLI instance.
+ * @param write The write callback function.
+ * @param context The user context passed to the write callback.
+ *
+ * @return true if the initialization was successful, false otherwise.
+ */
+bool SerialCLI_InitWithContext(SerialCLI *cli, SerialCLI_ContextWrite write, void *context);
+
+/**
+ * Initialize the SerialCLI with buffers provided by the caller.
+ *
+ * The buffers must stay valid until the instance is deinitialized.
+ *
+ * @param cli The SerialCLI instance.
+ * @param storage The buffers, the descriptor itself is not referenced after the call.
+ * @param write The write callback function.
+ * @param context The user context passed to the write callback.
+ *
+ * @return true if the initialization was successful, false otherwise.
+ */
+bool SerialCLI_InitWithStorage(SerialCLI *cli, const SerialCLI_Storage *storage, SerialCLI_ContextWrite write,
+                               void *context);
+
+/**
+ * Initialize the SerialCLI with a non-blocking write callback.
+ *
+ * Output the callback does not accept is kept in the TX ring, the transport
+ * calls @ref SerialCLI_TxReady once it has room again. Output that does not
+ * fit into the ring either is dropped and counted in txDropped, commands
+ * writing a lot check @ref SerialCLI_GetTxSpace and continue deferred.
+ * Queued lines are executed only while the ring has room for a full TX
+ * buffer. The buffers must stay valid until the instance is deinitialized.
+ *
+ * @param cli The SerialCLI instance.
+ * @param storage The buffers, NULL for the embedded default sized buffers.
+ * @param write The write callback function.
+ * @param context The user context passed to the write callback.
+ * @param txRing The TX ring.
+ * @param txRingSize The size of the TX ring, at least the size of the TX buffer.
+ *
+ * @return true if the initialization was successful, false otherwise.
+ */
+bool SerialCLI_InitNonBlocking(SerialCLI *cli, const SerialCLI_Storage *storage, SerialCLI_NonBlockingWrite write,
+                               void *context, char *txRing, size_t txRingSize);
+
+/**
+ * Get the user context of the SerialCLI.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return The context passed to @ref SerialCLI_InitWithContext, NULL otherwise.
+ */
+void *SerialCLI_GetContext(const SerialCLI *cli);
+
 /**
  * Deinitialize the SerialCLI.
  *
@@ -89,10 +645,15 @@ bool SerialCLI_Deinit(SerialCLI *cli);
 /**
  * Register a command with the SerialCLI.
  *
- * Command name must be unique and has a maximum length defined by
- * SERIAL_CLI_COMMAND_MAX_ARG_LENGTH. @ref SerialCLI_CommandEntry must
- * be statically allocated and remain valid for the lifetime of the
- * SerialCLI instance.
+ * Command name must be unique, also among the commands of
+ * @ref SERIAL_CLI_COMMAND, and has a maximum length defined by
+ * SERIAL_CLI_COMMAND_MAX_ARG_LENGTH. The command gets the next command ID
+ * of @ref SERIAL_CLI_MODE_RPC in registration order, see serial_cli_rpc.h.
+ * @ref SerialCLI_CommandEntry must be statically allocated and remain valid
+ * for the lifetime of the SerialCLI instance. Commands are found by name
+ * through a crit-bit trie and by command ID through a binary search tree,
+ * both linked through the entries so the instance holds no index. Lookup
+ * and registration cost grows with the logarithm of the number of commands.
  *
  * @param cli The SerialCLI instance.
  * @param command The command to register.
@@ -101,6 +662,115 @@ bool SerialCLI_Deinit(SerialCLI *cli);
  */
 bool SerialCLI_RegisterCommand(SerialCLI *cli, SerialCLI_CommandEntry *command);
 
+/**
+ * Register a group of subcommands.
+ *
+ * Typing the name of the group alone or "help <group>" lists its
+ * subcommands, tab completion after the name completes them. The command
+ * of the group entry is ignored. The name must be unique within the parent,
+ * the same rules as for @ref SerialCLI_RegisterCommand apply otherwise.
+ *
+ * @param cli The SerialCLI instance.
+ * @param parent The registered group to add the group to, NULL for the top level.
+ * @param group The group to register.
+ *
+ * @return true if registration was successful, false otherwise.
+ */
+bool SerialCLI_RegisterGroup(SerialCLI *cli, SerialCLI_CommandGroup *parent, SerialCLI_CommandGroup *group);
+
+/**
+ * Register a command as a subcommand of a group.
+ *
+ * The command is called with the arguments from its own name on, so
+ * "gpio set 3 1" calls the set command of the gpio group with argv
+ * {"set", "3", "1"}. The name must be unique within the group.
+ *
+ * @param cli The SerialCLI instance.
+ * @param group The registered group, NULL for the top level.
+ * @param command The command to register.
+ *
+ * @return true if registration was successful, false otherwise.
+ */
+bool SerialCLI_RegisterSubcommand(SerialCLI *cli, SerialCLI_CommandGroup *group, SerialCLI_CommandEntry *command);
+
+/**
+ * Initialize an empty registry of shared commands.
+ *
+ * @param registry The registry.
+ *
+ * @return true if the initialization was successful, false otherwise.
+ */
+bool SerialCLI_InitRegistry(SerialCLI_Registry *registry);
+
+/**
+ * Add a command to a registry.
+ *
+ * The same rules as for @ref SerialCLI_RegisterCommand apply. Commands can
+ * only be added until the registry is sealed.
+ *
+ * @param registry The registry.
+ * @param command The command to add.
+ *
+ * @return true if the command was added, false otherwise.
+ */
+bool SerialCLI_RegistryAddCommand(SerialCLI_Registry *registry, SerialCLI_CommandEntry *command);
+
+/**
+ * Add a group of subcommands to a registry.
+ *
+ * @param registry The registry.
+ * @param parent A group of the registry to add the group to, NULL for the top level.
+ * @param group The group to add.
+ *
+ * @return true if the group was added, false otherwise.
+ */
+bool SerialCLI_RegistryAddGroup(SerialCLI_Registry *registry, SerialCLI_CommandGroup *parent,
+                                SerialCLI_CommandGroup *group);
+
+/**
+ * Add a command as a subcommand of a group of a registry.
+ *
+ * @param registry The registry.
+ * @param group A group of the registry, NULL for the top level.
+ * @param command The command to add.
+ *
+ * @return true if the command was added, false otherwise.
+ */
+bool SerialCLI_RegistryAddSubcommand(SerialCLI_Registry *registry, SerialCLI_CommandGroup *group,
+                                     SerialCLI_CommandEntry *command);
+
+/**
+ * Seal a registry so it can be attached.
+ *
+ * No commands or groups are added afterwards, so instances on other threads
+ * may attach the registry and look commands up concurrently.
+ *
+ * @param registry The registry.
+ *
+ * @return true if the registry was sealed, false otherwise.
+ */
+bool SerialCLI_SealRegistry(SerialCLI_Registry *registry);
+
+/**
+ * Attach a registry of shared commands to the SerialCLI.
+ *
+ * Commands registered with the instance are looked up first, help and tab
+ * completion list them before the shared ones. No name may be both
+ * registered with the instance and shared, this includes the built-in
+ * commands. Groups of the registry cannot be extended through the instance.
+ * With SERIAL_CLI_ENABLE_METRICS the latencies of shared commands are
+ * shared by the instances too.
+ *
+ * The registry must be sealed and remain valid while it is attached. Any
+ * number of instances may attach it, including instances on other threads.
+ *
+ * @param cli The SerialCLI instance.
+ * @param registry The registry, NULL to detach the current one.
+ *
+ * @return true if the registry was attached, false if it is not sealed, a name clashes or a command is running.
+ */
+bool SerialCLI_AttachRegistry(SerialCLI *cli, const SerialCLI_Registry *registry);
+
 /**
  * Write a string to the SerialCLI output.
  *
@@ -112,6 +782,269 @@ bool SerialCLI_RegisterCommand(SerialCLI *cli, SerialCLI_CommandEntry *command);
  */
 bool SerialCLI_WriteString(SerialCLI *cli, const char *format, ...);
 
+/**
+ * Write bytes to the SerialCLI output as they are.
+ *
+ * Unlike @ref SerialCLI_WriteString the output is neither formatted nor
+ * limited in length.
+ *
+ * @param cli The SerialCLI instance.
+ * @param data The bytes.
+ * @param length The number of bytes.
+ *
+ * @return true if the bytes were written successfully, false otherwise.
+ */
+bool SerialCLI_WriteBytes(SerialCLI *cli, const char *data, size_t length);
+
+/**
+ * Hand all buffered output to the write callback.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if the output was flushed successfully, false otherwise.
+ */
+bool SerialCLI_Flush(SerialCLI *cli);
+
+/**
+ * Offer the output kept in the TX ring to the non-blocking write callback again.
+ *
+ * Called by the transport once it has room, from the context that calls
+ * @ref SerialCLI_Process. SerialCLI_Process offers the output as well.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if no output is pending, false if output is left in the ring or cli is NULL.
+ */
+bool SerialCLI_TxReady(SerialCLI *cli);
+
+/**
+ * Get the number of output bytes that can be written without dropping any.
+ *
+ * Output buffered for the write callback is taken into account.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return The free space, SIZE_MAX for a blocking write callback, 0 if cli is NULL.
+ */
+size_t SerialCLI_GetTxSpace(const SerialCLI *cli);
+
+/**
+ * Get the number of output bytes kept in the TX ring.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return The number of pending bytes.
+ */
+size_t SerialCLI_GetTxPending(const SerialCLI *cli);
+
+/**
+ * Check if queued lines wait for room in the TX ring.
+ *
+ * While blocked the transport should stop reading input until
+ * @ref SerialCLI_TxReady made room, or the input buffer fills up.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if the TX ring has less room than a full TX buffer, false otherwise.
+ */
+bool SerialCLI_IsTxBlocked(const SerialCLI *cli);
+
+/**
+ * Set when buffered output is handed to the write callback.
+ *
+ * The default policy is SERIAL_CLI_FLUSH_ON_COMMAND_END.
+ *
+ * @param cli The SerialCLI instance.
+ * @param policy Combination of @ref SerialCLI_FlushPolicy flags.
+ * @param highWaterMark Buffered output size for SERIAL_CLI_FLUSH_ON_HIGH_WATER,
+ *                      at most the TX buffer size.
+ *
+ * @return true if the policy was set successfully, false otherwise.
+ */
+bool SerialCLI_SetFlushPolicy(SerialCLI *cli, unsigned policy, size_t highWaterMark);
+
+/**
+ * Switch the protocol spoken on the link.
+ *
+ * Buffered output is flushed in the previous mode and a partially received
+ * line or frame is dropped. Switching to SERIAL_CLI_MODE_TEXT prints the
+ * prompt. Lines already queued are executed in the new mode, so the peer
+ * should wait for the switch to complete before sending in the new mode.
+ * May be called from a command, a running RPC request is completed first.
+ *
+ * @param cli The SerialCLI instance.
+ * @param mode The new mode.
+ *
+ * @return true if the mode was set successfully, false otherwise.
+ */
+bool SerialCLI_SetMode(SerialCLI *cli, SerialCLI_Mode mode);
+
+/**
+ * Set the callback receiving the outcome of each executed line.
+ *
+ * @param cli The SerialCLI instance.
+ * @param callback The callback function, NULL to remove it.
+ * @param context The user context passed to the callback.
+ *
+ * @return true if the callback was set successfully, false otherwise.
+ */
+bool SerialCLI_SetLineResultCallback(SerialCLI *cli, SerialCLI_LineResultCallback callback, void *context);
+
+/**
+ * Set the runner offered every command before it is called.
+ *
+ * @param cli The SerialCLI instance.
+ * @param runner The runner, NULL to call every command right away.
+ * @param context The user context passed to the runner.
+ *
+ * @return true if the runner was set successfully, false otherwise.
+ */
+bool SerialCLI_SetCommandRunner(SerialCLI *cli, SerialCLI_CommandRunner runner, void *context);
+
+/**
+ * Set the monitor observing every input chunk and every output write.
+ *
+ * @param cli The SerialCLI instance.
+ * @param monitor The monitor, NULL to remove it.
+ * @param context The user context passed to the monitor.
+ *
+ * @return true if the monitor was set successfully, false otherwise.
+ */
+bool SerialCLI_SetMonitor(SerialCLI *cli, SerialCLI_Monitor monitor, void *context);
+
+/**
+ * Mark the running command as failed.
+ *
+ * Called from a command, the line ends with SERIAL_CLI_LINE_COMMAND_FAILED
+ * and an RPC request with SERIAL_CLI_RPC_STATUS_COMMAND_FAILED.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if the command was marked successfully, false otherwise.
+ */
+bool SerialCLI_FailCommand(SerialCLI *cli);
+
+/**
+ * Continue the running command outside of its call.
+ *
+ * Called from a command, the command stays running after it returns.
+ * Each @ref SerialCLI_Process call then calls the continuation once instead
+ * of executing a queued line, until the continuation reports completion.
+ * Input keeps being queued meanwhile. Ctrl+C (ETX) received while the
+ * command runs cancels it, through @ref SerialCLI_ReadFromISR also ahead of
+ * queued input and with a full ring. A Ctrl+C typed before the command
+ * started does not cancel it. The arguments of the command are not valid in
+ * the continuation. The line result and the prompt follow the completion.
+ *
+ * @param cli The SerialCLI instance.
+ * @param continuation The continuation function.
+ * @param state The state passed to the continuation.
+ *
+ * @return true if the command was deferred successfully, false otherwise.
+ */
+bool SerialCLI_Defer(SerialCLI *cli, SerialCLI_Continuation continuation, void *state);
+
+/**
+ * Check if a deferred command is running.
+ *
+ * While it is running @ref SerialCLI_Process must be called regularly even
+ * without new input.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if a deferred command is running, false otherwise.
+ */
+bool SerialCLI_IsCommandRunning(const SerialCLI *cli);
+
+/**
+ * Get the bytes written by the line editor.
+ *
+ * @param cli The SerialCLI instance.
+ * @param stats The statistics to fill.
+ *
+ * @return true if the statistics were filled successfully, false otherwise.
+ */
+bool SerialCLI_GetEditStats(const SerialCLI *cli, SerialCLI_EditStats *stats);
+
+/**
+ * Set the clock measuring the command latencies.
+ *
+ * Fails if SERIAL_CLI_ENABLE_METRICS is 0.
+ *
+ * @param cli The SerialCLI instance.
+ * @param clock The clock, NULL stops measuring.
+ * @param context The user context passed to the clock.
+ *
+ * @return true if the clock was set successfully, false otherwise.
+ */
+bool SerialCLI_SetMetricsClock(SerialCLI *cli, SerialCLI_MetricsClock clock, void *context);
+
+/**
+ * Get a snapshot of the counters of the instance.
+ *
+ * The built-in stats command writes them together with the command latencies.
+ * Fails if SERIAL_CLI_ENABLE_METRICS is 0.
+ *
+ * @param cli The SerialCLI instance.
+ * @param metrics The counters to fill.
+ *
+ * @return true if the counters were filled successfully, false otherwise.
+ */
+bool SerialCLI_GetMetrics(const SerialCLI *cli, SerialCLI_Metrics *metrics);
+
+/**
+ * Get a snapshot of the latencies of a registered command.
+ *
+ * Fails if SERIAL_CLI_ENABLE_METRICS is 0.
+ *
+ * @param entry The command entry.
+ * @param metrics The latencies to fill.
+ *
+ * @return true if the latencies were filled successfully, false otherwise.
+ */
+bool SerialCLI_GetCommandMetrics(const SerialCLI_CommandEntry *entry, SerialCLI_CommandMetrics *metrics);
+
+/**
+ * Reset the counters and the latencies of all registered commands.
+ *
+ * The latencies of the commands of @ref SERIAL_CLI_COMMAND are reset for
+ * all instances. Fails if SERIAL_CLI_ENABLE_METRICS is 0.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if the metrics were reset successfully, false otherwise.
+ */
+bool SerialCLI_ResetMetrics(SerialCLI *cli);
+
+/**
+ * Execute a script of lines back to back.
+ *
+ * Runs in SERIAL_CLI_MODE_BATCH without echo and prompt, the previous mode
+ * is restored afterwards. Lines end with CR, LF or CR LF, the last line
+ * does not need a line ending. Each line, deferred commands included, is
+ * complete before the next one is read, the call returns once the last one
+ * completed. Lines still queued are executed first and are not part of the
+ * result. Fails in SERIAL_CLI_MODE_RPC.
+ *
+ * The batch is driven by calling @ref SerialCLI_Process, so it needs a
+ * blocking write callback and commands that complete without outside help.
+ * Once SERIAL_CLI_BATCH_MAX_IDLE_STEPS calls in a row neither run, write nor
+ * complete anything, such as with a non-blocking transport that is never
+ * drained or a deferred command waiting for an event, the batch stops with
+ * isStalled set. A running command of the stalled line is cancelled, a
+ * line that could not start stays queued.
+ *
+ * @param cli The SerialCLI instance.
+ * @param script The lines to execute.
+ * @param length The length of the script.
+ * @param isStopOnError Stop after the first line that fails.
+ * @param result The summary to fill, may be NULL.
+ *
+ * @return true if every line succeeded, false if a line failed or the batch stalled.
+ */
+bool SerialCLI_ExecuteBatch(SerialCLI *cli, const char *script, size_t length, bool isStopOnError,
+                            SerialCLI_BatchResult *result);
+
 /**
  * Set the prompt for the SerialCLI.
  *
@@ -134,12 +1067,39 @@ bool SerialCLI_ResetPrompt(SerialCLI *cli);
 /**
  * Process the SerialCLI.
  *
+ * Moves the input in the receive ring filled by @ref SerialCLI_ReadFromISR to
+ * the input buffer as far as it fits, offers pending output again and
+ * executes at most one queued command per call unless
+ * @ref SerialCLI_IsTxBlocked. While a deferred command is running its
+ * continuation is called instead.
+ *
+ * Outside RPC mode a line may chain commands with `;`, which always runs the
+ * next one, and `&&`, which runs it only if the previous one ended with
+ * SERIAL_CLI_LINE_OK. The output of a command can be piped through up to
+ * SERIAL_CLI_FILTER_MAX_COUNT filters before it reaches the write callback:
+ * `grep [-v] <text>` passes the lines containing the text, `head <n>` the
+ * first n lines and `count` replaces the lines by their number. Operators
+ * are words of their own, quoted ones are plain arguments. Ctrl+C drops the
+ * rest of a chained line.
+ *
  * @param cli The SerialCLI instance.
  *
  * @return true if the processing was successful, false otherwise.
  */
 bool SerialCLI_Process(SerialCLI *cli);
 
+/**
+ * Check if a complete line is waiting for @ref SerialCLI_Process.
+ *
+ * Lines still in the receive ring of @ref SerialCLI_ReadFromISR are not
+ * counted, they are only queued by SerialCLI_Process.
+ *
+ * @param cli The SerialCLI instance.
+ *
+ * @return true if a queued line is pending, false otherwise.
+ */
+bool SerialCLI_IsCommandPending(const SerialCLI *cli);
+
 #ifdef __cplusplus
 }
 #endif
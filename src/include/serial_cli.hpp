@@ -0,0 +1,204 @@
+#ifndef SERIAL_CLI_HPP
+#define SERIAL_CLI_HPP
+
+#include "serial_cli.h"
+
+#include <cstddef>
+
+namespace serial_cli {
+
+/**
+ * SerialCLI instance with buffers sized at compile time.
+ *
+ * Shares the C engine, only the storage differs. The input buffer holds
+ * MaxArgs + 1 arguments of ArgLen characters, like the default
+ * SERIAL_CLI_INPUT_BUFFER_SIZE. Commands receive the underlying SerialCLI and
+ * use the C API. @ref SerialCLI_GetContext returns the context passed to the
+ * constructor, or the Cli instance for a plain write callback.
+ *
+ * The underlying SerialCLI only embeds default buffers in builds with
+ * SERIAL_CLI_EMBEDDED_STORAGE.
+ *
+ * @tparam MaxArgs Maximum number of arguments including the command name.
+ * @tparam ArgLen Length of an argument the input buffer is sized for.
+ * @tparam TxSize Size of the TX buffer.
+ * @tparam HistorySize Size of the history ring, 0 for no history.
+ * @tparam TxRingSize Size of the TX ring of a non-blocking write callback, 0 for none.
+ * @tparam RxRingSize Size of the receive ring of readFromISR, a power of two or 0 for none.
+ * @tparam FilterLineSize Size of the line buffer of the output filters, 0 rejects every `|`.
+ * @tparam FilterPatternSize Size of the grep pattern buffer, 0 rejects every grep.
+ */
+template <std::size_t MaxArgs, std::size_t ArgLen, std::size_t TxSize, std::size_t HistorySize = 0,
+          std::size_t TxRingSize = 0, std::size_t RxRingSize = 0, std::size_t FilterLineSize = 0,
+          std::size_t FilterPatternSize = 0>
+class Cli {
+  static_assert(MaxArgs > 0, "A command needs at least its name as argument");
+  static_assert(ArgLen > 1, "An argument needs room for a character and its separator");
+  static_assert(TxSize > 0, "The TX buffer must not be empty");
+  static_assert(0 == (RxRingSize & (RxRingSize - 1)), "The receive ring size must be a power of two");
+  static_assert(FilterPatternSize <= 255, "Patterns are addressed by byte offsets");
+
+public:
+  static constexpr std::size_t maxArgs = MaxArgs;
+  static constexpr std::size_t inputBufferSize = (MaxArgs + 1) * ArgLen;
+  static constexpr std::size_t txBufferSize = TxSize;
+  static constexpr std::size_t historySize = HistorySize;
+  static constexpr std::size_t txRingSize = TxRingSize;
+  static constexpr std::size_t rxRingSize = RxRingSize;
+  static constexpr std::size_t filterLineSize = FilterLineSize;
+  static constexpr std::size_t filterPatternSize = FilterPatternSize;
+
+  /**
+   * Create the instance with a plain write callback.
+   *
+   * @param write The write callback function.
+   */
+  explicit Cli(SerialCLI_Write write) : plainWrite(write) {
+    initialized = (nullptr != write) && init(writePlain, this);
+  }
+
+  /**
+   * Create the instance with a write callback receiving a user context.
+   *
+   * @param write The write callback function.
+   * @param context The user context passed to the write callback.
+   */
+  Cli(SerialCLI_ContextWrite write, void *context) { initialized = init(write, context); }
+
+  /**
+   * Create the instance with a non-blocking write callback.
+   *
+   * @param write The write callback function.
+   * @param context The user context passed to the write callback.
+   */
+  Cli(SerialCLI_NonBlockingWrite write, void *context) {
+    static_assert(TxRingSize >= TxSize, "The TX ring must take a full TX buffer");
+    SerialCLI_Storage storage = getStorage();
+    initialized = SerialCLI_InitNonBlocking(&cli, &storage, write, context, txRing, TxRingSize);
+  }
+
+  ~Cli() { SerialCLI_Deinit(&cli); }
+
+  // The engine points into the instance, it must not move
+  Cli(const Cli &) = delete;
+  Cli &operator=(const Cli &) = delete;
+
+  bool isInitialized() const { return initialized; }
+
+  SerialCLI *get() { return &cli; }
+
+  bool registerCommand(SerialCLI_CommandEntry &command) { return SerialCLI_RegisterCommand(&cli, &command); }
+
+  bool registerGroup(SerialCLI_CommandGroup &group, SerialCLI_CommandGroup *parent = nullptr) {
+    return SerialCLI_RegisterGroup(&cli, parent, &group);
+  }
+
+  bool registerSubcommand(SerialCLI_CommandGroup &group, SerialCLI_CommandEntry &command) {
+    return SerialCLI_RegisterSubcommand(&cli, &group, &command);
+  }
+
+  bool attachRegistry(const SerialCLI_Registry *registry) { return SerialCLI_AttachRegistry(&cli, registry); }
+
+  bool read(const char *str, std::size_t len) { return SerialCLI_Read(&cli, str, len); }
+
+  std::size_t readFromISR(const char *str, std::size_t len) { return SerialCLI_ReadFromISR(&cli, str, len); }
+
+  bool process() { return SerialCLI_Process(&cli); }
+
+  bool isCommandPending() const { return SerialCLI_IsCommandPending(&cli); }
+
+  template <typename... Args> bool writeString(const char *format, Args... args) {
+    return SerialCLI_WriteString(&cli, format, args...);
+  }
+
+  bool writeBytes(const char *data, std::size_t len) { return SerialCLI_WriteBytes(&cli, data, len); }
+
+  bool flush() { return SerialCLI_Flush(&cli); }
+
+  bool txReady() { return SerialCLI_TxReady(&cli); }
+
+  std::size_t getTxSpace() const { return SerialCLI_GetTxSpace(&cli); }
+
+  bool isTxBlocked() const { return SerialCLI_IsTxBlocked(&cli); }
+
+  bool setFlushPolicy(unsigned policy, std::size_t highWaterMark) {
+    return SerialCLI_SetFlushPolicy(&cli, policy, highWaterMark);
+  }
+
+  bool setMode(SerialCLI_Mode mode) { return SerialCLI_SetMode(&cli, mode); }
+
+  bool setLineResultCallback(SerialCLI_LineResultCallback callback, void *context) {
+    return SerialCLI_SetLineResultCallback(&cli, callback, context);
+  }
+
+  bool setCommandRunner(SerialCLI_CommandRunner runner, void *context) {
+    return SerialCLI_SetCommandRunner(&cli, runner, context);
+  }
+
+  bool setMonitor(SerialCLI_Monitor monitor, void *context) { return SerialCLI_SetMonitor(&cli, monitor, context); }
+
+  bool executeBatch(const char *script, std::size_t len, bool isStopOnError, SerialCLI_BatchResult *result) {
+    return SerialCLI_ExecuteBatch(&cli, script, len, isStopOnError, result);
+  }
+
+  bool setPrompt(const char *prompt) { return SerialCLI_SetPrompt(&cli, prompt); }
+
+  bool resetPrompt() { return SerialCLI_ResetPrompt(&cli); }
+
+private:
+  SerialCLI cli{};
+  char inputBuffer[inputBufferSize + 1]{};
+  const char *argv[MaxArgs + 1]{};
+  char txBuffer[TxSize + 1]{};
+  char historyBuffer[(HistorySize > 0) ? HistorySize : 1]{};
+  char txRing[(TxRingSize > 0) ? TxRingSize : 1]{};
+  char rxRing[(RxRingSize > 0) ? RxRingSize : 1]{};
+  char filterLine[(FilterLineSize > 0) ? FilterLineSize : 1]{};
+  char filterPatterns[(FilterPatternSize > 0) ? FilterPatternSize : 1]{};
+  SerialCLI_Write plainWrite = nullptr;
+  bool initialized = false;
+
+  static void writePlain(void *context, const char *str, std::size_t len) {
+    static_cast<Cli *>(context)->plainWrite(str, len);
+  }
+
+  SerialCLI_Storage getStorage() {
+    return SerialCLI_Storage{inputBuffer, inputBufferSize, argv, MaxArgs, txBuffer, TxSize, historyBuffer,
+                             HistorySize, rxRing, RxRingSize, filterLine, FilterLineSize, filterPatterns,
+                             FilterPatternSize};
+  }
+
+  bool init(SerialCLI_ContextWrite write, void *context) {
+    SerialCLI_Storage storage = getStorage();
+    return SerialCLI_InitWithStorage(&cli, &storage, write, context);
+  }
+};
+
+/**
+ * Default sized buffers for @ref SerialCLI_InitWithStorage.
+ *
+ * Holds the buffers SerialCLI_Init uses in builds with
+ * SERIAL_CLI_EMBEDDED_STORAGE, for code written against the C API. The
+ * instance points into them, they must outlive it and not move.
+ */
+struct DefaultStorage {
+  char inputBuffer[SERIAL_CLI_INPUT_BUFFER_SIZE + 1]{};
+  const char *argv[SERIAL_CLI_COMMAND_MAX_ARGS + 1]{};
+  char txBuffer[SERIAL_CLI_TX_BUFFER_SIZE + 1]{};
+  char historyBuffer[SERIAL_CLI_HISTORY_SIZE]{};
+  char rxRing[SERIAL_CLI_RX_RING_SIZE]{};
+  char filterLine[SERIAL_CLI_FILTER_LINE_SIZE]{};
+  char filterPatterns[SERIAL_CLI_FILTER_PATTERN_SIZE]{};
+  SerialCLI_Storage storage{inputBuffer, SERIAL_CLI_INPUT_BUFFER_SIZE, argv, SERIAL_CLI_COMMAND_MAX_ARGS,
+                            txBuffer, SERIAL_CLI_TX_BUFFER_SIZE, historyBuffer, SERIAL_CLI_HISTORY_SIZE,
+                            rxRing, SERIAL_CLI_RX_RING_SIZE, filterLine, SERIAL_CLI_FILTER_LINE_SIZE,
+                            filterPatterns, SERIAL_CLI_FILTER_PATTERN_SIZE};
+
+  DefaultStorage() = default;
+  DefaultStorage(const DefaultStorage &) = delete;
+  DefaultStorage &operator=(const DefaultStorage &) = delete;
+};
+
+} // namespace serial_cli
+
+#endif // SERIAL_CLI_HPP
@@ -0,0 +1,131 @@
+#ifndef SERIAL_CLI_RPC_H
+#define SERIAL_CLI_RPC_H
+
+#include "serial_cli.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Wire format of SERIAL_CLI_MODE_RPC.
+ *
+ * Every frame is COBS encoded and ends with a zero byte, so a receiver can
+ * resynchronize on the next zero after any error. Decoded, a frame is a
+ * header, a body and a CRC-16/CCITT-FALSE over header and body, multi-byte
+ * fields are little-endian.
+ *
+ * Request:  type (1) | request ID (2) | command ID (4) | argc (1) | arguments | CRC (2)
+ * Response: type (1) | request ID (2) | status (1) | output | CRC (2)
+ *
+ * Command IDs are assigned in registration order, help is 0. The commands
+ * of an attached registry and those defined with SERIAL_CLI_COMMAND are
+ * numbered in ranges of their own, so the IDs of a firmware do not depend
+ * on the names and never clash. A client learns them with a request for
+ * SERIAL_CLI_RPC_LIST_COMMANDS, whose output holds command ID (4) | name |
+ * zero byte for every top-level command, see @ref SerialCLI_RpcFindCommandId.
+ * The arguments following the command ID are null-terminated strings.
+ * Subcommands of a group are named by the leading arguments, like on a text
+ * line. Requests are executed in order, each one is answered by zero or more
+ * SERIAL_CLI_RPC_OUTPUT frames and one SERIAL_CLI_RPC_RESULT frame. The
+ * output of a request is the concatenation of the output of its frames.
+ */
+
+enum {
+  SERIAL_CLI_RPC_REQUEST_HEADER_SIZE = 8,
+  SERIAL_CLI_RPC_RESPONSE_HEADER_SIZE = 4,
+  SERIAL_CLI_RPC_CRC_SIZE = 2,
+  SERIAL_CLI_RPC_DELIMITER = 0, ///< Ends every encoded frame.
+};
+
+#define SERIAL_CLI_RPC_LIST_COMMANDS 0xFFFFFFFFU ///< Command ID of the request listing the command IDs.
+
+/**
+ * Types of RPC frames.
+ */
+typedef enum SerialCLI_RpcFrameType {
+  SERIAL_CLI_RPC_REQUEST = 1, ///< Command to execute.
+  SERIAL_CLI_RPC_OUTPUT = 2,  ///< Output of a request that is still executing.
+  SERIAL_CLI_RPC_RESULT = 3,  ///< Last frame of a request with its status and remaining output.
+  SERIAL_CLI_RPC_NOTIFY = 4,  ///< Output written outside of a request, request ID 0.
+} SerialCLI_RpcFrameType;
+
+/**
+ * Status of an RPC request.
+ */
+typedef enum SerialCLI_RpcStatus {
+  SERIAL_CLI_RPC_STATUS_OK = 0,                ///< The command was executed.
+  SERIAL_CLI_RPC_STATUS_UNKNOWN_COMMAND = 1,   ///< No command with the command ID or subcommand is registered.
+  SERIAL_CLI_RPC_STATUS_INVALID_ARGUMENTS = 2, ///< Too many or malformed arguments.
+  SERIAL_CLI_RPC_STATUS_CORRUPT_FRAME = 3,     ///< Bad encoding, CRC or type, the request ID is a best guess.
+  SERIAL_CLI_RPC_STATUS_COMMAND_FAILED = 4,    ///< The command reported an error with @ref SerialCLI_FailCommand.
+  SERIAL_CLI_RPC_STATUS_CANCELLED = 5,         ///< The deferred command was cancelled by deinitializing the instance.
+} SerialCLI_RpcStatus;
+
+/**
+ * Decoded RPC response frame.
+ */
+typedef struct SerialCLI_RpcResponse {
+  uint8_t type;       ///< One of @ref SerialCLI_RpcFrameType.
+  uint16_t requestId; ///< ID of the request the frame answers.
+  uint8_t status;     ///< One of @ref SerialCLI_RpcStatus.
+  const char *data;   ///< Output of the command, points into the decoded frame.
+  size_t dataLength;  ///< Length of the output.
+} SerialCLI_RpcResponse;
+
+/**
+ * Get the command ID of a top-level command of an instance.
+ *
+ * Lets firmware that talks RPC to itself, or tests, skip the list request.
+ *
+ * @param cli The SerialCLI instance.
+ * @param commandName The name of a registered, shared or static command.
+ * @param commandId Set to the command ID used in request frames.
+ *
+ * @return true if the command exists, false otherwise.
+ */
+bool SerialCLI_RpcGetCommandId(SerialCLI *cli, const char *commandName, uint32_t *commandId);
+
+/**
+ * Find the command ID of a command name in the output of a list request.
+ *
+ * @param list The output of the SERIAL_CLI_RPC_LIST_COMMANDS request.
+ * @param listLength The length of the output.
+ * @param commandName The command name.
+ * @param commandId Set to the command ID used in request frames.
+ *
+ * @return true if the list holds the command, false otherwise.
+ */
+bool SerialCLI_RpcFindCommandId(const char *list, size_t listLength, const char *commandName, uint32_t *commandId);
+
+/**
+ * Encode a request frame.
+ *
+ * @param frame The buffer receiving the encoded frame including its delimiter.
+ * @param frameSize The size of the buffer.
+ * @param requestId The ID echoed in the response frames.
+ * @param commandId The ID of the top-level command.
+ * @param argc The number of arguments following the command.
+ * @param argv The arguments, may be NULL without arguments.
+ *
+ * @return The length of the encoded frame, 0 if it does not fit or the arguments are invalid.
+ */
+size_t SerialCLI_RpcEncodeRequest(char *frame, size_t frameSize, uint16_t requestId, uint32_t commandId, int argc,
+                                  const char **argv);
+
+/**
+ * Decode a response frame in place.
+ *
+ * @param frame The encoded frame without its delimiter, overwritten by the decoded frame.
+ * @param frameLength The length of the encoded frame.
+ * @param response The response to fill.
+ *
+ * @return true if the frame is a valid response, false otherwise.
+ */
+bool SerialCLI_RpcDecodeResponse(char *frame, size_t frameLength, SerialCLI_RpcResponse *response);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_RPC_H
@@ -0,0 +1,107 @@
+#ifndef SERIAL_CLI_TRACE_H
+#define SERIAL_CLI_TRACE_H
+
+#include "serial_cli.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Trace points on the path from a received byte to the command output.
+ *
+ * Every trace point writes a fixed-size record into one ring shared by all
+ * instances and threads. Writers claim a slot with an atomic increment, so
+ * any number of them can trace without a lock, and the oldest records are
+ * overwritten. The sequence field of a record is written last, a dump skips
+ * slots whose sequence does not match their position.
+ *
+ * A dump is the records oldest first as they lie in memory, on a
+ * little-endian target:
+ *
+ * Record: timestamp (4) | event (2) | sequence (2) | payload (4) | instance (4)
+ *
+ * Every instance gets its own tag when it is initialized, records of
+ * different instances nest independently.
+ *
+ * serial_cli_trace2json in the tools directory turns a dump into Chrome
+ * trace JSON for chrome://tracing and Perfetto. With SERIAL_CLI_ENABLE_TRACE
+ * 0 the trace points compile to nothing.
+ */
+
+/**
+ * Events of the trace points.
+ */
+typedef enum SerialCLI_TraceEvent {
+  SERIAL_CLI_TRACE_READ_BEGIN = 1,    ///< @ref SerialCLI_Read starts, the payload is the chunk length.
+  SERIAL_CLI_TRACE_READ_END = 2,      ///< SerialCLI_Read returns, the payload is the number of queued lines.
+  SERIAL_CLI_TRACE_PARSE_BEGIN = 3,   ///< A line is split into arguments, the payload is its length.
+  SERIAL_CLI_TRACE_PARSE_END = 4,     ///< The line is split, the payload is the number of arguments.
+  SERIAL_CLI_TRACE_COMMAND_BEGIN = 5, ///< A command is called, the payload is its RPC command ID.
+  SERIAL_CLI_TRACE_COMMAND_END = 6,   ///< The command returned, the payload is the @ref SerialCLI_LineStatus.
+  SERIAL_CLI_TRACE_WRITE = 7,         ///< @ref SerialCLI_WriteString, the payload is the formatted length.
+  SERIAL_CLI_TRACE_PROMPT = 8,        ///< The instance is ready for the next line, the payload is the queued lines.
+} SerialCLI_TraceEvent;
+
+/**
+ * Record written by a trace point.
+ */
+typedef struct SerialCLI_TraceRecord {
+  uint32_t timestamp; ///< Clock value in microseconds, may wrap around.
+  uint16_t event;     ///< @ref SerialCLI_TraceEvent.
+  uint16_t sequence;  ///< Low bits of the record number.
+  uint32_t payload;   ///< Event specific value.
+  uint32_t instance;  ///< Tag of the instance that wrote the record, starting at 1.
+} SerialCLI_TraceRecord;
+
+/**
+ * Callback function reading a free-running clock for the trace records.
+ *
+ * Called from every trace point, possibly from several threads at once.
+ *
+ * @param context The context passed to @ref SerialCLI_TraceStart.
+ *
+ * @return The current time in microseconds.
+ */
+typedef uint32_t (*SerialCLI_TraceClock)(void *context);
+
+/**
+ * Start tracing into a ring provided by the caller.
+ *
+ * Starting again discards the records. Must not be called while trace
+ * points run on other threads. Fails if SERIAL_CLI_ENABLE_TRACE is 0.
+ *
+ * @param ring The ring, must stay valid while it is traced into or dumped.
+ * @param recordCount The number of records of the ring, must be a power of two.
+ * @param clock The clock for the timestamps.
+ * @param context The user context passed to the clock.
+ *
+ * @return true if tracing was started successfully, false otherwise.
+ */
+bool SerialCLI_TraceStart(SerialCLI_TraceRecord *ring, size_t recordCount, SerialCLI_TraceClock clock, void *context);
+
+/**
+ * Stop tracing, the records stay in the ring for @ref SerialCLI_TraceDump.
+ *
+ * @return true if tracing was stopped, false if it was not running or is compiled out.
+ */
+bool SerialCLI_TraceStop(void);
+
+/**
+ * Copy the newest records oldest first.
+ *
+ * Records being written while dumping are skipped, stop tracing first for a
+ * complete dump.
+ *
+ * @param records The buffer to fill.
+ * @param maxCount The number of records the buffer can hold.
+ *
+ * @return The number of records copied, 0 if tracing never started or is compiled out.
+ */
+size_t SerialCLI_TraceDump(SerialCLI_TraceRecord *records, size_t maxCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_TRACE_H
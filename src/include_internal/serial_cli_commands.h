@@ -7,19 +7,283 @@
 extern "C" {
 #endif
 
+/**
+ * Result of a command prefix lookup.
+ */
+typedef struct SerialCLI_PrefixMatch {
+  SerialCLI_CommandEntry *subtree;               ///< Trie subtree holding all matching commands, NULL if none.
+  bool isLeaf;                                   ///< True if the subtree is a single command.
+  SerialCLI_CommandEntry *sharedSubtree;         ///< Subtree holding the matching shared commands, NULL if none.
+  bool isSharedLeaf;                             ///< True if the shared subtree is a single command.
+  const SerialCLI_StaticCommand *staticCommands; ///< First matching static command.
+  size_t staticCount;                            ///< The number of matching static commands.
+  bool isUnique;                                 ///< True if exactly one command matches.
+  const char *name;                              ///< Name of a matching command.
+  size_t commonLength;                           ///< Length of the prefix shared by all matching commands.
+} SerialCLI_PrefixMatch;
+
+/**
+ * Callback function to visit a command.
+ *
+ * @param context The user context.
+ * @param commandName The name of the visited command.
+ */
+typedef void (*SerialCLI_CommandVisitor)(void *context, const char *commandName);
+
+/**
+ * Ranges of the RPC command IDs of the top-level commands.
+ *
+ * Every range is numbered in registration order, the static commands in the
+ * order of their sorted table.
+ */
+#define SERIAL_CLI_INSTANCE_COMMAND_ID 0x00000000U ///< First command of an instance, help.
+#define SERIAL_CLI_SHARED_COMMAND_ID 0x40000000U   ///< First command of a shared registry.
+#define SERIAL_CLI_STATIC_COMMAND_ID 0x80000000U   ///< First command defined with SERIAL_CLI_COMMAND.
+
+/**
+ * Function to add a command entry to the command trie and ID tree of a registry.
+ *
+ * The entry gets the next command ID of the registry.
+ *
+ * @param registry The registry of the instance or a shared one.
+ * @param entry The entry to index, its name must not be indexed yet.
+ */
+void SerialCLI_IndexCommand(SerialCLI_Registry *registry, SerialCLI_CommandEntry *entry);
+
+/**
+ * Function to get a top-level command of a registry by its name.
+ *
+ * @param registry The registry.
+ * @param commandName The name of the command to retrieve.
+ * @return Pointer to the SerialCLI_CommandEntry if found, NULL otherwise.
+ */
+SerialCLI_CommandEntry *SerialCLI_FindRegistryCommand(const SerialCLI_Registry *registry, const char *commandName);
+
+/**
+ * Function to get a top-level command of a registry by its RPC command ID.
+ *
+ * @param registry The registry.
+ * @param commandId The command ID.
+ * @return Pointer to the SerialCLI_CommandEntry if found, NULL otherwise.
+ */
+SerialCLI_CommandEntry *SerialCLI_FindRegistryCommandById(const SerialCLI_Registry *registry, uint32_t commandId);
+
+/**
+ * Function to insert a command entry into a prefix trie.
+ *
+ * @param trie The trie of the instance or of a group.
+ * @param entry The entry to insert, its name must not be in the trie yet.
+ */
+void SerialCLI_InsertCommandPrefix(SerialCLI_CommandTrie *trie, SerialCLI_CommandEntry *entry);
+
+/**
+ * Function to find all commands starting with a prefix.
+ *
+ * The cost depends on the prefix length, not on the number of commands.
+ * The match holds no shared or static commands.
+ *
+ * @param trie The trie of the instance or of a group.
+ * @param prefix The prefix, does not need to be null-terminated.
+ * @param prefixLength The length of the prefix.
+ * @param match The match to fill.
+ * @return true if at least one command matches, false otherwise.
+ */
+bool SerialCLI_MatchCommandPrefix(const SerialCLI_CommandTrie *trie, const char *prefix, size_t prefixLength,
+                                  SerialCLI_PrefixMatch *match);
+
+/**
+ * Function to find a command by its full name in a prefix trie.
+ *
+ * The cost depends on the name length, not on the number of commands.
+ *
+ * @param trie The trie of the instance or of a group.
+ * @param name The name, does not need to be null-terminated.
+ * @param nameLength The length of the name.
+ * @return Pointer to the SerialCLI_CommandEntry if found, NULL otherwise.
+ */
+SerialCLI_CommandEntry *SerialCLI_FindCommand(const SerialCLI_CommandTrie *trie, const char *name, size_t nameLength);
+
+/**
+ * Function to find a top-level command by its full name.
+ *
+ * The commands of the instance are searched before the shared ones.
+ *
+ * @param cli The SerialCLI instance.
+ * @param name The name, does not need to be null-terminated.
+ * @param nameLength The length of the name.
+ * @return Pointer to the SerialCLI_CommandEntry if found, NULL otherwise.
+ */
+SerialCLI_CommandEntry *SerialCLI_FindTopLevelCommand(SerialCLI *cli, const char *name, size_t nameLength);
+
+/**
+ * Function to walk all registered commands depth first.
+ *
+ * The subcommands of a group follow the group, in registration order.
+ *
+ * @param entry The current command.
+ * @return The next command, NULL after the last one.
+ */
+SerialCLI_CommandEntry *SerialCLI_GetNextCommand(SerialCLI_CommandEntry *entry);
+
+/**
+ * Function to get the command listed after a command.
+ *
+ * The top-level commands of the instance are followed by those of its
+ * registry and then by the static commands. Subcommands end with their group.
+ *
+ * @param cli The SerialCLI instance.
+ * @param entry The current command.
+ * @return The next @ref SerialCLI_CommandEntry or @ref SerialCLI_StaticCommand, NULL after the last one.
+ */
+const void *SerialCLI_GetNextListed(const SerialCLI *cli, const SerialCLI_CommandEntry *entry);
+
+/**
+ * Function to check if a command entry is the entry of a group.
+ *
+ * @param entry The command entry.
+ * @return true if the entry belongs to a @ref SerialCLI_CommandGroup.
+ */
+static inline bool SerialCLI_IsCommandGroup(const SerialCLI_CommandEntry *entry);
+
+/**
+ * Function to visit all commands of a prefix match.
+ *
+ * The commands of the instance come first, then the shared and the static
+ * ones, each part in lexicographic order.
+ *
+ * @param match The prefix match.
+ * @param visitor The visitor callback.
+ * @param context The user context passed to the visitor.
+ */
+void SerialCLI_ForEachPrefixMatch(const SerialCLI_PrefixMatch *match, SerialCLI_CommandVisitor visitor,
+                                  void *context);
+
 /**
  * Function to get a command entry by its name.
  *
+ * The commands of the instance are searched before the shared ones.
+ *
  * @param cli The SerialCLI instance.
  * @param commandName The name of the command to retrieve.
  * @return Pointer to the SerialCLI_CommandEntry if found, NULL otherwise.
  */
 SerialCLI_CommandEntry *SerialCLI_GetCommandEntry(SerialCLI *cli, const char *commandName);
 
+/**
+ * Function to get a top-level command entry by its RPC command ID.
+ *
+ * @param cli The SerialCLI instance.
+ * @param commandId The command ID.
+ * @return Pointer to the SerialCLI_CommandEntry if found, NULL otherwise.
+ */
+SerialCLI_CommandEntry *SerialCLI_GetCommandEntryById(SerialCLI *cli, uint32_t commandId);
+
+/**
+ * Function to complete a partial command name.
+ *
+ * @param cli The SerialCLI instance.
+ * @param partialName The partial command name.
+ * @return The name of the only command extending partialName, NULL otherwise.
+ */
 const char *SerialCLI_ResolvePartialCommand(SerialCLI *cli, const char *partialName);
 
+/**
+ * Function to get the commands defined with SERIAL_CLI_COMMAND.
+ *
+ * @param count Set to the number of commands.
+ * @return The table sorted by name, NULL if there is none.
+ */
+const SerialCLI_StaticCommand *SerialCLI_GetStaticCommands(size_t *count);
+
+/**
+ * Function to check the table of static commands.
+ *
+ * The names must be in strictly ascending order, at most
+ * SERIAL_CLI_COMMAND_MAX_ARG_LENGTH characters long and must not name the
+ * built-in help command. The table is checked on the first call, in time
+ * linear in the number of commands, later calls return the stored result.
+ *
+ * @return true if the table is valid or empty, false otherwise.
+ */
+bool SerialCLI_CheckStaticCommands(void);
+
+/**
+ * Function to find a command by its full name in a table sorted by name.
+ *
+ * Binary search, the cost grows with the logarithm of the number of commands.
+ *
+ * @param commands The table.
+ * @param count The number of commands of the table.
+ * @param name The name, does not need to be null-terminated.
+ * @param nameLength The length of the name.
+ * @return Pointer to the command if found, NULL otherwise.
+ */
+const SerialCLI_StaticCommand *SerialCLI_SearchStaticCommands(const SerialCLI_StaticCommand *commands, size_t count,
+                                                              const char *name, size_t nameLength);
+
+/**
+ * Function to find a static command by its full name.
+ *
+ * @param name The name, does not need to be null-terminated.
+ * @param nameLength The length of the name.
+ * @return Pointer to the command if found, NULL otherwise.
+ */
+const SerialCLI_StaticCommand *SerialCLI_FindStaticCommand(const char *name, size_t nameLength);
+
+/**
+ * Function to find a static command by its RPC command ID.
+ *
+ * The ID indexes the table, the cost does not depend on the number of commands.
+ *
+ * @param commandId The command ID.
+ * @return Pointer to the command if found, NULL otherwise.
+ */
+const SerialCLI_StaticCommand *SerialCLI_GetStaticCommandById(uint32_t commandId);
+
+/**
+ * Function to get the RPC command ID of a static command.
+ *
+ * @param command The command, part of the table of static commands.
+ * @return The command ID.
+ */
+uint32_t SerialCLI_GetStaticCommandId(const SerialCLI_StaticCommand *command);
+
+/**
+ * Function to check if a command pointer points into the table of static commands.
+ *
+ * Tells the static commands apart from command entries in listings covering both.
+ *
+ * @param command The command pointer.
+ * @return true if command is a @ref SerialCLI_StaticCommand.
+ */
+bool SerialCLI_IsStaticCommand(const void *command);
+
+/**
+ * Function to add the shared commands starting with a prefix to a prefix match.
+ *
+ * @param trie The trie of the attached registry.
+ * @param prefix The prefix, does not need to be null-terminated.
+ * @param prefixLength The length of the prefix.
+ * @param match The match filled by @ref SerialCLI_MatchCommandPrefix.
+ * @return true if at least one command of either kind matches, false otherwise.
+ */
+bool SerialCLI_MatchSharedPrefix(const SerialCLI_CommandTrie *trie, const char *prefix, size_t prefixLength,
+                                 SerialCLI_PrefixMatch *match);
+
+/**
+ * Function to add the static commands starting with a prefix to a prefix match.
+ *
+ * @param prefix The prefix, does not need to be null-terminated.
+ * @param prefixLength The length of the prefix.
+ * @param match The match filled by @ref SerialCLI_MatchCommandPrefix and @ref SerialCLI_MatchSharedPrefix.
+ * @return true if at least one command of any kind matches, false otherwise.
+ */
+bool SerialCLI_MatchStaticPrefix(const char *prefix, size_t prefixLength, SerialCLI_PrefixMatch *match);
+
+static inline bool SerialCLI_IsCommandGroup(const SerialCLI_CommandEntry *entry) { return NULL == entry->command; }
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif // SERIAL_CLI_COMMAND_H_
\ No newline at end of file
+#endif // SERIAL_CLI_COMMAND_H_
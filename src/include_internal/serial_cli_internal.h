@@ -2,6 +2,7 @@
 #define SERIAL_CLI_INTERNAL_H_
 
 #include "serial_cli.h"
+#include "serial_cli_trace.h"
 #include <ctype.h>
 #include <string.h>
 
@@ -9,38 +10,475 @@
 extern "C" {
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+#define SERIAL_CLI_LOAD_ACQUIRE(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define SERIAL_CLI_STORE_RELEASE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define SERIAL_CLI_FETCH_ADD(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_RELAXED)
+#else
+#error "Receive ring requires GCC compatible atomic builtins"
+#endif
+
+enum {
+  SERIAL_CLI_CANCEL_CHARACTER = 3, ///< ASCII ETX, sent by Ctrl+C.
+};
+
+#define SERIAL_CLI_HISTORY_NO_ENTRY SIZE_MAX ///< History cursor while a new line is edited.
+
+/**
+ * Operators chaining the commands of a line.
+ */
+typedef enum SerialCLI_ChainOperator {
+  SERIAL_CLI_CHAIN_NONE = 0,     ///< Start of a line.
+  SERIAL_CLI_CHAIN_SEQUENCE = 1, ///< `;`, the next command always runs.
+  SERIAL_CLI_CHAIN_AND = 2,      ///< `&&`, the next command runs if the previous one succeeded.
+} SerialCLI_ChainOperator;
+
+/**
+ * Bounds of the first command of a chained line.
+ *
+ * The command and its arguments are followed by the filters after the first
+ * `|`, if any, and the operator ending the command.
+ */
+typedef struct SerialCLI_Segment {
+  size_t commandLength;                 ///< Bytes of the command and its arguments.
+  size_t filterStart;                   ///< Offset of the filters, commandLength if there is no `|`.
+  size_t length;                        ///< Bytes up to the operator ending the command.
+  size_t nextStart;                     ///< Offset of the next command, the line length if none.
+  SerialCLI_ChainOperator nextOperator; ///< Operator before the next command, none at the end of the line.
+} SerialCLI_Segment;
+
+#if SERIAL_CLI_ENABLE_METRICS
+#define SERIAL_CLI_METRICS_ADD(cli, counter, value) ((cli)->metrics.counter += (value))
+#else
+#define SERIAL_CLI_METRICS_ADD(cli, counter, value) ((void)0)
+#endif
+
+#if SERIAL_CLI_ENABLE_TRACE
+#define SERIAL_CLI_TRACE(cli, event, payload)                                                                          \
+  SerialCLI_TraceWrite((cli)->traceInstance, (uint16_t)(event), (uint32_t)(payload))
+#else
+#define SERIAL_CLI_TRACE(cli, event, payload) ((void)0)
+#endif
+
+/**
+ * Function to get the line being received.
+ *
+ * @param cli The SerialCLI instance.
+ * @return The line, it starts after the queued lines.
+ */
+static inline char *SerialCLI_GetLine(SerialCLI *cli);
+
+/**
+ * Function to get the number of characters the line being received can hold.
+ *
+ * @param cli The SerialCLI instance.
+ * @return The capacity of the line.
+ */
+static inline size_t SerialCLI_GetLineCapacity(const SerialCLI *cli);
+
 /**
- * Function to get the arguments as an array of strings.
+ * Function to get the arguments of the current command.
  *
  * @param cli The SerialCLI instance.
- * @param argv The array to fill with argument strings.
+ * @return Null-terminated array of the tokenCount extracted arguments.
  */
-static inline void SerialCLI_GetArgv(SerialCLI *cli, char *argv[]);
+static inline const char **SerialCLI_GetArgv(SerialCLI *cli);
 
 /**
  * Function to write back output to the serial interface.
  *
+ * The output is coalesced in the TX buffer and handed to the write callback
+ * according to the flush policy.
+ *
  * @param cli The SerialCLI instance.
  * @param output The output string.
  * @param length The length of the output string.
  */
-static inline void SerialCLI_WriteBack(SerialCLI *cli, const char *output, size_t length);
+void SerialCLI_WriteBack(SerialCLI *cli, const char *output, size_t length);
+
+/**
+ * Function to hand output to the write callback without framing it.
+ *
+ * @param cli The SerialCLI instance.
+ * @param data The output.
+ * @param length The length of the output.
+ */
+void SerialCLI_WriteRaw(SerialCLI *cli, const char *data, size_t length);
+
+/**
+ * Function to record a line in the history.
+ *
+ * Empty lines, lines longer than an entry can be and repetitions of the
+ * newest entry are not recorded. Evicts the oldest entries until the line fits.
+ *
+ * @param cli The SerialCLI instance.
+ * @param line The line.
+ * @param length The length of the line.
+ */
+void SerialCLI_HistoryAdd(SerialCLI *cli, const char *line, size_t length);
+
+/**
+ * Function to replace the line being received with an older or newer history entry.
+ *
+ * Moving newer than the newest entry leaves an empty line.
+ *
+ * @param cli The SerialCLI instance.
+ * @param isOlder true to move to the older entry, false to the newer one.
+ */
+void SerialCLI_HistoryRecall(SerialCLI *cli, bool isOlder);
+
+/**
+ * Function to start the reverse incremental search or move it to the next older match.
+ *
+ * @param cli The SerialCLI instance.
+ */
+void SerialCLI_HistorySearchOlder(SerialCLI *cli);
+
+/**
+ * Function to append a character to the search query.
+ *
+ * @param cli The SerialCLI instance.
+ * @param ch The character.
+ */
+void SerialCLI_HistorySearchAppend(SerialCLI *cli, char ch);
+
+/**
+ * Function to remove the last character of the search query.
+ *
+ * @param cli The SerialCLI instance.
+ */
+void SerialCLI_HistorySearchDelete(SerialCLI *cli);
+
+/**
+ * Function to end the search, the match becomes the line being received.
+ *
+ * @param cli The SerialCLI instance.
+ */
+void SerialCLI_HistoryEndSearch(SerialCLI *cli);
+
+/**
+ * Function to show a change of the line being received on the terminal.
+ *
+ * The line already holds the new text and the new cursor position. Writes
+ * the fewest bytes among rewriting the line from the change on, shifting the
+ * rest of the line with insert or delete character sequences and redrawing
+ * the whole line, and adds the edit to the edit statistics.
+ *
+ * @param cli The SerialCLI instance.
+ * @param start Position of the first changed character.
+ * @param removedLength The number of characters removed at start.
+ * @param insertedLength The number of characters inserted at start.
+ * @param oldCursor The cursor position before the change.
+ */
+void SerialCLI_EditorRefresh(SerialCLI *cli, size_t start, size_t removedLength, size_t insertedLength,
+                             size_t oldCursor);
+
+/**
+ * Function to redraw the prompt and the whole line being received.
+ *
+ * @param cli The SerialCLI instance.
+ */
+void SerialCLI_EditorRedraw(SerialCLI *cli);
+
+/**
+ * Function to insert a character at the cursor.
+ *
+ * @param cli The SerialCLI instance.
+ * @param ch The character.
+ *
+ * @return true if the character was inserted, false if the line is full.
+ */
+bool SerialCLI_EditorInsert(SerialCLI *cli, char ch);
+
+/**
+ * Function to delete characters of the line being received, the cursor moves to the start.
+ *
+ * @param cli The SerialCLI instance.
+ * @param start Position of the first character to delete.
+ * @param end Position after the last character to delete.
+ */
+void SerialCLI_EditorDelete(SerialCLI *cli, size_t start, size_t end);
+
+/**
+ * Function to move the cursor within the line being received.
+ *
+ * @param cli The SerialCLI instance.
+ * @param position The new cursor position, at most the line length.
+ */
+void SerialCLI_EditorMoveCursor(SerialCLI *cli, size_t position);
+
+/**
+ * Function to flush the TX buffer if the flush policy asks for it at the end of a command.
+ *
+ * @param cli The SerialCLI instance.
+ */
+static inline void SerialCLI_FlushOnCommandEnd(SerialCLI *cli);
+
+/**
+ * Function to feed bytes from the receive ring into the line queue.
+ *
+ * Moves line by line until the ring is empty. While lines are queued it
+ * stops before the first line that does not fit into the room the queued
+ * lines leave, that line waits in the ring instead of being dropped.
+ *
+ * @param cli The SerialCLI instance.
+ */
+void SerialCLI_DrainReceiveRing(SerialCLI *cli);
+
+/**
+ * Function to frame output written in SERIAL_CLI_MODE_RPC.
+ *
+ * Output of the request being executed becomes an output frame, any other
+ * output a notification frame.
+ *
+ * @param cli The SerialCLI instance.
+ * @param data The output.
+ * @param length The length of the output.
+ */
+void SerialCLI_RpcWriteOutput(SerialCLI *cli, const char *data, size_t length);
+
+/**
+ * Function to execute a queued RPC request frame.
+ *
+ * Decodes the frame in place and answers it with a result frame.
+ *
+ * @param cli The SerialCLI instance.
+ * @param frame The COBS encoded frame without its delimiter.
+ * @param frameLength The length of the encoded frame.
+ */
+void SerialCLI_RpcExecute(SerialCLI *cli, char *frame, size_t frameLength);
+
+/**
+ * Function to complete the RPC request being executed.
+ *
+ * Writes the buffered output in the result frame.
+ *
+ * @param cli The SerialCLI instance.
+ * @param status The status of the request.
+ */
+void SerialCLI_RpcFinishRequest(SerialCLI *cli, uint8_t status);
+
+/**
+ * Function to find the subcommand selected by the extracted arguments.
+ *
+ * Each argument after the name of a group selects one of its subcommands,
+ * the first argument that does not follow a group is not looked up.
+ *
+ * @param cli The SerialCLI instance.
+ * @param entry The top-level command named by the first argument.
+ * @param depth Set to the number of arguments before the name of the selected command.
+ *
+ * @return The selected command, NULL if an argument names no subcommand of its group.
+ */
+SerialCLI_CommandEntry *SerialCLI_ResolveSubcommand(SerialCLI *cli, SerialCLI_CommandEntry *entry, size_t *depth);
+
+/**
+ * Function to call a command with the extracted arguments.
+ *
+ * The command gets the arguments from its own name on, a group lists its
+ * subcommands instead.
+ *
+ * @param cli The SerialCLI instance.
+ * @param entry The command, see @ref SerialCLI_ResolveSubcommand.
+ * @param depth The number of arguments before the name of the command.
+ */
+void SerialCLI_CallCommand(SerialCLI *cli, SerialCLI_CommandEntry *entry, size_t depth);
+
+/**
+ * Function to call a command defined with SERIAL_CLI_COMMAND with the extracted arguments.
+ *
+ * @param cli The SerialCLI instance.
+ * @param command The command.
+ */
+void SerialCLI_CallStaticCommand(SerialCLI *cli, const SerialCLI_StaticCommand *command);
+
+/**
+ * Function to check if the TX ring has room for a line of a streamed listing.
+ *
+ * The line break and prompt following the listing must fit as well. A line
+ * larger than the TX ring has room once no other output is waiting.
+ *
+ * @param cli The SerialCLI instance.
+ * @param length The length of the line.
+ *
+ * @return true if the line can be written without dropping output.
+ */
+bool SerialCLI_HasLineRoom(const SerialCLI *cli, size_t length);
+
+/**
+ * Function to find the first command of a chained line.
+ *
+ * Operators are recognized as whitespace separated words outside quotes.
+ *
+ * @param line The line, NUL-terminated after its length.
+ * @param length The length of the line.
+ * @param segment The bounds to fill.
+ */
+void SerialCLI_FindSegment(const char *line, size_t length, SerialCLI_Segment *segment);
+
+#if SERIAL_CLI_ENABLE_FILTERS
+/**
+ * Function to set up the filters of the next command.
+ *
+ * The patterns are copied, the filters are split in place and argv is
+ * overwritten. Nothing is set up if a filter is invalid, if its patterns do
+ * not fit or if the instance has no filter line buffer.
+ *
+ * @param cli The SerialCLI instance.
+ * @param filters The filters after the first `|`, modified in place.
+ * @param length The length of the filters.
+ * @return true if all filters are valid, false otherwise.
+ */
+bool SerialCLI_StartFilters(SerialCLI *cli, char *filters, size_t length);
+
+/**
+ * Function to pass the output of the running command through its filters.
+ *
+ * Complete lines are filtered at once, the rest is kept until its line ends.
+ *
+ * @param cli The SerialCLI instance.
+ * @param output The output of the command.
+ * @param length The length of the output.
+ */
+void SerialCLI_FilterOutput(SerialCLI *cli, const char *output, size_t length);
+
+/**
+ * Function to filter the last unterminated line, write the counts and remove the filters.
+ *
+ * Called once the command completed.
+ *
+ * @param cli The SerialCLI instance.
+ */
+void SerialCLI_FinishFilters(SerialCLI *cli);
+#else
+static inline bool SerialCLI_StartFilters(SerialCLI *cli, char *filters, size_t length) {
+  (void)cli;
+  (void)filters;
+  (void)length;
+  return false;
+}
+
+static inline void SerialCLI_FinishFilters(SerialCLI *cli) { (void)cli; }
+#endif
+
+#if SERIAL_CLI_ENABLE_TRACE
+/**
+ * Function to hand out the trace tag of an instance being initialized.
+ *
+ * @return A tag no other instance got before, starting at 1.
+ */
+uint32_t SerialCLI_TraceNextInstance(void);
+
+/**
+ * Function to write a trace record, called by the trace points.
+ *
+ * Returns at once while tracing is stopped.
+ *
+ * @param instance The tag of the tracing instance.
+ * @param event The @ref SerialCLI_TraceEvent.
+ * @param payload The event specific value.
+ */
+void SerialCLI_TraceWrite(uint32_t instance, uint16_t event, uint32_t payload);
+#endif
+
+#if SERIAL_CLI_ENABLE_METRICS
+/**
+ * Function to reset the metrics and register the stats command.
+ *
+ * @param cli The SerialCLI instance.
+ */
+void SerialCLI_MetricsInit(SerialCLI *cli);
+
+/**
+ * Function to start measuring a command.
+ *
+ * @param cli The SerialCLI instance.
+ * @param entry The command about to run.
+ */
+void SerialCLI_MetricsStartCommand(SerialCLI *cli, SerialCLI_CommandEntry *entry);
+
+/**
+ * Function to start measuring a command defined with SERIAL_CLI_COMMAND.
+ *
+ * @param cli The SerialCLI instance.
+ * @param command The command about to run.
+ */
+void SerialCLI_MetricsStartStaticCommand(SerialCLI *cli, const SerialCLI_StaticCommand *command);
+
+/**
+ * Function to count the outcome of a line and end the measurement of its command.
+ *
+ * @param cli The SerialCLI instance.
+ * @param status The outcome of the line.
+ */
+void SerialCLI_MetricsEndLine(SerialCLI *cli, SerialCLI_LineStatus status);
+#else
+static inline void SerialCLI_MetricsInit(SerialCLI *cli) { (void)cli; }
+
+static inline void SerialCLI_MetricsStartCommand(SerialCLI *cli, SerialCLI_CommandEntry *entry) {
+  (void)cli;
+  (void)entry;
+}
+
+static inline void SerialCLI_MetricsStartStaticCommand(SerialCLI *cli, const SerialCLI_StaticCommand *command) {
+  (void)cli;
+  (void)command;
+}
+
+static inline void SerialCLI_MetricsEndLine(SerialCLI *cli, SerialCLI_LineStatus status) {
+  (void)cli;
+  (void)status;
+}
+#endif
 
 // Inline implementation below
 
-static inline void SerialCLI_GetArgv(SerialCLI *cli, char *argv[]) {
-  for (int i = 0; i < SERIAL_CLI_COMMAND_MAX_ARGS; ++i) {
-    argv[i] = cli->tokens[i];
+static inline char *SerialCLI_GetLine(SerialCLI *cli) { return &cli->inputBuffer[cli->queuedLength]; }
+
+static inline size_t SerialCLI_GetLineCapacity(const SerialCLI *cli) {
+  // Keeps room for the line terminator and for the terminator of the next, empty line
+  if (cli->queuedLength >= cli->inputBufferSize) {
+    return 0;
   }
-  argv[SERIAL_CLI_COMMAND_MAX_ARGS] = NULL;
+  return cli->inputBufferSize - cli->queuedLength - 1;
 }
 
-static inline void SerialCLI_WriteBack(SerialCLI *cli, const char *output, size_t length) {
-  if (NULL != cli->write) {
-    cli->write(output, length);
+static inline const char **SerialCLI_GetArgv(SerialCLI *cli) { return cli->argv; }
+
+static inline void SerialCLI_FlushOnCommandEnd(SerialCLI *cli) {
+  if (0U != (cli->flushPolicy & SERIAL_CLI_FLUSH_ON_COMMAND_END)) {
+    SerialCLI_Flush(cli);
   }
 }
 
+// The output of the running command passes its filters, the output of the CLI itself does not
+static inline void SerialCLI_SetOutputFiltered(SerialCLI *cli, bool isFiltered) {
+#if SERIAL_CLI_ENABLE_FILTERS
+  cli->isOutputFiltered = isFiltered && (cli->filterCount > 0);
+#else
+  (void)cli;
+  (void)isFiltered;
+#endif
+}
+
+static inline bool SerialCLI_IsOutputFiltered(const SerialCLI *cli) {
+#if SERIAL_CLI_ENABLE_FILTERS
+  return cli->isOutputFiltered;
+#else
+  (void)cli;
+  return false;
+#endif
+}
+
+// Removes the filters of a command that never ran
+static inline void SerialCLI_ClearFilters(SerialCLI *cli) {
+#if SERIAL_CLI_ENABLE_FILTERS
+  cli->filterCount = 0;
+#else
+  (void)cli;
+#endif
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,40 @@
+#ifndef SERIAL_CLI_PARSER_H_
+#define SERIAL_CLI_PARSER_H_
+
+#include "serial_cli.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Function to split a line into arguments.
+ *
+ * Arguments are separated by whitespace, double quotes group whitespace into
+ * one argument. The separators are overwritten with NUL characters and argv
+ * of the SerialCLI instance points into the line.
+ *
+ * @param cli The SerialCLI instance.
+ * @param line The line, modified in place.
+ * @param lineLength The length of the line.
+ * @return The command name, or NULL if the line is empty or has too many arguments.
+ */
+const char *SerialCLI_ParseInput(SerialCLI *cli, char *line, size_t lineLength);
+
+/**
+ * Byte-at-a-time reference of @ref SerialCLI_ParseInput.
+ *
+ * Splits the line the same way, the differential tests compare both.
+ *
+ * @param cli The SerialCLI instance.
+ * @param line The line, modified in place.
+ * @param lineLength The length of the line.
+ * @return The command name, or NULL if the line is empty or has too many arguments.
+ */
+const char *SerialCLI_ParseInputReference(SerialCLI *cli, char *line, size_t lineLength);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_PARSER_H_
@@ -0,0 +1,65 @@
+#ifndef SERIAL_CLI_SCAN_H_
+#define SERIAL_CLI_SCAN_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Scanners finding the next byte that needs attention in a run of input.
+ *
+ * The default scanners use SSE2 or NEON where the compiler targets them and
+ * compare a machine word at a time elsewhere. The scalar scanners are the
+ * reference the others must agree with.
+ */
+
+/**
+ * Function to find the next control byte.
+ *
+ * Control bytes are those below 0x20 and DEL, everything else is a plain
+ * character the line editor appends as it is.
+ *
+ * @param str The bytes to scan.
+ * @param length The number of bytes.
+ * @return Offset of the first control byte, length if there is none.
+ */
+size_t SerialCLI_ScanControl(const char *str, size_t length);
+
+/**
+ * Function to find the next argument delimiter.
+ *
+ * Delimiters are the whitespace of isspace in the C locale and the double quote.
+ *
+ * @param str The bytes to scan.
+ * @param length The number of bytes.
+ * @return Offset of the first delimiter, length if there is none.
+ */
+size_t SerialCLI_ScanDelimiter(const char *str, size_t length);
+
+/**
+ * Word-at-a-time variant of @ref SerialCLI_ScanControl.
+ */
+size_t SerialCLI_ScanControlSwar(const char *str, size_t length);
+
+/**
+ * Word-at-a-time variant of @ref SerialCLI_ScanDelimiter.
+ */
+size_t SerialCLI_ScanDelimiterSwar(const char *str, size_t length);
+
+/**
+ * Byte-at-a-time reference of @ref SerialCLI_ScanControl.
+ */
+size_t SerialCLI_ScanControlScalar(const char *str, size_t length);
+
+/**
+ * Byte-at-a-time reference of @ref SerialCLI_ScanDelimiter.
+ */
+size_t SerialCLI_ScanDelimiterScalar(const char *str, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERIAL_CLI_SCAN_H_
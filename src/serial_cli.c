@@ -1,253 +1,1198 @@
 #include "serial_cli.h"
 #include "serial_cli_commands.h"
 #include "serial_cli_internal.h"
+#include "serial_cli_parser.h"
+#include "serial_cli_rpc.h"
+#include "serial_cli_scan.h"
 
-#include <ctype.h>
-#include <stdarg.h>
-#include <stdio.h>
 #include <string.h>
 
 enum {
+  ASCII_LINE_FEED = '\n',       // ASCII LF character
   ASCII_CARRIAGE_RETURN = '\r', // ASCII CR character
   ASCII_TAB = '\t',             // ASCII TAB character
   ASCII_DEL = 127,              // ASCII DEL character
+  ASCII_ESC = 27,               // ASCII ESC character, starts escape sequences
+  ASCII_DC2 = 18,               // ASCII DC2 character, sent by Ctrl+R
+  ASCII_BS = '\b',              // ASCII BS character, sent by Ctrl+H
+  CONTROL_A = 1,                // Ctrl+A, moves to the start of the line
+  CONTROL_B = 2,                // Ctrl+B, moves left
+  CONTROL_E = 5,                // Ctrl+E, moves to the end of the line
+  CONTROL_F = 6,                // Ctrl+F, moves right
+  CONTROL_K = 11,               // Ctrl+K, deletes up to the end of the line
+  CONTROL_U = 21,               // Ctrl+U, deletes up to the start of the line
+  CONTROL_W = 23,               // Ctrl+W, deletes the word before the cursor
+  MAX_ESCAPE_PARAMETER = 9999,  // Larger parameters are not used by any key
 };
 
-static void resetCLI(SerialCLI *cli) {
-  memset(cli->inputBuffer, 0, SERIAL_CLI_INPUT_BUFFER_SIZE);
-  memset(cli->tokens, 0, sizeof(cli->tokens));
+// States of the escape sequence parser
+enum {
+  ESCAPE_NONE = 0, // Not in an escape sequence
+  ESCAPE_START,    // ESC received
+  ESCAPE_CSI,      // ESC [ received, parameters may follow
+  ESCAPE_SS3,      // ESC O received, sent for the arrow keys in application mode
+};
 
+static void resetEditing(SerialCLI *cli) {
+  cli->escapeState = ESCAPE_NONE;
+  cli->escapeParameter = 0;
+  cli->historyCursor = SERIAL_CLI_HISTORY_NO_ENTRY;
+  cli->isHistorySearching = false;
+  cli->isTabPending = false;
+}
+
+static void resetInput(SerialCLI *cli) {
+  cli->inputBuffer[0] = '\0';
+  cli->queuedLength = 0;
+  cli->queuedLines = 0;
   cli->charCount = 0;
+  cli->cursorPosition = 0;
+  cli->isLineDiscarded = false;
+  cli->isLastCharCarriageReturn = false;
+  cli->chainOperator = SERIAL_CLI_CHAIN_NONE;
+  resetEditing(cli);
+}
+
+static void writePrompt(SerialCLI *cli) {
+  // Machines on an RPC link get no prompt
+  if (SERIAL_CLI_MODE_TEXT == cli->mode) {
+    SerialCLI_WriteString(cli, "\r\n%s ", cli->promptBuffer);
+  }
+}
+
+static void resetCLI(SerialCLI *cli) {
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_PROMPT, cli->queuedLines);
+  cli->argv[0] = NULL;
   cli->tokenCount = 0;
-  cli->isCommandReady = false;
+  cli->isTabPending = false;
+  cli->isLineBreakWritten = false;
 
-  SerialCLI_WriteString(cli, "\r\n%s ", cli->promptBuffer);
+  writePrompt(cli);
+}
+
+static void dropLine(SerialCLI *cli) {
+  cli->charCount = 0;
+  cli->cursorPosition = 0;
+  *SerialCLI_GetLine(cli) = '\0';
+}
+
+static bool queueLine(SerialCLI *cli) {
+  if (cli->isLineDiscarded) {
+    cli->isLineDiscarded = false;
+    SERIAL_CLI_METRICS_ADD(cli, linesDropped, 1);
+    return true;
+  }
+
+  if ((cli->queuedLength + cli->charCount + 2) > (cli->inputBufferSize + 1)) {
+    dropLine(cli);
+    SERIAL_CLI_METRICS_ADD(cli, linesDropped, 1);
+    return false;
+  }
+
+  if (SERIAL_CLI_MODE_TEXT == cli->mode) {
+    SerialCLI_HistoryAdd(cli, SerialCLI_GetLine(cli), cli->charCount);
+  }
+
+  // The line is already in place, terminating it moves it into the queue
+  cli->queuedLength += cli->charCount + 1;
+  ++cli->queuedLines;
+  dropLine(cli);
+  return true;
+}
+
+static void consumeInput(SerialCLI *cli, size_t length) {
+  size_t remainingLength = cli->queuedLength - length + cli->charCount;
+  memmove(cli->inputBuffer, &cli->inputBuffer[length], remainingLength);
+
+  cli->queuedLength -= length;
+  cli->inputBuffer[remainingLength] = '\0';
 }
 
-static void callCommand(SerialCLI *cli, const char *commandName) {
+static void dequeueLine(SerialCLI *cli, size_t lineLength) {
+  consumeInput(cli, lineLength + 1);
+  --cli->queuedLines;
+}
+
+// Drops the commands of a chained line that did not run yet
+static void dropChain(SerialCLI *cli) {
+  if (SERIAL_CLI_CHAIN_NONE != cli->chainOperator) {
+    dequeueLine(cli, strlen(cli->inputBuffer));
+    cli->chainOperator = SERIAL_CLI_CHAIN_NONE;
+  }
+}
+
+static SerialCLI_LineStatus callCommand(SerialCLI *cli, const char *commandName) {
   SerialCLI_CommandEntry *entry = SerialCLI_GetCommandEntry(cli, commandName);
+  size_t depth = 0;
+  const SerialCLI_StaticCommand *staticCommand = NULL;
   if (NULL != entry) {
+    entry = SerialCLI_ResolveSubcommand(cli, entry, &depth);
+  } else {
+    // Registered commands are found first, the static table is searched only for the other names
+    staticCommand = SerialCLI_FindStaticCommand(commandName, strlen(commandName));
+  }
+  if ((NULL == entry) && (NULL == staticCommand)) {
+    return SERIAL_CLI_LINE_UNKNOWN_COMMAND;
+  }
+
+  // Output starts on a new line after the echoed input, the commands chained after the first one share it
+  if ((SERIAL_CLI_MODE_TEXT == cli->mode) && !cli->isLineBreakWritten) {
     char *toWrite = "\r\n";
     SerialCLI_WriteBack(cli, toWrite, strlen(toWrite));
+    cli->isLineBreakWritten = true;
+  }
 
-    char *argv[SERIAL_CLI_COMMAND_MAX_ARGS + 1] = {0};
-    SerialCLI_GetArgv(cli, argv);
-    entry->command(cli, (int)cli->tokenCount, (const char **)argv);
+  SerialCLI_SetOutputFiltered(cli, true);
+  if (NULL != entry) {
+    SerialCLI_CallCommand(cli, entry, depth);
+  } else {
+    SerialCLI_CallStaticCommand(cli, staticCommand);
+  }
+  SerialCLI_SetOutputFiltered(cli, false);
+  if (NULL == cli->continuation) {
+    SerialCLI_FinishFilters(cli);
   }
+  return cli->isCommandFailed ? SERIAL_CLI_LINE_COMMAND_FAILED : SERIAL_CLI_LINE_OK;
 }
 
-static const char *parseInput(SerialCLI *cli) {
-  bool isQuotedArgument = false;
-  bool isRegularArgument = false;
+static void reportLine(SerialCLI *cli, SerialCLI_LineStatus status) {
+  cli->chainStatus = status;
+  SerialCLI_MetricsEndLine(cli, status);
+  if (NULL != cli->onLineResult) {
+    cli->onLineResult(cli->lineResultContext, status);
+  }
+}
 
-  size_t argumentIdx = 0;
-  size_t argumentLength = 0;
-  for (size_t i = 0; i < cli->charCount; ++i) {
-    bool isMaxArgLengthReached = (argumentLength > SERIAL_CLI_COMMAND_MAX_ARG_LENGTH);
-    bool isMaxArgsReached = (argumentIdx == SERIAL_CLI_COMMAND_MAX_ARGS);
-    if (isMaxArgLengthReached || isMaxArgsReached) {
-      return NULL;
+// Returns false for an empty line
+static bool executeLine(SerialCLI *cli, char *line, size_t lineLength) {
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_PARSE_BEGIN, lineLength);
+  const char *commandName = SerialCLI_ParseInput(cli, line, lineLength);
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_PARSE_END, cli->tokenCount);
+  if ((NULL == commandName) && (0 == cli->tokenCount)) {
+    return false;
+  }
+
+  SerialCLI_LineStatus status =
+      (NULL != commandName) ? callCommand(cli, commandName) : SERIAL_CLI_LINE_TOO_MANY_ARGUMENTS;
+  // A deferred command is reported once it completes
+  if (NULL == cli->continuation) {
+    reportLine(cli, status);
+  }
+  return true;
+}
+
+// Returns false if the segment holds no command
+static bool executeSegment(SerialCLI *cli, char *text, const SerialCLI_Segment *segment) {
+  // The filters are split first, the arguments of the command take argv last
+  bool isPiped = segment->filterStart != segment->commandLength;
+  if (isPiped && !SerialCLI_StartFilters(cli, &text[segment->filterStart], segment->length - segment->filterStart)) {
+    reportLine(cli, SERIAL_CLI_LINE_INVALID_FILTER);
+    return true;
+  }
+
+  bool isExecuted = executeLine(cli, text, segment->commandLength);
+  // The filters of an empty or rejected command never saw output
+  if (NULL == cli->continuation) {
+    SerialCLI_ClearFilters(cli);
+  }
+  return isExecuted;
+}
+
+// Executes the next command of the first queued line, skipping the commands after a failed `&&`. Returns the length
+// of the line up to the next command.
+static size_t executeChain(SerialCLI *cli, char *line, size_t lineLength) {
+  size_t position = 0;
+  do {
+    SerialCLI_Segment segment;
+    char *text = &line[position];
+    SerialCLI_FindSegment(text, lineLength - position, &segment);
+    bool isSkipped = (SERIAL_CLI_CHAIN_AND == cli->chainOperator) && (SERIAL_CLI_LINE_OK != cli->chainStatus);
+    cli->chainOperator = (uint8_t)segment.nextOperator;
+    position += segment.nextStart;
+    if (!isSkipped && executeSegment(cli, text, &segment)) {
+      break;
     }
+  } while (position < lineLength);
+  return position;
+}
 
-    // quoted argument
-    if ('\"' == cli->inputBuffer[i]) {
-      if (isQuotedArgument) {
-        ++argumentIdx;
-      }
-      isQuotedArgument = !isQuotedArgument;
-      argumentLength = 0;
-      continue;
+static void completeCommand(SerialCLI *cli, SerialCLI_LineStatus status) {
+  if (SERIAL_CLI_MODE_RPC == cli->mode) {
+    uint8_t rpcStatus = SERIAL_CLI_RPC_STATUS_OK;
+    if (SERIAL_CLI_LINE_CANCELLED == status) {
+      rpcStatus = SERIAL_CLI_RPC_STATUS_CANCELLED;
+    } else if (SERIAL_CLI_LINE_COMMAND_FAILED == status) {
+      rpcStatus = SERIAL_CLI_RPC_STATUS_COMMAND_FAILED;
     }
+    SerialCLI_RpcFinishRequest(cli, rpcStatus);
+    return;
+  }
 
-    if (isQuotedArgument) {
-      cli->tokens[argumentIdx][argumentLength] = cli->inputBuffer[i];
-      ++argumentLength;
-      continue;
+  if ((SERIAL_CLI_LINE_CANCELLED == status) && (SERIAL_CLI_MODE_TEXT == cli->mode)) {
+    SerialCLI_WriteString(cli, "^C");
+  }
+  reportLine(cli, status);
+  // The prompt follows the last command of a chained line
+  if (SERIAL_CLI_CHAIN_NONE == cli->chainOperator) {
+    resetCLI(cli);
+  }
+  SerialCLI_FlushOnCommandEnd(cli);
+}
+
+static void continueCommand(SerialCLI *cli) {
+  bool isCancelled = SERIAL_CLI_LOAD_ACQUIRE(&cli->isCancelRequested);
+  SerialCLI_SetOutputFiltered(cli, true);
+  bool isComplete = cli->continuation(cli, cli->continuationState, isCancelled);
+  SerialCLI_SetOutputFiltered(cli, false);
+  if (!isComplete && !isCancelled) {
+    // Output of an RPC request is collected for its result frame
+    if (!cli->isRpcRequestActive) {
+      SerialCLI_FlushOnCommandEnd(cli);
     }
+    return;
+  }
 
-    // regular argument
-    if (isspace((unsigned char)cli->inputBuffer[i])) {
-      if (isRegularArgument) {
-        ++argumentIdx;
-      }
-      isRegularArgument = false;
-      argumentLength = 0;
+  SERIAL_CLI_STORE_RELEASE(&cli->continuation, NULL);
+  cli->continuationState = NULL;
+  SERIAL_CLI_STORE_RELEASE(&cli->isCancelRequested, false);
+
+  SerialCLI_FinishFilters(cli);
+  SerialCLI_LineStatus status = SERIAL_CLI_LINE_OK;
+  if (isCancelled) {
+    status = SERIAL_CLI_LINE_CANCELLED;
+    dropChain(cli);
+  } else if (cli->isCommandFailed) {
+    status = SERIAL_CLI_LINE_COMMAND_FAILED;
+  }
+  completeCommand(cli, status);
+}
+
+static size_t getHelpEntryLength(const char *name, const char *description) {
+  size_t length = (NULL != name) ? (strlen(name) + 5) : 0;
+  return length + ((NULL != description) ? (strlen(description) + 2) : 0);
+}
+
+bool SerialCLI_HasLineRoom(const SerialCLI *cli, size_t length) {
+  if ((length + strlen(cli->promptBuffer) + 3) <= SerialCLI_GetTxSpace(cli)) {
+    return true;
+  }
+
+  // Output of an RPC request leaves the buffer only once it is full
+  bool isBuffered = (cli->txLength > 0) && !cli->isRpcRequestActive;
+  return (0 == SerialCLI_GetTxPending(cli)) && !isBuffered;
+}
+
+static void writeHelpEntry(SerialCLI *cli, const char *name, const char *description) {
+  if (NULL != name) {
+    SerialCLI_WriteString(cli, "  %s - ", name);
+  }
+  if (NULL != description) {
+    SerialCLI_WriteString(cli, "%s\r\n", description);
+  }
+}
+
+// Returns the first command without room in the TX ring, NULL once all are written. The shared and the static
+// commands follow the last top-level entry.
+static const void *writeHelpEntries(SerialCLI *cli, const void *current) {
+  size_t staticCount = 0;
+  const SerialCLI_StaticCommand *staticCommands = SerialCLI_GetStaticCommands(&staticCount);
+  while (current != NULL) {
+    const char *name = NULL;
+    const char *description = NULL;
+    const void *next = NULL;
+    if (SerialCLI_IsStaticCommand(current)) {
+      const SerialCLI_StaticCommand *command = current;
+      name = command->commandName;
+      description = command->commandDescription;
+      next = (&command[1] < &staticCommands[staticCount]) ? &command[1] : NULL;
     } else {
-      isRegularArgument = true;
-      cli->tokens[argumentIdx][argumentLength] = cli->inputBuffer[i];
-      ++argumentLength;
+      const SerialCLI_CommandEntry *entry = current;
+      name = entry->commandName;
+      description = entry->commandDescription;
+      next = SerialCLI_GetNextListed(cli, entry);
+    }
+
+    if (!SerialCLI_HasLineRoom(cli, getHelpEntryLength(name, description))) {
+      return current;
     }
+    writeHelpEntry(cli, name, description);
+    current = next;
   }
+  return NULL;
+}
 
-  isRegularArgument ? (cli->tokenCount = (argumentIdx + 1)) : (cli->tokenCount = argumentIdx);
-  return cli->tokens[0];
+static bool continueHelp(SerialCLI *cli, void *state, bool isCancelled) {
+  if (isCancelled) {
+    return true;
+  }
+
+  cli->continuationState = (void *)writeHelpEntries(cli, state);
+  return NULL == cli->continuationState;
 }
 
-static void helpCommand(SerialCLI *cli, int argc, const char **argv) {
-  (void)argv;
+// With a non-blocking write callback the list streams as the transport takes it
+static void listCommands(SerialCLI *cli, const void *first) {
+  const void *rest = writeHelpEntries(cli, first);
+  if (NULL != rest) {
+    (void)SerialCLI_Defer(cli, continueHelp, (void *)rest);
+  }
+}
+
+static void listGroup(SerialCLI *cli, SerialCLI_CommandGroup *group) {
+  SerialCLI_WriteString(cli, "Available %s commands:\r\n", group->entry.commandName);
+  listCommands(cli, group->commands);
+}
 
+// Looks up a path of group and command names, NULL unless all of them name a command
+static SerialCLI_CommandEntry *findCommandPath(SerialCLI *cli, int argc, const char **argv) {
+  SerialCLI_CommandEntry *entry = SerialCLI_GetCommandEntry(cli, argv[0]);
+  for (int i = 1; (NULL != entry) && (i < argc); ++i) {
+    if (!SerialCLI_IsCommandGroup(entry)) {
+      return NULL;
+    }
+    entry = SerialCLI_FindCommand(&((SerialCLI_CommandGroup *)entry)->trie, argv[i], strlen(argv[i]));
+  }
+  return entry;
+}
+
+static void helpCommand(SerialCLI *cli, int argc, const char **argv) {
   if (argc > 1) {
-    SerialCLI_WriteString(cli, "Usage: help\r\n");
+    // Help on a group lists only its subcommands
+    SerialCLI_CommandEntry *entry = findCommandPath(cli, argc - 1, &argv[1]);
+    const SerialCLI_StaticCommand *staticCommand =
+        ((NULL == entry) && (2 == argc)) ? SerialCLI_FindStaticCommand(argv[1], strlen(argv[1])) : NULL;
+    if (NULL != staticCommand) {
+      writeHelpEntry(cli, staticCommand->commandName, staticCommand->commandDescription);
+    } else if (NULL == entry) {
+      SerialCLI_WriteString(cli, "Usage: help [group ...]\r\n");
+    } else if (SerialCLI_IsCommandGroup(entry)) {
+      listGroup(cli, (SerialCLI_CommandGroup *)entry);
+    } else {
+      writeHelpEntry(cli, entry->commandName, entry->commandDescription);
+    }
     return;
   }
 
   SerialCLI_WriteString(cli, "Available commands:\r\n");
+  listCommands(cli, SerialCLI_GetNextListed(cli, &cli->helpEntry));
+}
 
-  SerialCLI_CommandEntry *current = cli->commands.next;
-  while (current != NULL) {
-    if (NULL != current->commandName) {
-      SerialCLI_WriteString(cli, "  %s - ", current->commandName);
-    }
-    if (NULL != current->commandDescription) {
-      SerialCLI_WriteString(cli, "%s\r\n", current->commandDescription);
-    }
-    current = current->next;
+SerialCLI_CommandEntry *SerialCLI_ResolveSubcommand(SerialCLI *cli, SerialCLI_CommandEntry *entry, size_t *depth) {
+  const char **argv = SerialCLI_GetArgv(cli);
+  size_t i = 1;
+  // One lookup in the index of the group per level
+  while ((NULL != entry) && SerialCLI_IsCommandGroup(entry) && (i < cli->tokenCount)) {
+    entry = SerialCLI_FindCommand(&((SerialCLI_CommandGroup *)entry)->trie, argv[i], strlen(argv[i]));
+    ++i;
   }
+  *depth = i - 1;
+  return entry;
 }
 
-bool SerialCLI_Init(SerialCLI *cli, SerialCLI_Write write) {
-  if (NULL == cli || NULL == write) {
-    return false;
+// The built-in commands read the instance itself, they always run right away
+static bool isBuiltInCommand(const SerialCLI *cli, const SerialCLI_CommandEntry *entry) {
+#if SERIAL_CLI_ENABLE_METRICS
+  if (entry == &cli->statsEntry) {
+    return true;
   }
+#endif
+  return entry == &cli->helpEntry;
+}
 
-  cli->write = write;
+static void runCommand(SerialCLI *cli, SerialCLI_Command command, int argc, const char **argv) {
+  if ((NULL == cli->commandRunner) || !cli->commandRunner(cli->commandRunnerContext, cli, command, argc, argv)) {
+    command(cli, argc, argv);
+  }
+}
+
+void SerialCLI_CallCommand(SerialCLI *cli, SerialCLI_CommandEntry *entry, size_t depth) {
+  cli->isCommandFailed = false;
+  SerialCLI_MetricsStartCommand(cli, entry);
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_COMMAND_BEGIN, entry->commandId);
+  int argc = (int)(cli->tokenCount - depth);
+  const char **argv = &SerialCLI_GetArgv(cli)[depth];
+  if (SerialCLI_IsCommandGroup(entry)) {
+    listGroup(cli, (SerialCLI_CommandGroup *)entry);
+  } else if (isBuiltInCommand(cli, entry)) {
+    entry->command(cli, argc, argv);
+  } else {
+    runCommand(cli, entry->command, argc, argv);
+  }
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_COMMAND_END, cli->isCommandFailed ? SERIAL_CLI_LINE_COMMAND_FAILED
+                                                                           : SERIAL_CLI_LINE_OK);
+}
+
+void SerialCLI_CallStaticCommand(SerialCLI *cli, const SerialCLI_StaticCommand *command) {
+  cli->isCommandFailed = false;
+  SerialCLI_MetricsStartStaticCommand(cli, command);
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_COMMAND_BEGIN, SerialCLI_GetStaticCommandId(command));
+  runCommand(cli, command->command, (int)cli->tokenCount, SerialCLI_GetArgv(cli));
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_COMMAND_END, cli->isCommandFailed ? SERIAL_CLI_LINE_COMMAND_FAILED
+                                                                           : SERIAL_CLI_LINE_OK);
+}
+
+static void initialize(SerialCLI *cli) {
+#if SERIAL_CLI_ENABLE_TRACE
+  cli->traceInstance = SerialCLI_TraceNextInstance();
+#endif
+  cli->continuation = NULL;
+  cli->continuationState = NULL;
+  cli->isCancelRequested = false;
+  cli->mode = SERIAL_CLI_MODE_TEXT;
+  cli->onLineResult = NULL;
+  cli->lineResultContext = NULL;
+  cli->commandRunner = NULL;
+  cli->commandRunnerContext = NULL;
+  cli->monitor = NULL;
+  cli->monitorContext = NULL;
+  cli->isCommandFailed = false;
+  cli->isRpcRequestActive = false;
+  cli->rpcRequestId = 0;
+  cli->chainStatus = SERIAL_CLI_LINE_OK;
+#if SERIAL_CLI_ENABLE_FILTERS
+  cli->filterCount = 0;
+  cli->isOutputFiltered = false;
+  cli->filterPatternLength = 0;
+  cli->filterLineLength = 0;
+#endif
+  cli->rxHead = 0;
+  cli->rxTail = 0;
+  cli->rxDropped = 0;
+  cli->txLength = 0;
+  cli->txRingStart = 0;
+  cli->txRingLength = 0;
+  cli->txDropped = 0;
+  cli->flushPolicy = SERIAL_CLI_FLUSH_ON_COMMAND_END;
+  cli->txHighWaterMark = cli->txBufferSize;
+  cli->historyHead = 0;
+  cli->historyLength = 0;
+  memset(&cli->editStats, 0, sizeof(cli->editStats));
   strncpy(cli->promptBuffer, ">>", SERIAL_CLI_PROMPT_BUFFER_MAX_LENGTH);
+  resetInput(cli);
   resetCLI(cli);
 
-  SerialCLI_CommandEntry *helpEntry = &cli->commands;
+  SerialCLI_CommandEntry *helpEntry = &cli->helpEntry;
   helpEntry->command = helpCommand;
   helpEntry->commandName = "help";
   helpEntry->commandDescription = "Prints all available commands";
   helpEntry->next = NULL;
+  helpEntry->parent = NULL;
+
+  (void)SerialCLI_InitRegistry(&cli->commands);
+  cli->commands.nextCommandId = SERIAL_CLI_INSTANCE_COMMAND_ID;
+  SerialCLI_IndexCommand(&cli->commands, helpEntry);
+  cli->commands.commands = helpEntry;
+  cli->commands.commandsTail = helpEntry;
+  cli->registry = NULL;
+  SerialCLI_MetricsInit(cli);
+
+  SerialCLI_FlushOnCommandEnd(cli);
+}
+
+static bool useEmbeddedStorage(SerialCLI *cli) {
+#if SERIAL_CLI_EMBEDDED_STORAGE
+  cli->inputBuffer = cli->embeddedInputBuffer;
+  cli->inputBufferSize = SERIAL_CLI_INPUT_BUFFER_SIZE;
+  cli->argv = cli->embeddedArgv;
+  cli->maxArgs = SERIAL_CLI_COMMAND_MAX_ARGS;
+  cli->txBuffer = cli->embeddedTxBuffer;
+  cli->txBufferSize = SERIAL_CLI_TX_BUFFER_SIZE;
+  cli->historyBuffer = cli->embeddedHistoryBuffer;
+  cli->historySize = SERIAL_CLI_HISTORY_SIZE;
+  cli->rxRing = cli->embeddedRxRing;
+  cli->rxRingSize = SERIAL_CLI_RX_RING_SIZE;
+#if SERIAL_CLI_ENABLE_FILTERS
+  cli->filterPatterns = cli->embeddedFilterPatterns;
+  cli->filterPatternSize = SERIAL_CLI_FILTER_PATTERN_SIZE;
+  cli->filterLine = cli->embeddedFilterLine;
+  cli->filterLineSize = SERIAL_CLI_FILTER_LINE_SIZE;
+#endif
+  return true;
+#else
+  (void)cli;
+  return false;
+#endif
+}
+
+bool SerialCLI_Init(SerialCLI *cli, SerialCLI_Write write) {
+  if (NULL == cli || NULL == write || !useEmbeddedStorage(cli) || !SerialCLI_CheckStaticCommands()) {
+    return false;
+  }
+
+  cli->write = write;
+  cli->contextWrite = NULL;
+  cli->nonBlockingWrite = NULL;
+  cli->context = NULL;
+  initialize(cli);
+  return true;
+}
+
+bool SerialCLI_InitWithContext(SerialCLI *cli, SerialCLI_ContextWrite write, void *context) {
+  if (NULL == cli || NULL == write || !useEmbeddedStorage(cli) || !SerialCLI_CheckStaticCommands()) {
+    return false;
+  }
+
+  cli->write = NULL;
+  cli->contextWrite = write;
+  cli->nonBlockingWrite = NULL;
+  cli->context = context;
+  initialize(cli);
   return true;
 }
 
+static bool useStorage(SerialCLI *cli, const SerialCLI_Storage *storage) {
+  bool isStorageValid = (NULL != storage->inputBuffer) && (storage->inputBufferSize >= 2) &&
+                        (NULL != storage->argv) && (storage->maxArgs > 0) && (NULL != storage->txBuffer) &&
+                        (storage->txBufferSize > 0) &&
+                        ((NULL != storage->historyBuffer) || (0 == storage->historyBufferSize)) &&
+                        ((NULL != storage->rxRing) || (0 == storage->rxRingSize)) &&
+                        (0 == (storage->rxRingSize & (storage->rxRingSize - 1))) &&
+                        ((NULL != storage->filterLine) || (0 == storage->filterLineSize)) &&
+                        ((NULL != storage->filterPatterns) || (0 == storage->filterPatternSize)) &&
+                        (storage->filterPatternSize <= UINT8_MAX);
+  if (!isStorageValid) {
+    return false;
+  }
+
+  cli->inputBuffer = storage->inputBuffer;
+  cli->inputBufferSize = storage->inputBufferSize;
+  cli->argv = storage->argv;
+  cli->maxArgs = storage->maxArgs;
+  cli->txBuffer = storage->txBuffer;
+  cli->txBufferSize = storage->txBufferSize;
+  cli->historyBuffer = storage->historyBuffer;
+  cli->historySize = storage->historyBufferSize;
+  cli->rxRing = storage->rxRing;
+  cli->rxRingSize = storage->rxRingSize;
+#if SERIAL_CLI_ENABLE_FILTERS
+  cli->filterPatterns = storage->filterPatterns;
+  cli->filterPatternSize = storage->filterPatternSize;
+  cli->filterLine = storage->filterLine;
+  cli->filterLineSize = storage->filterLineSize;
+#endif
+  return true;
+}
+
+bool SerialCLI_InitWithStorage(SerialCLI *cli, const SerialCLI_Storage *storage, SerialCLI_ContextWrite write,
+                               void *context) {
+  if (NULL == cli || NULL == storage || NULL == write || !useStorage(cli, storage) ||
+      !SerialCLI_CheckStaticCommands()) {
+    return false;
+  }
+
+  cli->write = NULL;
+  cli->contextWrite = write;
+  cli->nonBlockingWrite = NULL;
+  cli->context = context;
+  initialize(cli);
+  return true;
+}
+
+bool SerialCLI_InitNonBlocking(SerialCLI *cli, const SerialCLI_Storage *storage, SerialCLI_NonBlockingWrite write,
+                               void *context, char *txRing, size_t txRingSize) {
+  if (NULL == cli || NULL == write || NULL == txRing || !SerialCLI_CheckStaticCommands()) {
+    return false;
+  }
+
+  bool isStorageValid = (NULL != storage) ? useStorage(cli, storage) : useEmbeddedStorage(cli);
+  // A flushed TX buffer must fit into the empty ring
+  if (!isStorageValid || (txRingSize < cli->txBufferSize)) {
+    return false;
+  }
+
+  cli->write = NULL;
+  cli->contextWrite = NULL;
+  cli->nonBlockingWrite = write;
+  cli->context = context;
+  cli->txRing = txRing;
+  cli->txRingSize = txRingSize;
+  initialize(cli);
+  return true;
+}
+
+void *SerialCLI_GetContext(const SerialCLI *cli) { return (NULL != cli) ? cli->context : NULL; }
+
 bool SerialCLI_Deinit(SerialCLI *cli) {
   if (NULL == cli) {
     return false;
   }
 
+  // A deferred command gets the chance to release its state
+  if (NULL != cli->continuation) {
+    SERIAL_CLI_STORE_RELEASE(&cli->isCancelRequested, true);
+    continueCommand(cli);
+  }
+
+  resetInput(cli);
   resetCLI(cli);
+  SerialCLI_Flush(cli);
   return true;
 }
 
-static void handleDelete(SerialCLI *cli, char *output, size_t *outputLen) {
-  if (cli->charCount == 0) {
-    return;
+static size_t findWordStart(SerialCLI *cli) {
+  const char *line = SerialCLI_GetLine(cli);
+  size_t position = cli->cursorPosition;
+  while ((position > 0) && (' ' == line[position - 1])) {
+    --position;
+  }
+  while ((position > 0) && (' ' != line[position - 1])) {
+    --position;
   }
+  return position;
+}
 
-  // Remove the last character from the input buffer
-  cli->inputBuffer[cli->charCount - 1] = '\0';
-  cli->charCount--;
+// Returns false if the character is not an editing key
+static bool handleEditKey(SerialCLI *cli, char ch) {
+  size_t cursor = cli->cursorPosition;
+  switch (ch) {
+  case ASCII_DEL:
+  case ASCII_BS:
+    if (cursor > 0) {
+      SerialCLI_EditorDelete(cli, cursor - 1, cursor);
+    }
+    return true;
+  case CONTROL_A:
+    SerialCLI_EditorMoveCursor(cli, 0);
+    return true;
+  case CONTROL_B:
+    if (cursor > 0) {
+      SerialCLI_EditorMoveCursor(cli, cursor - 1);
+    }
+    return true;
+  case CONTROL_E:
+    SerialCLI_EditorMoveCursor(cli, cli->charCount);
+    return true;
+  case CONTROL_F:
+    SerialCLI_EditorMoveCursor(cli, cursor + 1);
+    return true;
+  case CONTROL_K:
+    SerialCLI_EditorDelete(cli, cursor, cli->charCount);
+    return true;
+  case CONTROL_U:
+    SerialCLI_EditorDelete(cli, 0, cursor);
+    return true;
+  case CONTROL_W:
+    SerialCLI_EditorDelete(cli, findWordStart(cli), cursor);
+    return true;
+  default:
+    return false;
+  }
+}
 
-  // Add delete sequence to output buffer
-  const char *deleteSequence = "\b \b";
-  size_t deleteSeqLen = strlen(deleteSequence);
-  bool isOutputSpaceAvailable = ((*outputLen + deleteSeqLen) < SERIAL_CLI_OUTPUT_BUFFER_SIZE);
+static void writeCandidate(void *context, const char *commandName) {
+  SerialCLI_WriteString((SerialCLI *)context, "%s  ", commandName);
+}
+
+static void listCandidates(SerialCLI *cli, const SerialCLI_PrefixMatch *match) {
+  SerialCLI_WriteString(cli, "\r\n");
+  SerialCLI_ForEachPrefixMatch(match, writeCandidate, cli);
+  SerialCLI_WriteString(cli, "\r\n%s ", cli->promptBuffer);
+  SerialCLI_WriteBack(cli, SerialCLI_GetLine(cli), cli->charCount);
+}
 
-  if (isOutputSpaceAvailable) {
-    size_t outIdx = *outputLen;
-    for (size_t i = 0; i < deleteSeqLen; i++) {
-      output[outIdx] = deleteSequence[i];
-      ++outIdx;
+// Finds the commands the last word of the line is completed from, the words before it must name groups
+static SerialCLI_CommandTrie *findCompletionScope(SerialCLI *cli, const char *line, size_t length, size_t *wordStart) {
+  SerialCLI_CommandTrie *trie = &cli->commands.commandTrie;
+  size_t start = 0;
+  for (size_t i = 0; i < length; ++i) {
+    if (' ' != line[i]) {
+      continue;
+    }
+    if (i > start) {
+      SerialCLI_CommandEntry *entry = (&cli->commands.commandTrie == trie)
+                                          ? SerialCLI_FindTopLevelCommand(cli, &line[start], i - start)
+                                          : SerialCLI_FindCommand(trie, &line[start], i - start);
+      if ((NULL == entry) || !SerialCLI_IsCommandGroup(entry)) {
+        return NULL;
+      }
+      trie = &((SerialCLI_CommandGroup *)entry)->trie;
     }
-    *outputLen = outIdx;
+    start = i + 1;
   }
+  *wordStart = start;
+  return trie;
 }
 
-static void handleTabCompletion(SerialCLI *cli, char *output, size_t *outputLen) {
-  const char *name = SerialCLI_ResolvePartialCommand(cli, cli->inputBuffer);
-  if (NULL == name) {
+static void handleTabCompletion(SerialCLI *cli) {
+  char *line = SerialCLI_GetLine(cli);
+
+  // Only the command name at the end of the line is completed
+  if (cli->cursorPosition != cli->charCount) {
     return;
   }
 
-  size_t outIdx = *outputLen;
-  size_t nameLen = strlen(name);
+  size_t wordStart = 0;
+  SerialCLI_CommandTrie *trie = findCompletionScope(cli, line, cli->charCount, &wordStart);
+  size_t wordLength = cli->charCount - wordStart;
+  SerialCLI_PrefixMatch match;
+  if (NULL == trie) {
+    return;
+  }
+  bool isMatch = SerialCLI_MatchCommandPrefix(trie, &line[wordStart], wordLength, &match);
+  // The shared and the static commands are completed at the top level only
+  if (&cli->commands.commandTrie == trie) {
+    if (NULL != cli->registry) {
+      isMatch = SerialCLI_MatchSharedPrefix(&cli->registry->commandTrie, &line[wordStart], wordLength, &match);
+    }
+    isMatch = SerialCLI_MatchStaticPrefix(&line[wordStart], wordLength, &match);
+  }
+  if (!isMatch) {
+    return;
+  }
 
-  bool isOutputSpaceAvailable = ((outIdx + nameLen + strlen(" ")) < SERIAL_CLI_OUTPUT_BUFFER_SIZE);
-  bool isInputSpaceAvailable = (nameLen + strlen(" ") < SERIAL_CLI_INPUT_BUFFER_SIZE);
-  if (!isOutputSpaceAvailable || !isInputSpaceAvailable) {
+  if (match.commonLength <= wordLength) {
+    // Nothing to fill in, a second TAB lists the candidates
+    if (cli->isTabPending && !match.isUnique) {
+      listCandidates(cli, &match);
+    }
     return;
   }
 
-  for (size_t i = cli->charCount; i < nameLen; ++i) {
-    cli->inputBuffer[i] = name[i];
-    output[outIdx] = name[i];
-    ++outIdx;
+  size_t fillLen = wordStart + (match.isUnique ? (match.commonLength + strlen(" ")) : match.commonLength);
+  if (fillLen > SerialCLI_GetLineCapacity(cli)) {
+    return;
   }
 
-  output[outIdx] = ' ';
-  ++outIdx;
-  cli->inputBuffer[nameLen] = ' ';
-  cli->charCount = nameLen + strlen(" ");
-  *outputLen = outIdx;
+  size_t completionLen = match.commonLength - wordLength;
+  memcpy(&line[cli->charCount], &match.name[wordLength], completionLen);
+  SerialCLI_WriteBack(cli, &match.name[wordLength], completionLen);
+
+  if (match.isUnique) {
+    line[wordStart + match.commonLength] = ' ';
+    SerialCLI_WriteBack(cli, " ", strlen(" "));
+  }
+  cli->charCount = fillLen;
+  cli->cursorPosition = fillLen;
+  line[cli->charCount] = '\0';
 }
 
-bool SerialCLI_Read(SerialCLI *cli, const char *str, size_t length) {
-  if (NULL == cli || (NULL == str)) {
+static void handleCancel(SerialCLI *cli) {
+  if (NULL != cli->continuation) {
+    SERIAL_CLI_STORE_RELEASE(&cli->isCancelRequested, true);
+    return;
+  }
+
+  // Without a running command Ctrl+C discards the line being typed and the rest of a chained line
+  SERIAL_CLI_STORE_RELEASE(&cli->isCancelRequested, false);
+  if (SERIAL_CLI_CHAIN_NONE != cli->chainOperator) {
+    dropChain(cli);
+    cli->isLineBreakWritten = false;
+  }
+  dropLine(cli);
+  cli->isLineDiscarded = false;
+  resetEditing(cli);
+  if (SERIAL_CLI_MODE_TEXT == cli->mode) {
+    SerialCLI_WriteString(cli, "^C");
+    writePrompt(cli);
+  }
+}
+
+static bool handleLineEnd(SerialCLI *cli, char ch) {
+  // CR LF is a single line ending
+  bool isCarriageReturnLineFeed = (ASCII_LINE_FEED == ch) && cli->isLastCharCarriageReturn;
+  cli->isLastCharCarriageReturn = (ASCII_CARRIAGE_RETURN == ch);
+  cli->isTabPending = false;
+  cli->escapeState = ESCAPE_NONE;
+
+  if (isCarriageReturnLineFeed) {
+    return true;
+  }
+  // Enter executes the search match
+  if (cli->isHistorySearching) {
+    SerialCLI_HistoryEndSearch(cli);
+  }
+  return queueLine(cli);
+}
+
+static void handleEscapeFinal(SerialCLI *cli, char ch) {
+  uint16_t parameter = cli->escapeParameter;
+  size_t cursor = cli->cursorPosition;
+
+  if ('~' == ch) {
+    // VT220 editing keys carry the key as parameter
+    if ((1 == parameter) || (7 == parameter)) {
+      ch = 'H';
+    } else if ((4 == parameter) || (8 == parameter)) {
+      ch = 'F';
+    } else if (3 == parameter) {
+      SerialCLI_EditorDelete(cli, cursor, cursor + 1);
+      return;
+    }
+  }
+
+  switch (ch) {
+  case 'A':
+    SerialCLI_HistoryRecall(cli, true);
+    break;
+  case 'B':
+    SerialCLI_HistoryRecall(cli, false);
+    break;
+  case 'C':
+    SerialCLI_EditorMoveCursor(cli, cursor + 1);
+    break;
+  case 'D':
+    if (cursor > 0) {
+      SerialCLI_EditorMoveCursor(cli, cursor - 1);
+    }
+    break;
+  case 'H':
+    SerialCLI_EditorMoveCursor(cli, 0);
+    break;
+  case 'F':
+    SerialCLI_EditorMoveCursor(cli, cli->charCount);
+    break;
+  default:
+    break;
+  }
+}
+
+// Returns false if the character is not part of the sequence and must be handled on its own
+static bool handleEscape(SerialCLI *cli, char ch) {
+  uint8_t state = cli->escapeState;
+  cli->escapeState = ESCAPE_NONE;
+
+  switch (state) {
+  case ESCAPE_START:
+    if ('[' == ch) {
+      cli->escapeState = ESCAPE_CSI;
+      cli->escapeParameter = 0;
+      return true;
+    }
+    if ('O' == ch) {
+      cli->escapeState = ESCAPE_SS3;
+      return true;
+    }
+    return false;
+
+  case ESCAPE_CSI:
+    // Parameter and intermediate bytes, then a final byte. Only the last parameter is kept.
+    if ((ch >= 0x20) && (ch <= 0x3F)) {
+      cli->escapeState = ESCAPE_CSI;
+      if ((ch >= '0') && (ch <= '9')) {
+        if (cli->escapeParameter <= (MAX_ESCAPE_PARAMETER / 10)) {
+          cli->escapeParameter = (uint16_t)((cli->escapeParameter * 10U) + (unsigned)(ch - '0'));
+        }
+      } else {
+        cli->escapeParameter = 0;
+      }
+      return true;
+    }
+    if ((ch >= 0x40) && (ch <= 0x7E)) {
+      handleEscapeFinal(cli, ch);
+      return true;
+    }
+    return false;
+
+  case ESCAPE_SS3:
+    cli->escapeParameter = 0;
+    handleEscapeFinal(cli, ch);
+    return true;
+
+  default:
     return false;
   }
+}
 
-  bool isStateValid = !cli->isCommandReady;
-  bool isLengthValid = (SERIAL_CLI_OUTPUT_BUFFER_SIZE > length);
-  if (!isStateValid || !isLengthValid) {
+// Keys of the reverse incremental search, any other key ends it
+static bool handleSearchKey(SerialCLI *cli, char ch) {
+  if (ASCII_DC2 == ch) {
+    SerialCLI_HistorySearchOlder(cli);
+  } else if ((ASCII_DEL == ch) || (ASCII_BS == ch)) {
+    SerialCLI_HistorySearchDelete(cli);
+  } else if (((unsigned char)ch >= 0x20) && (ASCII_ESC != ch)) {
+    SerialCLI_HistorySearchAppend(cli, ch);
+  } else {
+    SerialCLI_HistoryEndSearch(cli);
     return false;
   }
+  return true;
+}
 
-  char output[SERIAL_CLI_OUTPUT_BUFFER_SIZE + 1] = {0};
-  size_t outputIdx = 0;
+// Queues COBS encoded frames, which contain no zero bytes, like lines ended by the frame delimiter
+static bool readFrames(SerialCLI *cli, const char *str, size_t length) {
+  bool isAccepted = true;
 
   for (size_t i = 0; i < length; ++i) {
-    if (SERIAL_CLI_INPUT_BUFFER_SIZE == cli->charCount) {
-      resetCLI(cli);
-      return false;
+    if (SERIAL_CLI_RPC_DELIMITER == str[i]) {
+      // Empty frames only resynchronize
+      if ((cli->charCount > 0) || cli->isLineDiscarded) {
+        isAccepted = queueLine(cli) && isAccepted;
+      }
+      continue;
     }
 
-    if (ASCII_CARRIAGE_RETURN == str[i]) {
-      cli->isCommandReady = true;
-      return true;
+    if (cli->isLineDiscarded) {
+      continue;
+    }
+
+    if (cli->charCount == SerialCLI_GetLineCapacity(cli)) {
+      dropLine(cli);
+      cli->isLineDiscarded = true;
+      isAccepted = false;
+      continue;
+    }
+
+    char *line = SerialCLI_GetLine(cli);
+    line[cli->charCount] = str[i];
+    ++cli->charCount;
+    line[cli->charCount] = '\0';
+  }
+
+  return isAccepted;
+}
+
+static inline bool isLineEnd(char ch) { return (ASCII_CARRIAGE_RETURN == ch) || (ASCII_LINE_FEED == ch); }
+
+static inline bool isBatchControl(char ch) { return isLineEnd(ch) || (SERIAL_CLI_CANCEL_CHARACTER == ch); }
+
+// Other control characters are part of the line without line editing
+static size_t findBatchControl(const char *str, size_t length) {
+  size_t i = SerialCLI_ScanControl(str, length);
+  while ((i < length) && !isBatchControl(str[i])) {
+    ++i;
+    i += SerialCLI_ScanControl(&str[i], length - i);
+  }
+  return i;
+}
+
+// Without echo and line editing the characters between line endings are copied as a whole
+static bool readBatchLines(SerialCLI *cli, const char *str, size_t length) {
+  bool isAccepted = true;
+
+  size_t i = 0;
+  while (i < length) {
+    if (SERIAL_CLI_CANCEL_CHARACTER == str[i]) {
+      handleCancel(cli);
+      ++i;
+      continue;
+    }
+
+    if (isLineEnd(str[i])) {
+      isAccepted = handleLineEnd(cli, str[i]) && isAccepted;
+      ++i;
+      continue;
+    }
+    cli->isLastCharCarriageReturn = false;
+
+    size_t runEnd = i + 1 + findBatchControl(&str[i + 1], length - i - 1);
+    size_t runLength = runEnd - i;
+
+    if (cli->isLineDiscarded) {
+      i = runEnd;
+      continue;
+    }
+
+    if (runLength > (SerialCLI_GetLineCapacity(cli) - cli->charCount)) {
+      dropLine(cli);
+      cli->isLineDiscarded = true;
+      isAccepted = false;
+    } else {
+      char *line = SerialCLI_GetLine(cli);
+      memcpy(&line[cli->charCount], &str[i], runLength);
+      cli->charCount += runLength;
+      line[cli->charCount] = '\0';
+    }
+    i = runEnd;
+  }
+
+  return isAccepted;
+}
+
+static bool readText(SerialCLI *cli, const char *str, size_t length) {
+  bool isAccepted = true;
+
+  for (size_t i = 0; i < length; ++i) {
+    if (SERIAL_CLI_CANCEL_CHARACTER == str[i]) {
+      handleCancel(cli);
+      continue;
+    }
+
+    if (isLineEnd(str[i])) {
+      isAccepted = handleLineEnd(cli, str[i]) && isAccepted;
+      continue;
+    }
+    cli->isLastCharCarriageReturn = false;
+
+    if ((ESCAPE_NONE != cli->escapeState) && handleEscape(cli, str[i])) {
+      continue;
     }
 
-    if (ASCII_DEL == str[i]) {
-      handleDelete(cli, output, &outputIdx);
+    if (cli->isLineDiscarded) {
+      continue;
+    }
+
+    if (cli->isHistorySearching && handleSearchKey(cli, str[i])) {
+      continue;
+    }
+
+    if (ASCII_ESC == str[i]) {
+      cli->escapeState = ESCAPE_START;
+      cli->isTabPending = false;
+      continue;
+    }
+
+    if (ASCII_DC2 == str[i]) {
+      SerialCLI_HistorySearchOlder(cli);
+      cli->isTabPending = false;
+      continue;
+    }
+
+    if (handleEditKey(cli, str[i])) {
+      cli->isTabPending = false;
       continue;
     }
 
     if (ASCII_TAB == str[i]) {
-      handleTabCompletion(cli, output, &outputIdx);
+      handleTabCompletion(cli);
+      cli->isTabPending = true;
       continue;
     }
+    cli->isTabPending = false;
 
-    output[outputIdx] = str[i];
-    ++outputIdx;
-    cli->inputBuffer[cli->charCount] = str[i];
-    ++cli->charCount;
+    if (cli->charCount == SerialCLI_GetLineCapacity(cli)) {
+      // The line does not fit, drop it up to its line ending
+      dropLine(cli);
+      cli->isLineDiscarded = true;
+      isAccepted = false;
+      continue;
+    }
+
+    if (cli->cursorPosition != cli->charCount) {
+      SerialCLI_EditorInsert(cli, str[i]);
+      continue;
+    }
+
+    // The plain characters up to the next control character are appended and echoed at once
+    size_t room = SerialCLI_GetLineCapacity(cli) - cli->charCount;
+    size_t limit = (((length - i) < room) ? (length - i) : room) - 1;
+    size_t runLength = 1 + ((limit > 0) ? SerialCLI_ScanControl(&str[i + 1], limit) : 0);
+    char *line = SerialCLI_GetLine(cli);
+    memcpy(&line[cli->charCount], &str[i], runLength);
+    cli->charCount += runLength;
+    cli->cursorPosition += runLength;
+    line[cli->charCount] = '\0';
+    SerialCLI_WriteBack(cli, &str[i], runLength);
+    i += runLength - 1;
+  }
+
+  SerialCLI_FlushOnCommandEnd(cli);
+  return isAccepted;
+}
+
+bool SerialCLI_Read(SerialCLI *cli, const char *str, size_t length) {
+  if (NULL == cli || (NULL == str)) {
+    return false;
+  }
+  SERIAL_CLI_METRICS_ADD(cli, bytesIn, length);
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_READ_BEGIN, length);
+  if (NULL != cli->monitor) {
+    cli->monitor(cli->monitorContext, SERIAL_CLI_MONITOR_INPUT, str, length);
+  }
+
+  bool isAccepted = false;
+  if (SERIAL_CLI_MODE_RPC == cli->mode) {
+    isAccepted = readFrames(cli, str, length);
+  } else if (SERIAL_CLI_MODE_BATCH == cli->mode) {
+    isAccepted = readBatchLines(cli, str, length);
+  } else {
+    isAccepted = readText(cli, str, length);
+  }
+
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_READ_END, cli->queuedLines);
+  return isAccepted;
+}
+
+bool SerialCLI_SetMode(SerialCLI *cli, SerialCLI_Mode mode) {
+  bool isModeValid = (SERIAL_CLI_MODE_TEXT == mode) || (SERIAL_CLI_MODE_RPC == mode) || (SERIAL_CLI_MODE_BATCH == mode);
+  if ((NULL == cli) || !isModeValid) {
+    return false;
+  }
+
+  if (mode == cli->mode) {
+    return true;
+  }
+
+  if (NULL != cli->continuation) {
+    return false;
+  }
+
+  // Output so far belongs to the previous mode
+  if (cli->isRpcRequestActive) {
+    SerialCLI_RpcFinishRequest(cli, SERIAL_CLI_RPC_STATUS_OK);
+  } else {
+    SerialCLI_Flush(cli);
+  }
+
+  dropLine(cli);
+  cli->isLineDiscarded = false;
+  cli->isLastCharCarriageReturn = false;
+  resetEditing(cli);
+  cli->mode = mode;
+
+  writePrompt(cli);
+  SerialCLI_FlushOnCommandEnd(cli);
+  return true;
+}
+
+bool SerialCLI_Defer(SerialCLI *cli, SerialCLI_Continuation continuation, void *state) {
+  if ((NULL == cli) || (NULL == continuation) || (NULL != cli->continuation)) {
+    return false;
+  }
+
+  cli->continuationState = state;
+  // A Ctrl+C the previous command did not see belongs to neither of them
+  SERIAL_CLI_STORE_RELEASE(&cli->isCancelRequested, false);
+  SERIAL_CLI_STORE_RELEASE(&cli->continuation, continuation);
+  return true;
+}
+
+bool SerialCLI_IsCommandRunning(const SerialCLI *cli) { return (NULL != cli) && (NULL != cli->continuation); }
+
+bool SerialCLI_GetEditStats(const SerialCLI *cli, SerialCLI_EditStats *stats) {
+  if ((NULL == cli) || (NULL == stats)) {
+    return false;
+  }
+
+  *stats = cli->editStats;
+  return true;
+}
+
+bool SerialCLI_SetLineResultCallback(SerialCLI *cli, SerialCLI_LineResultCallback callback, void *context) {
+  if (NULL == cli) {
+    return false;
   }
 
-  // Echo the received characters back
-  if (outputIdx > 0) {
-    SerialCLI_WriteBack(cli, output, outputIdx);
+  cli->onLineResult = callback;
+  cli->lineResultContext = context;
+  return true;
+}
+
+bool SerialCLI_SetCommandRunner(SerialCLI *cli, SerialCLI_CommandRunner runner, void *context) {
+  if (NULL == cli) {
+    return false;
   }
+
+  cli->commandRunner = runner;
+  cli->commandRunnerContext = context;
   return true;
 }
 
-bool SerialCLI_WriteString(SerialCLI *cli, const char *format, ...) {
-  if (NULL == format || NULL == cli) {
+bool SerialCLI_SetMonitor(SerialCLI *cli, SerialCLI_Monitor monitor, void *context) {
+  if (NULL == cli) {
     return false;
   }
 
-  char buffer[SERIAL_CLI_OUTPUT_BUFFER_SIZE];
-  va_list arg;
-  va_start(arg, format);
-  int len = vsnprintf(buffer, sizeof(buffer), format, arg);
-  va_end(arg);
+  cli->monitor = monitor;
+  cli->monitorContext = context;
+  return true;
+}
 
-  bool isLengthValid = (len < SERIAL_CLI_OUTPUT_BUFFER_SIZE);
-  if (len <= 0 || !isLengthValid) {
+bool SerialCLI_FailCommand(SerialCLI *cli) {
+  if (NULL == cli) {
     return false;
   }
 
-  SerialCLI_WriteBack(cli, buffer, (size_t)len);
+  cli->isCommandFailed = true;
   return true;
 }
 
@@ -269,27 +1214,198 @@ bool SerialCLI_ResetPrompt(SerialCLI *cli) {
   return true;
 }
 
+// Adds an entry at the top level of a registry, the entry of a group has no command function. The name must not be
+// taken by the attached registry either.
+static bool addCommand(SerialCLI_Registry *registry, const SerialCLI_Registry *shared,
+                       SerialCLI_CommandEntry *command) {
+  const char *name = command->commandName;
+  if ((NULL == name) || (strlen(name) > SERIAL_CLI_COMMAND_MAX_ARG_LENGTH)) {
+    return false;
+  }
+
+  // Check if the name is already registered or defined with SERIAL_CLI_COMMAND
+  size_t nameLength = strlen(name);
+  if ((NULL != SerialCLI_FindCommand(&registry->commandTrie, name, nameLength)) ||
+      ((NULL != shared) && (NULL != SerialCLI_FindCommand(&shared->commandTrie, name, nameLength))) ||
+      (NULL != SerialCLI_FindStaticCommand(name, nameLength))) {
+    return false;
+  }
+
+  SerialCLI_IndexCommand(registry, command);
+#if SERIAL_CLI_ENABLE_METRICS
+  memset(&command->metrics, 0, sizeof(command->metrics));
+#endif
+
+  command->next = NULL;
+  command->parent = NULL;
+  if (NULL == registry->commandsTail) {
+    registry->commands = command;
+  } else {
+    registry->commandsTail->next = command;
+  }
+  registry->commandsTail = command;
+  return true;
+}
+
+// Checks that a group was added to the registry, so the groups of a shared registry are not extended by an instance
+static bool isRegistryGroup(const SerialCLI_Registry *registry, const SerialCLI_CommandGroup *group) {
+  const SerialCLI_CommandEntry *root = &group->entry;
+  while (NULL != root->parent) {
+    root = root->parent;
+  }
+  return SerialCLI_FindRegistryCommand(registry, root->commandName) == root;
+}
+
+// Subcommands are only in the index of their group, names may repeat in other groups
+static bool addSubcommand(SerialCLI_CommandGroup *group, SerialCLI_CommandEntry *command) {
+  const char *name = command->commandName;
+  if ((NULL == name) || (strlen(name) > SERIAL_CLI_COMMAND_MAX_ARG_LENGTH)) {
+    return false;
+  }
+
+  if (NULL != SerialCLI_FindCommand(&group->trie, name, strlen(name))) {
+    return false;
+  }
+
+  command->commandId = group->entry.commandId;
+  command->idChild[0] = NULL;
+  command->idChild[1] = NULL;
+  SerialCLI_InsertCommandPrefix(&group->trie, command);
+#if SERIAL_CLI_ENABLE_METRICS
+  memset(&command->metrics, 0, sizeof(command->metrics));
+#endif
+
+  command->next = NULL;
+  command->parent = &group->entry;
+  if (NULL == group->commandsTail) {
+    group->commands = command;
+  } else {
+    group->commandsTail->next = command;
+  }
+  group->commandsTail = command;
+  return true;
+}
+
+static bool addGroup(SerialCLI_Registry *registry, const SerialCLI_Registry *shared, SerialCLI_CommandGroup *parent,
+                     SerialCLI_CommandGroup *group) {
+  if ((NULL != parent) && !isRegistryGroup(registry, parent)) {
+    return false;
+  }
+
+  group->entry.command = NULL;
+  if (!((NULL != parent) ? addSubcommand(parent, &group->entry) : addCommand(registry, shared, &group->entry))) {
+    return false;
+  }
+
+  group->commands = NULL;
+  group->commandsTail = NULL;
+  group->trie.root = NULL;
+  group->trie.rootLeafMask = 0;
+  return true;
+}
+
+static bool addToGroup(SerialCLI_Registry *registry, const SerialCLI_Registry *shared, SerialCLI_CommandGroup *group,
+                       SerialCLI_CommandEntry *command) {
+  if (NULL == group) {
+    return addCommand(registry, shared, command);
+  }
+  return isRegistryGroup(registry, group) && addSubcommand(group, command);
+}
+
 bool SerialCLI_RegisterCommand(SerialCLI *cli, SerialCLI_CommandEntry *command) {
-  if ((NULL == cli) || (NULL == command) || (NULL == command->commandName) || (NULL == command->command)) {
+  if ((NULL == cli) || (NULL == command) || (NULL == command->command)) {
+    return false;
+  }
+
+  return addCommand(&cli->commands, cli->registry, command);
+}
+
+bool SerialCLI_RegisterGroup(SerialCLI *cli, SerialCLI_CommandGroup *parent, SerialCLI_CommandGroup *group) {
+  if ((NULL == cli) || (NULL == group)) {
+    return false;
+  }
+
+  return addGroup(&cli->commands, cli->registry, parent, group);
+}
+
+bool SerialCLI_RegisterSubcommand(SerialCLI *cli, SerialCLI_CommandGroup *group, SerialCLI_CommandEntry *command) {
+  if ((NULL == cli) || (NULL == command) || (NULL == command->command)) {
+    return false;
+  }
+
+  return addToGroup(&cli->commands, cli->registry, group, command);
+}
+
+bool SerialCLI_InitRegistry(SerialCLI_Registry *registry) {
+  if (NULL == registry) {
+    return false;
+  }
+
+  registry->commands = NULL;
+  registry->commandsTail = NULL;
+  registry->idRoot = NULL;
+  registry->commandTrie.root = NULL;
+  registry->commandTrie.rootLeafMask = 0;
+  registry->isSealed = false;
+  registry->nextCommandId = SERIAL_CLI_SHARED_COMMAND_ID;
+  return true;
+}
+
+bool SerialCLI_RegistryAddCommand(SerialCLI_Registry *registry, SerialCLI_CommandEntry *command) {
+  if ((NULL == registry) || registry->isSealed || (NULL == command) || (NULL == command->command)) {
+    return false;
+  }
+
+  return addCommand(registry, NULL, command);
+}
+
+bool SerialCLI_RegistryAddGroup(SerialCLI_Registry *registry, SerialCLI_CommandGroup *parent,
+                                SerialCLI_CommandGroup *group) {
+  if ((NULL == registry) || registry->isSealed || (NULL == group)) {
     return false;
   }
 
-  if (strlen(command->commandName) > SERIAL_CLI_COMMAND_MAX_ARG_LENGTH) {
+  return addGroup(registry, NULL, parent, group);
+}
+
+bool SerialCLI_RegistryAddSubcommand(SerialCLI_Registry *registry, SerialCLI_CommandGroup *group,
+                                     SerialCLI_CommandEntry *command) {
+  if ((NULL == registry) || registry->isSealed || (NULL == command) || (NULL == command->command)) {
+    return false;
+  }
+
+  return addToGroup(registry, NULL, group, command);
+}
+
+bool SerialCLI_SealRegistry(SerialCLI_Registry *registry) {
+  if (NULL == registry) {
     return false;
   }
 
-  SerialCLI_CommandEntry *current = &cli->commands;
+  registry->isSealed = true;
+  return true;
+}
 
-  while (NULL != current->next) {
-    // Check if command is already registered
-    if (current->next == command) {
+bool SerialCLI_AttachRegistry(SerialCLI *cli, const SerialCLI_Registry *registry) {
+  // A running command may be walking the commands of the current registry
+  if ((NULL == cli) || (NULL != cli->continuation)) {
+    return false;
+  }
+
+  if (NULL != registry) {
+    // Only sealed registries are read from other threads safely
+    if (!registry->isSealed) {
       return false;
     }
-    current = current->next;
+    // The commands of the instance must not hide shared ones
+    for (const SerialCLI_CommandEntry *entry = cli->commands.commands; NULL != entry; entry = entry->next) {
+      if (NULL != SerialCLI_FindRegistryCommand(registry, entry->commandName)) {
+        return false;
+      }
+    }
   }
 
-  command->next = NULL;
-  current->next = command;
+  cli->registry = registry;
   return true;
 }
 
@@ -298,13 +1414,38 @@ bool SerialCLI_Process(SerialCLI *cli) {
     return false;
   }
 
-  if (cli->isCommandReady) {
-    const char *commandName = parseInput(cli);
-    if (NULL != commandName) {
-      callCommand(cli, commandName);
+  SerialCLI_DrainReceiveRing(cli);
+  (void)SerialCLI_TxReady(cli);
+
+  if (NULL != cli->continuation) {
+    continueCommand(cli);
+    return true;
+  }
+
+  // Execute one queued command per call, once its output has room
+  if ((cli->queuedLines > 0) && !SerialCLI_IsTxBlocked(cli)) {
+    size_t lineLength = strlen(cli->inputBuffer);
+    if (SERIAL_CLI_MODE_RPC == cli->mode) {
+      SerialCLI_RpcExecute(cli, cli->inputBuffer, lineLength);
+      dequeueLine(cli, lineLength);
+      return true;
     }
-    resetCLI(cli);
+
+    size_t executedLength = executeChain(cli, cli->inputBuffer, lineLength);
+    if (executedLength < lineLength) {
+      // The commands after the executed one stay queued as the first line
+      consumeInput(cli, executedLength);
+    } else {
+      dequeueLine(cli, lineLength);
+      cli->chainOperator = SERIAL_CLI_CHAIN_NONE;
+    }
+    if ((NULL == cli->continuation) && (SERIAL_CLI_CHAIN_NONE == cli->chainOperator)) {
+      resetCLI(cli);
+    }
+    SerialCLI_FlushOnCommandEnd(cli);
   }
 
   return true;
 }
+
+bool SerialCLI_IsCommandPending(const SerialCLI *cli) { return (NULL != cli) && (cli->queuedLines > 0); }
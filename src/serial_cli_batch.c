@@ -0,0 +1,153 @@
+#include "serial_cli.h"
+#include "serial_cli_internal.h"
+
+#include <string.h>
+
+typedef struct BatchRun {
+  SerialCLI_BatchResult *result;
+  SerialCLI_LineResultCallback userCallback;
+  void *userContext;
+  size_t lineNumber;
+  bool isFailed;
+} BatchRun;
+
+static void recordLine(BatchRun *run, SerialCLI_LineStatus status) {
+  ++run->result->lineCount;
+  if (SERIAL_CLI_LINE_OK != status) {
+    if (0 == run->result->failedCount) {
+      run->result->firstFailedLine = run->lineNumber;
+      run->result->firstFailedStatus = status;
+    }
+    ++run->result->failedCount;
+    run->isFailed = true;
+  }
+}
+
+static void onLineResult(void *context, SerialCLI_LineStatus status) {
+  BatchRun *run = (BatchRun *)context;
+  recordLine(run, status);
+  if (NULL != run->userCallback) {
+    run->userCallback(run->userContext, status);
+  }
+}
+
+// State a call of SerialCLI_Process changes when it moves the batch forward
+typedef struct Progress {
+  size_t lineCount;
+  size_t queuedLines;
+  size_t charCount;
+  bool isRunning;
+  void *continuationState;
+  size_t txLength;
+  size_t txRingLength;
+} Progress;
+
+static Progress getProgress(const SerialCLI *cli, const BatchRun *run) {
+  Progress progress;
+  progress.lineCount = run->result->lineCount;
+  progress.queuedLines = cli->queuedLines;
+  progress.charCount = cli->charCount;
+  progress.isRunning = SerialCLI_IsCommandRunning(cli);
+  progress.continuationState = cli->continuationState;
+  progress.txLength = cli->txLength;
+  progress.txRingLength = cli->txRingLength;
+  return progress;
+}
+
+static bool isSameProgress(const Progress *progress, const Progress *other) {
+  return (progress->lineCount == other->lineCount) && (progress->queuedLines == other->queuedLines) &&
+         (progress->charCount == other->charCount) && (progress->isRunning == other->isRunning) &&
+         (progress->continuationState == other->continuationState) && (progress->txLength == other->txLength) &&
+         (progress->txRingLength == other->txRingLength);
+}
+
+// A deferred command has left the queue already, it is waited for as well. Returns false once the lines stop
+// advancing, such as output a non-blocking transport never takes or a command waiting for an event that never comes.
+static bool processAll(SerialCLI *cli, const BatchRun *run) {
+  size_t idleSteps = 0;
+  Progress progress = getProgress(cli, run);
+  while (SerialCLI_IsCommandPending(cli) || SerialCLI_IsCommandRunning(cli)) {
+    if (SERIAL_CLI_BATCH_MAX_IDLE_STEPS == idleSteps) {
+      return false;
+    }
+    (void)SerialCLI_Process(cli);
+    Progress next = getProgress(cli, run);
+    idleSteps = isSameProgress(&progress, &next) ? (idleSteps + 1) : 0;
+    progress = next;
+  }
+  return true;
+}
+
+// A running command would keep the instance in batch mode, it is cancelled like with Ctrl+C
+static void cancelStalledCommand(SerialCLI *cli) {
+  if (SerialCLI_IsCommandRunning(cli)) {
+    SERIAL_CLI_STORE_RELEASE(&cli->isCancelRequested, true);
+    (void)SerialCLI_Process(cli);
+  }
+}
+
+static size_t findLineEnd(const char *script, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    if (('\r' == script[i]) || ('\n' == script[i])) {
+      return i;
+    }
+  }
+  return length;
+}
+
+bool SerialCLI_ExecuteBatch(SerialCLI *cli, const char *script, size_t length, bool isStopOnError,
+                            SerialCLI_BatchResult *result) {
+  if ((NULL == cli) || ((NULL == script) && (length > 0)) || (SERIAL_CLI_MODE_RPC == cli->mode)) {
+    return false;
+  }
+
+  SerialCLI_BatchResult summary;
+  memset(&summary, 0, sizeof(summary));
+  BatchRun run = {&summary, cli->onLineResult, cli->lineResultContext, 0, false};
+  summary.isStalled = !processAll(cli, &run);
+  if (summary.isStalled) {
+    cancelStalledCommand(cli);
+  }
+
+  SerialCLI_Mode previousMode = cli->mode;
+  (void)SerialCLI_SetMode(cli, SERIAL_CLI_MODE_BATCH);
+  cli->onLineResult = onLineResult;
+  cli->lineResultContext = &run;
+
+  size_t position = 0;
+  while ((position < length) && !summary.isStalled && !(isStopOnError && run.isFailed)) {
+    size_t lineLength = findLineEnd(&script[position], length - position);
+    ++run.lineNumber;
+
+    // Each line is executed before the next one is read, the line queue never fills up
+    bool isAccepted = SerialCLI_Read(cli, &script[position], lineLength);
+    isAccepted = SerialCLI_Read(cli, "\n", 1) && isAccepted;
+    if (!isAccepted) {
+      recordLine(&run, SERIAL_CLI_LINE_TOO_LONG);
+      if (NULL != run.userCallback) {
+        run.userCallback(run.userContext, SERIAL_CLI_LINE_TOO_LONG);
+      }
+    }
+    summary.isStalled = !processAll(cli, &run);
+
+    position += lineLength;
+    if ((position < length) && ('\r' == script[position])) {
+      ++position;
+    }
+    if ((position < length) && ('\n' == script[position])) {
+      ++position;
+    }
+  }
+
+  if (summary.isStalled) {
+    cancelStalledCommand(cli);
+  }
+  cli->onLineResult = run.userCallback;
+  cli->lineResultContext = run.userContext;
+  (void)SerialCLI_SetMode(cli, previousMode);
+
+  if (NULL != result) {
+    *result = summary;
+  }
+  return !run.isFailed && !summary.isStalled;
+}
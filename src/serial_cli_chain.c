@@ -0,0 +1,307 @@
+#include "serial_cli.h"
+#include "serial_cli_internal.h"
+#include "serial_cli_parser.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+// Kinds of words found by the operator scan
+enum {
+  WORD_PLAIN = 0, // An argument
+  WORD_SEQUENCE,  // `;`
+  WORD_AND,       // `&&`
+  WORD_PIPE,      // `|`, starts a filter
+};
+
+// Bytes that may start an operator, lines without them hold a single command
+static const char OPERATOR_CHARACTERS[] = ";&|";
+
+static uint8_t getWordType(const char *word, size_t length) {
+  if ((1 == length) && (';' == word[0])) {
+    return WORD_SEQUENCE;
+  }
+  if ((1 == length) && ('|' == word[0])) {
+    return WORD_PIPE;
+  }
+  if ((2 == length) && ('&' == word[0]) && ('&' == word[1])) {
+    return WORD_AND;
+  }
+  return WORD_PLAIN;
+}
+
+static inline bool isWordDelimiter(char ch) { return ('\"' == ch) || isspace((unsigned char)ch); }
+
+// Returns the offset of the next operator word outside quotes, the length if there is none. Words are split like
+// the arguments, so an unterminated quote runs to the end of the line.
+static size_t findOperator(const char *line, size_t length, size_t position, uint8_t *type, size_t *wordLength) {
+  size_t i = position;
+  while (i < length) {
+    if ('\"' == line[i]) {
+      const char *quote = memchr(&line[i + 1], '\"', length - i - 1);
+      if (NULL == quote) {
+        break;
+      }
+      i = (size_t)(quote - line) + 1;
+      continue;
+    }
+    if (isspace((unsigned char)line[i])) {
+      ++i;
+      continue;
+    }
+
+    size_t start = i;
+    while ((i < length) && !isWordDelimiter(line[i])) {
+      ++i;
+    }
+    *type = getWordType(&line[start], i - start);
+    if (WORD_PLAIN != *type) {
+      *wordLength = i - start;
+      return start;
+    }
+  }
+
+  *type = WORD_PLAIN;
+  *wordLength = 0;
+  return length;
+}
+
+void SerialCLI_FindSegment(const char *line, size_t length, SerialCLI_Segment *segment) {
+  segment->commandLength = length;
+  segment->filterStart = length;
+  segment->length = length;
+  segment->nextStart = length;
+  segment->nextOperator = SERIAL_CLI_CHAIN_NONE;
+  if (NULL == strpbrk(line, OPERATOR_CHARACTERS)) {
+    return;
+  }
+
+  bool isPiped = false;
+  size_t position = 0;
+  for (;;) {
+    uint8_t type = WORD_PLAIN;
+    size_t wordLength = 0;
+    size_t start = findOperator(line, length, position, &type, &wordLength);
+    if (WORD_PIPE != type) {
+      segment->length = start;
+      segment->nextStart = start + wordLength;
+      if (WORD_PLAIN != type) {
+        segment->nextOperator = (WORD_AND == type) ? SERIAL_CLI_CHAIN_AND : SERIAL_CLI_CHAIN_SEQUENCE;
+      }
+      if (!isPiped) {
+        segment->commandLength = start;
+        segment->filterStart = start;
+      }
+      return;
+    }
+
+    // The filters run up to the operator ending the command
+    if (!isPiped) {
+      isPiped = true;
+      segment->commandLength = start;
+      segment->filterStart = start + wordLength;
+    }
+    position = start + wordLength;
+  }
+}
+
+#if SERIAL_CLI_ENABLE_FILTERS
+
+// Filters applied to the output lines
+enum {
+  FILTER_GREP = 0, // Passes the lines containing the pattern
+  FILTER_HEAD,     // Passes the first lines
+  FILTER_COUNT,    // Counts the lines, the count is written once the command completed
+};
+
+static bool parseLineCount(const char *text, size_t *count) {
+  size_t value = 0;
+  if ('\0' == *text) {
+    return false;
+  }
+  for (; '\0' != *text; ++text) {
+    if ((*text < '0') || (*text > '9') || (value > ((SIZE_MAX - 9) / 10))) {
+      return false;
+    }
+    value = (value * 10) + (size_t)(*text - '0');
+  }
+  *count = value;
+  return true;
+}
+
+// The pattern is copied, the line holding it is reused by the next command
+static bool addPattern(SerialCLI *cli, SerialCLI_Filter *filter, const char *pattern) {
+  size_t length = strlen(pattern);
+  if (length > (cli->filterPatternSize - cli->filterPatternLength)) {
+    return false;
+  }
+
+  memcpy(&cli->filterPatterns[cli->filterPatternLength], pattern, length);
+  filter->patternStart = (uint8_t)cli->filterPatternLength;
+  filter->patternLength = (uint8_t)length;
+  cli->filterPatternLength += length;
+  return true;
+}
+
+static bool addFilter(SerialCLI *cli, char *text, size_t length) {
+  const char *name = SerialCLI_ParseInput(cli, text, length);
+  if ((NULL == name) || (SERIAL_CLI_FILTER_MAX_COUNT == cli->filterCount)) {
+    return false;
+  }
+
+  SerialCLI_Filter *filter = &cli->filters[cli->filterCount];
+  const char **argv = SerialCLI_GetArgv(cli);
+  size_t argc = cli->tokenCount;
+  filter->isInverted = false;
+  filter->count = 0;
+  if ((0 == strcmp(name, "count")) && (1 == argc)) {
+    filter->type = FILTER_COUNT;
+  } else if ((0 == strcmp(name, "head")) && (2 == argc)) {
+    filter->type = FILTER_HEAD;
+    if (!parseLineCount(argv[1], &filter->count)) {
+      return false;
+    }
+  } else if ((0 == strcmp(name, "grep")) && ((2 == argc) || ((3 == argc) && (0 == strcmp(argv[1], "-v"))))) {
+    filter->type = FILTER_GREP;
+    filter->isInverted = (3 == argc);
+    if (!addPattern(cli, filter, argv[argc - 1])) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+
+  ++cli->filterCount;
+  return true;
+}
+
+bool SerialCLI_StartFilters(SerialCLI *cli, char *filters, size_t length) {
+  cli->filterCount = 0;
+  cli->filterPatternLength = 0;
+  cli->filterLineLength = 0;
+  // Output is collected in the line buffer, an instance without one has no filters
+  if (0 == cli->filterLineSize) {
+    return false;
+  }
+
+  size_t position = 0;
+  for (;;) {
+    uint8_t type = WORD_PLAIN;
+    size_t wordLength = 0;
+    size_t end = findOperator(filters, length, position, &type, &wordLength);
+    if (!addFilter(cli, &filters[position], end - position)) {
+      cli->filterCount = 0;
+      return false;
+    }
+    if (end == length) {
+      return true;
+    }
+    position = end + wordLength;
+  }
+}
+
+static bool containsPattern(const char *line, size_t length, const char *pattern, size_t patternLength) {
+  if (0 == patternLength) {
+    return true;
+  }
+  if (patternLength > length) {
+    return false;
+  }
+
+  // Candidates start with the first byte of the pattern
+  const char *last = &line[length - patternLength];
+  for (const char *candidate = line; candidate <= last; ++candidate) {
+    candidate = memchr(candidate, pattern[0], (size_t)(last - candidate) + 1);
+    if (NULL == candidate) {
+      return false;
+    }
+    if (0 == memcmp(candidate, pattern, patternLength)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Runs a line through the filters from the given one on, the lines passing all of them are written
+static void passLine(SerialCLI *cli, size_t first, const char *line, size_t length) {
+  for (size_t i = first; i < cli->filterCount; ++i) {
+    SerialCLI_Filter *filter = &cli->filters[i];
+    if (FILTER_COUNT == filter->type) {
+      ++filter->count;
+      return;
+    }
+    if (FILTER_HEAD == filter->type) {
+      if (0 == filter->count) {
+        return;
+      }
+      --filter->count;
+    } else if (containsPattern(line, length, &cli->filterPatterns[filter->patternStart], filter->patternLength) ==
+               filter->isInverted) {
+      return;
+    }
+  }
+
+  bool isFiltered = cli->isOutputFiltered;
+  cli->isOutputFiltered = false;
+  SerialCLI_WriteBack(cli, line, length);
+  cli->isOutputFiltered = isFiltered;
+}
+
+// Takes bytes of a line that started in an earlier write, returns the number of bytes taken
+static size_t collectLine(SerialCLI *cli, const char *output, size_t length, bool isLineEnd) {
+  size_t room = cli->filterLineSize - cli->filterLineLength;
+  size_t taken = (length < room) ? length : room;
+  memcpy(&cli->filterLine[cli->filterLineLength], output, taken);
+  cli->filterLineLength += taken;
+
+  if ((isLineEnd && (taken == length)) || (cli->filterLineSize == cli->filterLineLength)) {
+    passLine(cli, 0, cli->filterLine, cli->filterLineLength);
+    cli->filterLineLength = 0;
+  }
+  return taken;
+}
+
+void SerialCLI_FilterOutput(SerialCLI *cli, const char *output, size_t length) {
+  // Once head passed its lines nothing else gets through
+  const SerialCLI_Filter *first = &cli->filters[0];
+  if ((FILTER_HEAD == first->type) && (0 == first->count)) {
+    return;
+  }
+
+  while (length > 0) {
+    const char *lineFeed = memchr(output, '\n', length);
+    size_t pieceLength = (NULL != lineFeed) ? ((size_t)(lineFeed - output) + 1) : length;
+    // Complete lines are filtered where they are
+    if ((0 == cli->filterLineLength) && (NULL != lineFeed) && (pieceLength <= cli->filterLineSize)) {
+      passLine(cli, 0, output, pieceLength);
+    } else {
+      pieceLength = collectLine(cli, output, pieceLength, NULL != lineFeed);
+    }
+    output += pieceLength;
+    length -= pieceLength;
+  }
+}
+
+void SerialCLI_FinishFilters(SerialCLI *cli) {
+  if (0 == cli->filterCount) {
+    return;
+  }
+
+  cli->isOutputFiltered = false;
+  if (cli->filterLineLength > 0) {
+    passLine(cli, 0, cli->filterLine, cli->filterLineLength);
+    cli->filterLineLength = 0;
+  }
+
+  // A count is a line for the filters after it
+  for (size_t i = 0; i < cli->filterCount; ++i) {
+    if (FILTER_COUNT == cli->filters[i].type) {
+      char text[24];
+      int length = snprintf(text, sizeof(text), "%zu\r\n", cli->filters[i].count);
+      passLine(cli, i + 1, text, (size_t)length);
+    }
+  }
+  cli->filterCount = 0;
+}
+
+#endif
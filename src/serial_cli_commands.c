@@ -1,42 +1,446 @@
 #include "serial_cli_commands.h"
+#include "serial_cli_internal.h"
 
 #include <stddef.h>
 #include <string.h>
 
-SerialCLI_CommandEntry *SerialCLI_GetCommandEntry(SerialCLI *cli, const char *commandName) {
-  SerialCLI_CommandEntry *current = &cli->commands;
-  while (NULL != current) {
-    if (0 == strncmp(current->commandName, commandName, SERIAL_CLI_COMMAND_MAX_ARG_LENGTH)) {
-      return current;
+static const uint32_t ID_KEY_FACTOR = 2654435769U; // Odd, 2^32 divided by the golden ratio
+
+enum {
+  STATIC_TABLE_UNCHECKED = 0, // SerialCLI_CheckStaticCommands was not called yet
+  STATIC_TABLE_VALID = 1,
+  STATIC_TABLE_INVALID = 2,
+};
+
+#if SERIAL_CLI_ENABLE_STATIC_COMMANDS
+// Bounds of the table defined by serial_cli_cmds.ld, weak so that a link without the table leaves them NULL
+extern const SerialCLI_StaticCommand __start_serial_cli_cmds[] __attribute__((weak));
+extern const SerialCLI_StaticCommand __stop_serial_cli_cmds[] __attribute__((weak));
+#endif
+
+// Consecutive IDs would chain the tree into a list, multiplying by an odd factor spreads them and keeps them unique
+static inline uint32_t getIdKey(uint32_t commandId) { return commandId * ID_KEY_FACTOR; }
+
+void SerialCLI_IndexCommand(SerialCLI_Registry *registry, SerialCLI_CommandEntry *entry) {
+  entry->commandId = registry->nextCommandId++;
+  entry->idChild[0] = NULL;
+  entry->idChild[1] = NULL;
+
+  // The keys spread evenly, so the tree stays balanced on average without rotations
+  uint32_t key = getIdKey(entry->commandId);
+  SerialCLI_CommandEntry **link = &registry->idRoot;
+  while (NULL != *link) {
+    link = &(*link)->idChild[key > getIdKey((*link)->commandId)];
+  }
+  *link = entry;
+
+  SerialCLI_InsertCommandPrefix(&registry->commandTrie, entry);
+}
+
+SerialCLI_CommandEntry *SerialCLI_FindRegistryCommand(const SerialCLI_Registry *registry, const char *commandName) {
+  return SerialCLI_FindCommand(&registry->commandTrie, commandName, strlen(commandName));
+}
+
+SerialCLI_CommandEntry *SerialCLI_FindRegistryCommandById(const SerialCLI_Registry *registry, uint32_t commandId) {
+  uint32_t key = getIdKey(commandId);
+  SerialCLI_CommandEntry *current = registry->idRoot;
+  while ((NULL != current) && (commandId != current->commandId)) {
+    current = current->idChild[key > getIdKey(current->commandId)];
+  }
+  return current;
+}
+
+// Reference to a trie child slot: the root of the trie or a child of an internal node
+typedef struct TrieSlot {
+  SerialCLI_CommandEntry **entry;
+  uint8_t *leafMask;
+  uint8_t leafBit;
+} TrieSlot;
+
+// Only the insertion writes through slots, and it holds a mutable trie
+static inline TrieSlot getRootSlot(const SerialCLI_CommandTrie *trie) {
+  TrieSlot slot = {(SerialCLI_CommandEntry **)&trie->root, (uint8_t *)&trie->rootLeafMask, 1U};
+  return slot;
+}
+
+static inline TrieSlot getChildSlot(SerialCLI_CommandEntry *node, size_t direction) {
+  TrieSlot slot = {&node->trieNode.child[direction], &node->trieNode.leafMask, (uint8_t)(1U << direction)};
+  return slot;
+}
+
+static inline bool isLeafSlot(TrieSlot slot) { return 0 != (*slot.leafMask & slot.leafBit); }
+
+static inline void setSlot(TrieSlot slot, SerialCLI_CommandEntry *entry, bool isLeaf) {
+  *slot.entry = entry;
+  if (isLeaf) {
+    *slot.leafMask = (uint8_t)(*slot.leafMask | slot.leafBit);
+  } else {
+    *slot.leafMask = (uint8_t)(*slot.leafMask & ~slot.leafBit);
+  }
+}
+
+static inline size_t getDirection(const SerialCLI_TrieNode *node, const char *key, size_t keyLength) {
+  unsigned keyByte = (node->byte < keyLength) ? (unsigned char)key[node->byte] : 0U;
+  return (size_t)((1U + (node->otherBits | keyByte)) >> 8);
+}
+
+void SerialCLI_InsertCommandPrefix(SerialCLI_CommandTrie *trie, SerialCLI_CommandEntry *entry) {
+  const char *key = entry->commandName;
+  size_t keyLength = strlen(key);
+
+  TrieSlot root = getRootSlot(trie);
+  if (NULL == *root.entry) {
+    setSlot(root, entry, true);
+    return;
+  }
+
+  // Find the closest existing command
+  TrieSlot slot = root;
+  while (!isLeafSlot(slot)) {
+    SerialCLI_CommandEntry *node = *slot.entry;
+    slot = getChildSlot(node, getDirection(&node->trieNode, key, keyLength));
+  }
+  const char *closest = (*slot.entry)->commandName;
+
+  // Find the critical bit, the first bit where both names differ
+  size_t newByte = 0;
+  while (key[newByte] == closest[newByte]) {
+    if ('\0' == key[newByte]) {
+      return;
     }
-    current = current->next;
+    ++newByte;
   }
-  return NULL;
+  unsigned newOtherBits = (unsigned char)key[newByte] ^ (unsigned char)closest[newByte];
+  while (0 != (newOtherBits & (newOtherBits - 1U))) {
+    newOtherBits &= newOtherBits - 1U;
+  }
+  newOtherBits ^= 0xFFU;
+  size_t closestDirection = (size_t)((1U + (newOtherBits | (unsigned char)closest[newByte])) >> 8);
+
+  // Find the insertion point, nodes are ordered by critical bit position
+  slot = root;
+  while (!isLeafSlot(slot)) {
+    SerialCLI_TrieNode *node = &(*slot.entry)->trieNode;
+    if ((node->byte > newByte) || ((node->byte == newByte) && (node->otherBits > newOtherBits))) {
+      break;
+    }
+    slot = getChildSlot(*slot.entry, getDirection(node, key, keyLength));
+  }
+
+  SerialCLI_TrieNode *newNode = &entry->trieNode;
+  newNode->byte = (uint16_t)newByte;
+  newNode->otherBits = (uint8_t)newOtherBits;
+  newNode->leafMask = 0;
+  setSlot(getChildSlot(entry, closestDirection), *slot.entry, isLeafSlot(slot));
+  setSlot(getChildSlot(entry, 1U - closestDirection), entry, true);
+  setSlot(slot, entry, false);
 }
 
-const char *SerialCLI_ResolvePartialCommand(SerialCLI *cli, const char *partialName) {
-  SerialCLI_CommandEntry *current = &cli->commands;
-  size_t matchCount = 0;
+bool SerialCLI_MatchCommandPrefix(const SerialCLI_CommandTrie *trie, const char *prefix, size_t prefixLength,
+                                  SerialCLI_PrefixMatch *match) {
+  match->subtree = NULL;
+  match->sharedSubtree = NULL;
+  match->staticCommands = NULL;
+  match->staticCount = 0;
+
+  TrieSlot slot = getRootSlot(trie);
+  if (NULL == *slot.entry) {
+    return false;
+  }
+
+  // Descend while the critical bits are inside the prefix
+  while (!isLeafSlot(slot)) {
+    SerialCLI_CommandEntry *node = *slot.entry;
+    if (node->trieNode.byte >= prefixLength) {
+      break;
+    }
+    slot = getChildSlot(node, getDirection(&node->trieNode, prefix, prefixLength));
+  }
+
+  // All commands below the slot share their first bytes, check the leftmost one
+  TrieSlot leftmost = slot;
+  while (!isLeafSlot(leftmost)) {
+    leftmost = getChildSlot(*leftmost.entry, 0);
+  }
+  const char *name = (*leftmost.entry)->commandName;
+  if (0 != strncmp(name, prefix, prefixLength)) {
+    return false;
+  }
+
+  match->subtree = *slot.entry;
+  match->isLeaf = isLeafSlot(slot);
+  match->isUnique = match->isLeaf;
+  match->name = name;
+  match->commonLength = match->isUnique ? strlen(name) : (size_t)match->subtree->trieNode.byte;
+  return true;
+}
+
+SerialCLI_CommandEntry *SerialCLI_FindCommand(const SerialCLI_CommandTrie *trie, const char *name, size_t nameLength) {
+  TrieSlot slot = getRootSlot(trie);
+  if (NULL == *slot.entry) {
+    return NULL;
+  }
+
+  // The critical bits lead to the only command that can match
+  while (!isLeafSlot(slot)) {
+    SerialCLI_CommandEntry *node = *slot.entry;
+    slot = getChildSlot(node, getDirection(&node->trieNode, name, nameLength));
+  }
+  SerialCLI_CommandEntry *entry = *slot.entry;
+  if ((0 != strncmp(entry->commandName, name, nameLength)) || ('\0' != entry->commandName[nameLength])) {
+    return NULL;
+  }
+  return entry;
+}
+
+SerialCLI_CommandEntry *SerialCLI_FindTopLevelCommand(SerialCLI *cli, const char *name, size_t nameLength) {
+  SerialCLI_CommandEntry *entry = SerialCLI_FindCommand(&cli->commands.commandTrie, name, nameLength);
+  if ((NULL == entry) && (NULL != cli->registry)) {
+    entry = SerialCLI_FindCommand(&cli->registry->commandTrie, name, nameLength);
+  }
+  return entry;
+}
+
+SerialCLI_CommandEntry *SerialCLI_GetNextCommand(SerialCLI_CommandEntry *entry) {
+  if (SerialCLI_IsCommandGroup(entry) && (NULL != ((SerialCLI_CommandGroup *)entry)->commands)) {
+    return ((SerialCLI_CommandGroup *)entry)->commands;
+  }
+
+  // Past the last subcommand of a group continue after the group
+  while ((NULL != entry) && (NULL == entry->next)) {
+    entry = entry->parent;
+  }
+  return (NULL != entry) ? entry->next : NULL;
+}
+
+const void *SerialCLI_GetNextListed(const SerialCLI *cli, const SerialCLI_CommandEntry *entry) {
+  if ((NULL != entry->next) || (NULL != entry->parent)) {
+    return entry->next;
+  }
+
+  // The last top-level command of the instance or of its registry
+  const SerialCLI_Registry *registry = cli->registry;
+  if ((entry == cli->commands.commandsTail) && (NULL != registry) && (NULL != registry->commands)) {
+    return registry->commands;
+  }
+  size_t staticCount = 0;
+  return SerialCLI_GetStaticCommands(&staticCount);
+}
 
-  const char *command = NULL;
+static void visitSubtree(SerialCLI_CommandEntry *entry, bool isLeaf, SerialCLI_CommandVisitor visitor,
+                         void *context) {
+  if (isLeaf) {
+    visitor(context, entry->commandName);
+    return;
+  }
+
+  for (size_t direction = 0; direction < 2; ++direction) {
+    TrieSlot child = getChildSlot(entry, direction);
+    visitSubtree(*child.entry, isLeafSlot(child), visitor, context);
+  }
+}
+
+void SerialCLI_ForEachPrefixMatch(const SerialCLI_PrefixMatch *match, SerialCLI_CommandVisitor visitor,
+                                  void *context) {
+  if (NULL != match->subtree) {
+    visitSubtree(match->subtree, match->isLeaf, visitor, context);
+  }
+  if (NULL != match->sharedSubtree) {
+    visitSubtree(match->sharedSubtree, match->isSharedLeaf, visitor, context);
+  }
+  for (size_t i = 0; i < match->staticCount; ++i) {
+    visitor(context, match->staticCommands[i].commandName);
+  }
+}
+
+SerialCLI_CommandEntry *SerialCLI_GetCommandEntry(SerialCLI *cli, const char *commandName) {
+  return SerialCLI_FindTopLevelCommand(cli, commandName, strlen(commandName));
+}
+
+SerialCLI_CommandEntry *SerialCLI_GetCommandEntryById(SerialCLI *cli, uint32_t commandId) {
+  if (commandId < SERIAL_CLI_SHARED_COMMAND_ID) {
+    return SerialCLI_FindRegistryCommandById(&cli->commands, commandId);
+  }
+  return (NULL != cli->registry) ? SerialCLI_FindRegistryCommandById(cli->registry, commandId) : NULL;
+}
+
+const char *SerialCLI_ResolvePartialCommand(SerialCLI *cli, const char *partialName) {
   size_t partialLen = strlen(partialName);
-  while (NULL != current) {
-    if (NULL != current->commandName) {
-      if (partialLen >= strlen(current->commandName)) {
-        current = current->next;
-        continue;
-      }
 
-      if (0 == strncmp(partialName, current->commandName, partialLen)) {
-        command = current->commandName;
-        ++matchCount;
-      }
+  SerialCLI_PrefixMatch match;
+  bool isMatch = SerialCLI_MatchCommandPrefix(&cli->commands.commandTrie, partialName, partialLen, &match);
+  if (NULL != cli->registry) {
+    isMatch = SerialCLI_MatchSharedPrefix(&cli->registry->commandTrie, partialName, partialLen, &match);
+  }
+  if (!isMatch) {
+    return NULL;
+  }
+
+  if (match.isUnique && (match.commonLength > partialLen)) {
+    return match.name;
+  }
+  return NULL;
+}
+
+static size_t getCommonLength(const char *name, const char *other, size_t maxLength) {
+  size_t length = 0;
+  while ((length < maxLength) && ('\0' != name[length]) && (name[length] == other[length])) {
+    ++length;
+  }
+  return length;
+}
+
+static inline bool hasCandidates(const SerialCLI_PrefixMatch *match) {
+  return (NULL != match->subtree) || (NULL != match->sharedSubtree) || (match->staticCount > 0);
+}
+
+// Merges the candidates of one more part into the match, before the part is stored in it
+static void addCandidates(SerialCLI_PrefixMatch *match, const char *name, size_t commonLength, bool isUnique) {
+  if (!hasCandidates(match)) {
+    match->name = name;
+    match->commonLength = commonLength;
+    match->isUnique = isUnique;
+    return;
+  }
+
+  size_t maxLength = (commonLength < match->commonLength) ? commonLength : match->commonLength;
+  match->commonLength = getCommonLength(name, match->name, maxLength);
+  match->isUnique = false;
+}
+
+bool SerialCLI_MatchSharedPrefix(const SerialCLI_CommandTrie *trie, const char *prefix, size_t prefixLength,
+                                 SerialCLI_PrefixMatch *match) {
+  SerialCLI_PrefixMatch shared;
+  if (!SerialCLI_MatchCommandPrefix(trie, prefix, prefixLength, &shared)) {
+    return hasCandidates(match);
+  }
+
+  addCandidates(match, shared.name, shared.commonLength, shared.isUnique);
+  match->sharedSubtree = shared.subtree;
+  match->isSharedLeaf = shared.isLeaf;
+  return true;
+}
+
+const SerialCLI_StaticCommand *SerialCLI_GetStaticCommands(size_t *count) {
+#if SERIAL_CLI_ENABLE_STATIC_COMMANDS
+  const SerialCLI_StaticCommand *start = __start_serial_cli_cmds;
+  const SerialCLI_StaticCommand *stop = __stop_serial_cli_cmds;
+  if ((NULL != start) && (NULL != stop) && (stop > start)) {
+    *count = (size_t)(stop - start);
+    return start;
+  }
+#endif
+  *count = 0;
+  return NULL;
+}
+
+static bool checkStaticCommands(void) {
+  size_t count = 0;
+  const SerialCLI_StaticCommand *commands = SerialCLI_GetStaticCommands(&count);
+  for (size_t i = 0; i < count; ++i) {
+    const char *name = commands[i].commandName;
+    if ((NULL == name) || (NULL == commands[i].command) || (strlen(name) > SERIAL_CLI_COMMAND_MAX_ARG_LENGTH)) {
+      return false;
+    }
+    // The binary search relies on the order the linker sorted the sections in
+    if ((i > 0) && (strcmp(commands[i - 1].commandName, name) >= 0)) {
+      return false;
     }
-    current = current->next;
   }
+  return NULL == SerialCLI_SearchStaticCommands(commands, count, "help", strlen("help"));
+}
+
+bool SerialCLI_CheckStaticCommands(void) {
+  // The table is fixed at link time, instances initialized concurrently may both check it with the same result
+  static uint8_t checkResult = STATIC_TABLE_UNCHECKED;
+  uint8_t result = SERIAL_CLI_LOAD_ACQUIRE(&checkResult);
+  if (STATIC_TABLE_UNCHECKED == result) {
+    result = checkStaticCommands() ? STATIC_TABLE_VALID : STATIC_TABLE_INVALID;
+    SERIAL_CLI_STORE_RELEASE(&checkResult, result);
+  }
+  return STATIC_TABLE_VALID == result;
+}
 
-  if (1 == matchCount) {
-    return command;
+const SerialCLI_StaticCommand *SerialCLI_SearchStaticCommands(const SerialCLI_StaticCommand *commands, size_t count,
+                                                              const char *name, size_t nameLength) {
+  size_t low = 0;
+  size_t high = count;
+  while (low < high) {
+    size_t middle = low + ((high - low) / 2);
+    const char *middleName = commands[middle].commandName;
+    int result = strncmp(middleName, name, nameLength);
+    if ((0 == result) && ('\0' == middleName[nameLength])) {
+      return &commands[middle];
+    }
+    // A longer name sharing the first nameLength characters sorts after the name
+    if (result < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
   }
   return NULL;
-}
\ No newline at end of file
+}
+
+const SerialCLI_StaticCommand *SerialCLI_FindStaticCommand(const char *name, size_t nameLength) {
+  size_t count = 0;
+  const SerialCLI_StaticCommand *commands = SerialCLI_GetStaticCommands(&count);
+  return SerialCLI_SearchStaticCommands(commands, count, name, nameLength);
+}
+
+const SerialCLI_StaticCommand *SerialCLI_GetStaticCommandById(uint32_t commandId) {
+  size_t count = 0;
+  const SerialCLI_StaticCommand *commands = SerialCLI_GetStaticCommands(&count);
+  if ((commandId < SERIAL_CLI_STATIC_COMMAND_ID) || ((commandId - SERIAL_CLI_STATIC_COMMAND_ID) >= count)) {
+    return NULL;
+  }
+  return &commands[commandId - SERIAL_CLI_STATIC_COMMAND_ID];
+}
+
+uint32_t SerialCLI_GetStaticCommandId(const SerialCLI_StaticCommand *command) {
+  size_t count = 0;
+  const SerialCLI_StaticCommand *commands = SerialCLI_GetStaticCommands(&count);
+  return SERIAL_CLI_STATIC_COMMAND_ID + (uint32_t)(command - commands);
+}
+
+bool SerialCLI_IsStaticCommand(const void *command) {
+  size_t count = 0;
+  const SerialCLI_StaticCommand *commands = SerialCLI_GetStaticCommands(&count);
+  uintptr_t address = (uintptr_t)command;
+  return (NULL != commands) && (address >= (uintptr_t)commands) && (address < (uintptr_t)&commands[count]);
+}
+
+// Index of the first command whose name starts with more than the prefix, or with at least the prefix
+static size_t findPrefixBound(const SerialCLI_StaticCommand *commands, size_t count, const char *prefix,
+                              size_t prefixLength, bool isAfterPrefix) {
+  size_t low = 0;
+  size_t high = count;
+  while (low < high) {
+    size_t middle = low + ((high - low) / 2);
+    int result = strncmp(commands[middle].commandName, prefix, prefixLength);
+    if ((result < 0) || (isAfterPrefix && (0 == result))) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+bool SerialCLI_MatchStaticPrefix(const char *prefix, size_t prefixLength, SerialCLI_PrefixMatch *match) {
+  size_t count = 0;
+  const SerialCLI_StaticCommand *commands = SerialCLI_GetStaticCommands(&count);
+  size_t first = findPrefixBound(commands, count, prefix, prefixLength, false);
+  size_t end = findPrefixBound(commands, count, prefix, prefixLength, true);
+  if (first == end) {
+    return hasCandidates(match);
+  }
+
+  // The table is sorted, the first and the last match share what all matches share
+  const char *firstName = commands[first].commandName;
+  const char *lastName = commands[end - 1].commandName;
+  addCandidates(match, firstName, getCommonLength(firstName, lastName, SIZE_MAX), 1 == (end - first));
+  match->staticCommands = &commands[first];
+  match->staticCount = end - first;
+  return true;
+}
@@ -0,0 +1,235 @@
+#include "serial_cli_internal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Every edit is written the cheapest way among rewriting the line from the
+ * first changed character, shifting the characters behind the change with
+ * the VT102 insert and delete character sequences, and redrawing the whole
+ * line. Each way is first run without writing to measure its length.
+ */
+
+enum {
+  CSI_MAX_LENGTH = 16, // ESC [ count final
+};
+
+typedef struct Output {
+  SerialCLI *cli;
+  bool isWriting;
+  size_t length;
+} Output;
+
+// A change of the line, which already holds the new text
+typedef struct Change {
+  size_t start;          // First changed character
+  size_t removedLength;  // Characters removed at start
+  size_t insertedLength; // Characters inserted at start
+  size_t oldLength;      // Length of the line before the change
+  size_t oldCursor;      // Cursor position before the change
+} Change;
+
+typedef void (*WriteChange)(Output *out, const Change *change);
+
+static void put(Output *out, const char *data, size_t length) {
+  out->length += length;
+  if (out->isWriting && (length > 0)) {
+    SerialCLI_WriteBack(out->cli, data, length);
+  }
+}
+
+static size_t formatCsi(char *sequence, size_t count, char final) {
+  // A count of 1 is the default and is left out
+  int length = (1 == count) ? snprintf(sequence, CSI_MAX_LENGTH, "\x1b[%c", final)
+                            : snprintf(sequence, CSI_MAX_LENGTH, "\x1b[%zu%c", count, final);
+  return (size_t)length;
+}
+
+static void putCsi(Output *out, size_t count, char final) {
+  char sequence[CSI_MAX_LENGTH];
+  put(out, sequence, formatCsi(sequence, count, final));
+}
+
+static void moveRight(Output *out, size_t from, size_t to) {
+  char sequence[CSI_MAX_LENGTH];
+  size_t count = to - from;
+  if (count <= formatCsi(sequence, count, 'C')) {
+    put(out, &SerialCLI_GetLine(out->cli)[from], count);
+  } else {
+    putCsi(out, count, 'C');
+  }
+}
+
+static size_t getMoveRightLength(size_t count) {
+  char sequence[CSI_MAX_LENGTH];
+  size_t sequenceLength = formatCsi(sequence, count, 'C');
+  return (count < sequenceLength) ? count : sequenceLength;
+}
+
+/*
+ * Moves left with backspaces, a cursor sequence or by returning to the start
+ * of the row and writing the prompt again. Moves right by writing the
+ * characters again or a cursor sequence. The shortest way is taken.
+ */
+static void moveCursor(Output *out, size_t from, size_t to) {
+  if (to > from) {
+    moveRight(out, from, to);
+    return;
+  }
+  if (to == from) {
+    return;
+  }
+
+  char sequence[CSI_MAX_LENGTH];
+  size_t count = from - to;
+  size_t sequenceLength = formatCsi(sequence, count, 'D');
+  size_t promptLength = strlen(out->cli->promptBuffer);
+  size_t returnLength = 2 + promptLength + getMoveRightLength(to);
+
+  if ((count <= sequenceLength) && (count <= returnLength)) {
+    for (size_t i = 0; i < count; ++i) {
+      put(out, "\b", 1);
+    }
+  } else if (sequenceLength <= returnLength) {
+    put(out, sequence, sequenceLength);
+  } else {
+    put(out, "\r", 1);
+    put(out, out->cli->promptBuffer, promptLength);
+    put(out, " ", 1);
+    moveRight(out, 0, to);
+  }
+}
+
+static void writeRedraw(Output *out, const Change *change) {
+  (void)change;
+  SerialCLI *cli = out->cli;
+  put(out, "\r", 1);
+  put(out, cli->promptBuffer, strlen(cli->promptBuffer));
+  put(out, " ", 1);
+  put(out, SerialCLI_GetLine(cli), cli->charCount);
+  put(out, "\x1b[K", 3);
+  moveCursor(out, cli->charCount, cli->cursorPosition);
+}
+
+static void writeMove(Output *out, const Change *change) {
+  moveCursor(out, change->oldCursor, out->cli->cursorPosition);
+}
+
+static void writeRewrite(Output *out, const Change *change, bool isErasing) {
+  SerialCLI *cli = out->cli;
+  moveCursor(out, change->oldCursor, change->start);
+  put(out, &SerialCLI_GetLine(cli)[change->start], cli->charCount - change->start);
+
+  size_t position = cli->charCount;
+  if (change->oldLength > cli->charCount) {
+    if (isErasing) {
+      put(out, "\x1b[K", 3);
+    } else {
+      for (; position < change->oldLength; ++position) {
+        put(out, " ", 1);
+      }
+    }
+  }
+  moveCursor(out, position, cli->cursorPosition);
+}
+
+static void writeRewriteErasing(Output *out, const Change *change) { writeRewrite(out, change, true); }
+
+static void writeRewriteBlanking(Output *out, const Change *change) { writeRewrite(out, change, false); }
+
+static void writeShift(Output *out, const Change *change) {
+  const char *line = SerialCLI_GetLine(out->cli);
+  size_t overwrittenLength =
+      (change->removedLength < change->insertedLength) ? change->removedLength : change->insertedLength;
+
+  moveCursor(out, change->oldCursor, change->start);
+  put(out, &line[change->start], overwrittenLength);
+  if (change->insertedLength > change->removedLength) {
+    putCsi(out, change->insertedLength - change->removedLength, '@');
+    put(out, &line[change->start + overwrittenLength], change->insertedLength - overwrittenLength);
+  } else if (change->removedLength > change->insertedLength) {
+    putCsi(out, change->removedLength - change->insertedLength, 'P');
+  }
+  moveCursor(out, change->start + change->insertedLength, out->cli->cursorPosition);
+}
+
+static size_t measure(SerialCLI *cli, WriteChange write, const Change *change) {
+  Output out = {cli, false, 0};
+  write(&out, change);
+  return out.length;
+}
+
+static void writeCheapest(SerialCLI *cli, const WriteChange *candidates, size_t candidateCount,
+                          const Change *change) {
+  WriteChange cheapest = writeRedraw;
+  size_t redrawLength = measure(cli, writeRedraw, change);
+  size_t cheapestLength = redrawLength;
+  for (size_t i = 0; i < candidateCount; ++i) {
+    size_t length = measure(cli, candidates[i], change);
+    if (length < cheapestLength) {
+      cheapest = candidates[i];
+      cheapestLength = length;
+    }
+  }
+
+  Output out = {cli, true, 0};
+  cheapest(&out, change);
+
+  SerialCLI_EditStats *stats = &cli->editStats;
+  ++stats->editCount;
+  stats->bytesWritten += cheapestLength;
+  stats->lastEditSaved = redrawLength - cheapestLength;
+  stats->bytesSaved += stats->lastEditSaved;
+}
+
+static const WriteChange changeCandidates[] = {writeRewriteErasing, writeRewriteBlanking, writeShift};
+
+void SerialCLI_EditorRefresh(SerialCLI *cli, size_t start, size_t removedLength, size_t insertedLength,
+                             size_t oldCursor) {
+  Change change = {start, removedLength, insertedLength, cli->charCount - insertedLength + removedLength, oldCursor};
+  writeCheapest(cli, changeCandidates, sizeof(changeCandidates) / sizeof(changeCandidates[0]), &change);
+}
+
+void SerialCLI_EditorRedraw(SerialCLI *cli) {
+  Output out = {cli, true, 0};
+  writeRedraw(&out, NULL);
+}
+
+bool SerialCLI_EditorInsert(SerialCLI *cli, char ch) {
+  if (cli->charCount >= SerialCLI_GetLineCapacity(cli)) {
+    return false;
+  }
+
+  char *line = SerialCLI_GetLine(cli);
+  size_t start = cli->cursorPosition;
+  memmove(&line[start + 1], &line[start], cli->charCount - start + 1);
+  line[start] = ch;
+  ++cli->charCount;
+  ++cli->cursorPosition;
+  SerialCLI_EditorRefresh(cli, start, 0, 1, start);
+  return true;
+}
+
+void SerialCLI_EditorDelete(SerialCLI *cli, size_t start, size_t end) {
+  if ((start >= end) || (end > cli->charCount)) {
+    return;
+  }
+
+  char *line = SerialCLI_GetLine(cli);
+  size_t oldCursor = cli->cursorPosition;
+  memmove(&line[start], &line[end], cli->charCount - end + 1);
+  cli->charCount -= end - start;
+  cli->cursorPosition = start;
+  SerialCLI_EditorRefresh(cli, start, end - start, 0, oldCursor);
+}
+
+void SerialCLI_EditorMoveCursor(SerialCLI *cli, size_t position) {
+  if ((position > cli->charCount) || (position == cli->cursorPosition)) {
+    return;
+  }
+
+  static const WriteChange moveCandidates[] = {writeMove};
+  Change change = {position, 0, 0, cli->charCount, cli->cursorPosition};
+  cli->cursorPosition = position;
+  writeCheapest(cli, moveCandidates, 1, &change);
+}
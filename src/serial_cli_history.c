@@ -0,0 +1,268 @@
+#include "serial_cli_internal.h"
+
+#include <string.h>
+
+/*
+ * The history is a byte ring of variable-length entries without padding.
+ * Every entry is its length, its characters and its length again, so the
+ * entries next to any entry are found in constant time in both directions.
+ * historyHead is where the next entry starts, the oldest entry starts
+ * historyLength bytes before it.
+ */
+
+enum {
+  ENTRY_OVERHEAD = 2,          // Length byte before and after the characters
+  MAX_ENTRY_LENGTH = UINT8_MAX, // Longest line a length byte can describe
+};
+
+static inline size_t wrap(const SerialCLI *cli, size_t offset) {
+  return (offset >= cli->historySize) ? (offset - cli->historySize) : offset;
+}
+
+static inline size_t stepBack(const SerialCLI *cli, size_t offset, size_t count) {
+  return wrap(cli, offset + cli->historySize - count);
+}
+
+static inline uint8_t readByte(const SerialCLI *cli, size_t offset) {
+  return (uint8_t)cli->historyBuffer[wrap(cli, offset)];
+}
+
+static inline size_t getEntryLength(const SerialCLI *cli, size_t entry) { return readByte(cli, entry); }
+
+static inline size_t getOldest(const SerialCLI *cli) { return stepBack(cli, cli->historyHead, cli->historyLength); }
+
+static size_t getNewest(const SerialCLI *cli) {
+  if (0 == cli->historyLength) {
+    return SERIAL_CLI_HISTORY_NO_ENTRY;
+  }
+  size_t length = readByte(cli, stepBack(cli, cli->historyHead, 1));
+  return stepBack(cli, cli->historyHead, length + ENTRY_OVERHEAD);
+}
+
+static size_t getOlder(const SerialCLI *cli, size_t entry) {
+  if (entry == getOldest(cli)) {
+    return SERIAL_CLI_HISTORY_NO_ENTRY;
+  }
+  size_t length = readByte(cli, stepBack(cli, entry, 1));
+  return stepBack(cli, entry, length + ENTRY_OVERHEAD);
+}
+
+static size_t getNewer(const SerialCLI *cli, size_t entry) {
+  size_t next = wrap(cli, entry + getEntryLength(cli, entry) + ENTRY_OVERHEAD);
+  return (next == cli->historyHead) ? SERIAL_CLI_HISTORY_NO_ENTRY : next;
+}
+
+// Copies between the ring and a flat buffer, the ring part may wrap around once
+static void copyFromRing(const SerialCLI *cli, size_t offset, char *destination, size_t length) {
+  size_t firstLength = cli->historySize - offset;
+  if (firstLength >= length) {
+    memcpy(destination, &cli->historyBuffer[offset], length);
+    return;
+  }
+  memcpy(destination, &cli->historyBuffer[offset], firstLength);
+  memcpy(&destination[firstLength], cli->historyBuffer, length - firstLength);
+}
+
+static void copyToRing(SerialCLI *cli, size_t offset, const char *source, size_t length) {
+  size_t firstLength = cli->historySize - offset;
+  if (firstLength >= length) {
+    memcpy(&cli->historyBuffer[offset], source, length);
+    return;
+  }
+  memcpy(&cli->historyBuffer[offset], source, firstLength);
+  memcpy(cli->historyBuffer, &source[firstLength], length - firstLength);
+}
+
+static bool matchesAt(const SerialCLI *cli, size_t entry, size_t position, const char *str, size_t length) {
+  size_t offset = entry + 1 + position;
+  for (size_t i = 0; i < length; ++i) {
+    if ((uint8_t)str[i] != readByte(cli, offset + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool contains(const SerialCLI *cli, size_t entry, const char *query, size_t queryLength) {
+  size_t entryLength = getEntryLength(cli, entry);
+  for (size_t position = 0; (position + queryLength) <= entryLength; ++position) {
+    if (matchesAt(cli, entry, position, query, queryLength)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SerialCLI_HistoryAdd(SerialCLI *cli, const char *line, size_t length) {
+  cli->historyCursor = SERIAL_CLI_HISTORY_NO_ENTRY;
+
+  size_t entrySize = length + ENTRY_OVERHEAD;
+  if ((0 == length) || (length > MAX_ENTRY_LENGTH) || (entrySize > cli->historySize)) {
+    return;
+  }
+
+  size_t newest = getNewest(cli);
+  if ((SERIAL_CLI_HISTORY_NO_ENTRY != newest) && (getEntryLength(cli, newest) == length) &&
+      matchesAt(cli, newest, 0, line, length)) {
+    return;
+  }
+
+  while ((cli->historySize - cli->historyLength) < entrySize) {
+    cli->historyLength -= getEntryLength(cli, getOldest(cli)) + ENTRY_OVERHEAD;
+  }
+
+  size_t head = cli->historyHead;
+  cli->historyBuffer[head] = (char)length;
+  copyToRing(cli, wrap(cli, head + 1), line, length);
+  cli->historyBuffer[wrap(cli, head + 1 + length)] = (char)length;
+  cli->historyHead = wrap(cli, head + entrySize);
+  cli->historyLength += entrySize;
+}
+
+// Makes the entry the line being received, SERIAL_CLI_HISTORY_NO_ENTRY empties the line
+static bool loadEntry(SerialCLI *cli, size_t entry) {
+  char *line = SerialCLI_GetLine(cli);
+  size_t length = (SERIAL_CLI_HISTORY_NO_ENTRY != entry) ? getEntryLength(cli, entry) : 0;
+  if (length > SerialCLI_GetLineCapacity(cli)) {
+    return false;
+  }
+
+  // Only the part behind the common prefix changes on the terminal
+  size_t prefixLength = 0;
+  while ((prefixLength < length) && (prefixLength < cli->charCount) &&
+         ((uint8_t)line[prefixLength] == readByte(cli, entry + 1 + prefixLength))) {
+    ++prefixLength;
+  }
+
+  if (length > prefixLength) {
+    copyFromRing(cli, wrap(cli, entry + 1 + prefixLength), &line[prefixLength], length - prefixLength);
+  }
+  size_t removedLength = cli->charCount - prefixLength;
+  size_t oldCursor = cli->cursorPosition;
+  cli->charCount = length;
+  cli->cursorPosition = length;
+  line[length] = '\0';
+
+  if (!cli->isHistorySearching) {
+    SerialCLI_EditorRefresh(cli, prefixLength, removedLength, length - prefixLength, oldCursor);
+  }
+  return true;
+}
+
+void SerialCLI_HistoryRecall(SerialCLI *cli, bool isOlder) {
+  if (0 == cli->historyLength) {
+    return;
+  }
+
+  size_t entry = SERIAL_CLI_HISTORY_NO_ENTRY;
+  if (isOlder) {
+    entry = (SERIAL_CLI_HISTORY_NO_ENTRY == cli->historyCursor) ? getNewest(cli) : getOlder(cli, cli->historyCursor);
+    if (SERIAL_CLI_HISTORY_NO_ENTRY == entry) {
+      return;
+    }
+  } else {
+    if (SERIAL_CLI_HISTORY_NO_ENTRY == cli->historyCursor) {
+      return;
+    }
+    entry = getNewer(cli, cli->historyCursor);
+  }
+
+  if (loadEntry(cli, entry)) {
+    cli->historyCursor = entry;
+  }
+}
+
+static void writeSearch(SerialCLI *cli, bool isFailed) {
+  SerialCLI_WriteString(cli, "\r%s`", isFailed ? "(failed reverse-i-search)" : "(reverse-i-search)");
+  SerialCLI_WriteBack(cli, SerialCLI_GetLine(cli), cli->charCount);
+  SerialCLI_WriteString(cli, "': ");
+
+  size_t entry = cli->historyCursor;
+  if (SERIAL_CLI_HISTORY_NO_ENTRY != entry) {
+    size_t offset = wrap(cli, entry + 1);
+    size_t length = getEntryLength(cli, entry);
+    size_t firstLength = cli->historySize - offset;
+    if (firstLength >= length) {
+      SerialCLI_WriteBack(cli, &cli->historyBuffer[offset], length);
+    } else {
+      SerialCLI_WriteBack(cli, &cli->historyBuffer[offset], firstLength);
+      SerialCLI_WriteBack(cli, cli->historyBuffer, length - firstLength);
+    }
+  }
+  SerialCLI_WriteString(cli, "\x1b[K");
+}
+
+// The line being received holds the query, the cursor the last match
+static void search(SerialCLI *cli, size_t from) {
+  const char *query = SerialCLI_GetLine(cli);
+  size_t entry = from;
+  while ((SERIAL_CLI_HISTORY_NO_ENTRY != entry) && !contains(cli, entry, query, cli->charCount)) {
+    entry = getOlder(cli, entry);
+  }
+
+  if ((0 == cli->charCount) || (SERIAL_CLI_HISTORY_NO_ENTRY != entry)) {
+    cli->historyCursor = (cli->charCount > 0) ? entry : SERIAL_CLI_HISTORY_NO_ENTRY;
+    writeSearch(cli, false);
+    return;
+  }
+  // A failed search keeps showing the last match
+  writeSearch(cli, true);
+}
+
+void SerialCLI_HistorySearchOlder(SerialCLI *cli) {
+  if (0 == cli->historySize) {
+    return;
+  }
+
+  if (!cli->isHistorySearching) {
+    cli->isHistorySearching = true;
+    cli->historyCursor = SERIAL_CLI_HISTORY_NO_ENTRY;
+    cli->charCount = 0;
+    cli->cursorPosition = 0;
+    SerialCLI_GetLine(cli)[0] = '\0';
+    writeSearch(cli, false);
+    return;
+  }
+
+  if ((0 == cli->charCount) || (SERIAL_CLI_HISTORY_NO_ENTRY == cli->historyCursor)) {
+    return;
+  }
+  size_t older = getOlder(cli, cli->historyCursor);
+  if (SERIAL_CLI_HISTORY_NO_ENTRY == older) {
+    writeSearch(cli, true);
+    return;
+  }
+  search(cli, older);
+}
+
+void SerialCLI_HistorySearchAppend(SerialCLI *cli, char ch) {
+  if (cli->charCount >= SerialCLI_GetLineCapacity(cli)) {
+    return;
+  }
+
+  char *line = SerialCLI_GetLine(cli);
+  line[cli->charCount++] = ch;
+  line[cli->charCount] = '\0';
+
+  // A longer query can only match the current match or older entries
+  search(cli, (SERIAL_CLI_HISTORY_NO_ENTRY != cli->historyCursor) ? cli->historyCursor : getNewest(cli));
+}
+
+void SerialCLI_HistorySearchDelete(SerialCLI *cli) {
+  if (0 == cli->charCount) {
+    return;
+  }
+
+  SerialCLI_GetLine(cli)[--cli->charCount] = '\0';
+  search(cli, getNewest(cli));
+}
+
+void SerialCLI_HistoryEndSearch(SerialCLI *cli) {
+  // The terminal shows the search, so the whole line is drawn
+  if (!loadEntry(cli, cli->historyCursor)) {
+    cli->historyCursor = SERIAL_CLI_HISTORY_NO_ENTRY;
+    loadEntry(cli, SERIAL_CLI_HISTORY_NO_ENTRY);
+  }
+  cli->isHistorySearching = false;
+  SerialCLI_EditorRedraw(cli);
+}
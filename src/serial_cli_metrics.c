@@ -0,0 +1,277 @@
+#include "serial_cli_commands.h"
+#include "serial_cli_internal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if SERIAL_CLI_ENABLE_METRICS
+
+/*
+ * The counters are plain increments on the paths they count. The command
+ * being executed is measured from its start until its line is reported, so a
+ * deferred command includes all calls of its continuation. rxDropped and
+ * txDropped of the metrics hold the values of the instance at the last reset.
+ */
+
+enum {
+  STATS_LINE_SIZE = SERIAL_CLI_OUTPUT_BUFFER_SIZE + SERIAL_CLI_COMMAND_MAX_ARG_LENGTH, // Longest name included
+};
+
+static size_t getBucket(uint32_t duration) {
+  size_t bucket = 0;
+  for (uint32_t limit = 10; (bucket < (SERIAL_CLI_METRICS_BUCKET_COUNT - 1)) && (duration >= limit); limit *= 10) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+static void recordDuration(SerialCLI_CommandMetrics *metrics, uint32_t duration) {
+  metrics->totalTime += duration;
+  if (duration > metrics->maxTime) {
+    metrics->maxTime = duration;
+  }
+  ++metrics->histogram[getBucket(duration)];
+}
+
+static void startCommand(SerialCLI *cli, SerialCLI_CommandMetrics *metrics) {
+  ++metrics->callCount;
+  cli->timedCommand = metrics;
+  if (NULL != cli->metricsClock) {
+    cli->timedCommandStart = cli->metricsClock(cli->metricsClockContext);
+  }
+}
+
+void SerialCLI_MetricsStartCommand(SerialCLI *cli, SerialCLI_CommandEntry *entry) {
+  startCommand(cli, &entry->metrics);
+}
+
+void SerialCLI_MetricsStartStaticCommand(SerialCLI *cli, const SerialCLI_StaticCommand *command) {
+  startCommand(cli, command->metrics);
+}
+
+void SerialCLI_MetricsEndLine(SerialCLI *cli, SerialCLI_LineStatus status) {
+  SerialCLI_Metrics *metrics = &cli->metrics;
+  switch (status) {
+  case SERIAL_CLI_LINE_OK:
+    ++metrics->linesExecuted;
+    break;
+  case SERIAL_CLI_LINE_COMMAND_FAILED:
+    ++metrics->linesExecuted;
+    ++metrics->commandsFailed;
+    break;
+  case SERIAL_CLI_LINE_CANCELLED:
+    ++metrics->linesExecuted;
+    ++metrics->commandsCancelled;
+    break;
+  case SERIAL_CLI_LINE_UNKNOWN_COMMAND:
+  case SERIAL_CLI_LINE_TOO_MANY_ARGUMENTS:
+  case SERIAL_CLI_LINE_INVALID_FILTER:
+    ++metrics->linesRejected;
+    break;
+  default:
+    // Dropped lines are counted when they are dropped
+    break;
+  }
+
+  SerialCLI_CommandMetrics *timedCommand = cli->timedCommand;
+  if ((NULL != timedCommand) && (NULL != cli->metricsClock)) {
+    recordDuration(timedCommand, cli->metricsClock(cli->metricsClockContext) - cli->timedCommandStart);
+  }
+  cli->timedCommand = NULL;
+}
+
+// Formats the table row of a command, returns 0 if it does not fit into the line
+static size_t formatStatsRow(const char *name, int indent, const SerialCLI_CommandMetrics *metrics, char *line,
+                             size_t size) {
+  size_t measuredCount = 0;
+  for (size_t i = 0; i < SERIAL_CLI_METRICS_BUCKET_COUNT; ++i) {
+    measuredCount += metrics->histogram[i];
+  }
+  unsigned long long averageTime = (measuredCount > 0) ? (metrics->totalTime / measuredCount) : 0;
+  int nameWidth = (indent < 12) ? (12 - indent) : 0;
+
+  int length = snprintf(line, size, "  %*s%-*s %7zu %9llu %9lu", indent, "", nameWidth, name, metrics->callCount,
+                        averageTime, (unsigned long)metrics->maxTime);
+  for (size_t i = 0; (length > 0) && ((size_t)length < size) && (i < SERIAL_CLI_METRICS_BUCKET_COUNT); ++i) {
+    length += snprintf(&line[length], size - (size_t)length, " %6zu", metrics->histogram[i]);
+  }
+  if ((length <= 0) || (((size_t)length + 2) >= size)) {
+    return 0;
+  }
+  memcpy(&line[length], "\r\n", 2);
+  return (size_t)length + 2;
+}
+
+// Returns the first command without room in the TX ring, NULL once all are written. The shared and the static
+// commands follow the registered ones.
+static const void *writeStatsEntries(SerialCLI *cli, const void *current) {
+  char line[STATS_LINE_SIZE];
+  size_t staticCount = 0;
+  const SerialCLI_StaticCommand *staticCommands = SerialCLI_GetStaticCommands(&staticCount);
+  while (current != NULL) {
+    size_t length = 0;
+    const void *next = NULL;
+    if (SerialCLI_IsStaticCommand(current)) {
+      const SerialCLI_StaticCommand *command = current;
+      length = formatStatsRow(command->commandName, 0, command->metrics, line, sizeof(line));
+      next = (&command[1] < &staticCommands[staticCount]) ? &command[1] : NULL;
+    } else {
+      // Subcommands are indented below their group
+      const SerialCLI_CommandEntry *entry = current;
+      int indent = 0;
+      for (const SerialCLI_CommandEntry *parent = entry->parent; NULL != parent; parent = parent->parent) {
+        indent += 2;
+      }
+      length = formatStatsRow(entry->commandName, indent, &entry->metrics, line, sizeof(line));
+      next = SerialCLI_GetNextCommand((SerialCLI_CommandEntry *)current);
+      if (NULL == next) {
+        const SerialCLI_CommandEntry *root = entry;
+        while (NULL != root->parent) {
+          root = root->parent;
+        }
+        next = SerialCLI_GetNextListed(cli, root);
+      }
+    }
+
+    if (!SerialCLI_HasLineRoom(cli, length)) {
+      return current;
+    }
+    SerialCLI_WriteBack(cli, line, length);
+    current = next;
+  }
+  return NULL;
+}
+
+static bool continueStats(SerialCLI *cli, void *state, bool isCancelled) {
+  if (isCancelled) {
+    return true;
+  }
+
+  cli->continuationState = (void *)writeStatsEntries(cli, state);
+  return NULL == cli->continuationState;
+}
+
+static void statsCommand(SerialCLI *cli, int argc, const char **argv) {
+  (void)argv;
+
+  if (argc > 1) {
+    SerialCLI_WriteString(cli, "Usage: stats\r\n");
+    return;
+  }
+
+  SerialCLI_Metrics metrics;
+  (void)SerialCLI_GetMetrics(cli, &metrics);
+  SerialCLI_WriteString(cli, "Lines: %zu executed, %zu rejected, %zu dropped\r\n", metrics.linesExecuted,
+                        metrics.linesRejected, metrics.linesDropped);
+  SerialCLI_WriteString(cli, "Commands: %zu failed, %zu cancelled\r\n", metrics.commandsFailed,
+                        metrics.commandsCancelled);
+  SerialCLI_WriteString(cli, "Bytes: %zu in, %zu out, %zu RX dropped, %zu TX dropped\r\n", metrics.bytesIn,
+                        metrics.bytesOut, metrics.rxDropped, metrics.txDropped);
+  SerialCLI_WriteString(cli, "  %-12s %7s %9s %9s %6s %6s %6s %6s %6s %6s %6s %6s\r\n", "command", "calls", "avg us",
+                        "max us", "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", "<10s", ">=10s");
+
+  // With a non-blocking write callback the table streams like the help
+  const void *rest = writeStatsEntries(cli, &cli->helpEntry);
+  if (NULL != rest) {
+    (void)SerialCLI_Defer(cli, continueStats, (void *)rest);
+  }
+}
+
+void SerialCLI_MetricsInit(SerialCLI *cli) {
+  memset(&cli->metrics, 0, sizeof(cli->metrics));
+  memset(&cli->helpEntry.metrics, 0, sizeof(cli->helpEntry.metrics));
+  cli->metricsClock = NULL;
+  cli->metricsClockContext = NULL;
+  cli->timedCommand = NULL;
+  cli->timedCommandStart = 0;
+
+  SerialCLI_CommandEntry *statsEntry = &cli->statsEntry;
+  memset(statsEntry, 0, sizeof(*statsEntry));
+  statsEntry->command = statsCommand;
+  statsEntry->commandName = "stats";
+  statsEntry->commandDescription = "Prints counters and command latencies";
+  (void)SerialCLI_RegisterCommand(cli, statsEntry);
+}
+
+bool SerialCLI_SetMetricsClock(SerialCLI *cli, SerialCLI_MetricsClock clock, void *context) {
+  if (NULL == cli) {
+    return false;
+  }
+
+  // A command started on another clock is not measured
+  cli->metricsClock = clock;
+  cli->metricsClockContext = context;
+  cli->timedCommand = NULL;
+  return true;
+}
+
+bool SerialCLI_GetMetrics(const SerialCLI *cli, SerialCLI_Metrics *metrics) {
+  if ((NULL == cli) || (NULL == metrics)) {
+    return false;
+  }
+
+  *metrics = cli->metrics;
+  metrics->rxDropped = cli->rxDropped - cli->metrics.rxDropped;
+  metrics->txDropped = cli->txDropped - cli->metrics.txDropped;
+  return true;
+}
+
+bool SerialCLI_GetCommandMetrics(const SerialCLI_CommandEntry *entry, SerialCLI_CommandMetrics *metrics) {
+  if ((NULL == entry) || (NULL == metrics)) {
+    return false;
+  }
+
+  *metrics = entry->metrics;
+  return true;
+}
+
+bool SerialCLI_ResetMetrics(SerialCLI *cli) {
+  if (NULL == cli) {
+    return false;
+  }
+
+  memset(&cli->metrics, 0, sizeof(cli->metrics));
+  cli->metrics.rxDropped = cli->rxDropped;
+  cli->metrics.txDropped = cli->txDropped;
+  for (SerialCLI_CommandEntry *entry = &cli->helpEntry; NULL != entry; entry = SerialCLI_GetNextCommand(entry)) {
+    memset(&entry->metrics, 0, sizeof(entry->metrics));
+  }
+  SerialCLI_CommandEntry *shared = (NULL != cli->registry) ? cli->registry->commands : NULL;
+  for (SerialCLI_CommandEntry *entry = shared; NULL != entry; entry = SerialCLI_GetNextCommand(entry)) {
+    memset(&entry->metrics, 0, sizeof(entry->metrics));
+  }
+  size_t staticCount = 0;
+  const SerialCLI_StaticCommand *staticCommands = SerialCLI_GetStaticCommands(&staticCount);
+  for (size_t i = 0; i < staticCount; ++i) {
+    memset(staticCommands[i].metrics, 0, sizeof(*staticCommands[i].metrics));
+  }
+  return true;
+}
+
+#else
+
+bool SerialCLI_SetMetricsClock(SerialCLI *cli, SerialCLI_MetricsClock clock, void *context) {
+  (void)cli;
+  (void)clock;
+  (void)context;
+  return false;
+}
+
+bool SerialCLI_GetMetrics(const SerialCLI *cli, SerialCLI_Metrics *metrics) {
+  (void)cli;
+  (void)metrics;
+  return false;
+}
+
+bool SerialCLI_GetCommandMetrics(const SerialCLI_CommandEntry *entry, SerialCLI_CommandMetrics *metrics) {
+  (void)entry;
+  (void)metrics;
+  return false;
+}
+
+bool SerialCLI_ResetMetrics(SerialCLI *cli) {
+  (void)cli;
+  return false;
+}
+
+#endif
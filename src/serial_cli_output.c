@@ -0,0 +1,241 @@
+#include "serial_cli.h"
+#include "serial_cli_internal.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static inline size_t wrapTxRing(const SerialCLI *cli, size_t offset) {
+  return (offset >= cli->txRingSize) ? (offset - cli->txRingSize) : offset;
+}
+
+// Offers the pending output until the callback takes less than offered
+static void drainTxRing(SerialCLI *cli) {
+  while (cli->txRingLength > 0) {
+    size_t chunkLength = cli->txRingSize - cli->txRingStart;
+    if (chunkLength > cli->txRingLength) {
+      chunkLength = cli->txRingLength;
+    }
+
+    size_t accepted = cli->nonBlockingWrite(cli->context, &cli->txRing[cli->txRingStart], chunkLength);
+    if (accepted > chunkLength) {
+      accepted = chunkLength;
+    }
+    cli->txRingStart = wrapTxRing(cli, cli->txRingStart + accepted);
+    cli->txRingLength -= accepted;
+    if (accepted < chunkLength) {
+      return;
+    }
+  }
+
+  // An empty ring starts over, so the next output is kept in one piece
+  cli->txRingStart = 0;
+}
+
+static void writeNonBlocking(SerialCLI *cli, const char *data, size_t length) {
+  // New output only bypasses the ring while nothing is pending before it
+  if (0 == cli->txRingLength) {
+    size_t accepted = cli->nonBlockingWrite(cli->context, data, length);
+    if (accepted >= length) {
+      return;
+    }
+    data += accepted;
+    length -= accepted;
+  }
+
+  size_t freeLength = cli->txRingSize - cli->txRingLength;
+  if (length > freeLength) {
+    cli->txDropped += length - freeLength;
+    length = freeLength;
+  }
+
+  size_t end = wrapTxRing(cli, cli->txRingStart + cli->txRingLength);
+  size_t firstLength = cli->txRingSize - end;
+  if (firstLength >= length) {
+    memcpy(&cli->txRing[end], data, length);
+  } else {
+    memcpy(&cli->txRing[end], data, firstLength);
+    memcpy(cli->txRing, &data[firstLength], length - firstLength);
+  }
+  cli->txRingLength += length;
+}
+
+void SerialCLI_WriteRaw(SerialCLI *cli, const char *data, size_t length) {
+  SERIAL_CLI_METRICS_ADD(cli, bytesOut, length);
+  if (NULL != cli->monitor) {
+    cli->monitor(cli->monitorContext, SERIAL_CLI_MONITOR_OUTPUT, data, length);
+  }
+  if (NULL != cli->nonBlockingWrite) {
+    writeNonBlocking(cli, data, length);
+  } else if (NULL != cli->contextWrite) {
+    cli->contextWrite(cli->context, data, length);
+  } else if (NULL != cli->write) {
+    cli->write(data, length);
+  }
+}
+
+static void writeOut(SerialCLI *cli, const char *data, size_t length) {
+  if (SERIAL_CLI_MODE_RPC == cli->mode) {
+    SerialCLI_RpcWriteOutput(cli, data, length);
+  } else {
+    SerialCLI_WriteRaw(cli, data, length);
+  }
+}
+
+static void flushBuffer(SerialCLI *cli) {
+  if (cli->txLength > 0) {
+    writeOut(cli, cli->txBuffer, cli->txLength);
+  }
+  cli->txLength = 0;
+}
+
+static void applyFlushPolicy(SerialCLI *cli, const char *output, size_t length) {
+  // Output of an RPC request is collected for its result frame
+  if (cli->isRpcRequestActive) {
+    return;
+  }
+
+  bool isNewlineFlush = (0U != (cli->flushPolicy & SERIAL_CLI_FLUSH_ON_NEWLINE)) && (NULL != memchr(output, '\n', length));
+  bool isHighWaterFlush =
+      (0U != (cli->flushPolicy & SERIAL_CLI_FLUSH_ON_HIGH_WATER)) && (cli->txLength >= cli->txHighWaterMark);
+  if (isNewlineFlush || isHighWaterFlush) {
+    flushBuffer(cli);
+  }
+}
+
+void SerialCLI_WriteBack(SerialCLI *cli, const char *output, size_t length) {
+#if SERIAL_CLI_ENABLE_FILTERS
+  // The lines passing the filters come back with filtering turned off
+  if (cli->isOutputFiltered) {
+    SerialCLI_FilterOutput(cli, output, length);
+    return;
+  }
+#endif
+
+  const char *data = output;
+  size_t remaining = length;
+
+  // Output that would only pass through the buffer is written directly
+  if ((remaining >= cli->txBufferSize) &&
+      ((NULL != cli->write) || (NULL != cli->contextWrite) || (NULL != cli->nonBlockingWrite))) {
+    flushBuffer(cli);
+    writeOut(cli, data, remaining);
+    return;
+  }
+
+  while (remaining > 0) {
+    if (cli->txBufferSize == cli->txLength) {
+      flushBuffer(cli);
+    }
+
+    size_t chunkLength = cli->txBufferSize - cli->txLength;
+    if (chunkLength > remaining) {
+      chunkLength = remaining;
+    }
+    memcpy(&cli->txBuffer[cli->txLength], data, chunkLength);
+    cli->txLength += chunkLength;
+    data += chunkLength;
+    remaining -= chunkLength;
+  }
+
+  applyFlushPolicy(cli, output, length);
+}
+
+bool SerialCLI_WriteString(SerialCLI *cli, const char *format, ...) {
+  if (NULL == format || NULL == cli) {
+    return false;
+  }
+
+  va_list arg;
+  va_start(arg, format);
+
+  // Format straight into the TX buffer when the output fits, filtered output has to pass the filters first
+  va_list argCopy;
+  va_copy(argCopy, arg);
+  size_t freeSpace = SerialCLI_IsOutputFiltered(cli) ? 0 : (cli->txBufferSize + 1 - cli->txLength);
+  int len = vsnprintf(&cli->txBuffer[cli->txLength], freeSpace, format, argCopy);
+  va_end(argCopy);
+
+  bool isLengthValid = (len < SERIAL_CLI_OUTPUT_BUFFER_SIZE);
+  if (len <= 0 || !isLengthValid) {
+    va_end(arg);
+    return false;
+  }
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_WRITE, len);
+
+  if ((size_t)len < freeSpace) {
+    va_end(arg);
+    const char *output = &cli->txBuffer[cli->txLength];
+    cli->txLength += (size_t)len;
+    applyFlushPolicy(cli, output, (size_t)len);
+    return true;
+  }
+
+  char buffer[SERIAL_CLI_OUTPUT_BUFFER_SIZE];
+  (void)vsnprintf(buffer, sizeof(buffer), format, arg);
+  va_end(arg);
+
+  SerialCLI_WriteBack(cli, buffer, (size_t)len);
+  return true;
+}
+
+bool SerialCLI_WriteBytes(SerialCLI *cli, const char *data, size_t length) {
+  if ((NULL == cli) || ((NULL == data) && (length > 0))) {
+    return false;
+  }
+
+  SERIAL_CLI_TRACE(cli, SERIAL_CLI_TRACE_WRITE, length);
+  SerialCLI_WriteBack(cli, data, length);
+  return true;
+}
+
+bool SerialCLI_Flush(SerialCLI *cli) {
+  if (NULL == cli) {
+    return false;
+  }
+
+  flushBuffer(cli);
+  return true;
+}
+
+bool SerialCLI_TxReady(SerialCLI *cli) {
+  if (NULL == cli) {
+    return false;
+  }
+
+  if (NULL != cli->nonBlockingWrite) {
+    drainTxRing(cli);
+  }
+  return 0 == cli->txRingLength;
+}
+
+size_t SerialCLI_GetTxSpace(const SerialCLI *cli) {
+  if (NULL == cli) {
+    return 0;
+  }
+  if (NULL == cli->nonBlockingWrite) {
+    return SIZE_MAX;
+  }
+
+  // Buffered output takes its room in the ring once it is flushed
+  size_t freeLength = cli->txRingSize - cli->txRingLength;
+  return (freeLength > cli->txLength) ? (freeLength - cli->txLength) : 0;
+}
+
+size_t SerialCLI_GetTxPending(const SerialCLI *cli) { return (NULL != cli) ? cli->txRingLength : 0; }
+
+bool SerialCLI_IsTxBlocked(const SerialCLI *cli) {
+  // An empty ring is never blocked, it takes a full TX buffer
+  return (NULL != cli) && (NULL != cli->nonBlockingWrite) &&
+         ((cli->txRingSize - cli->txRingLength) < cli->txBufferSize);
+}
+
+bool SerialCLI_SetFlushPolicy(SerialCLI *cli, unsigned policy, size_t highWaterMark) {
+  if ((NULL == cli) || (highWaterMark > cli->txBufferSize)) {
+    return false;
+  }
+
+  cli->flushPolicy = policy;
+  cli->txHighWaterMark = highWaterMark;
+  return true;
+}
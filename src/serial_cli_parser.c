@@ -0,0 +1,97 @@
+#include "serial_cli_parser.h"
+#include "serial_cli_scan.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <string.h>
+
+static bool startArgument(SerialCLI *cli, const char *argument) {
+  if (cli->maxArgs == cli->tokenCount) {
+    return false;
+  }
+
+  cli->argv[cli->tokenCount] = argument;
+  ++cli->tokenCount;
+  return true;
+}
+
+const char *SerialCLI_ParseInputReference(SerialCLI *cli, char *line, size_t lineLength) {
+  bool isQuotedArgument = false;
+  bool isRegularArgument = false;
+
+  // Arguments are split in place, argv points into the line
+  cli->tokenCount = 0;
+  for (size_t i = 0; i < lineLength; ++i) {
+    // quoted argument
+    if ('\"' == line[i]) {
+      line[i] = '\0';
+      isRegularArgument = false;
+      if (isQuotedArgument) {
+        isQuotedArgument = false;
+        continue;
+      }
+
+      if (!startArgument(cli, &line[i + 1])) {
+        return NULL;
+      }
+      isQuotedArgument = true;
+      continue;
+    }
+
+    if (isQuotedArgument) {
+      continue;
+    }
+
+    // regular argument
+    if (isspace((unsigned char)line[i])) {
+      line[i] = '\0';
+      isRegularArgument = false;
+    } else if (!isRegularArgument) {
+      if (!startArgument(cli, &line[i])) {
+        return NULL;
+      }
+      isRegularArgument = true;
+    }
+  }
+
+  cli->argv[cli->tokenCount] = NULL;
+  return cli->argv[0];
+}
+
+const char *SerialCLI_ParseInput(SerialCLI *cli, char *line, size_t lineLength) {
+  // Arguments are split in place, argv points into the line
+  cli->tokenCount = 0;
+  size_t i = 0;
+  while (i < lineLength) {
+    // A quoted argument runs up to the closing quote or the end of the line
+    if ('\"' == line[i]) {
+      line[i] = '\0';
+      ++i;
+      if (!startArgument(cli, &line[i])) {
+        return NULL;
+      }
+      char *quote = memchr(&line[i], '\"', lineLength - i);
+      if (NULL == quote) {
+        break;
+      }
+      *quote = '\0';
+      i = (size_t)(quote - line) + 1;
+      continue;
+    }
+
+    if (isspace((unsigned char)line[i])) {
+      line[i] = '\0';
+      ++i;
+      continue;
+    }
+
+    // A regular argument runs up to the next delimiter, found many bytes at a time
+    if (!startArgument(cli, &line[i])) {
+      return NULL;
+    }
+    i += 1 + SerialCLI_ScanDelimiter(&line[i + 1], lineLength - i - 1);
+  }
+
+  cli->argv[cli->tokenCount] = NULL;
+  return cli->argv[0];
+}
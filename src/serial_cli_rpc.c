@@ -0,0 +1,391 @@
+#include "serial_cli_rpc.h"
+#include "serial_cli_commands.h"
+#include "serial_cli_internal.h"
+
+#include <string.h>
+
+enum {
+  COBS_MAX_BLOCK_LENGTH = 254, // Non-zero bytes one COBS code byte can cover
+  CRC_INITIAL_VALUE = 0xFFFF,  // CRC-16/CCITT-FALSE initial value
+};
+
+/**
+ * Streaming COBS encoder.
+ *
+ * Holds one block behind its code byte, so a frame is encoded from several
+ * pieces without assembling it first and reaches the sink in blocks.
+ */
+typedef struct FrameEncoder {
+  void (*emit)(void *context, const char *data, size_t length); ///< Receives the encoded blocks.
+  void *context;                                                ///< Context of the sink.
+  uint16_t crc;                                                 ///< CRC of the bytes encoded so far.
+  size_t blockLength;                                           ///< Code byte plus the buffered block.
+  char block[COBS_MAX_BLOCK_LENGTH + 2];                        ///< Code byte, block and delimiter.
+} FrameEncoder;
+
+// CRC-16/CCITT-FALSE without a table, polynomial 0x1021
+static uint16_t updateCrc(uint16_t crc, uint8_t byte) {
+  crc = (uint16_t)((crc >> 8) | (crc << 8));
+  crc ^= byte;
+  crc ^= (uint16_t)((crc & 0xFFU) >> 4);
+  crc ^= (uint16_t)(crc << 12);
+  crc ^= (uint16_t)((crc & 0xFFU) << 5);
+  return crc;
+}
+
+static uint16_t getCrc(const uint8_t *data, size_t length) {
+  uint16_t crc = CRC_INITIAL_VALUE;
+  for (size_t i = 0; i < length; ++i) {
+    crc = updateCrc(crc, data[i]);
+  }
+  return crc;
+}
+
+static inline uint16_t readUint16(const uint8_t *data) { return (uint16_t)(data[0] | (data[1] << 8)); }
+
+static inline uint32_t readUint32(const uint8_t *data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static inline void writeUint16(uint8_t *data, uint16_t value) {
+  data[0] = (uint8_t)value;
+  data[1] = (uint8_t)(value >> 8);
+}
+
+static inline void writeUint32(uint8_t *data, uint32_t value) {
+  writeUint16(data, (uint16_t)value);
+  writeUint16(&data[2], (uint16_t)(value >> 16));
+}
+
+static void startFrame(FrameEncoder *encoder) {
+  encoder->crc = CRC_INITIAL_VALUE;
+  encoder->blockLength = 1;
+}
+
+static void emitBlock(FrameEncoder *encoder, bool isLast) {
+  encoder->block[0] = (char)encoder->blockLength;
+  if (isLast) {
+    encoder->block[encoder->blockLength++] = (char)SERIAL_CLI_RPC_DELIMITER;
+  }
+  encoder->emit(encoder->context, encoder->block, encoder->blockLength);
+  encoder->blockLength = 1;
+}
+
+static void encodeBytes(FrameEncoder *encoder, const uint8_t *data, size_t length, bool isCovered) {
+  for (size_t i = 0; i < length; ++i) {
+    if (isCovered) {
+      encoder->crc = updateCrc(encoder->crc, data[i]);
+    }
+
+    if (0U == data[i]) {
+      emitBlock(encoder, false);
+      continue;
+    }
+    encoder->block[encoder->blockLength++] = (char)data[i];
+    if ((COBS_MAX_BLOCK_LENGTH + 1) == encoder->blockLength) {
+      emitBlock(encoder, false);
+    }
+  }
+}
+
+static void finishFrame(FrameEncoder *encoder) {
+  uint8_t crc[SERIAL_CLI_RPC_CRC_SIZE];
+  writeUint16(crc, encoder->crc);
+  encodeBytes(encoder, crc, sizeof(crc), false);
+  emitBlock(encoder, true);
+}
+
+// Decodes in place, returns SIZE_MAX on an invalid encoding
+static size_t decodeFrame(uint8_t *frame, size_t frameLength) {
+  size_t in = 0;
+  size_t out = 0;
+  while (in < frameLength) {
+    size_t code = frame[in++];
+    if ((0U == code) || ((in + code - 1) > frameLength)) {
+      return SIZE_MAX;
+    }
+
+    memmove(&frame[out], &frame[in], code - 1);
+    out += code - 1;
+    in += code - 1;
+    // Blocks of maximum length are not followed by a zero
+    if (((COBS_MAX_BLOCK_LENGTH + 1) != code) && (in < frameLength)) {
+      frame[out++] = 0;
+    }
+  }
+  return out;
+}
+
+static void emitToCli(void *context, const char *data, size_t length) {
+  SerialCLI_WriteRaw((SerialCLI *)context, data, length);
+}
+
+static void writeResponse(SerialCLI *cli, uint8_t type, uint8_t status, const char *data, size_t length) {
+  FrameEncoder encoder;
+  encoder.emit = emitToCli;
+  encoder.context = cli;
+  startFrame(&encoder);
+
+  uint8_t header[SERIAL_CLI_RPC_RESPONSE_HEADER_SIZE] = {type, 0, 0, status};
+  writeUint16(&header[1], cli->rpcRequestId);
+  encodeBytes(&encoder, header, sizeof(header), true);
+  encodeBytes(&encoder, (const uint8_t *)data, length, true);
+  finishFrame(&encoder);
+}
+
+void SerialCLI_RpcWriteOutput(SerialCLI *cli, const char *data, size_t length) {
+  if (cli->isRpcRequestActive) {
+    writeResponse(cli, SERIAL_CLI_RPC_OUTPUT, SERIAL_CLI_RPC_STATUS_OK, data, length);
+    return;
+  }
+
+  cli->rpcRequestId = 0;
+  writeResponse(cli, SERIAL_CLI_RPC_NOTIFY, SERIAL_CLI_RPC_STATUS_OK, data, length);
+}
+
+#if SERIAL_CLI_ENABLE_METRICS
+// Requests the command never saw count as rejected lines
+static SerialCLI_LineStatus toLineStatus(uint8_t status) {
+  switch (status) {
+  case SERIAL_CLI_RPC_STATUS_OK:
+    return SERIAL_CLI_LINE_OK;
+  case SERIAL_CLI_RPC_STATUS_UNKNOWN_COMMAND:
+    return SERIAL_CLI_LINE_UNKNOWN_COMMAND;
+  case SERIAL_CLI_RPC_STATUS_COMMAND_FAILED:
+    return SERIAL_CLI_LINE_COMMAND_FAILED;
+  case SERIAL_CLI_RPC_STATUS_CANCELLED:
+    return SERIAL_CLI_LINE_CANCELLED;
+  default:
+    return SERIAL_CLI_LINE_TOO_MANY_ARGUMENTS;
+  }
+}
+#endif
+
+void SerialCLI_RpcFinishRequest(SerialCLI *cli, uint8_t status) {
+#if SERIAL_CLI_ENABLE_METRICS
+  SerialCLI_MetricsEndLine(cli, toLineStatus(status));
+#endif
+  writeResponse(cli, SERIAL_CLI_RPC_RESULT, status, cli->txBuffer, cli->txLength);
+  cli->txLength = 0;
+  cli->isRpcRequestActive = false;
+}
+
+// Points the arguments into the decoded body, which holds argc null-terminated strings
+static bool splitArguments(SerialCLI *cli, const char *commandName, size_t argc, char *body, size_t bodyLength) {
+  if ((argc + 1) > cli->maxArgs) {
+    return false;
+  }
+
+  const char **argv = SerialCLI_GetArgv(cli);
+  argv[0] = commandName;
+  size_t offset = 0;
+  for (size_t i = 1; i <= argc; ++i) {
+    const char *end = memchr(&body[offset], '\0', bodyLength - offset);
+    if (NULL == end) {
+      return false;
+    }
+    argv[i] = &body[offset];
+    offset = (size_t)(end - body) + 1;
+  }
+  argv[argc + 1] = NULL;
+  cli->tokenCount = argc + 1;
+  return offset == bodyLength;
+}
+
+static void writeListEntry(SerialCLI *cli, uint32_t commandId, const char *commandName) {
+  uint8_t id[4];
+  writeUint32(id, commandId);
+  (void)SerialCLI_WriteBytes(cli, (const char *)id, sizeof(id));
+  (void)SerialCLI_WriteBytes(cli, commandName, strlen(commandName) + 1);
+}
+
+// Lists the top-level commands in the order of help, the subcommands are named by arguments
+static void writeCommandList(SerialCLI *cli) {
+  for (const SerialCLI_CommandEntry *entry = cli->commands.commands; NULL != entry; entry = entry->next) {
+    writeListEntry(cli, entry->commandId, entry->commandName);
+  }
+  if (NULL != cli->registry) {
+    for (const SerialCLI_CommandEntry *entry = cli->registry->commands; NULL != entry; entry = entry->next) {
+      writeListEntry(cli, entry->commandId, entry->commandName);
+    }
+  }
+
+  size_t count = 0;
+  const SerialCLI_StaticCommand *commands = SerialCLI_GetStaticCommands(&count);
+  for (size_t i = 0; i < count; ++i) {
+    writeListEntry(cli, SerialCLI_GetStaticCommandId(&commands[i]), commands[i].commandName);
+  }
+}
+
+void SerialCLI_RpcExecute(SerialCLI *cli, char *frame, size_t frameLength) {
+  uint8_t *decoded = (uint8_t *)frame;
+  size_t length = decodeFrame(decoded, frameLength);
+
+  // Output written between requests is not part of this one
+  SerialCLI_Flush(cli);
+  cli->isRpcRequestActive = true;
+  cli->rpcRequestId = ((SIZE_MAX != length) && (length >= 3)) ? readUint16(&decoded[1]) : 0;
+
+  bool isFrameValid = (SIZE_MAX != length) &&
+                      (length >= (SERIAL_CLI_RPC_REQUEST_HEADER_SIZE + SERIAL_CLI_RPC_CRC_SIZE)) &&
+                      (SERIAL_CLI_RPC_REQUEST == decoded[0]) &&
+                      (getCrc(decoded, length - SERIAL_CLI_RPC_CRC_SIZE) ==
+                       readUint16(&decoded[length - SERIAL_CLI_RPC_CRC_SIZE]));
+  if (!isFrameValid) {
+    SerialCLI_RpcFinishRequest(cli, SERIAL_CLI_RPC_STATUS_CORRUPT_FRAME);
+    return;
+  }
+
+  uint32_t commandId = readUint32(&decoded[3]);
+  size_t argc = decoded[SERIAL_CLI_RPC_REQUEST_HEADER_SIZE - 1];
+  char *body = &frame[SERIAL_CLI_RPC_REQUEST_HEADER_SIZE];
+  size_t bodyLength = length - SERIAL_CLI_RPC_REQUEST_HEADER_SIZE - SERIAL_CLI_RPC_CRC_SIZE;
+  if (SERIAL_CLI_RPC_LIST_COMMANDS == commandId) {
+    if ((0U != argc) || (0U != bodyLength)) {
+      SerialCLI_RpcFinishRequest(cli, SERIAL_CLI_RPC_STATUS_INVALID_ARGUMENTS);
+      return;
+    }
+    writeCommandList(cli);
+    SerialCLI_RpcFinishRequest(cli, SERIAL_CLI_RPC_STATUS_OK);
+    return;
+  }
+
+  SerialCLI_CommandEntry *entry = SerialCLI_GetCommandEntryById(cli, commandId);
+  const SerialCLI_StaticCommand *staticCommand = (NULL == entry) ? SerialCLI_GetStaticCommandById(commandId) : NULL;
+  if ((NULL == entry) && (NULL == staticCommand)) {
+    SerialCLI_RpcFinishRequest(cli, SERIAL_CLI_RPC_STATUS_UNKNOWN_COMMAND);
+    return;
+  }
+
+  const char *commandName = (NULL != entry) ? entry->commandName : staticCommand->commandName;
+  if (!splitArguments(cli, commandName, argc, body, bodyLength)) {
+    SerialCLI_RpcFinishRequest(cli, SERIAL_CLI_RPC_STATUS_INVALID_ARGUMENTS);
+    return;
+  }
+
+  // The command ID names the top-level command, the leading arguments its subcommands
+  if (NULL != entry) {
+    size_t depth = 0;
+    entry = SerialCLI_ResolveSubcommand(cli, entry, &depth);
+    if (NULL == entry) {
+      SerialCLI_RpcFinishRequest(cli, SERIAL_CLI_RPC_STATUS_UNKNOWN_COMMAND);
+      return;
+    }
+    SerialCLI_CallCommand(cli, entry, depth);
+  } else {
+    SerialCLI_CallStaticCommand(cli, staticCommand);
+  }
+
+  // The command may have left RPC mode, which completes the request, or may continue deferred
+  if (cli->isRpcRequestActive && (NULL == cli->continuation)) {
+    SerialCLI_RpcFinishRequest(cli, cli->isCommandFailed ? SERIAL_CLI_RPC_STATUS_COMMAND_FAILED
+                                                         : SERIAL_CLI_RPC_STATUS_OK);
+  }
+}
+
+bool SerialCLI_RpcGetCommandId(SerialCLI *cli, const char *commandName, uint32_t *commandId) {
+  if ((NULL == cli) || (NULL == commandName) || (NULL == commandId)) {
+    return false;
+  }
+
+  size_t nameLength = strlen(commandName);
+  const SerialCLI_CommandEntry *entry = SerialCLI_FindTopLevelCommand(cli, commandName, nameLength);
+  if (NULL != entry) {
+    *commandId = entry->commandId;
+    return true;
+  }
+  const SerialCLI_StaticCommand *command = SerialCLI_FindStaticCommand(commandName, nameLength);
+  if (NULL != command) {
+    *commandId = SerialCLI_GetStaticCommandId(command);
+    return true;
+  }
+  return false;
+}
+
+bool SerialCLI_RpcFindCommandId(const char *list, size_t listLength, const char *commandName, uint32_t *commandId) {
+  if (((NULL == list) && (listLength > 0)) || (NULL == commandName) || (NULL == commandId)) {
+    return false;
+  }
+
+  size_t offset = 0;
+  while ((listLength - offset) > sizeof(uint32_t)) {
+    const char *name = &list[offset + sizeof(uint32_t)];
+    const char *end = memchr(name, '\0', listLength - offset - sizeof(uint32_t));
+    if (NULL == end) {
+      return false;
+    }
+    if (0 == strcmp(name, commandName)) {
+      *commandId = readUint32((const uint8_t *)&list[offset]);
+      return true;
+    }
+    offset = (size_t)(end - list) + 1;
+  }
+  return false;
+}
+
+typedef struct BufferSink {
+  char *buffer;
+  size_t size;
+  size_t length;
+  bool isOverflowed;
+} BufferSink;
+
+static void emitToBuffer(void *context, const char *data, size_t length) {
+  BufferSink *sink = (BufferSink *)context;
+  if (sink->isOverflowed || (length > (sink->size - sink->length))) {
+    sink->isOverflowed = true;
+    return;
+  }
+  memcpy(&sink->buffer[sink->length], data, length);
+  sink->length += length;
+}
+
+size_t SerialCLI_RpcEncodeRequest(char *frame, size_t frameSize, uint16_t requestId, uint32_t commandId, int argc,
+                                  const char **argv) {
+  if ((NULL == frame) || ((NULL == argv) && (argc > 0)) || (argc < 0) || (argc > UINT8_MAX)) {
+    return 0;
+  }
+
+  BufferSink sink = {frame, frameSize, 0, false};
+  FrameEncoder encoder;
+  encoder.emit = emitToBuffer;
+  encoder.context = &sink;
+  startFrame(&encoder);
+
+  uint8_t header[SERIAL_CLI_RPC_REQUEST_HEADER_SIZE] = {SERIAL_CLI_RPC_REQUEST};
+  writeUint16(&header[1], requestId);
+  writeUint32(&header[3], commandId);
+  header[7] = (uint8_t)argc;
+  encodeBytes(&encoder, header, sizeof(header), true);
+
+  for (int i = 0; i < argc; ++i) {
+    if (NULL == argv[i]) {
+      return 0;
+    }
+    // Arguments are sent with their terminator
+    encodeBytes(&encoder, (const uint8_t *)argv[i], strlen(argv[i]) + 1, true);
+  }
+  finishFrame(&encoder);
+
+  return sink.isOverflowed ? 0 : sink.length;
+}
+
+bool SerialCLI_RpcDecodeResponse(char *frame, size_t frameLength, SerialCLI_RpcResponse *response) {
+  if ((NULL == frame) || (NULL == response)) {
+    return false;
+  }
+
+  uint8_t *decoded = (uint8_t *)frame;
+  size_t length = decodeFrame(decoded, frameLength);
+  if ((SIZE_MAX == length) || (length < (SERIAL_CLI_RPC_RESPONSE_HEADER_SIZE + SERIAL_CLI_RPC_CRC_SIZE)) ||
+      (getCrc(decoded, length - SERIAL_CLI_RPC_CRC_SIZE) != readUint16(&decoded[length - SERIAL_CLI_RPC_CRC_SIZE]))) {
+    return false;
+  }
+
+  response->type = decoded[0];
+  response->requestId = readUint16(&decoded[1]);
+  response->status = decoded[3];
+  response->data = &frame[SERIAL_CLI_RPC_RESPONSE_HEADER_SIZE];
+  response->dataLength = length - SERIAL_CLI_RPC_RESPONSE_HEADER_SIZE - SERIAL_CLI_RPC_CRC_SIZE;
+  return true;
+}
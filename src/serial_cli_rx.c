@@ -0,0 +1,101 @@
+#include "serial_cli.h"
+#include "serial_cli_internal.h"
+#include "serial_cli_rpc.h"
+
+#include <string.h>
+
+static inline size_t getRingOffset(const SerialCLI *cli, size_t index) { return index & (cli->rxRingSize - 1); }
+
+static size_t findLineEnd(const SerialCLI *cli, const char *data, size_t length) {
+  if (SERIAL_CLI_MODE_RPC == cli->mode) {
+    const char *delimiter = memchr(data, SERIAL_CLI_RPC_DELIMITER, length);
+    return (NULL != delimiter) ? (size_t)(delimiter - data) + 1 : length;
+  }
+
+  for (size_t i = 0; i < length; ++i) {
+    if (('\r' == data[i]) || ('\n' == data[i])) {
+      return i + 1;
+    }
+  }
+  return length;
+}
+
+// Copies bytes to the ring in at most two segments, up to the end of the ring and from its start
+static void storeBytes(SerialCLI *cli, size_t index, const char *str, size_t length) {
+  // Without a receive ring nothing is stored and the ring pointer may be NULL
+  if (0U == length) {
+    return;
+  }
+
+  size_t offset = getRingOffset(cli, index);
+  size_t firstLength = cli->rxRingSize - offset;
+  if (firstLength > length) {
+    firstLength = length;
+  }
+  memcpy(&cli->rxRing[offset], str, firstLength);
+  memcpy(cli->rxRing, &str[firstLength], length - firstLength);
+}
+
+size_t SerialCLI_ReadFromISR(SerialCLI *cli, const char *str, size_t len) {
+  if ((NULL == cli) || (NULL == str)) {
+    return 0;
+  }
+
+  size_t head = cli->rxHead;
+  size_t tail = SERIAL_CLI_LOAD_ACQUIRE(&cli->rxTail);
+  size_t freeSpace = cli->rxRingSize - (head - tail);
+
+  // Ctrl+C for a running command is delivered here, even when the ring is full, and is not stored for the drain to
+  // see again. Otherwise it waits in the ring like any byte. RPC frames may contain any byte.
+  bool isCancelDelivered = (SERIAL_CLI_MODE_RPC != SERIAL_CLI_LOAD_ACQUIRE(&cli->mode)) &&
+                           (NULL != SERIAL_CLI_LOAD_ACQUIRE(&cli->continuation));
+  size_t accepted = 0;
+  size_t stored = 0;
+  while (accepted < len) {
+    const char *cancel = isCancelDelivered ? memchr(&str[accepted], SERIAL_CLI_CANCEL_CHARACTER, len - accepted) : NULL;
+    size_t runLength = (NULL != cancel) ? (size_t)(cancel - &str[accepted]) : (len - accepted);
+    size_t storedLength = (runLength < (freeSpace - stored)) ? runLength : (freeSpace - stored);
+    storeBytes(cli, head + stored, &str[accepted], storedLength);
+    stored += storedLength;
+    accepted += storedLength;
+
+    if (NULL != cancel) {
+      SERIAL_CLI_STORE_RELEASE(&cli->isCancelRequested, true);
+    }
+    if ((NULL == cancel) || (storedLength < runLength)) {
+      break;
+    }
+    ++accepted;
+  }
+
+  cli->rxDropped += len - accepted;
+  if (stored > 0) {
+    SERIAL_CLI_STORE_RELEASE(&cli->rxHead, head + stored);
+  }
+  return accepted;
+}
+
+void SerialCLI_DrainReceiveRing(SerialCLI *cli) {
+  size_t head = SERIAL_CLI_LOAD_ACQUIRE(&cli->rxHead);
+  size_t tail = cli->rxTail;
+
+  // Free the ring for the next burst; behind queued lines only input fitting into the line is moved, the rest waits in
+  // the ring instead of being dropped with the line
+  while (tail != head) {
+    size_t offset = getRingOffset(cli, tail);
+    size_t segmentLength = cli->rxRingSize - offset;
+    if (segmentLength > (head - tail)) {
+      segmentLength = head - tail;
+    }
+
+    const char *segment = &cli->rxRing[offset];
+    size_t length = findLineEnd(cli, segment, segmentLength);
+    if ((cli->queuedLines > 0) && ((cli->charCount + length) > SerialCLI_GetLineCapacity(cli))) {
+      break;
+    }
+    (void)SerialCLI_Read(cli, segment, length);
+
+    tail += length;
+    SERIAL_CLI_STORE_RELEASE(&cli->rxTail, tail);
+  }
+}
@@ -0,0 +1,196 @@
+#include "serial_cli_scan.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SERIAL_CLI_SCAN_SSE2 1
+#elif defined(__ARM_NEON) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#include <arm_neon.h>
+#define SERIAL_CLI_SCAN_NEON 1
+#endif
+
+/*
+ * The word-at-a-time scanners mark the bytes of interest in the high bit of
+ * every byte of a word. Only the low seven bits take part in the additions,
+ * so no carry crosses into the next byte and the marks are exact.
+ */
+
+typedef size_t Word;
+
+#define ONES ((Word)-1 / 0xFF) // 0x01 in every byte
+#define HIGHS (ONES * 0x80)    // 0x80 in every byte
+
+enum {
+  ASCII_TAB = '\t',             // First whitespace character
+  ASCII_CARRIAGE_RETURN = '\r', // Last of the whitespace characters following TAB
+  ASCII_SPACE = ' ',            // First plain character
+  ASCII_QUOTE = '\"',           // Groups an argument
+  ASCII_DEL = 127,              // Only control character above the plain ones
+};
+
+static inline bool isControl(unsigned char ch) { return (ch < ASCII_SPACE) || (ASCII_DEL == ch); }
+
+static inline bool isDelimiter(unsigned char ch) {
+  return ((ch >= ASCII_TAB) && (ch <= ASCII_CARRIAGE_RETURN)) || (ASCII_SPACE == ch) || (ASCII_QUOTE == ch);
+}
+
+size_t SerialCLI_ScanControlScalar(const char *str, size_t length) {
+  size_t i = 0;
+  while ((i < length) && !isControl((unsigned char)str[i])) {
+    ++i;
+  }
+  return i;
+}
+
+size_t SerialCLI_ScanDelimiterScalar(const char *str, size_t length) {
+  size_t i = 0;
+  while ((i < length) && !isDelimiter((unsigned char)str[i])) {
+    ++i;
+  }
+  return i;
+}
+
+static inline Word loadWord(const char *str) {
+  Word word;
+  memcpy(&word, str, sizeof(word));
+  return word;
+}
+
+// Marks the bytes below limit, which is at most 0x80
+static inline Word markBelow(Word word, unsigned limit) {
+  return ~(((word & ~HIGHS) + (ONES * (0x80U - limit))) | word) & HIGHS;
+}
+
+static inline Word markEqual(Word word, unsigned char ch) { return markBelow(word ^ (ONES * ch), 1); }
+
+static inline size_t getFirstMarked(Word marks) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+  return (size_t)__builtin_ctzll((unsigned long long)marks) / 8;
+#else
+  return ((size_t)__builtin_clzll((unsigned long long)marks) - ((sizeof(unsigned long long) - sizeof(Word)) * 8)) / 8;
+#endif
+}
+
+static inline Word markControl(Word word) { return markBelow(word, ASCII_SPACE) | markEqual(word, ASCII_DEL); }
+
+static inline Word markDelimiter(Word word) {
+  Word whitespace = markBelow(word, ASCII_CARRIAGE_RETURN + 1) & ~markBelow(word, ASCII_TAB);
+  return whitespace | markEqual(word, ASCII_SPACE) | markEqual(word, ASCII_QUOTE);
+}
+
+size_t SerialCLI_ScanControlSwar(const char *str, size_t length) {
+  size_t i = 0;
+  for (; (i + sizeof(Word)) <= length; i += sizeof(Word)) {
+    Word marks = markControl(loadWord(&str[i]));
+    if (0U != marks) {
+      return i + getFirstMarked(marks);
+    }
+  }
+  return i + SerialCLI_ScanControlScalar(&str[i], length - i);
+}
+
+size_t SerialCLI_ScanDelimiterSwar(const char *str, size_t length) {
+  size_t i = 0;
+  for (; (i + sizeof(Word)) <= length; i += sizeof(Word)) {
+    Word marks = markDelimiter(loadWord(&str[i]));
+    if (0U != marks) {
+      return i + getFirstMarked(marks);
+    }
+  }
+  return i + SerialCLI_ScanDelimiterScalar(&str[i], length - i);
+}
+
+#if SERIAL_CLI_SCAN_SSE2
+
+enum {
+  VECTOR_SIZE = 16, // Bytes compared at once
+};
+
+static inline __m128i loadVector(const char *str) { return _mm_loadu_si128((const __m128i *)(const void *)str); }
+
+// Unsigned comparison, SSE2 only compares signed bytes
+static inline __m128i compareAtMost(__m128i bytes, char limit) {
+  return _mm_cmpeq_epi8(_mm_min_epu8(bytes, _mm_set1_epi8(limit)), bytes);
+}
+
+size_t SerialCLI_ScanControl(const char *str, size_t length) {
+  size_t i = 0;
+  for (; (i + VECTOR_SIZE) <= length; i += VECTOR_SIZE) {
+    __m128i bytes = loadVector(&str[i]);
+    __m128i matches =
+        _mm_or_si128(compareAtMost(bytes, ASCII_SPACE - 1), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(ASCII_DEL)));
+    unsigned mask = (unsigned)_mm_movemask_epi8(matches);
+    if (0U != mask) {
+      return i + (size_t)__builtin_ctz(mask);
+    }
+  }
+  return i + SerialCLI_ScanControlSwar(&str[i], length - i);
+}
+
+size_t SerialCLI_ScanDelimiter(const char *str, size_t length) {
+  size_t i = 0;
+  for (; (i + VECTOR_SIZE) <= length; i += VECTOR_SIZE) {
+    __m128i bytes = loadVector(&str[i]);
+    __m128i whitespace =
+        compareAtMost(_mm_sub_epi8(bytes, _mm_set1_epi8(ASCII_TAB)), ASCII_CARRIAGE_RETURN - ASCII_TAB);
+    __m128i matches = _mm_or_si128(whitespace, _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(ASCII_SPACE)),
+                                                            _mm_cmpeq_epi8(bytes, _mm_set1_epi8(ASCII_QUOTE))));
+    unsigned mask = (unsigned)_mm_movemask_epi8(matches);
+    if (0U != mask) {
+      return i + (size_t)__builtin_ctz(mask);
+    }
+  }
+  return i + SerialCLI_ScanDelimiterSwar(&str[i], length - i);
+}
+
+#elif SERIAL_CLI_SCAN_NEON
+
+enum {
+  VECTOR_SIZE = 16, // Bytes compared at once
+};
+
+// Four bits per byte, NEON has no movemask
+static inline uint64_t getMask(uint8x16_t matches) {
+  uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+size_t SerialCLI_ScanControl(const char *str, size_t length) {
+  size_t i = 0;
+  for (; (i + VECTOR_SIZE) <= length; i += VECTOR_SIZE) {
+    uint8x16_t bytes = vld1q_u8((const uint8_t *)&str[i]);
+    uint8x16_t matches = vorrq_u8(vcltq_u8(bytes, vdupq_n_u8(ASCII_SPACE)), vceqq_u8(bytes, vdupq_n_u8(ASCII_DEL)));
+    uint64_t mask = getMask(matches);
+    if (0U != mask) {
+      return i + (size_t)(__builtin_ctzll(mask) / 4);
+    }
+  }
+  return i + SerialCLI_ScanControlSwar(&str[i], length - i);
+}
+
+size_t SerialCLI_ScanDelimiter(const char *str, size_t length) {
+  size_t i = 0;
+  for (; (i + VECTOR_SIZE) <= length; i += VECTOR_SIZE) {
+    uint8x16_t bytes = vld1q_u8((const uint8_t *)&str[i]);
+    uint8x16_t whitespace =
+        vcleq_u8(vsubq_u8(bytes, vdupq_n_u8(ASCII_TAB)), vdupq_n_u8(ASCII_CARRIAGE_RETURN - ASCII_TAB));
+    uint8x16_t matches = vorrq_u8(
+        whitespace, vorrq_u8(vceqq_u8(bytes, vdupq_n_u8(ASCII_SPACE)), vceqq_u8(bytes, vdupq_n_u8(ASCII_QUOTE))));
+    uint64_t mask = getMask(matches);
+    if (0U != mask) {
+      return i + (size_t)(__builtin_ctzll(mask) / 4);
+    }
+  }
+  return i + SerialCLI_ScanDelimiterSwar(&str[i], length - i);
+}
+
+#else
+
+size_t SerialCLI_ScanControl(const char *str, size_t length) { return SerialCLI_ScanControlSwar(str, length); }
+
+size_t SerialCLI_ScanDelimiter(const char *str, size_t length) { return SerialCLI_ScanDelimiterSwar(str, length); }
+
+#endif
@@ -0,0 +1,105 @@
+#include "serial_cli_internal.h"
+
+#include <string.h>
+
+#if SERIAL_CLI_ENABLE_TRACE
+
+/*
+ * traceHead counts the claimed records, record n lives in slot n & traceMask.
+ * The ring stays set after stopping so it can still be dumped.
+ */
+
+static SerialCLI_TraceRecord *traceRing = NULL;
+static size_t traceMask = 0;
+static size_t traceHead = 0;
+static SerialCLI_TraceClock traceClock = NULL;
+static void *traceClockContext = NULL;
+static bool isTracing = false;
+static uint32_t traceInstanceCount = 0;
+
+uint32_t SerialCLI_TraceNextInstance(void) { return SERIAL_CLI_FETCH_ADD(&traceInstanceCount, 1) + 1; }
+
+void SerialCLI_TraceWrite(uint32_t instance, uint16_t event, uint32_t payload) {
+  if (!SERIAL_CLI_LOAD_ACQUIRE(&isTracing)) {
+    return;
+  }
+
+  size_t index = SERIAL_CLI_FETCH_ADD(&traceHead, 1);
+  SerialCLI_TraceRecord *record = &traceRing[index & traceMask];
+  record->timestamp = traceClock(traceClockContext);
+  record->event = event;
+  record->payload = payload;
+  record->instance = instance;
+  SERIAL_CLI_STORE_RELEASE(&record->sequence, (uint16_t)index);
+}
+
+bool SerialCLI_TraceStart(SerialCLI_TraceRecord *ring, size_t recordCount, SerialCLI_TraceClock clock,
+                          void *context) {
+  bool isPowerOfTwo = (recordCount > 0) && (0 == (recordCount & (recordCount - 1)));
+  if ((NULL == ring) || !isPowerOfTwo || (NULL == clock)) {
+    return false;
+  }
+
+  SERIAL_CLI_STORE_RELEASE(&isTracing, false);
+  // No slot holds the sequence of its first record before it is written
+  for (size_t i = 0; i < recordCount; ++i) {
+    memset(&ring[i], 0, sizeof(ring[i]));
+    ring[i].sequence = (uint16_t)(i + 1);
+  }
+  traceRing = ring;
+  traceMask = recordCount - 1;
+  traceHead = 0;
+  traceClock = clock;
+  traceClockContext = context;
+  SERIAL_CLI_STORE_RELEASE(&isTracing, true);
+  return true;
+}
+
+bool SerialCLI_TraceStop(void) {
+  if (!SERIAL_CLI_LOAD_ACQUIRE(&isTracing)) {
+    return false;
+  }
+
+  SERIAL_CLI_STORE_RELEASE(&isTracing, false);
+  return true;
+}
+
+size_t SerialCLI_TraceDump(SerialCLI_TraceRecord *records, size_t maxCount) {
+  if ((NULL == records) || (NULL == traceRing)) {
+    return 0;
+  }
+
+  size_t head = SERIAL_CLI_LOAD_ACQUIRE(&traceHead);
+  size_t count = (head < (traceMask + 1)) ? head : (traceMask + 1);
+  count = (count < maxCount) ? count : maxCount;
+
+  size_t copied = 0;
+  for (size_t index = head - count; index != head; ++index) {
+    const SerialCLI_TraceRecord *record = &traceRing[index & traceMask];
+    if ((uint16_t)index == SERIAL_CLI_LOAD_ACQUIRE(&record->sequence)) {
+      records[copied++] = *record;
+    }
+  }
+  return copied;
+}
+
+#else
+
+bool SerialCLI_TraceStart(SerialCLI_TraceRecord *ring, size_t recordCount, SerialCLI_TraceClock clock,
+                          void *context) {
+  (void)ring;
+  (void)recordCount;
+  (void)clock;
+  (void)context;
+  return false;
+}
+
+bool SerialCLI_TraceStop(void) { return false; }
+
+size_t SerialCLI_TraceDump(SerialCLI_TraceRecord *records, size_t maxCount) {
+  (void)records;
+  (void)maxCount;
+  return 0;
+}
+
+#endif
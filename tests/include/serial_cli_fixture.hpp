@@ -1,10 +1,45 @@
 #include <gtest/gtest.h>
 
-#include "serial_cli.h"
+#include <string>
+#include <vector>
+
+#include "serial_cli.hpp"
+#include "serial_cli_rpc.h"
+
+/**
+ * Default sized buffers for an instance under test.
+ *
+ * get() returns NULL when the embedded buffers are compiled in, so the suites
+ * cover SerialCLI_InitWithContext and the embedded storage there, and the
+ * caller provided storage in builds without SERIAL_CLI_EMBEDDED_STORAGE.
+ */
+struct SerialCLITestStorage : serial_cli::DefaultStorage {
+  const SerialCLI_Storage *get() const { return SERIAL_CLI_EMBEDDED_STORAGE ? nullptr : &storage; }
+};
+
+// Initializes like SerialCLI_InitWithContext, on the test's buffers in builds without the embedded ones
+inline bool initTestInstance(SerialCLI *cli, const SerialCLITestStorage &storage, SerialCLI_ContextWrite write,
+                             void *context) {
+  if (nullptr == storage.get()) {
+    return SerialCLI_InitWithContext(cli, write, context);
+  }
+  return SerialCLI_InitWithStorage(cli, storage.get(), write, context);
+}
+
+// Encodes an RPC request from a text style argv, an unknown command name gets an ID no command has
+inline size_t encodeRpcRequest(SerialCLI *cli, char *frame, size_t frameSize, uint16_t requestId,
+                               std::vector<const char *> argv) {
+  uint32_t commandId = SERIAL_CLI_RPC_LIST_COMMANDS - 1;
+  (void)SerialCLI_RpcGetCommandId(cli, argv[0], &commandId);
+  return SerialCLI_RpcEncodeRequest(frame, frameSize, requestId, commandId, (int)argv.size() - 1, &argv[1]);
+}
 
 class SerialCLITest : public ::testing::Test {
 public:
   SerialCLI cli;
+  SerialCLITestStorage storage;
+  static inline std::string output;
+  static inline size_t writeCount = 0;
 
   void process() {
     // Processes enough times to handle a full command and any extra input
@@ -22,7 +57,15 @@ public:
 
 protected:
   void SetUp() override {
-    SerialCLI_Init(&cli, [](const char *, size_t) {});
+    output.clear();
+    writeCount = 0;
+    initTestInstance(
+        &cli, storage,
+        [](void *, const char *str, size_t len) {
+          output.append(str, len);
+          ++writeCount;
+        },
+        nullptr);
   }
 
   void TearDown() override { SerialCLI_Deinit(&cli); }
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "serial_cli_fixture.hpp"
+
+namespace {
+
+std::vector<SerialCLI_LineStatus> statuses;
+
+void setCommand(SerialCLI *cli, int argc, const char **argv) {
+  if (argc != 3) {
+    SerialCLI_WriteString(cli, "usage");
+    SerialCLI_FailCommand(cli);
+    return;
+  }
+  SerialCLI_WriteString(cli, "%s=%s;", argv[1], argv[2]);
+}
+
+// Writes a tick per continuation call and fails after the third one
+void slowCommand(SerialCLI *cli, int, const char **) {
+  static int ticks;
+  ticks = 0;
+  SerialCLI_Defer(
+      cli,
+      [](SerialCLI *cli, void *, bool isCancelled) -> bool {
+        if (isCancelled) {
+          return true;
+        }
+        SerialCLI_WriteString(cli, "tick;");
+        if (++ticks < 3) {
+          return false;
+        }
+        SerialCLI_FailCommand(cli);
+        return true;
+      },
+      nullptr);
+}
+
+bool isReleased = false;
+
+// Waits silently until the test releases it
+void waitCommand(SerialCLI *cli, int, const char **) {
+  SerialCLI_Defer(
+      cli, [](SerialCLI *, void *, bool isCancelled) -> bool { return isCancelled || isReleased; }, nullptr);
+}
+
+void recordStatus(void *, SerialCLI_LineStatus status) { statuses.push_back(status); }
+
+} // namespace
+
+class SerialCLIBatchTest : public SerialCLITest {
+public:
+  SerialCLI_CommandEntry commandEntry{};
+  SerialCLI_CommandEntry slowEntry{};
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    statuses.clear();
+    commandEntry.commandName = "set";
+    commandEntry.command = setCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+    slowEntry.commandName = "slow";
+    slowEntry.command = slowCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &slowEntry));
+    output.clear();
+  }
+};
+
+TEST_F(SerialCLIBatchTest, BatchMode) {
+  ASSERT_TRUE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_BATCH));
+  output.clear();
+
+  // Only the command output reaches the link, no echo, line break or prompt
+  writeString("set a 1\r\nset b\t2\n");
+  process();
+  EXPECT_EQ(output, "a=1;b=2;");
+
+  ASSERT_TRUE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_TEXT));
+  EXPECT_EQ(output, "a=1;b=2;\r\n>> ");
+}
+
+TEST_F(SerialCLIBatchTest, LineResults) {
+  ASSERT_TRUE(SerialCLI_SetLineResultCallback(&cli, recordStatus, nullptr));
+  writeString("set a 1\r\rget\rset a\rset 1 2 3 4 5 6 7 8\r");
+  process();
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK, SERIAL_CLI_LINE_UNKNOWN_COMMAND,
+                                                         SERIAL_CLI_LINE_COMMAND_FAILED,
+                                                         SERIAL_CLI_LINE_TOO_MANY_ARGUMENTS}));
+  EXPECT_FALSE(SerialCLI_SetLineResultCallback(nullptr, recordStatus, nullptr));
+  EXPECT_FALSE(SerialCLI_FailCommand(nullptr));
+}
+
+TEST_F(SerialCLIBatchTest, ExecuteBatch) {
+  ASSERT_TRUE(SerialCLI_SetLineResultCallback(&cli, recordStatus, nullptr));
+  std::string script = "set a 1\n\nset b\r\nget\r\n" + std::string(SERIAL_CLI_INPUT_BUFFER_SIZE, 'x') + "\nset c 3";
+
+  SerialCLI_BatchResult result;
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), false, &result));
+  EXPECT_EQ(result.lineCount, 5U);
+  EXPECT_EQ(result.failedCount, 3U);
+  EXPECT_EQ(result.firstFailedLine, 3U);
+  EXPECT_EQ(result.firstFailedStatus, SERIAL_CLI_LINE_COMMAND_FAILED);
+  EXPECT_EQ(statuses.size(), 5U);
+  EXPECT_EQ(statuses[3], SERIAL_CLI_LINE_TOO_LONG);
+
+  // The previous mode and the prompt are back after the batch
+  EXPECT_EQ(cli.mode, SERIAL_CLI_MODE_TEXT);
+  EXPECT_EQ(output, "a=1;usagec=3;\r\n>> ");
+}
+
+TEST_F(SerialCLIBatchTest, StopOnError) {
+  std::string script = "set a 1\nget\nset b 2\n";
+
+  SerialCLI_BatchResult result;
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), true, &result));
+  EXPECT_EQ(result.lineCount, 2U);
+  EXPECT_EQ(result.firstFailedLine, 2U);
+  EXPECT_EQ(result.firstFailedStatus, SERIAL_CLI_LINE_UNKNOWN_COMMAND);
+  EXPECT_EQ(output.find("b=2"), std::string::npos);
+
+  script = "set a 1\r\nset b 2";
+  EXPECT_TRUE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), true, nullptr));
+
+  ASSERT_TRUE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_RPC));
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), true, nullptr));
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(nullptr, script.data(), script.size(), true, nullptr));
+}
+
+TEST_F(SerialCLIBatchTest, DeferredCommand) {
+  // The deferred command completes before its result is checked and the next line is read
+  std::string script = "slow\nset a 1\n";
+  SerialCLI_BatchResult result;
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), true, &result));
+  EXPECT_EQ(result.lineCount, 1U);
+  EXPECT_EQ(result.failedCount, 1U);
+  EXPECT_EQ(result.firstFailedLine, 1U);
+  EXPECT_EQ(result.firstFailedStatus, SERIAL_CLI_LINE_COMMAND_FAILED);
+  EXPECT_FALSE(SerialCLI_IsCommandRunning(&cli));
+  EXPECT_EQ(cli.mode, SERIAL_CLI_MODE_TEXT);
+  EXPECT_EQ(output, "tick;tick;tick;\r\n>> ");
+
+  script = "set a 1\nslow\nset b 2";
+  output.clear();
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), false, &result));
+  EXPECT_EQ(result.lineCount, 3U);
+  EXPECT_EQ(result.firstFailedLine, 2U);
+  EXPECT_EQ(output, "a=1;tick;tick;tick;b=2;\r\n>> ");
+}
+
+TEST_F(SerialCLIBatchTest, StalledCommand) {
+  SerialCLI_CommandEntry waitEntry{};
+  waitEntry.commandName = "wait";
+  waitEntry.command = waitCommand;
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &waitEntry));
+
+  // A command waiting for an event is cancelled and stops the batch instead of hanging it
+  isReleased = false;
+  std::string script = "wait\nset a 1\n";
+  SerialCLI_BatchResult result;
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), false, &result));
+  EXPECT_TRUE(result.isStalled);
+  EXPECT_EQ(result.lineCount, 1U);
+  EXPECT_EQ(result.firstFailedLine, 1U);
+  EXPECT_EQ(result.firstFailedStatus, SERIAL_CLI_LINE_CANCELLED);
+  EXPECT_FALSE(SerialCLI_IsCommandRunning(&cli));
+  EXPECT_EQ(cli.mode, SERIAL_CLI_MODE_TEXT);
+  EXPECT_EQ(output.find("a=1;"), std::string::npos);
+
+  // Commands that complete run as before
+  isReleased = true;
+  script = "wait\nset b 2";
+  output.clear();
+  EXPECT_TRUE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), true, &result));
+  EXPECT_FALSE(result.isStalled);
+  EXPECT_EQ(result.lineCount, 2U);
+  EXPECT_NE(output.find("b=2;"), std::string::npos);
+}
+
+TEST_F(SerialCLIBatchTest, BlockedTransport) {
+  static char txRing[SERIAL_CLI_TX_BUFFER_SIZE];
+  SerialCLI_Deinit(&cli);
+  ASSERT_TRUE(SerialCLI_InitNonBlocking(
+      &cli, storage.get(), [](void *, const char *, size_t) -> size_t { return 0; }, nullptr, txRing, sizeof(txRing)));
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+
+  // The prompt the transport never takes leaves no room for the output of a line
+  ASSERT_TRUE(SerialCLI_IsTxBlocked(&cli));
+  std::string script = "set a 1";
+  SerialCLI_BatchResult result;
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), true, &result));
+  EXPECT_TRUE(result.isStalled);
+  EXPECT_EQ(result.lineCount, 0U);
+  EXPECT_TRUE(SerialCLI_IsCommandPending(&cli));
+}
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "serial_cli_capture.h"
+#include "serial_cli_fixture.hpp"
+
+namespace {
+
+void echoCommand(SerialCLI *cli, int argc, const char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    SerialCLI_WriteString(cli, "%s\r\n", argv[i]);
+  }
+}
+
+int count;
+
+// Writes one line per continuation call
+bool countTick(SerialCLI *cli, void *, bool isCancelled) {
+  if (isCancelled) {
+    return true;
+  }
+  SerialCLI_WriteString(cli, "tick %d\r\n", ++count);
+  return count == 3;
+}
+
+void countCommand(SerialCLI *cli, int, const char **) {
+  count = 0;
+  SerialCLI_Defer(cli, countTick, nullptr);
+}
+
+// Takes far longer than the recording for the same output
+void slowCountCommand(SerialCLI *cli, int, const char **) {
+  count = 0;
+  SerialCLI_Defer(
+      cli,
+      [](SerialCLI *cli, void *state, bool isCancelled) -> bool {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return countTick(cli, state, isCancelled);
+      },
+      nullptr);
+}
+
+} // namespace
+
+class SerialCLICaptureTest : public SerialCLITest {
+public:
+  SerialCLI replayCli;
+  SerialCLITestStorage replayStorage;
+  static inline std::string replayOutput;
+  SerialCLI_CommandEntry echoEntries[2]{};
+  SerialCLI_CommandEntry countEntries[2]{};
+  SerialCLI_Capture capture;
+  std::string path;
+
+  void setUpInstance(SerialCLI *instance, size_t index, SerialCLI_Command echo) {
+    echoEntries[index].commandName = "echo";
+    echoEntries[index].command = echo;
+    countEntries[index].commandName = "count";
+    countEntries[index].command = countCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(instance, &echoEntries[index]));
+    ASSERT_TRUE(SerialCLI_RegisterCommand(instance, &countEntries[index]));
+  }
+
+  // Records the lines typed into the fixture instance
+  void record(const std::vector<std::string> &lines) {
+    ASSERT_TRUE(SerialCLI_CaptureOpen(&capture, &cli, path.c_str()));
+    output.clear();
+    for (const auto &line : lines) {
+      writeString(line);
+      process();
+    }
+    ASSERT_TRUE(SerialCLI_CaptureClose(&capture));
+  }
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    setUpInstance(&cli, 0, echoCommand);
+    replayOutput.clear();
+    initTestInstance(
+        &replayCli, replayStorage, [](void *, const char *str, size_t len) { replayOutput.append(str, len); },
+        nullptr);
+    path = "/tmp/serial_cli_capture." + std::to_string(getpid());
+  }
+
+  void TearDown() override {
+    SerialCLI_Deinit(&replayCli);
+    unlink(path.c_str());
+    SerialCLITest::TearDown();
+  }
+};
+
+TEST_F(SerialCLICaptureTest, RoundTrip) {
+  record({"echo a b\r", "count\r", "unknown\r", "help count\r"});
+  EXPECT_GT(capture.recordCount, 0U);
+
+  std::vector<SerialCLI_LineStatus> statuses;
+  SerialCLI_SetLineResultCallback(
+      &replayCli,
+      [](void *context, SerialCLI_LineStatus status) {
+        static_cast<std::vector<SerialCLI_LineStatus> *>(context)->push_back(status);
+      },
+      &statuses);
+  setUpInstance(&replayCli, 1, echoCommand);
+  replayOutput.clear();
+
+  SerialCLI_ReplayResult result;
+  ASSERT_TRUE(SerialCLI_Replay(&replayCli, path.c_str(), false, &result));
+  EXPECT_EQ(replayOutput, output);
+  EXPECT_NE(replayOutput.find("tick 3\r\n"), std::string::npos);
+  EXPECT_EQ(result.inputBytes, std::string("echo a b\rcount\runknown\rhelp count\r").size());
+  EXPECT_EQ(result.outputBytes, output.size());
+  EXPECT_EQ(result.expectedOutputBytes, output.size());
+  EXPECT_EQ(result.mismatchOffset, SIZE_MAX);
+  EXPECT_EQ(result.lineCount, 4U);
+  EXPECT_LE(result.latencyMaxUs, result.latencyTotalUs);
+
+  // The user callback keeps receiving the outcomes and is restored afterwards
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK, SERIAL_CLI_LINE_OK,
+                                                         SERIAL_CLI_LINE_UNKNOWN_COMMAND, SERIAL_CLI_LINE_OK}));
+  EXPECT_EQ(replayCli.lineResultContext, &statuses);
+  EXPECT_EQ(replayCli.monitor, nullptr);
+
+  size_t bucketTotal = 0;
+  for (size_t count : result.latencyHistogram) {
+    bucketTotal += count;
+  }
+  EXPECT_EQ(bucketTotal, 4U);
+  EXPECT_LE(SerialCLI_ReplayGetPercentile(&result, 50), SerialCLI_ReplayGetPercentile(&result, 100));
+  EXPECT_EQ(SerialCLI_ReplayGetPercentile(&result, 100), result.latencyMaxUs);
+  EXPECT_EQ(SerialCLI_ReplayGetPercentile(&result, 0), 0U);
+}
+
+TEST_F(SerialCLICaptureTest, Mismatch) {
+  record({"count\r", "echo a\r", "echo b\r"});
+
+  // The replayed instance answers differently from the second line on
+  setUpInstance(&replayCli, 1, [](SerialCLI *cli, int, const char **) { SerialCLI_WriteString(cli, "changed\r\n"); });
+  replayOutput.clear();
+
+  SerialCLI_ReplayResult result;
+  EXPECT_FALSE(SerialCLI_Replay(&replayCli, path.c_str(), false, &result));
+  auto difference = std::mismatch(output.begin(), output.end(), replayOutput.begin(), replayOutput.end());
+  size_t firstDifference = (size_t)(difference.first - output.begin());
+  EXPECT_EQ(result.mismatchOffset, firstDifference);
+  EXPECT_EQ(result.lineCount, 3U);
+
+  // Missing output is a mismatch at its end
+  ASSERT_TRUE(SerialCLI_SetFlushPolicy(&replayCli, SERIAL_CLI_FLUSH_EXPLICIT, 0));
+  EXPECT_FALSE(SerialCLI_Replay(&replayCli, path.c_str(), false, &result));
+  EXPECT_EQ(result.outputBytes, 0U);
+  EXPECT_EQ(result.mismatchOffset, 0U);
+}
+
+TEST_F(SerialCLICaptureTest, Pacing) {
+  ASSERT_TRUE(SerialCLI_CaptureOpen(&capture, &cli, path.c_str()));
+  writeString("echo a\r");
+  process();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  writeString("echo b\r");
+  process();
+  ASSERT_TRUE(SerialCLI_CaptureClose(&capture));
+
+  setUpInstance(&replayCli, 1, echoCommand);
+  SerialCLI_ReplayResult result;
+  ASSERT_TRUE(SerialCLI_Replay(&replayCli, path.c_str(), true, &result));
+  EXPECT_GE(result.elapsedUs, 50000U);
+
+  // As fast as possible the recorded gap is skipped
+  ASSERT_TRUE(SerialCLI_Replay(&replayCli, path.c_str(), false, &result));
+  EXPECT_LT(result.elapsedUs, 50000U);
+}
+
+TEST_F(SerialCLICaptureTest, SlowerThanRecorded) {
+  record({"echo a\r", "count\r"});
+
+  // The output of the slower command is waited for, the recorded gaps do not matter
+  setUpInstance(&replayCli, 1, echoCommand);
+  countEntries[1].command = slowCountCommand;
+  replayOutput.clear();
+
+  SerialCLI_ReplayResult result;
+  ASSERT_TRUE(SerialCLI_Replay(&replayCli, path.c_str(), false, &result));
+  EXPECT_EQ(replayOutput, output);
+  EXPECT_EQ(result.lineCount, 2U);
+}
+
+TEST_F(SerialCLICaptureTest, InvalidCapture) {
+  record({"echo a\r"});
+
+  // A truncated record fails after the complete ones
+  ASSERT_EQ(truncate(path.c_str(), 10), 0);
+  SerialCLI_ReplayResult result;
+  EXPECT_FALSE(SerialCLI_Replay(&replayCli, path.c_str(), false, &result));
+  EXPECT_EQ(result.inputBytes, 0U);
+
+  ASSERT_EQ(truncate(path.c_str(), 0), 0);
+  EXPECT_FALSE(SerialCLI_Replay(&replayCli, path.c_str(), false, nullptr));
+  EXPECT_FALSE(SerialCLI_Replay(&replayCli, "/nonexistent/capture", false, nullptr));
+  EXPECT_FALSE(SerialCLI_Replay(nullptr, path.c_str(), false, nullptr));
+  EXPECT_FALSE(SerialCLI_CaptureOpen(&capture, &cli, "/nonexistent/capture"));
+  EXPECT_FALSE(SerialCLI_CaptureOpen(nullptr, &cli, path.c_str()));
+  EXPECT_FALSE(SerialCLI_CaptureFlush(nullptr));
+  EXPECT_FALSE(SerialCLI_CaptureClose(&capture));
+  EXPECT_EQ(SerialCLI_ReplayGetPercentile(nullptr, 50), 0U);
+}
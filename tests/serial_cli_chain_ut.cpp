@@ -0,0 +1,281 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "serial_cli_fixture.hpp"
+
+namespace {
+
+std::vector<SerialCLI_LineStatus> statuses;
+int tickCount;
+
+void echoCommand(SerialCLI *cli, int argc, const char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    SerialCLI_WriteString(cli, "%s\r\n", argv[i]);
+  }
+}
+
+void failCommand(SerialCLI *cli, int, const char **) { SerialCLI_FailCommand(cli); }
+
+// The last line has no line ending
+void linesCommand(SerialCLI *cli, int, const char **) { SerialCLI_WriteString(cli, "one\r\ntwo\r\nthree\r\nfour"); }
+
+// Writes every line in pieces
+void piecesCommand(SerialCLI *cli, int, const char **) {
+  for (const char *piece : {"al", "pha\r", "\nbe", "ta\r\ngam", "ma\r\n"}) {
+    SerialCLI_WriteBytes(cli, piece, strlen(piece));
+  }
+}
+
+// Writes one line per continuation call
+void tickCommand(SerialCLI *cli, int, const char **) {
+  tickCount = 0;
+  SerialCLI_Defer(
+      cli,
+      [](SerialCLI *cli, void *, bool isCancelled) -> bool {
+        if (isCancelled) {
+          return true;
+        }
+        SerialCLI_WriteString(cli, "tick %d\r\n", ++tickCount);
+        return 3 == tickCount;
+      },
+      nullptr);
+}
+
+void recordStatus(void *, SerialCLI_LineStatus status) { statuses.push_back(status); }
+
+} // namespace
+
+class SerialCLIChainTest : public SerialCLITest {
+public:
+  SerialCLI_CommandEntry commands[5]{};
+
+  // Types a line and returns the output after its echo
+  std::string run(const std::string &line) {
+    writeString(line + "\r");
+    output.clear();
+    process();
+    return output;
+  }
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    statuses.clear();
+    const std::pair<const char *, SerialCLI_Command> definitions[] = {
+        {"echo", echoCommand}, {"fail", failCommand}, {"lines", linesCommand},
+        {"pieces", piecesCommand}, {"tick", tickCommand}};
+    for (size_t i = 0; i < std::size(definitions); ++i) {
+      commands[i].commandName = definitions[i].first;
+      commands[i].command = definitions[i].second;
+      ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commands[i]));
+    }
+    ASSERT_TRUE(SerialCLI_SetLineResultCallback(&cli, recordStatus, nullptr));
+    output.clear();
+  }
+};
+
+TEST_F(SerialCLIChainTest, Sequence) {
+  // One line break after the echo and one prompt after the last command
+  EXPECT_EQ(run("echo a ; fail ; echo b"), "\r\na\r\nb\r\n\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK, SERIAL_CLI_LINE_COMMAND_FAILED,
+                                                         SERIAL_CLI_LINE_OK}));
+
+  // Empty commands are skipped
+  statuses.clear();
+  EXPECT_EQ(run("; echo a ; ; ;"), "\r\na\r\n\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK}));
+  EXPECT_FALSE(SerialCLI_IsCommandPending(&cli));
+}
+
+TEST_F(SerialCLIChainTest, OneCommandPerProcess) {
+  writeString("echo a ; echo b\recho c\r");
+  output.clear();
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_EQ(output, "\r\na\r\n");
+  EXPECT_TRUE(SerialCLI_IsCommandPending(&cli));
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_EQ(output, "\r\na\r\nb\r\n\r\n>> ");
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_EQ(output, "\r\na\r\nb\r\n\r\n>> \r\nc\r\n\r\n>> ");
+  EXPECT_FALSE(SerialCLI_IsCommandPending(&cli));
+}
+
+TEST_F(SerialCLIChainTest, And) {
+  EXPECT_EQ(run("echo a && echo b"), "\r\na\r\nb\r\n\r\n>> ");
+
+  // A failure skips the commands up to the next `;`
+  statuses.clear();
+  EXPECT_EQ(run("fail && echo a && echo b ; echo c"), "\r\nc\r\n\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_COMMAND_FAILED, SERIAL_CLI_LINE_OK}));
+
+  statuses.clear();
+  EXPECT_EQ(run("unknown && echo a"), "\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_UNKNOWN_COMMAND}));
+
+  // Each line starts afresh
+  statuses.clear();
+  EXPECT_EQ(run("fail"), "\r\n\r\n>> ");
+  EXPECT_EQ(run("echo a && echo b"), "\r\na\r\nb\r\n\r\n>> ");
+}
+
+TEST_F(SerialCLIChainTest, QuotedOperatorsAreArguments) {
+  EXPECT_EQ(run("echo \";\" \"a && b\" x|y a;"), "\r\n;\r\na && b\r\nx|y\r\na;\r\n\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK}));
+
+  // An unterminated quote runs to the end of the line
+  EXPECT_EQ(run("echo \"a ; echo b"), "\r\na ; echo b\r\n\r\n>> ");
+}
+
+TEST_F(SerialCLIChainTest, CancelDropsRest) {
+  writeString("tick ; echo a\r");
+  output.clear();
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  writeString("\x03");
+  process();
+  EXPECT_EQ(output, "\r\ntick 1\r\n^C\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_CANCELLED}));
+  EXPECT_FALSE(SerialCLI_IsCommandPending(&cli));
+
+  // Between commands that return at once Ctrl+C drops the rest as well
+  writeString("echo a ; echo b\r");
+  output.clear();
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  writeString("\x03");
+  process();
+  EXPECT_EQ(output, "\r\na\r\n^C\r\n>> ");
+  EXPECT_FALSE(SerialCLI_IsCommandPending(&cli));
+
+  EXPECT_EQ(run("echo c"), "\r\nc\r\n\r\n>> ");
+}
+
+TEST_F(SerialCLIChainTest, Batch) {
+  const std::string script = "echo a ; fail ; echo b\necho c && fail && echo d\n";
+  SerialCLI_BatchResult result;
+  EXPECT_FALSE(SerialCLI_ExecuteBatch(&cli, script.data(), script.size(), false, &result));
+  EXPECT_EQ(output, "a\r\nb\r\nc\r\n\r\n>> ");
+  EXPECT_EQ(result.lineCount, 5U);
+  EXPECT_EQ(result.failedCount, 2U);
+  EXPECT_EQ(result.firstFailedLine, 1U);
+}
+
+#if SERIAL_CLI_ENABLE_FILTERS
+
+TEST_F(SerialCLIChainTest, Grep) {
+  EXPECT_EQ(run("lines | grep o"), "\r\none\r\ntwo\r\nfour\r\n>> ");
+  EXPECT_EQ(run("lines | grep -v o"), "\r\nthree\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | grep \"ree\""), "\r\nthree\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | grep x"), "\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | grep t | grep -v w"), "\r\nthree\r\n\r\n>> ");
+  EXPECT_EQ(run("pieces | grep a"), "\r\nalpha\r\nbeta\r\ngamma\r\n\r\n>> ");
+  EXPECT_EQ(run("pieces | grep et"), "\r\nbeta\r\n\r\n>> ");
+  EXPECT_EQ(statuses, std::vector<SerialCLI_LineStatus>(7, SERIAL_CLI_LINE_OK));
+}
+
+TEST_F(SerialCLIChainTest, HeadAndCount) {
+  EXPECT_EQ(run("lines | head 2"), "\r\none\r\ntwo\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | head 0"), "\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | count"), "\r\n4\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | grep o | count"), "\r\n3\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | head 3 | grep t"), "\r\ntwo\r\nthree\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | count | grep 4"), "\r\n4\r\n\r\n>> ");
+  EXPECT_EQ(run("echo | count"), "\r\n0\r\n\r\n>> ");
+}
+
+TEST_F(SerialCLIChainTest, LongLinesArePieces) {
+  commands[0].command = [](SerialCLI *cli, int, const char **) {
+    std::string line(SERIAL_CLI_FILTER_LINE_SIZE + 10, 'x');
+    line.replace(SERIAL_CLI_FILTER_LINE_SIZE, 3, "end");
+    SerialCLI_WriteBytes(cli, line.data(), line.size());
+    SerialCLI_WriteString(cli, "\r\n");
+  };
+  EXPECT_EQ(run("echo | grep end"), "\r\nendxxxxxxx\r\n\r\n>> ");
+  EXPECT_EQ(run("echo | count"), "\r\n2\r\n\r\n>> ");
+}
+
+TEST_F(SerialCLIChainTest, DeferredCommand) {
+  // The filters stay in place until the command completes, the next command runs afterwards
+  EXPECT_EQ(run("tick | grep 2 ; tick | count"), "\r\ntick 2\r\n3\r\n\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK, SERIAL_CLI_LINE_OK}));
+
+  // A cancelled command still gets its count
+  writeString("tick | count && echo a\r");
+  output.clear();
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  writeString("\x03");
+  process();
+  EXPECT_EQ(output, "\r\n1\r\n^C\r\n>> ");
+  EXPECT_FALSE(SerialCLI_IsCommandPending(&cli));
+}
+
+TEST_F(SerialCLIChainTest, InvalidFilter) {
+  for (const char *line : {"lines | sort", "lines |", "lines | head", "lines | head x", "lines | head -1",
+                           "lines | grep", "lines | grep -x o", "lines | count 1",
+                           "lines | count | count | count | count"}) {
+    statuses.clear();
+    EXPECT_EQ(run(line), "\r\n>> ") << line;
+    EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_INVALID_FILTER})) << line;
+  }
+
+  // The patterns of one command share their storage
+  std::string pattern(SERIAL_CLI_FILTER_PATTERN_SIZE / 2, 'o');
+  EXPECT_EQ(run("lines | grep " + pattern + " | grep -v " + pattern), "\r\n\r\n>> ");
+  EXPECT_EQ(run("lines | grep " + pattern + " | grep -v " + pattern + "o"), "\r\n>> ");
+
+  // Filters without a command are ignored, a rejected command gets no filter output
+  statuses.clear();
+  EXPECT_EQ(run("| count"), "\r\n>> ");
+  EXPECT_EQ(run("unknown | count"), "\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_UNKNOWN_COMMAND}));
+  EXPECT_EQ(run("lines | count"), "\r\n4\r\n\r\n>> ");
+}
+
+TEST_F(SerialCLIChainTest, CallerStorage) {
+  static char inputBuffer[65];
+  static const char *argv[5];
+  static char txBuffer[33];
+  static char filterLine[8];
+  static char filterPatterns[4];
+  SerialCLI_Storage storage{inputBuffer, 64, argv, 4, txBuffer, 32, nullptr, 0, nullptr, 0,
+                            filterLine, sizeof(filterLine), filterPatterns, sizeof(filterPatterns)};
+  auto write = [](void *, const char *str, size_t len) { output.append(str, len); };
+  auto reinit = [&]() {
+    ASSERT_TRUE(SerialCLI_InitWithStorage(&cli, &storage, write, nullptr));
+    for (SerialCLI_CommandEntry &command : commands) {
+      ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &command));
+    }
+    ASSERT_TRUE(SerialCLI_SetLineResultCallback(&cli, recordStatus, nullptr));
+  };
+
+  // Lines longer than the caller's line buffer are filtered in pieces, patterns must fit into theirs
+  reinit();
+  EXPECT_EQ(run("lines | grep o"), "\r\none\r\ntwo\r\nfour\r\n>> ");
+  EXPECT_EQ(run("pieces | grep alpha"), "\r\n>> ");
+  EXPECT_EQ(run("pieces | grep ph"), "\r\nalpha\r\n\r\n>> ");
+  EXPECT_EQ(run("echo abcdefghij | grep j"), "\r\nij\r\n\r\n>> ");
+
+  // An instance without filter buffers rejects every pipe but still chains
+  storage.filterLine = nullptr;
+  storage.filterLineSize = 0;
+  storage.filterPatterns = nullptr;
+  storage.filterPatternSize = 0;
+  reinit();
+  statuses.clear();
+  EXPECT_EQ(run("lines | count ; echo a"), "\r\na\r\n\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_INVALID_FILTER, SERIAL_CLI_LINE_OK}));
+}
+
+#else
+
+TEST_F(SerialCLIChainTest, FiltersDisabled) {
+  EXPECT_EQ(run("lines | count ; echo a"), "\r\na\r\n\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_INVALID_FILTER, SERIAL_CLI_LINE_OK}));
+}
+
+#endif
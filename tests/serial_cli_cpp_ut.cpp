@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "serial_cli.hpp"
+
+namespace {
+
+std::string output;
+size_t writeCount = 0;
+std::vector<std::string> executedArgs;
+
+void write(const char *str, size_t len) {
+  output.append(str, len);
+  ++writeCount;
+}
+
+void recordCommand(SerialCLI *, int argc, const char **argv) {
+  executedArgs.assign(argv, argv + argc);
+}
+
+} // namespace
+
+class SerialCLICppTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    output.clear();
+    writeCount = 0;
+    executedArgs.clear();
+  }
+};
+
+TEST_F(SerialCLICppTest, SmallConsole) {
+  serial_cli::Cli<4, 8, 32> cli(write);
+  ASSERT_TRUE(cli.isInitialized());
+  EXPECT_NE(output.find(">>"), std::string::npos);
+  EXPECT_EQ(SerialCLI_GetContext(cli.get()), &cli);
+
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = recordCommand;
+  commandEntry.commandName = "set";
+  ASSERT_TRUE(cli.registerCommand(commandEntry));
+
+  std::string input = "set a b c\r";
+  EXPECT_TRUE(cli.read(input.data(), input.size()));
+  EXPECT_TRUE(cli.isCommandPending());
+  EXPECT_TRUE(cli.process());
+  EXPECT_EQ(executedArgs, (std::vector<std::string>{"set", "a", "b", "c"}));
+
+  // A fifth argument exceeds MaxArgs
+  executedArgs.clear();
+  input = "set a b c d\r";
+  EXPECT_TRUE(cli.read(input.data(), input.size()));
+  cli.process();
+  EXPECT_TRUE(executedArgs.empty());
+
+  // A line longer than the 40 byte input buffer is dropped
+  input = "set " + std::string(40, 'x') + "\r";
+  EXPECT_FALSE(cli.read(input.data(), input.size()));
+  EXPECT_FALSE(cli.isCommandPending());
+}
+
+TEST_F(SerialCLICppTest, SmallTxBuffer) {
+  serial_cli::Cli<2, 16, 8> cli(write);
+  ASSERT_TRUE(cli.isInitialized());
+  ASSERT_TRUE(cli.setFlushPolicy(SERIAL_CLI_FLUSH_EXPLICIT, 0));
+  EXPECT_FALSE(cli.setFlushPolicy(SERIAL_CLI_FLUSH_ON_HIGH_WATER, 9));
+
+  // Output is handed over in chunks of the TX buffer size
+  output.clear();
+  writeCount = 0;
+  EXPECT_TRUE(cli.writeString("%d%s", 1234, "567"));
+  EXPECT_EQ(writeCount, 0U);
+  EXPECT_TRUE(cli.writeString("89"));
+  EXPECT_EQ(writeCount, 1U);
+  EXPECT_TRUE(cli.flush());
+  EXPECT_EQ(output, "123456789");
+  EXPECT_EQ(writeCount, 2U);
+}
+
+TEST_F(SerialCLICppTest, RxRing) {
+  serial_cli::Cli<4, 8, 32> noRing(write);
+  EXPECT_EQ(noRing.readFromISR("set\r", 4), 0U);
+
+  serial_cli::Cli<4, 8, 32, 0, 0, 16> cli(write);
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = recordCommand;
+  commandEntry.commandName = "set";
+  ASSERT_TRUE(cli.registerCommand(commandEntry));
+
+  std::string input = "set a\rset b\rset c\r";
+  EXPECT_EQ(cli.readFromISR(input.data(), input.size()), 16U);
+  cli.process();
+  EXPECT_EQ(executedArgs, (std::vector<std::string>{"set", "a"}));
+}
+
+TEST_F(SerialCLICppTest, ContextWrite) {
+  std::string sessionOutput;
+  serial_cli::Cli<8, 64, 128> cli(
+      [](void *context, const char *str, size_t len) { static_cast<std::string *>(context)->append(str, len); },
+      &sessionOutput);
+  ASSERT_TRUE(cli.isInitialized());
+  EXPECT_EQ(SerialCLI_GetContext(cli.get()), &sessionOutput);
+  EXPECT_NE(sessionOutput.find(">>"), std::string::npos);
+}
+
+TEST_F(SerialCLICppTest, DefaultStorage) {
+  serial_cli::DefaultStorage storage;
+  SerialCLI cli;
+  ASSERT_TRUE(SerialCLI_InitWithStorage(
+      &cli, &storage.storage, [](void *, const char *str, size_t len) { output.append(str, len); }, nullptr));
+  EXPECT_EQ(cli.inputBufferSize, static_cast<size_t>(SERIAL_CLI_INPUT_BUFFER_SIZE));
+  EXPECT_EQ(cli.historySize, static_cast<size_t>(SERIAL_CLI_HISTORY_SIZE));
+  EXPECT_EQ(cli.rxRingSize, static_cast<size_t>(SERIAL_CLI_RX_RING_SIZE));
+  EXPECT_NE(output.find(">>"), std::string::npos);
+  SerialCLI_Deinit(&cli);
+}
+
+TEST_F(SerialCLICppTest, Footprint) {
+  using SmallCli = serial_cli::Cli<4, 16, 32>;
+  EXPECT_EQ(SmallCli::inputBufferSize, 80U);
+
+#if !SERIAL_CLI_EMBEDDED_STORAGE
+  // Without the embedded defaults a small console is a fraction of a default one
+  EXPECT_LT(sizeof(SmallCli), sizeof(SerialCLI) + SERIAL_CLI_INPUT_BUFFER_SIZE / 2);
+#endif
+}
+
+TEST(SerialCLIStorage, InvalidStorage) {
+  SerialCLI cli;
+  char inputBuffer[9];
+  const char *argv[3];
+  char txBuffer[9];
+  auto write = [](void *, const char *, size_t) {};
+
+  char rxRing[16];
+  char filterLine[16];
+  char filterPatterns[8];
+  SerialCLI_Storage storage{inputBuffer, 8, argv, 2, txBuffer, 8, nullptr, 0, rxRing, sizeof(rxRing),
+                            filterLine, sizeof(filterLine), filterPatterns, sizeof(filterPatterns)};
+  EXPECT_FALSE(SerialCLI_InitWithStorage(nullptr, &storage, write, nullptr));
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, nullptr, write, nullptr));
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &storage, nullptr, nullptr));
+
+  SerialCLI_Storage invalid = storage;
+  invalid.inputBufferSize = 1;
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+  invalid = storage;
+  invalid.maxArgs = 0;
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+  invalid = storage;
+  invalid.txBuffer = nullptr;
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+  invalid = storage;
+  invalid.rxRingSize = 12;
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+  invalid = storage;
+  invalid.filterLine = nullptr;
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+  invalid = storage;
+  invalid.filterPatterns = nullptr;
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+  invalid = storage;
+  invalid.filterPatternSize = 256;
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+  invalid = storage;
+  invalid.rxRing = nullptr;
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+
+  // Without a receive ring all interrupt input is dropped
+  invalid.rxRingSize = 0;
+  EXPECT_TRUE(SerialCLI_InitWithStorage(&cli, &invalid, write, nullptr));
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, "a\r", 2), 0U);
+  EXPECT_EQ(cli.rxDropped, 2U);
+
+  EXPECT_TRUE(SerialCLI_InitWithStorage(&cli, &storage, write, nullptr));
+}
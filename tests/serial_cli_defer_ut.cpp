@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_rpc.h"
+
+namespace {
+
+struct EraseJob {
+  int remaining;
+  bool isReleased;
+};
+
+EraseJob job;
+std::vector<SerialCLI_LineStatus> statuses;
+
+bool continueErase(SerialCLI *cli, void *state, bool isCancelled) {
+  auto *eraseJob = static_cast<EraseJob *>(state);
+  if (isCancelled) {
+    eraseJob->isReleased = true;
+    return true;
+  }
+
+  SerialCLI_WriteString(cli, "[%d]", eraseJob->remaining);
+  return 0 == --eraseJob->remaining;
+}
+
+void eraseCommand(SerialCLI *cli, int, const char **argv) {
+  job = {std::stoi(argv[1]), false};
+  SerialCLI_Defer(cli, continueErase, &job);
+}
+
+void echoCommand(SerialCLI *cli, int, const char **argv) { SerialCLI_WriteString(cli, "%s", argv[1]); }
+
+void recordStatus(void *, SerialCLI_LineStatus status) { statuses.push_back(status); }
+
+} // namespace
+
+class SerialCLIDeferTest : public SerialCLITest {
+public:
+  SerialCLI_CommandEntry commands[2]{};
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    statuses.clear();
+    commands[0].commandName = "erase";
+    commands[0].command = eraseCommand;
+    commands[1].commandName = "echo";
+    commands[1].command = echoCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commands[0]));
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commands[1]));
+    ASSERT_TRUE(SerialCLI_SetLineResultCallback(&cli, recordStatus, nullptr));
+    output.clear();
+  }
+};
+
+TEST_F(SerialCLIDeferTest, ContinuesInProcess) {
+  writeString("erase 3\r");
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_TRUE(SerialCLI_IsCommandRunning(&cli));
+  EXPECT_TRUE(statuses.empty());
+
+  // Input typed meanwhile is queued, not rejected
+  output.clear();
+  writeString("echo x\r");
+  EXPECT_TRUE(SerialCLI_IsCommandPending(&cli));
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_EQ(output, "echo x[3][2]");
+
+  // The prompt follows the completion, then the queued line runs
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_FALSE(SerialCLI_IsCommandRunning(&cli));
+  EXPECT_EQ(output, "echo x[3][2][1]\r\n>> ");
+  EXPECT_TRUE(SerialCLI_Process(&cli));
+  EXPECT_EQ(output, "echo x[3][2][1]\r\n>> \r\nx\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK, SERIAL_CLI_LINE_OK}));
+}
+
+TEST_F(SerialCLIDeferTest, CtrlCCancels) {
+  writeString("erase 100\r");
+  process();
+  EXPECT_TRUE(SerialCLI_IsCommandRunning(&cli));
+
+  output.clear();
+  writeString("\x03");
+  SerialCLI_Process(&cli);
+  EXPECT_FALSE(SerialCLI_IsCommandRunning(&cli));
+  EXPECT_TRUE(job.isReleased);
+  EXPECT_EQ(output, "^C\r\n>> ");
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_CANCELLED}));
+
+  // Without a running command Ctrl+C discards the typed line
+  output.clear();
+  writeString("echo y\x03");
+  writeString("echo z\r");
+  process();
+  EXPECT_EQ(output.find("y\r\n"), std::string::npos);
+  EXPECT_NE(output.find("^C\r\n>> echo z\r\nz"), std::string::npos);
+}
+
+TEST_F(SerialCLIDeferTest, CtrlCFromISR) {
+  writeString("erase 100\r");
+  process();
+
+  // Ctrl+C gets through even if the ring has no room left for it
+  std::string filler(SERIAL_CLI_RX_RING_SIZE, 'x');
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, filler.data(), filler.size()), filler.size());
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, "\x03", 1), 1U);
+  EXPECT_EQ(cli.rxDropped, 0U);
+  SerialCLI_Process(&cli);
+  EXPECT_FALSE(SerialCLI_IsCommandRunning(&cli));
+  EXPECT_TRUE(job.isReleased);
+}
+
+TEST_F(SerialCLIDeferTest, CtrlCFromISRCancelsOnce) {
+  writeString("erase 100\r");
+  process();
+
+  // The delivered Ctrl+C is not stored, the drain cannot pass it to the next command
+  size_t head = cli.rxHead;
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, "\x03" "erase 2\r", 9), 9U);
+  EXPECT_EQ(cli.rxHead, head + 8);
+  process();
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_CANCELLED, SERIAL_CLI_LINE_OK}));
+}
+
+TEST_F(SerialCLIDeferTest, CtrlCFromISRBeforeDefer) {
+  std::string lines;
+  while (lines.size() < SERIAL_CLI_RX_RING_SIZE) {
+    lines += "erase 2\r";
+  }
+  lines.resize(SERIAL_CLI_RX_RING_SIZE);
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, lines.data(), lines.size()), lines.size());
+
+  // Without a running command Ctrl+C waits behind the input, here it does not fit and is dropped
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, "\x03", 1), 0U);
+  do {
+    SerialCLI_Process(&cli);
+  } while (SerialCLI_IsCommandPending(&cli) || SerialCLI_IsCommandRunning(&cli));
+  EXPECT_EQ(statuses, std::vector<SerialCLI_LineStatus>(lines.size() / 8, SERIAL_CLI_LINE_OK));
+}
+
+TEST_F(SerialCLIDeferTest, DeinitCancels) {
+  writeString("erase 100\r");
+  process();
+  EXPECT_FALSE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_RPC));
+  EXPECT_FALSE(SerialCLI_Defer(&cli, continueErase, &job));
+  EXPECT_FALSE(SerialCLI_Defer(nullptr, continueErase, &job));
+  EXPECT_TRUE(SerialCLI_Deinit(&cli));
+  EXPECT_TRUE(job.isReleased);
+  EXPECT_FALSE(SerialCLI_IsCommandRunning(&cli));
+}
+
+TEST_F(SerialCLIDeferTest, RpcRequest) {
+  ASSERT_TRUE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_RPC));
+  output.clear();
+
+  char frame[64];
+  size_t length = encodeRpcRequest(&cli, frame, sizeof(frame), 42, {"erase", "2"});
+  SerialCLI_Read(&cli, frame, length);
+  SerialCLI_Process(&cli);
+  SerialCLI_Process(&cli);
+  EXPECT_TRUE(output.empty());
+
+  // The result frame carries the output of every step
+  SerialCLI_Process(&cli);
+  ASSERT_FALSE(output.empty());
+  SerialCLI_RpcResponse response;
+  ASSERT_TRUE(SerialCLI_RpcDecodeResponse(output.data(), output.size() - 1, &response));
+  EXPECT_EQ(response.requestId, 42);
+  EXPECT_EQ(response.type, SERIAL_CLI_RPC_RESULT);
+  EXPECT_EQ(std::string(response.data, response.dataLength), "[2][1]");
+}
@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+#include "serial_cli_fixture.hpp"
+
+namespace {
+
+const std::string left = "\x1b[D";
+const std::string right = "\x1b[C";
+const std::string home = "\x1b[H";
+const std::string end = "\x1b[F";
+const std::string del = "\x1b[3~";
+
+// Single-row terminal understanding the sequences the editor writes
+class Terminal {
+public:
+  std::string row;
+  size_t column = 0;
+
+  void write(const std::string &output) {
+    for (size_t i = 0; i < output.size(); ++i) {
+      char ch = output[i];
+      if ('\x1b' == ch) {
+        size_t count = 0;
+        for (i += 2; (output[i] >= '0') && (output[i] <= '9'); ++i) {
+          count = (count * 10) + (size_t)(output[i] - '0');
+        }
+        apply(output[i], (0 == count) ? 1 : count);
+      } else if ('\r' == ch) {
+        column = 0;
+      } else if ('\n' == ch) {
+        row.clear();
+      } else if ('\b' == ch) {
+        column -= (column > 0) ? 1 : 0;
+      } else {
+        if (column >= row.size()) {
+          row.resize(column + 1, ' ');
+        }
+        row[column++] = ch;
+      }
+    }
+  }
+
+private:
+  void apply(char final, size_t count) {
+    switch (final) {
+    case 'C':
+      column += count;
+      break;
+    case 'D':
+      column -= std::min(count, column);
+      break;
+    case 'K':
+      row.resize(std::min(row.size(), column));
+      break;
+    case '@':
+      if (column < row.size()) {
+        row.insert(column, count, ' ');
+      }
+      break;
+    case 'P':
+      if (column < row.size()) {
+        row.erase(column, count);
+      }
+      break;
+    default:
+      FAIL() << "Unexpected sequence " << final;
+    }
+  }
+};
+
+// Blanks at the end of a row look the same as no characters
+std::string trimRight(std::string row) { return row.erase(row.find_last_not_of(' ') + 1); }
+
+} // namespace
+
+class SerialCLIEditorTest : public SerialCLITest {
+public:
+  std::string currentLine() const { return std::string(&cli.inputBuffer[cli.queuedLength], cli.charCount); }
+
+  std::string edit(const std::string &keys) {
+    output.clear();
+    writeString(keys);
+    return output;
+  }
+};
+
+TEST_F(SerialCLIEditorTest, CursorMovement) {
+  writeString("set gpio 12 high");
+
+  // The shortest of backspaces, a cursor sequence and writing the prompt again is used
+  EXPECT_EQ(edit(left), "\b");
+  EXPECT_EQ(edit(home), "\r>> ");
+  EXPECT_EQ(cli.cursorPosition, 0U);
+  EXPECT_EQ(edit(left), "");
+
+  // Moving right writes the characters again unless the sequence is shorter
+  EXPECT_EQ(edit(right + right), "se");
+  EXPECT_EQ(edit(end), "\x1b[14C");
+  EXPECT_EQ(edit(right), "");
+
+  // Control keys and VT220 keys move as well
+  EXPECT_EQ(edit("\x01"), "\r>> ");
+  EXPECT_EQ(edit("\x06\x06\x02"), "se\b");
+  EXPECT_EQ(edit("\x1b[4~"), "\x1b[15C");
+  EXPECT_EQ(edit("\x1bOH"), "\r>> ");
+  EXPECT_EQ(currentLine(), "set gpio 12 high");
+}
+
+TEST_F(SerialCLIEditorTest, MidLineEdits) {
+  writeString("set gpio 12 high");
+
+  // Inserting shifts the rest of the line on the terminal instead of writing it again
+  EXPECT_EQ(edit(home + "x"), "\r>> \x1b[@x");
+  EXPECT_EQ(currentLine(), "xset gpio 12 high");
+  EXPECT_EQ(edit("\x7f"), "\b\x1b[P");
+  EXPECT_EQ(edit(del), "\x1b[P");
+  EXPECT_EQ(currentLine(), "et gpio 12 high");
+
+  // Near the end rewriting the rest is shorter
+  EXPECT_EQ(edit(end + left + "g"), "\x1b[15C\bgh\b");
+  EXPECT_EQ(currentLine(), "et gpio 12 higgh");
+
+  // Deleting at the end keeps the classic sequence
+  EXPECT_EQ(edit(end + "\x7f"), "h\b \b");
+  EXPECT_EQ(currentLine(), "et gpio 12 higg");
+
+  // Ctrl+W deletes the word before the cursor, trailing spaces included
+  EXPECT_EQ(edit(" \x17"), " \x1b[5D\x1b[K");
+  EXPECT_EQ(currentLine(), "et gpio 12 ");
+
+  // Ctrl+K deletes up to the end, Ctrl+U up to the start
+  edit(home + right + right + right + "\x0b");
+  EXPECT_EQ(currentLine(), "et ");
+  edit(left + "\x15");
+  EXPECT_EQ(currentLine(), " ");
+
+  // The edited line is executed as shown
+  static std::string executed;
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.commandName = "set";
+  commandEntry.command = [](SerialCLI *, int, const char **argv) { executed = argv[1]; };
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+  writeString("\x15st" + left + "e" + end + " gpio\r");
+  process();
+  EXPECT_EQ(executed, "gpio");
+}
+
+TEST_F(SerialCLIEditorTest, Stats) {
+  SerialCLI_EditStats stats;
+  EXPECT_FALSE(SerialCLI_GetEditStats(nullptr, &stats));
+  EXPECT_FALSE(SerialCLI_GetEditStats(&cli, nullptr));
+
+  // Typing at the end of the line is not an edit
+  writeString("set gpio 12 high");
+  ASSERT_TRUE(SerialCLI_GetEditStats(&cli, &stats));
+  EXPECT_EQ(stats.editCount, 0U);
+
+  // "\r>> xset gpio 12 high\x1b[K" and 16 characters back would be 29 bytes
+  edit(home);
+  size_t written = edit("x").size();
+  ASSERT_TRUE(SerialCLI_GetEditStats(&cli, &stats));
+  EXPECT_EQ(stats.editCount, 2U);
+  EXPECT_EQ(written, 4U);
+  EXPECT_EQ(stats.lastEditSaved, 29U - written);
+  EXPECT_EQ(stats.bytesWritten, 4U + written);
+
+  // Clearing a long line is cheapest by redrawing it
+  EXPECT_EQ(edit(end + "\x15"), "\x1b[16C\r>> \x1b[K");
+  ASSERT_TRUE(SerialCLI_GetEditStats(&cli, &stats));
+  EXPECT_EQ(stats.editCount, 4U);
+  EXPECT_EQ(stats.lastEditSaved, 0U);
+  EXPECT_EQ(stats.bytesWritten + stats.bytesSaved, 27U + 29U + 24U + 7U);
+}
+
+TEST_F(SerialCLIEditorTest, RandomEdits) {
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.commandName = "x";
+  commandEntry.command = [](SerialCLI *, int, const char **) {};
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+
+  const std::string keys[] = {left, right, home, end, del, "\x7f", "\b", "\x01", "\x02", "\x05", "\x06",
+                              "\x0b", "\x15", "\x17", "\x1b[A", "\x1b[B", "\x1bOD", "\x1b[1;5C"};
+  std::mt19937 random(7);
+  Terminal terminal;
+  terminal.write(output);
+
+  // After every key the terminal shows the line with the cursor in place
+  for (int i = 0; i < 5000; ++i) {
+    std::string key;
+    auto pick = (unsigned)(random() % 40);
+    if (pick < 18) {
+      key = keys[pick];
+    } else if ((pick < 20) && (cli.charCount > 0)) {
+      key = "\r";
+    } else if (cli.charCount < 60) {
+      key = std::string(1, (pick < 24) ? ' ' : (char)('a' + (int)(random() % 26)));
+    }
+
+    output.clear();
+    writeString(key);
+    process();
+    terminal.write(output);
+    ASSERT_EQ(trimRight(terminal.row), trimRight(">> " + currentLine())) << "key " << i;
+    ASSERT_EQ(terminal.column, 3 + cli.cursorPosition) << "key " << i;
+  }
+
+  SerialCLI_EditStats stats;
+  ASSERT_TRUE(SerialCLI_GetEditStats(&cli, &stats));
+  EXPECT_GT(stats.bytesSaved, stats.bytesWritten);
+}
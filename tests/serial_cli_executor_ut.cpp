@@ -0,0 +1,298 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "serial_cli.h"
+#include "serial_cli_executor.h"
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_server.h"
+
+namespace {
+
+// Instance with its output, the context of the instance
+struct Console {
+  std::string name;
+  std::string output;
+  std::vector<SerialCLI_LineStatus> statuses;
+  SerialCLI cli;
+  SerialCLITestStorage storage;
+};
+
+std::thread::id mainThread;
+std::atomic<bool> isGateOpen{true};
+std::atomic<int> cancelledCount{0};
+std::atomic<int> workerCalls{0};
+
+// Writes numbered lines, more than a job buffers
+void countCommand(SerialCLI *cli, int argc, const char **argv) {
+  auto *console = static_cast<Console *>(SerialCLI_GetContext(cli));
+  int count = (argc > 1) ? std::stoi(argv[1]) : 0;
+  for (int i = 0; i < count; ++i) {
+    SerialCLI_WriteString(cli, "%s %d\r\n", console->name.c_str(), i);
+  }
+  workerCalls += (std::this_thread::get_id() != mainThread) ? 1 : 0;
+}
+
+void failCommand(SerialCLI *cli, int, const char **) {
+  SerialCLI_WriteString(cli, "failing\r\n");
+  SerialCLI_FailCommand(cli);
+}
+
+// Tells where it ran, on a worker once the gate is open
+void gateCommand(SerialCLI *cli, int, const char **) {
+  bool isInline = std::this_thread::get_id() == mainThread;
+  while (!isInline && !isGateOpen) {
+    std::this_thread::yield();
+  }
+  SerialCLI_WriteString(cli, isInline ? "inline\r\n" : "worker\r\n");
+}
+
+// Runs deferred on the worker until it is cancelled
+bool waitForCancel(SerialCLI *, void *, bool isCancelled) {
+  if (isCancelled) {
+    ++cancelledCount;
+    return true;
+  }
+  std::this_thread::yield();
+  return false;
+}
+
+void waitCommand(SerialCLI *cli, int, const char **) { SerialCLI_Defer(cli, waitForCancel, nullptr); }
+
+std::string expectedCount(const std::string &name, int count) {
+  std::string expected;
+  for (int i = 0; i < count; ++i) {
+    expected += name + " " + std::to_string(i) + "\r\n";
+  }
+  return expected;
+}
+
+} // namespace
+
+class SerialCLIExecutorTest : public ::testing::Test {
+public:
+  SerialCLI_Executor executor;
+  std::vector<SerialCLI_Worker> workers{2};
+  std::vector<SerialCLI_Job> jobs{2};
+  SerialCLI_CommandEntry entries[4]{};
+  SerialCLI_Registry registry{};
+  Console consoles[2];
+
+  void execute(Console &console, const std::string &line) {
+    SerialCLI_Read(&console.cli, line.data(), line.size());
+    SerialCLI_Read(&console.cli, "\r", 1);
+    SerialCLI_Process(&console.cli);
+  }
+
+  bool isWaiting() {
+    return SerialCLI_ExecutorIsWaiting(&consoles[0].cli) || SerialCLI_ExecutorIsWaiting(&consoles[1].cli);
+  }
+
+  // Continues the instances the executor reports until none of them waits
+  void runJobs() {
+    struct pollfd pollFd = {SerialCLI_ExecutorGetFd(&executor), POLLIN, 0};
+    while (isWaiting() && (poll(&pollFd, 1, 1000) > 0)) {
+      uint64_t count;
+      ASSERT_EQ(read(pollFd.fd, &count, sizeof(count)), (ssize_t)sizeof(count));
+      for (SerialCLI *cli = SerialCLI_ExecutorTakeReady(&executor); nullptr != cli;
+           cli = SerialCLI_ExecutorTakeReady(&executor)) {
+        SerialCLI_Process(cli);
+      }
+    }
+    EXPECT_FALSE(isWaiting());
+  }
+
+protected:
+  void SetUp() override {
+    mainThread = std::this_thread::get_id();
+    isGateOpen = true;
+    cancelledCount = 0;
+    workerCalls = 0;
+    ASSERT_TRUE(SerialCLI_ExecutorInit(&executor, workers.data(), workers.size(), jobs.data(), jobs.size()));
+
+    const std::pair<const char *, SerialCLI_Command> commands[] = {
+        {"count", countCommand}, {"fail", failCommand}, {"gate", gateCommand}, {"wait", waitCommand}};
+    ASSERT_TRUE(SerialCLI_InitRegistry(&registry));
+    for (size_t i = 0; i < 4; ++i) {
+      entries[i].commandName = commands[i].first;
+      entries[i].command = commands[i].second;
+      ASSERT_TRUE(SerialCLI_RegistryAddCommand(&registry, &entries[i]));
+    }
+    ASSERT_TRUE(SerialCLI_SealRegistry(&registry));
+
+    for (size_t i = 0; i < 2; ++i) {
+      Console &console = consoles[i];
+      console.name = "console" + std::to_string(i);
+      ASSERT_TRUE(initTestInstance(
+          &console.cli, console.storage,
+          [](void *context, const char *str, size_t len) { static_cast<Console *>(context)->output.append(str, len); },
+          &console));
+      ASSERT_TRUE(SerialCLI_SetMode(&console.cli, SERIAL_CLI_MODE_BATCH));
+      SerialCLI_SetLineResultCallback(
+          &console.cli,
+          [](void *context, SerialCLI_LineStatus status) {
+            static_cast<std::vector<SerialCLI_LineStatus> *>(context)->push_back(status);
+          },
+          &console.statuses);
+      ASSERT_TRUE(SerialCLI_AttachRegistry(&console.cli, &registry));
+      ASSERT_TRUE(SerialCLI_ExecutorAttach(&executor, &console.cli));
+      console.output.clear();
+    }
+  }
+
+  void TearDown() override {
+    for (auto &console : consoles) {
+      SerialCLI_Deinit(&console.cli);
+    }
+    SerialCLI_ExecutorClose(&executor);
+  }
+};
+
+TEST_F(SerialCLIExecutorTest, InvalidArguments) {
+  SerialCLI_Executor other;
+  SerialCLI_Job tooMany[SERIAL_CLI_EXECUTOR_QUEUE_SIZE + 1];
+  EXPECT_FALSE(SerialCLI_ExecutorInit(&other, workers.data(), 0, jobs.data(), jobs.size()));
+  EXPECT_FALSE(SerialCLI_ExecutorInit(&other, workers.data(), 1, tooMany, SERIAL_CLI_EXECUTOR_QUEUE_SIZE + 1));
+  EXPECT_FALSE(SerialCLI_ExecutorInit(nullptr, workers.data(), 1, jobs.data(), jobs.size()));
+  EXPECT_FALSE(SerialCLI_ExecutorAttach(nullptr, &consoles[0].cli));
+  EXPECT_EQ(SerialCLI_ExecutorTakeReady(&executor), nullptr);
+  EXPECT_FALSE(SerialCLI_ExecutorIsWaiting(&consoles[0].cli));
+}
+
+TEST_F(SerialCLIExecutorTest, OrderedOutput) {
+  // Both commands run at once, each instance gets its own output in order
+  execute(consoles[0], "count 300");
+  execute(consoles[1], "count 200");
+  EXPECT_TRUE(SerialCLI_ExecutorIsWaiting(&consoles[0].cli));
+  EXPECT_TRUE(SerialCLI_ExecutorIsWaiting(&consoles[1].cli));
+  runJobs();
+
+  EXPECT_EQ(consoles[0].output, expectedCount("console0", 300));
+  EXPECT_EQ(consoles[1].output, expectedCount("console1", 200));
+  EXPECT_EQ(workerCalls, 2);
+  EXPECT_EQ(consoles[0].statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK}));
+
+  // Lines queued meanwhile follow the job
+  consoles[0].output.clear();
+  SerialCLI_Read(&consoles[0].cli, "count 2\rcount 1\r", 16);
+  SerialCLI_Process(&consoles[0].cli);
+  runJobs();
+  SerialCLI_Process(&consoles[0].cli);
+  runJobs();
+  EXPECT_EQ(consoles[0].output, expectedCount("console0", 2) + expectedCount("console0", 1));
+}
+
+TEST_F(SerialCLIExecutorTest, TextMode) {
+  ASSERT_TRUE(SerialCLI_SetMode(&consoles[0].cli, SERIAL_CLI_MODE_TEXT));
+  consoles[0].output.clear();
+  execute(consoles[0], "count 1");
+  runJobs();
+  // The prompt follows the output of the job
+  EXPECT_EQ(consoles[0].output, "count 1\r\nconsole0 0\r\n\r\n>> ");
+
+  // The built-in commands run right away
+  consoles[0].output.clear();
+  execute(consoles[0], "help");
+  EXPECT_FALSE(isWaiting());
+  EXPECT_NE(consoles[0].output.find("Available commands"), std::string::npos);
+}
+
+TEST_F(SerialCLIExecutorTest, Failure) {
+  execute(consoles[0], "fail");
+  runJobs();
+  EXPECT_EQ(consoles[0].output, "failing\r\n");
+  EXPECT_EQ(consoles[0].statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_COMMAND_FAILED}));
+}
+
+TEST_F(SerialCLIExecutorTest, Cancel) {
+  // Ctrl+C ends the wait of the instance and cancels the command deferred on the worker
+  execute(consoles[0], "wait");
+  EXPECT_TRUE(SerialCLI_ExecutorIsWaiting(&consoles[0].cli));
+  SerialCLI_Read(&consoles[0].cli, "\x03", 1);
+  SerialCLI_Process(&consoles[0].cli);
+  EXPECT_FALSE(SerialCLI_IsCommandRunning(&consoles[0].cli));
+  EXPECT_EQ(consoles[0].statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_CANCELLED}));
+  while (0 == cancelledCount) {
+    std::this_thread::yield();
+  }
+
+  // Deinitializing cancels as well, the jobs are free again afterwards
+  execute(consoles[1], "wait");
+  SerialCLI_Deinit(&consoles[1].cli);
+  while (cancelledCount < 2) {
+    std::this_thread::yield();
+  }
+  execute(consoles[0], "count 1");
+  runJobs();
+  EXPECT_EQ(consoles[0].output, expectedCount("console0", 1));
+}
+
+TEST_F(SerialCLIExecutorTest, RunsInlineWithoutFreeJob) {
+  SerialCLI_Executor single;
+  std::vector<SerialCLI_Worker> singleWorkers{1};
+  std::vector<SerialCLI_Job> singleJobs{1};
+  ASSERT_TRUE(SerialCLI_ExecutorInit(&single, singleWorkers.data(), 1, singleJobs.data(), 1));
+  for (auto &console : consoles) {
+    ASSERT_TRUE(SerialCLI_ExecutorAttach(&single, &console.cli));
+  }
+
+  // The only job is taken, the second command runs on the calling thread
+  isGateOpen = false;
+  execute(consoles[0], "gate");
+  execute(consoles[1], "gate");
+  EXPECT_EQ(consoles[1].output, "inline\r\n");
+  isGateOpen = true;
+
+  struct pollfd pollFd = {SerialCLI_ExecutorGetFd(&single), POLLIN, 0};
+  while (SerialCLI_ExecutorIsWaiting(&consoles[0].cli) && (poll(&pollFd, 1, 1000) > 0)) {
+    uint64_t count;
+    ASSERT_EQ(read(pollFd.fd, &count, sizeof(count)), (ssize_t)sizeof(count));
+    for (SerialCLI *cli = SerialCLI_ExecutorTakeReady(&single); nullptr != cli;
+         cli = SerialCLI_ExecutorTakeReady(&single)) {
+      SerialCLI_Process(cli);
+    }
+  }
+  EXPECT_EQ(consoles[0].output, "worker\r\n");
+  for (auto &console : consoles) {
+    SerialCLI_Deinit(&console.cli);
+  }
+  EXPECT_TRUE(SerialCLI_ExecutorClose(&single));
+}
+
+TEST_F(SerialCLIExecutorTest, Server) {
+  SerialCLI_Server server;
+  std::vector<SerialCLI_Session> sessions{2};
+  ASSERT_TRUE(SerialCLI_ServerInit(&server, sessions.data(), sessions.size(), &registry));
+  ASSERT_TRUE(SerialCLI_ServerSetExecutor(&server, &executor));
+  EXPECT_FALSE(SerialCLI_ServerSetExecutor(&server, &executor));
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_NE(SerialCLI_ServerOpenSession(&server, fds[0]), nullptr);
+
+  // The lines of a session run one after another, the output of the jobs reaches the client in order
+  const char request[] = "fail\rgate\r";
+  ASSERT_EQ(write(fds[1], request, sizeof(request) - 1), (ssize_t)(sizeof(request) - 1));
+  std::string received;
+  struct pollfd pollFd = {fds[1], POLLIN, 0};
+  for (int i = 0; (i < 1000) && (received.find("worker") == std::string::npos); ++i) {
+    ASSERT_TRUE(SerialCLI_ServerPoll(&server, 10));
+    if (poll(&pollFd, 1, 0) > 0) {
+      char buffer[256];
+      ssize_t length = read(fds[1], buffer, sizeof(buffer));
+      ASSERT_GT(length, 0);
+      received.append(buffer, (size_t)length);
+    }
+  }
+  ASSERT_NE(received.find("worker"), std::string::npos) << received;
+  EXPECT_LT(received.find("failing"), received.find("worker"));
+
+  SerialCLI_ServerClose(&server);
+  close(fds[1]);
+}
@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_rpc.h"
+
+namespace {
+
+std::vector<std::string> calls;
+
+// Records the arguments the command was called with
+void recordCommand(SerialCLI *, int argc, const char **argv) {
+  std::string call;
+  for (int i = 0; i < argc; ++i) {
+    call += (i > 0) ? " " : "";
+    call += argv[i];
+  }
+  calls.push_back(call);
+}
+
+} // namespace
+
+class SerialCLIGroupTest : public SerialCLITest {
+public:
+  SerialCLI_CommandGroup gpio{};
+  SerialCLI_CommandGroup net{};
+  SerialCLI_CommandGroup netIf{};
+  SerialCLI_CommandEntry gpioSet{};
+  SerialCLI_CommandEntry gpioGet{};
+  SerialCLI_CommandEntry gpioShow{};
+  SerialCLI_CommandEntry netIfShow{};
+  SerialCLI_CommandEntry show{};
+
+  void execute(const std::string &line) {
+    writeString(line + "\r");
+    process();
+  }
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    calls.clear();
+
+    gpio.entry.commandName = "gpio";
+    gpio.entry.commandDescription = "GPIO pins";
+    ASSERT_TRUE(SerialCLI_RegisterGroup(&cli, nullptr, &gpio));
+    net.entry.commandName = "net";
+    net.entry.commandDescription = "Network";
+    ASSERT_TRUE(SerialCLI_RegisterGroup(&cli, nullptr, &net));
+    netIf.entry.commandName = "if";
+    netIf.entry.commandDescription = "Network interfaces";
+    ASSERT_TRUE(SerialCLI_RegisterGroup(&cli, &net, &netIf));
+
+    for (auto [group, entry, name] : {std::tuple{&gpio, &gpioSet, "set"}, std::tuple{&gpio, &gpioGet, "get"},
+                                      std::tuple{&gpio, &gpioShow, "show"}, std::tuple{&netIf, &netIfShow, "show"},
+                                      std::tuple{(SerialCLI_CommandGroup *)nullptr, &show, "show"}}) {
+      entry->commandName = name;
+      entry->commandDescription = "Does something";
+      entry->command = recordCommand;
+      ASSERT_TRUE(SerialCLI_RegisterSubcommand(&cli, group, entry));
+    }
+  }
+};
+
+TEST_F(SerialCLIGroupTest, Register) {
+  // Names repeat across groups but not within one
+  SerialCLI_CommandEntry duplicate{};
+  duplicate.commandName = "set";
+  duplicate.command = recordCommand;
+  EXPECT_FALSE(SerialCLI_RegisterSubcommand(&cli, &gpio, &duplicate));
+  EXPECT_TRUE(SerialCLI_RegisterSubcommand(&cli, &net, &duplicate));
+
+  SerialCLI_CommandGroup duplicateGroup{};
+  duplicateGroup.entry.commandName = "gpio";
+  EXPECT_FALSE(SerialCLI_RegisterGroup(&cli, nullptr, &duplicateGroup));
+  EXPECT_TRUE(SerialCLI_RegisterGroup(&cli, &net, &duplicateGroup));
+
+  // Subcommands need a command function, groups a name
+  SerialCLI_CommandEntry noCommand{};
+  noCommand.commandName = "none";
+  EXPECT_FALSE(SerialCLI_RegisterSubcommand(&cli, &gpio, &noCommand));
+  SerialCLI_CommandGroup unnamed{};
+  EXPECT_FALSE(SerialCLI_RegisterGroup(&cli, &gpio, &unnamed));
+  EXPECT_FALSE(SerialCLI_RegisterGroup(nullptr, nullptr, &unnamed));
+  EXPECT_FALSE(SerialCLI_RegisterSubcommand(&cli, &gpio, nullptr));
+}
+
+TEST_F(SerialCLIGroupTest, Dispatch) {
+  std::vector<SerialCLI_LineStatus> statuses;
+  SerialCLI_SetLineResultCallback(
+      &cli,
+      [](void *context, SerialCLI_LineStatus status) {
+        static_cast<std::vector<SerialCLI_LineStatus> *>(context)->push_back(status);
+      },
+      &statuses);
+
+  // Subcommands get the arguments from their own name on
+  execute("gpio set 3 1");
+  execute("net if show eth0");
+  execute("show");
+  execute("gpio \"show\"");
+  EXPECT_EQ(calls, (std::vector<std::string>{"set 3 1", "show eth0", "show", "show"}));
+
+  // Unknown subcommands are unknown commands
+  calls.clear();
+  execute("gpio frob 1");
+  execute("net show");
+  EXPECT_TRUE(calls.empty());
+  EXPECT_EQ(statuses.back(), SERIAL_CLI_LINE_UNKNOWN_COMMAND);
+
+  // A group alone lists its subcommands
+  output.clear();
+  execute("net if");
+  EXPECT_NE(output.find("Available if commands:\r\n  show - Does something\r\n"), std::string::npos) << output;
+  EXPECT_EQ(statuses.back(), SERIAL_CLI_LINE_OK);
+}
+
+TEST_F(SerialCLIGroupTest, Help) {
+  // The top level lists groups like commands
+  execute("help");
+  EXPECT_NE(output.find("  gpio - GPIO pins\r\n"), std::string::npos);
+  EXPECT_NE(output.find("  net - Network\r\n"), std::string::npos);
+  EXPECT_EQ(output.find("  set - "), std::string::npos);
+
+  output.clear();
+  execute("help gpio");
+  EXPECT_NE(output.find("Available gpio commands:\r\n  set - Does something\r\n  get - Does something\r\n  show - "),
+            std::string::npos)
+      << output;
+  EXPECT_EQ(output.find("gpio - "), std::string::npos);
+
+  output.clear();
+  execute("help net if show");
+  EXPECT_NE(output.find("\r\n  show - Does something\r\n"), std::string::npos) << output;
+  EXPECT_EQ(output.find("Available"), std::string::npos);
+
+  output.clear();
+  execute("help gpio nope");
+  EXPECT_NE(output.find("Usage: help [group ...]"), std::string::npos);
+  output.clear();
+  execute("help show extra");
+  EXPECT_NE(output.find("Usage: help [group ...]"), std::string::npos);
+}
+
+TEST_F(SerialCLIGroupTest, TabCompletion) {
+  // Completion is scoped to the group named before the word
+  writeString("gp\t");
+  writeString("s\t");
+  EXPECT_NE(output.find("gpio s"), std::string::npos);
+  output.clear();
+  writeString("\t");
+  EXPECT_NE(output.find("set  show"), std::string::npos) << output;
+  writeString("h\t1\r");
+  process();
+  EXPECT_EQ(calls, (std::vector<std::string>{"show 1"}));
+
+  output.clear();
+  writeString("net i\tsh\t\r");
+  process();
+  EXPECT_EQ(calls.back(), "show");
+
+  // Nothing is completed after a command that is not a group
+  output.clear();
+  writeString("show s\t");
+  EXPECT_EQ(output, "show s");
+  writeString("\x03");
+}
+
+TEST_F(SerialCLIGroupTest, Rpc) {
+  ASSERT_TRUE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_RPC));
+  output.clear();
+
+  // Subcommands are named by the leading arguments
+  char frame[64];
+  for (std::vector<const char *> argv : {std::vector<const char *>{"gpio", "get", "7"}, {"gpio", "nope"}}) {
+    size_t length = encodeRpcRequest(&cli, frame, sizeof(frame), 1, argv);
+    SerialCLI_Read(&cli, frame, length);
+  }
+  process();
+  EXPECT_EQ(calls, (std::vector<std::string>{"get 7"}));
+
+  std::vector<uint8_t> statuses;
+  size_t start = 0;
+  for (size_t end = output.find('\0'); std::string::npos != end; start = end + 1, end = output.find('\0', start)) {
+    std::string encoded = output.substr(start, end - start);
+    SerialCLI_RpcResponse response;
+    ASSERT_TRUE(SerialCLI_RpcDecodeResponse(encoded.data(), encoded.size(), &response));
+    statuses.push_back(response.status);
+  }
+  EXPECT_EQ(statuses, (std::vector<uint8_t>{SERIAL_CLI_RPC_STATUS_OK, SERIAL_CLI_RPC_STATUS_UNKNOWN_COMMAND}));
+}
+
+#if SERIAL_CLI_ENABLE_METRICS
+
+TEST_F(SerialCLIGroupTest, Metrics) {
+  execute("gpio set 3 1");
+  execute("net if show");
+  SerialCLI_CommandMetrics metrics;
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&gpioSet, &metrics));
+  EXPECT_EQ(metrics.callCount, 1U);
+
+  // Subcommands are listed below their group
+  output.clear();
+  execute("stats");
+  EXPECT_NE(output.find("  gpio               0"), std::string::npos) << output;
+  EXPECT_NE(output.find("    set              1"), std::string::npos) << output;
+  EXPECT_NE(output.find("  net                0"), std::string::npos) << output;
+  EXPECT_NE(output.find("      show           1"), std::string::npos) << output;
+
+  ASSERT_TRUE(SerialCLI_ResetMetrics(&cli));
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&netIfShow, &metrics));
+  EXPECT_EQ(metrics.callCount, 0U);
+}
+
+#endif
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "serial_cli.hpp"
+#include "serial_cli_fixture.hpp"
+
+namespace {
+
+std::vector<std::string> executedLines;
+
+void echoCommand(SerialCLI *, int argc, const char **argv) {
+  std::string line;
+  for (int i = 0; i < argc; ++i) {
+    line += (i > 0) ? " " : "";
+    line += argv[i];
+  }
+  executedLines.push_back(line);
+}
+
+const std::string up = "\x1b[A";
+const std::string down = "\x1b[B";
+const std::string search = "\x12";
+
+} // namespace
+
+class SerialCLIHistoryTest : public SerialCLITest {
+public:
+  SerialCLI_CommandEntry commandEntry{};
+
+  void execute(const std::string &line) {
+    writeString(line + "\r");
+    process();
+  }
+
+  std::string currentLine() const { return std::string(&cli.inputBuffer[cli.queuedLength], cli.charCount); }
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    executedLines.clear();
+    commandEntry.commandName = "echo";
+    commandEntry.command = echoCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+  }
+};
+
+TEST_F(SerialCLIHistoryTest, Recall) {
+  execute("echo one");
+  execute("echo two");
+  output.clear();
+
+  // The recalled line replaces the echoed one
+  writeString(up);
+  EXPECT_EQ(output, "echo two");
+  writeString(up);
+  EXPECT_EQ(currentLine(), "echo one");
+  writeString(up);
+  EXPECT_EQ(currentLine(), "echo one");
+  writeString(down);
+  EXPECT_EQ(currentLine(), "echo two");
+  writeString(down);
+  EXPECT_EQ(currentLine(), "");
+
+  // Application mode cursor keys send SS3 sequences
+  writeString("\x1bOA\x1bOA");
+  EXPECT_EQ(currentLine(), "echo one");
+  writeString(" more\r");
+  process();
+  EXPECT_EQ(executedLines.back(), "echo one more");
+
+  writeString(up);
+  EXPECT_EQ(currentLine(), "echo one more");
+}
+
+TEST_F(SerialCLIHistoryTest, EscapeSequences) {
+  // Unknown sequences are consumed without reaching the line
+  writeString("ec\x1b[5~\x1b[1;2Pho\x1b[2~ x\r");
+  process();
+  ASSERT_EQ(executedLines.size(), 1U);
+  EXPECT_EQ(executedLines[0], "echo x");
+
+  // A sequence split across reads is still recognized
+  SerialCLI_Read(&cli, "\x1b", 1);
+  SerialCLI_Read(&cli, "[", 1);
+  SerialCLI_Read(&cli, "A", 1);
+  EXPECT_EQ(currentLine(), "echo x");
+
+  // Empty lines and repetitions are not recorded
+  writeString("\r");
+  execute("echo x");
+  writeString(up + up);
+  EXPECT_EQ(currentLine(), "echo x");
+}
+
+TEST_F(SerialCLIHistoryTest, ReverseSearch) {
+  execute("echo alpha");
+  execute("echo beta");
+  execute("echo alphabet");
+  output.clear();
+
+  writeString(search + "alp");
+  EXPECT_EQ(output.substr(output.rfind('\r')), "\r(reverse-i-search)`alp': echo alphabet\x1b[K");
+  writeString(search);
+  EXPECT_EQ(output.substr(output.rfind('\r')), "\r(reverse-i-search)`alp': echo alpha\x1b[K");
+
+  // No older match, the last match stays
+  writeString(search);
+  EXPECT_EQ(output.substr(output.rfind('\r')), "\r(failed reverse-i-search)`alp': echo alpha\x1b[K");
+  writeString("z");
+  EXPECT_EQ(output.substr(output.rfind('\r')), "\r(failed reverse-i-search)`alpz': echo alpha\x1b[K");
+  writeString("\x7f");
+  EXPECT_EQ(output.substr(output.rfind('\r')), "\r(reverse-i-search)`alp': echo alphabet\x1b[K");
+
+  // Enter executes the match
+  writeString("\r");
+  process();
+  EXPECT_EQ(executedLines.back(), "echo alphabet");
+
+  // An arrow key ends the search and moves on from the match
+  writeString(search + "beta" + up);
+  EXPECT_EQ(currentLine(), "echo alpha");
+
+  // Ctrl+C abandons the search
+  executedLines.clear();
+  writeString(search + "beta\x03\r");
+  process();
+  EXPECT_TRUE(executedLines.empty());
+  EXPECT_FALSE(cli.isHistorySearching);
+}
+
+TEST(SerialCLIHistory, RingEviction) {
+  SerialCLI cli;
+  char inputBuffer[65];
+  const char *argv[9];
+  char txBuffer[65];
+  char historyBuffer[40];
+  SerialCLI_Storage storage{inputBuffer, 64, argv, 8, txBuffer, 64, historyBuffer, sizeof(historyBuffer),
+                            nullptr, 0, nullptr, 0, nullptr, 0};
+  ASSERT_TRUE(SerialCLI_InitWithStorage(&cli, &storage, [](void *, const char *, size_t) {}, nullptr));
+
+  // Entries of varying length wrap around the ring many times
+  std::deque<std::string> expected;
+  size_t expectedBytes = 0;
+  for (int i = 0; i < 200; ++i) {
+    std::string line = std::string((size_t)(i * 7) % 13 + 1, (char)('a' + i % 26));
+    std::string input = line + "\r";
+    SerialCLI_Read(&cli, input.data(), input.size());
+    SerialCLI_Process(&cli);
+
+    expected.push_back(line);
+    expectedBytes += line.size() + 2;
+    while (expectedBytes > sizeof(historyBuffer)) {
+      expectedBytes -= expected.front().size() + 2;
+      expected.pop_front();
+    }
+
+    for (auto entry = expected.rbegin(); entry != expected.rend(); ++entry) {
+      SerialCLI_Read(&cli, up.data(), up.size());
+      ASSERT_EQ(std::string(cli.inputBuffer, cli.charCount), *entry) << "after line " << i;
+    }
+    // The oldest entry is the end
+    SerialCLI_Read(&cli, up.data(), up.size());
+    ASSERT_EQ(std::string(cli.inputBuffer, cli.charCount), expected.front());
+    SerialCLI_Read(&cli, "\x03", 1);
+  }
+
+  // A line longer than the ring is not recorded
+  std::string input = std::string(sizeof(historyBuffer), 'z') + "\r";
+  SerialCLI_Read(&cli, input.data(), input.size());
+  SerialCLI_Process(&cli);
+  SerialCLI_Read(&cli, up.data(), up.size());
+  EXPECT_EQ(std::string(cli.inputBuffer, cli.charCount), expected.back());
+}
+
+TEST(SerialCLIHistory, WithoutHistory) {
+  SerialCLI cli;
+  char inputBuffer[33];
+  const char *argv[3];
+  char txBuffer[33];
+  SerialCLI_Storage storage{inputBuffer, 32, argv, 2, txBuffer, 32, nullptr, 16, nullptr, 0, nullptr, 0, nullptr, 0};
+  auto write = [](void *, const char *, size_t) {};
+  EXPECT_FALSE(SerialCLI_InitWithStorage(&cli, &storage, write, nullptr));
+  storage.historyBufferSize = 0;
+  ASSERT_TRUE(SerialCLI_InitWithStorage(&cli, &storage, write, nullptr));
+
+  std::string input = "help\r" + up + search + "x";
+  SerialCLI_Read(&cli, input.data(), input.size());
+  EXPECT_FALSE(cli.isHistorySearching);
+  EXPECT_EQ(std::string(&cli.inputBuffer[cli.queuedLength], cli.charCount), "x");
+
+  std::string output;
+  serial_cli::Cli<4, 16, 32, 64> smallCli(
+      [](void *context, const char *str, size_t len) { static_cast<std::string *>(context)->append(str, len); },
+      &output);
+  ASSERT_TRUE(smallCli.isInitialized());
+  input = "help\r";
+  smallCli.read(input.data(), input.size());
+  smallCli.process();
+  output.clear();
+  smallCli.read(up.data(), up.size());
+  EXPECT_EQ(output, "help");
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "serial_cli.h"
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_host.h"
+
+class SerialCLIHostTest : public ::testing::Test {
+public:
+  SerialCLI cli;
+  SerialCLITestStorage storage;
+  SerialCLI_Host host;
+  SerialCLI_CommandEntry commandEntry{};
+  static inline size_t pingCount = 0;
+
+  void registerPing() {
+    commandEntry.command = [](SerialCLI *cli, int, const char **) -> void {
+      ++pingCount;
+      SerialCLI_WriteString(cli, "pong\r\n");
+    };
+    commandEntry.commandName = "ping";
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+  }
+
+  // Reads from the peer until the expected text arrived or nothing arrives for a second
+  static std::string readUntil(int fd, std::string_view expected) {
+    std::string received;
+    struct pollfd pollFd = {fd, POLLIN, 0};
+    while ((received.find(expected) == std::string::npos) && (poll(&pollFd, 1, 1000) > 0)) {
+      char buffer[256];
+      ssize_t length = read(fd, buffer, sizeof(buffer));
+      if (length <= 0) {
+        break;
+      }
+      received.append(buffer, (size_t)length);
+    }
+    return received;
+  }
+
+protected:
+  void SetUp() override { pingCount = 0; }
+
+  void TearDown() override {
+    SerialCLI_Deinit(&cli);
+    SerialCLI_HostClose(&host);
+  }
+};
+
+TEST_F(SerialCLIHostTest, SocketRoundTrip) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(SerialCLI_HostAttach(&host, &cli, fds[0], fds[0]));
+  ASSERT_TRUE(initTestInstance(&cli, storage, SerialCLI_HostWrite, &host));
+  registerPing();
+  EXPECT_NE(readUntil(fds[1], ">>").find(">>"), std::string::npos);
+
+  // Several lines in one write are processed by a single poll
+  std::string input = "ping\rping\r";
+  ASSERT_EQ(write(fds[1], input.data(), input.size()), (ssize_t)input.size());
+  EXPECT_TRUE(SerialCLI_HostPoll(&host, 1000));
+  EXPECT_EQ(pingCount, 2U);
+  std::string received = readUntil(fds[1], "pong\r\n>>");
+  EXPECT_NE(received.find("pong"), received.rfind("pong"));
+
+  // A poll without input times out without processing
+  EXPECT_TRUE(SerialCLI_HostPoll(&host, 0));
+  EXPECT_EQ(pingCount, 2U);
+
+  // Closing the peer ends the input
+  close(fds[1]);
+  EXPECT_FALSE(SerialCLI_HostPoll(&host, 1000));
+  close(fds[0]);
+}
+
+TEST_F(SerialCLIHostTest, PTYRoundTrip) {
+  char slaveName[64];
+  ASSERT_TRUE(SerialCLI_HostOpenPTY(&host, &cli, slaveName, sizeof(slaveName)));
+  ASSERT_TRUE(initTestInstance(&cli, storage, SerialCLI_HostWrite, &host));
+  registerPing();
+
+  int slaveFd = open(slaveName, O_RDWR | O_NOCTTY);
+  ASSERT_GE(slaveFd, 0);
+  std::string input = "ping\r";
+  ASSERT_EQ(write(slaveFd, input.data(), input.size()), (ssize_t)input.size());
+  EXPECT_TRUE(SerialCLI_HostPoll(&host, 1000));
+  EXPECT_EQ(pingCount, 1U);
+  EXPECT_NE(readUntil(slaveFd, "pong\r\n").find("pong\r\n"), std::string::npos);
+  close(slaveFd);
+}
+
+TEST_F(SerialCLIHostTest, Stop) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(SerialCLI_HostAttach(&host, &cli, fds[0], fds[0]));
+  ASSERT_TRUE(initTestInstance(&cli, storage, SerialCLI_HostWrite, &host));
+  registerPing();
+
+  std::thread stopper([&]() { SerialCLI_HostStop(&host); });
+  EXPECT_TRUE(SerialCLI_HostRun(&host));
+  stopper.join();
+
+  close(fds[1]);
+  close(fds[0]);
+}
+
+TEST_F(SerialCLIHostTest, DeferredCommand) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(SerialCLI_HostAttach(&host, &cli, fds[0], fds[0]));
+  ASSERT_TRUE(initTestInstance(&cli, storage, SerialCLI_HostWrite, &host));
+  registerPing();
+  static SerialCLI_CommandEntry sweepEntry{};
+  sweepEntry.commandName = "sweep";
+  sweepEntry.command = [](SerialCLI *cli, int, const char **) {
+    SerialCLI_Defer(
+        cli, [](SerialCLI *, void *, bool) { return ++pingCount == 3; }, nullptr);
+  };
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &sweepEntry));
+
+  std::string input = "sweep\rping\r";
+  ASSERT_EQ(write(fds[1], input.data(), input.size()), (ssize_t)input.size());
+
+  // Polls continue the command without waiting for the timeout
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; (i < 10) && (pingCount < 4); ++i) {
+    EXPECT_TRUE(SerialCLI_HostPoll(&host, 1000));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+  EXPECT_EQ(pingCount, 4U);
+  EXPECT_NE(readUntil(fds[1], "pong").find("pong"), std::string::npos);
+
+  close(fds[1]);
+}
+
+TEST_F(SerialCLIHostTest, RunScript) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(SerialCLI_HostAttach(&host, &cli, fds[0], fds[0]));
+  ASSERT_TRUE(initTestInstance(&cli, storage, SerialCLI_HostWrite, &host));
+  registerPing();
+
+  char path[] = "/tmp/serial_cli_script.XXXXXX";
+  int scriptFd = mkstemp(path);
+  ASSERT_GE(scriptFd, 0);
+  std::string script = "ping\nping\r\nunknown\nping";
+  ASSERT_EQ(write(scriptFd, script.data(), script.size()), (ssize_t)script.size());
+  close(scriptFd);
+
+  SerialCLI_BatchResult result;
+  EXPECT_FALSE(SerialCLI_HostRunScript(&cli, path, false, &result));
+  EXPECT_EQ(pingCount, 3U);
+  EXPECT_EQ(result.lineCount, 4U);
+  EXPECT_EQ(result.firstFailedLine, 3U);
+
+  // An empty script succeeds
+  ASSERT_EQ(truncate(path, 0), 0);
+  EXPECT_TRUE(SerialCLI_HostRunScript(&cli, path, false, &result));
+  EXPECT_EQ(result.lineCount, 0U);
+  unlink(path);
+
+  EXPECT_FALSE(SerialCLI_HostRunScript(&cli, "/nonexistent/script", false, nullptr));
+  close(fds[1]);
+}
+
+TEST_F(SerialCLIHostTest, InvalidArguments) {
+  char slaveName[64];
+  EXPECT_FALSE(SerialCLI_HostAttach(nullptr, &cli, 0, 1));
+  EXPECT_FALSE(SerialCLI_HostAttach(&host, &cli, -1, 1));
+  EXPECT_FALSE(SerialCLI_HostOpenTTY(&host, &cli, "/dev/null", 12345));
+  EXPECT_FALSE(SerialCLI_HostOpenTTY(&host, &cli, "/dev/null", 115200));
+  EXPECT_FALSE(SerialCLI_HostOpenPTY(&host, &cli, slaveName, 0));
+  EXPECT_FALSE(SerialCLI_HostConnectUnix(&host, &cli, "/nonexistent/serial_cli.sock"));
+  EXPECT_FALSE(SerialCLI_HostPoll(nullptr, 0));
+  EXPECT_FALSE(SerialCLI_HostStop(nullptr));
+  ASSERT_TRUE(initTestInstance(&cli, storage, SerialCLI_HostWrite, &host));
+}
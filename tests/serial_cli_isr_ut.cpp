@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "serial_cli.h"
+#include "serial_cli_fixture.hpp"
+
+TEST_F(SerialCLITest, ReadFromISR) {
+  static bool isCommandExecuted = false;
+
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *, int argc, const char **argv) -> void {
+    EXPECT_EQ(argc, 2);
+    EXPECT_STREQ(argv[1], "arg");
+    isCommandExecuted = true;
+  };
+  commandEntry.commandName = "test";
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+
+  std::string input = "test arg\r";
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, input.data(), input.size()), input.size());
+  EXPECT_TRUE(output.find("test arg") == std::string::npos) << "Echo must be written from SerialCLI_Process";
+
+  process();
+  EXPECT_TRUE(isCommandExecuted);
+  EXPECT_NE(output.find("test arg"), std::string::npos);
+
+  EXPECT_EQ(SerialCLI_ReadFromISR(nullptr, input.data(), input.size()), 0U);
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, nullptr, input.size()), 0U);
+}
+
+TEST_F(SerialCLITest, ReadFromISRRingFull) {
+  std::string input(SERIAL_CLI_RX_RING_SIZE + 10, 'a');
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, input.data(), input.size()), (size_t)SERIAL_CLI_RX_RING_SIZE);
+  EXPECT_EQ(cli.rxDropped, 10U);
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, input.data(), 1), 0U);
+
+  // Draining frees the ring again
+  SerialCLI_Process(&cli);
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, input.data(), 1), 1U);
+}
+
+TEST_F(SerialCLITest, ReadFromISRDrainsBurst) {
+  static size_t executedCount = 0;
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *, int, const char **) -> void { ++executedCount; };
+  commandEntry.commandName = "t";
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+  executedCount = 0;
+
+  // One call executes a single line but frees the whole ring for the next burst
+  std::string burst;
+  while (burst.size() < SERIAL_CLI_RX_RING_SIZE) {
+    burst += "t\r";
+  }
+  burst.resize(SERIAL_CLI_RX_RING_SIZE);
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, burst.data(), burst.size()), burst.size());
+  SerialCLI_Process(&cli);
+  EXPECT_EQ(executedCount, 1U);
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, burst.data(), burst.size()), burst.size());
+  EXPECT_EQ(cli.rxDropped, 0U);
+
+  while (SerialCLI_IsCommandPending(&cli)) {
+    SerialCLI_Process(&cli);
+  }
+  EXPECT_EQ(executedCount, 2 * (burst.size() / 2));
+}
+
+TEST_F(SerialCLITest, ReadFromISRWaitsForRoom) {
+  static size_t executedCount = 0;
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *, int, const char **) -> void { ++executedCount; };
+  commandEntry.commandName = "t";
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+  executedCount = 0;
+
+  // A line not fitting behind the queued ones stays in the ring instead of being dropped
+  std::string queued = "t " + std::string(SERIAL_CLI_INPUT_BUFFER_SIZE - 40, 'x') + "\r";
+  EXPECT_TRUE(SerialCLI_Read(&cli, queued.data(), queued.size()));
+  std::string line = "t " + std::string(40, 'y') + "\r";
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, line.data(), line.size()), line.size());
+  SerialCLI_Process(&cli);
+  EXPECT_EQ(executedCount, 1U);
+  EXPECT_NE(cli.rxTail, cli.rxHead);
+
+  SerialCLI_Process(&cli);
+  SerialCLI_Process(&cli);
+  EXPECT_EQ(executedCount, 2U);
+  EXPECT_EQ(cli.rxTail, cli.rxHead);
+}
+
+// The producer models a receive interrupt that cannot wait: it hands over a burst of 256 bytes every millisecond,
+// 256 KB/s or about three times a 921600 baud UART, and never retries. The 64 KB ring takes the bursts arriving while
+// the consumer is descheduled, every byte must be accepted the first time.
+TEST_F(SerialCLITest, ReadFromISRStress) {
+  constexpr size_t lineCount = 50000;
+  constexpr size_t burstLength = 256;
+  constexpr auto burstInterval = std::chrono::milliseconds(1);
+  static size_t nextSequence = 0;
+  static size_t errorCount = 0;
+
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *, int argc, const char **argv) -> void {
+    if ((argc != 2) || (std::stoul(argv[1]) != nextSequence)) {
+      ++errorCount;
+    }
+    ++nextSequence;
+  };
+  commandEntry.commandName = "seq";
+
+  // The output is not needed, keep the stress test free of string appends
+  static char inputBuffer[4096 + 1];
+  static const char *argv[3];
+  static char txBuffer[64 + 1];
+  static char rxRing[65536];
+  SerialCLI_Storage storage{inputBuffer, sizeof(inputBuffer) - 1, argv, 2, txBuffer, sizeof(txBuffer) - 1,
+                            nullptr, 0, rxRing, sizeof(rxRing), nullptr, 0, nullptr, 0};
+  ASSERT_TRUE(SerialCLI_InitWithStorage(&cli, &storage, [](void *, const char *, size_t) {}, nullptr));
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+  nextSequence = 0;
+  errorCount = 0;
+
+  std::atomic<size_t> bytesSent{0};
+  std::atomic<size_t> bytesDropped{0};
+  std::atomic<bool> isProducerDone{false};
+  std::thread producer([&]() {
+    std::string stream;
+    for (size_t i = 0; i < lineCount; ++i) {
+      stream += "seq " + std::to_string(i) + ((0 == (i % 3)) ? "\r\n" : "\r");
+    }
+
+    // Vary the chunk sizes within a burst to cover ring wrap-around at every offset
+    size_t chunkLength = 1;
+    size_t sent = 0;
+    size_t dropped = 0;
+    while (sent < stream.size()) {
+      size_t burstEnd = std::min(sent + burstLength, stream.size());
+      while (sent < burstEnd) {
+        size_t length = std::min(chunkLength, burstEnd - sent);
+        dropped += length - SerialCLI_ReadFromISR(&cli, &stream[sent], length);
+        sent += length;
+        chunkLength = (chunkLength % 23) + 1;
+      }
+      std::this_thread::sleep_for(burstInterval);
+    }
+    bytesSent = sent;
+    bytesDropped = dropped;
+    isProducerDone = true;
+  });
+
+  // Give the producer the CPU between the calls, single core hosts would starve it otherwise
+  while (!isProducerDone.load() || (cli.rxTail != cli.rxHead) || SerialCLI_IsCommandPending(&cli)) {
+    SerialCLI_Process(&cli);
+    std::this_thread::yield();
+  }
+  producer.join();
+
+  EXPECT_EQ(bytesDropped.load(), 0U);
+  EXPECT_EQ(cli.rxDropped, 0U);
+  EXPECT_EQ(nextSequence, lineCount);
+  EXPECT_EQ(errorCount, 0U);
+  EXPECT_GT(bytesSent.load(), 500000U);
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_rpc.h"
+
+namespace {
+
+uint32_t now = 0;
+
+uint32_t readClock(void *) { return now; }
+
+// Takes as many microseconds as its first argument says
+void sleepCommand(SerialCLI *cli, int argc, const char **argv) {
+  now += (argc > 1) ? (uint32_t)std::stoul(argv[1]) : 0;
+  if (argc > 2) {
+    SerialCLI_FailCommand(cli);
+  }
+}
+
+// Runs for a tenth of a second on every call until it is cancelled
+bool continueForever(SerialCLI *, void *, bool) {
+  now += 100000;
+  return false;
+}
+
+void foreverCommand(SerialCLI *cli, int, const char **) { (void)SerialCLI_Defer(cli, continueForever, nullptr); }
+
+} // namespace
+
+class SerialCLIMetricsTest : public SerialCLITest {
+public:
+  SerialCLI_CommandEntry sleepEntry{};
+  SerialCLI_CommandEntry foreverEntry{};
+
+  void execute(const std::string &line) {
+    writeString(line + "\r");
+    process();
+  }
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    now = 0xFFFFFF00; // The clock wraps around during the tests
+    sleepEntry.commandName = "sleep";
+    sleepEntry.command = sleepCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &sleepEntry));
+    foreverEntry.commandName = "forever";
+    foreverEntry.command = foreverCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &foreverEntry));
+  }
+};
+
+#if SERIAL_CLI_ENABLE_METRICS
+
+TEST_F(SerialCLIMetricsTest, Counters) {
+  SerialCLI_Metrics metrics;
+  EXPECT_FALSE(SerialCLI_GetMetrics(nullptr, &metrics));
+  EXPECT_FALSE(SerialCLI_GetMetrics(&cli, nullptr));
+
+  execute("sleep");
+  execute("sleep 1 fail");
+  execute("unknown");
+  execute("sleep 1 2 3 4 5 6 7 8 9");
+  execute(std::string(SERIAL_CLI_INPUT_BUFFER_SIZE + 1, 'x'));
+  execute("");
+
+  ASSERT_TRUE(SerialCLI_GetMetrics(&cli, &metrics));
+  EXPECT_EQ(metrics.linesExecuted, 2U);
+  EXPECT_EQ(metrics.commandsFailed, 1U);
+  EXPECT_EQ(metrics.linesRejected, 2U);
+  EXPECT_EQ(metrics.linesDropped, 1U);
+  EXPECT_EQ(metrics.commandsCancelled, 0U);
+  EXPECT_EQ(metrics.bytesOut, output.size());
+  EXPECT_EQ(metrics.bytesIn, 6U + 13U + 8U + 24U + SERIAL_CLI_INPUT_BUFFER_SIZE + 2U + 1U);
+
+  // Bytes the receive ring could not take are counted since the last reset
+  std::string burst(SERIAL_CLI_RX_RING_SIZE + 4, 'a');
+  SerialCLI_ReadFromISR(&cli, burst.data(), burst.size());
+  ASSERT_TRUE(SerialCLI_GetMetrics(&cli, &metrics));
+  EXPECT_EQ(metrics.rxDropped, 4U);
+  ASSERT_TRUE(SerialCLI_ResetMetrics(&cli));
+  ASSERT_TRUE(SerialCLI_GetMetrics(&cli, &metrics));
+  EXPECT_EQ(metrics.rxDropped, 0U);
+  EXPECT_EQ(metrics.linesExecuted, 0U);
+  EXPECT_EQ(metrics.bytesIn, 0U);
+}
+
+TEST_F(SerialCLIMetricsTest, Latencies) {
+  // Without a clock the calls are only counted
+  execute("sleep 5");
+  SerialCLI_CommandMetrics metrics;
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&sleepEntry, &metrics));
+  EXPECT_EQ(metrics.callCount, 1U);
+  EXPECT_EQ(metrics.totalTime, 0U);
+  EXPECT_FALSE(SerialCLI_GetCommandMetrics(nullptr, &metrics));
+
+  ASSERT_TRUE(SerialCLI_SetMetricsClock(&cli, readClock, nullptr));
+  for (const char *duration : {"0", "9", "10", "99", "100", "999999", "1000000", "12000000"}) {
+    execute(std::string("sleep ") + duration);
+  }
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&sleepEntry, &metrics));
+  EXPECT_EQ(metrics.callCount, 9U);
+  EXPECT_EQ(metrics.totalTime, 0U + 9U + 10U + 99U + 100U + 999999U + 1000000U + 12000000U);
+  EXPECT_EQ(metrics.maxTime, 12000000U);
+  const size_t expected[SERIAL_CLI_METRICS_BUCKET_COUNT] = {2, 2, 1, 0, 0, 1, 1, 1};
+  for (size_t i = 0; i < SERIAL_CLI_METRICS_BUCKET_COUNT; ++i) {
+    EXPECT_EQ(metrics.histogram[i], expected[i]) << "bucket " << i;
+  }
+
+  // A deferred command is measured until it completes
+  writeString("forever\r");
+  process();
+  writeString("\x03");
+  process();
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&foreverEntry, &metrics));
+  EXPECT_EQ(metrics.callCount, 1U);
+  EXPECT_GE(metrics.maxTime, 1000000U);
+  EXPECT_EQ(metrics.histogram[SERIAL_CLI_METRICS_BUCKET_COUNT - 2], 1U);
+
+  SerialCLI_Metrics counters;
+  ASSERT_TRUE(SerialCLI_GetMetrics(&cli, &counters));
+  EXPECT_EQ(counters.commandsCancelled, 1U);
+
+  ASSERT_TRUE(SerialCLI_ResetMetrics(&cli));
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&sleepEntry, &metrics));
+  EXPECT_EQ(metrics.callCount, 0U);
+  EXPECT_EQ(metrics.maxTime, 0U);
+}
+
+TEST_F(SerialCLIMetricsTest, StatsCommand) {
+  ASSERT_TRUE(SerialCLI_SetMetricsClock(&cli, readClock, nullptr));
+  execute("sleep 250");
+  execute("nope");
+  output.clear();
+  execute("stats");
+
+  EXPECT_NE(output.find("Lines: 1 executed, 1 rejected, 0 dropped\r\n"), std::string::npos) << output;
+  EXPECT_NE(output.find("  sleep              1       250       250      0      0      1      0"), std::string::npos)
+      << output;
+  EXPECT_NE(output.find("  stats              1         0         0"), std::string::npos) << output;
+  EXPECT_NE(output.find("  help               0"), std::string::npos) << output;
+
+  // The command is listed by help and takes no arguments
+  output.clear();
+  execute("help");
+  EXPECT_NE(output.find("  stats - "), std::string::npos);
+  output.clear();
+  execute("stats now");
+  EXPECT_NE(output.find("Usage: stats"), std::string::npos);
+}
+
+TEST_F(SerialCLIMetricsTest, RpcRequests) {
+  ASSERT_TRUE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_RPC));
+  ASSERT_TRUE(SerialCLI_ResetMetrics(&cli));
+
+  std::vector<const char *> argv = {"sleep", "3"};
+  char frame[64];
+  size_t length = encodeRpcRequest(&cli, frame, sizeof(frame), 1, argv);
+  SerialCLI_Read(&cli, frame, length);
+  SerialCLI_Read(&cli, "x\0", 2);
+  process();
+
+  SerialCLI_Metrics metrics;
+  ASSERT_TRUE(SerialCLI_GetMetrics(&cli, &metrics));
+  EXPECT_EQ(metrics.linesExecuted, 1U);
+  EXPECT_EQ(metrics.linesRejected, 1U);
+  EXPECT_EQ(metrics.bytesIn, length + 2U);
+  SerialCLI_CommandMetrics commandMetrics;
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&sleepEntry, &commandMetrics));
+  EXPECT_EQ(commandMetrics.callCount, 1U);
+}
+
+#else
+
+TEST_F(SerialCLIMetricsTest, CompiledOut) {
+  SerialCLI_Metrics metrics;
+  SerialCLI_CommandMetrics commandMetrics;
+  EXPECT_FALSE(SerialCLI_SetMetricsClock(&cli, readClock, nullptr));
+  EXPECT_FALSE(SerialCLI_GetMetrics(&cli, &metrics));
+  EXPECT_FALSE(SerialCLI_GetCommandMetrics(&sleepEntry, &commandMetrics));
+  EXPECT_FALSE(SerialCLI_ResetMetrics(&cli));
+
+  // No stats command is registered
+  output.clear();
+  execute("stats");
+  EXPECT_EQ(output.find("Lines:"), std::string::npos);
+}
+
+#endif
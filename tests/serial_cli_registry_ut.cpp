@@ -0,0 +1,238 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "serial_cli.h"
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_rpc.h"
+
+namespace {
+
+std::vector<std::string> calls;
+
+// Records the arguments the command was called with
+void recordCommand(SerialCLI *, int argc, const char **argv) {
+  std::string call;
+  for (int i = 0; i < argc; ++i) {
+    call += (i > 0) ? " " : "";
+    call += argv[i];
+  }
+  calls.push_back(call);
+}
+
+// One instance attaching the shared registry
+struct Console {
+  SerialCLI cli{};
+  SerialCLITestStorage storage;
+  std::string output;
+
+  Console() {
+    auto write = [](void *context, const char *str, size_t len) {
+      static_cast<Console *>(context)->output.append(str, len);
+    };
+    EXPECT_TRUE(initTestInstance(&cli, storage, write, this));
+  }
+
+  ~Console() { SerialCLI_Deinit(&cli); }
+
+  void execute(const std::string &line) {
+    SerialCLI_Read(&cli, line.data(), line.size());
+    SerialCLI_Read(&cli, "\r", 1);
+    while (SerialCLI_IsCommandPending(&cli)) {
+      SerialCLI_Process(&cli);
+    }
+  }
+};
+
+} // namespace
+
+class SerialCLIRegistryTest : public ::testing::Test {
+public:
+  SerialCLI_Registry registry{};
+  SerialCLI_CommandEntry reboot{};
+  SerialCLI_CommandEntry version{};
+  SerialCLI_CommandGroup net{};
+  SerialCLI_CommandEntry netShow{};
+
+protected:
+  void SetUp() override {
+    calls.clear();
+    ASSERT_TRUE(SerialCLI_InitRegistry(&registry));
+    reboot.commandName = "reboot";
+    reboot.commandDescription = "Reboots";
+    reboot.command = recordCommand;
+    ASSERT_TRUE(SerialCLI_RegistryAddCommand(&registry, &reboot));
+    version.commandName = "version";
+    version.commandDescription = "Prints the version";
+    version.command = recordCommand;
+    ASSERT_TRUE(SerialCLI_RegistryAddCommand(&registry, &version));
+    net.entry.commandName = "net";
+    net.entry.commandDescription = "Network";
+    ASSERT_TRUE(SerialCLI_RegistryAddGroup(&registry, nullptr, &net));
+    netShow.commandName = "show";
+    netShow.commandDescription = "Shows the interfaces";
+    netShow.command = recordCommand;
+    ASSERT_TRUE(SerialCLI_RegistryAddSubcommand(&registry, &net, &netShow));
+    ASSERT_TRUE(SerialCLI_SealRegistry(&registry));
+  }
+};
+
+TEST_F(SerialCLIRegistryTest, SharedByInstances) {
+  // Every instance dispatches the same entries, next to commands of its own
+  std::vector<Console> consoles(3);
+  SerialCLI_CommandEntry local{};
+  local.commandName = "local";
+  local.command = recordCommand;
+  for (auto &console : consoles) {
+    ASSERT_TRUE(SerialCLI_AttachRegistry(&console.cli, &registry));
+  }
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&consoles[1].cli, &local));
+
+  consoles[0].execute("reboot now");
+  consoles[1].execute("net show eth0");
+  consoles[1].execute("local 1");
+  consoles[2].execute("version");
+  consoles[2].execute("local 2");
+  EXPECT_EQ(calls, (std::vector<std::string>{"reboot now", "show eth0", "local 1", "version"}));
+
+  // Detached instances no longer see the shared commands
+  ASSERT_TRUE(SerialCLI_AttachRegistry(&consoles[0].cli, nullptr));
+  calls.clear();
+  consoles[0].execute("reboot");
+  EXPECT_TRUE(calls.empty());
+}
+
+TEST_F(SerialCLIRegistryTest, Names) {
+  Console console;
+  SerialCLI_CommandEntry local{};
+  local.commandName = "reboot";
+  local.command = recordCommand;
+
+  // A name is either registered with the instance or shared
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&console.cli, &local));
+  EXPECT_FALSE(SerialCLI_AttachRegistry(&console.cli, &registry));
+
+  // The built-in commands of the instance count as well
+  SerialCLI_CommandEntry help{};
+  help.commandName = "help";
+  help.command = recordCommand;
+  SerialCLI_Registry other{};
+  ASSERT_TRUE(SerialCLI_InitRegistry(&other));
+  ASSERT_TRUE(SerialCLI_RegistryAddCommand(&other, &help));
+  ASSERT_TRUE(SerialCLI_SealRegistry(&other));
+  EXPECT_FALSE(SerialCLI_AttachRegistry(&console.cli, &other));
+
+  Console attached;
+  ASSERT_TRUE(SerialCLI_AttachRegistry(&attached.cli, &registry));
+  SerialCLI_CommandEntry clash{};
+  clash.commandName = "version";
+  clash.command = recordCommand;
+  EXPECT_FALSE(SerialCLI_RegisterCommand(&attached.cli, &clash));
+  SerialCLI_CommandGroup group{};
+  group.entry.commandName = "version";
+  EXPECT_FALSE(SerialCLI_RegisterGroup(&attached.cli, nullptr, &group));
+}
+
+TEST_F(SerialCLIRegistryTest, Sealed) {
+  Console console;
+  ASSERT_TRUE(SerialCLI_AttachRegistry(&console.cli, &registry));
+
+  // Sealed registries and their groups do not change
+  SerialCLI_CommandEntry late{};
+  late.commandName = "late";
+  late.command = recordCommand;
+  EXPECT_FALSE(SerialCLI_RegistryAddCommand(&registry, &late));
+  EXPECT_FALSE(SerialCLI_RegistryAddSubcommand(&registry, &net, &late));
+  EXPECT_FALSE(SerialCLI_RegisterSubcommand(&console.cli, &net, &late));
+  SerialCLI_CommandGroup group{};
+  group.entry.commandName = "if";
+  EXPECT_FALSE(SerialCLI_RegisterGroup(&console.cli, &net, &group));
+
+  // Groups only take subcommands through their own registry
+  SerialCLI_Registry other{};
+  ASSERT_TRUE(SerialCLI_InitRegistry(&other));
+  EXPECT_FALSE(SerialCLI_RegistryAddSubcommand(&other, &net, &late));
+
+  // Registries still changing cannot be attached
+  EXPECT_FALSE(SerialCLI_AttachRegistry(&console.cli, &other));
+  EXPECT_EQ(console.cli.registry, &registry);
+  EXPECT_FALSE(SerialCLI_InitRegistry(nullptr));
+  EXPECT_FALSE(SerialCLI_SealRegistry(nullptr));
+  EXPECT_FALSE(SerialCLI_AttachRegistry(nullptr, &registry));
+}
+
+TEST_F(SerialCLIRegistryTest, HelpAndCompletion) {
+  Console console;
+  SerialCLI_CommandEntry local{};
+  local.commandName = "ver";
+  local.commandDescription = "Local";
+  local.command = recordCommand;
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&console.cli, &local));
+  ASSERT_TRUE(SerialCLI_AttachRegistry(&console.cli, &registry));
+
+  // The commands of the instance come first
+  console.execute("help");
+  EXPECT_NE(console.output.find("  ver - Local\r\n  reboot - Reboots\r\n  version - Prints the version\r\n  net - "),
+            std::string::npos)
+      << console.output;
+  console.output.clear();
+  console.execute("help net");
+  EXPECT_NE(console.output.find("Available net commands:\r\n  show - Shows the interfaces\r\n"), std::string::npos);
+
+  // Candidates of both are completed together
+  console.output.clear();
+  SerialCLI_Read(&console.cli, "ve\t", 3);
+  EXPECT_EQ(console.output, "ver");
+  SerialCLI_Read(&console.cli, "\t", 1);
+  EXPECT_NE(console.output.find("ver  version  "), std::string::npos) << console.output;
+  SerialCLI_Read(&console.cli, "\x03", 1);
+
+  // Shared groups complete their subcommands
+  calls.clear();
+  SerialCLI_Read(&console.cli, "re\t", 3);
+  console.execute("");
+  SerialCLI_Read(&console.cli, "net sh\t", 7);
+  console.execute("");
+  EXPECT_EQ(calls, (std::vector<std::string>{"reboot", "show"}));
+}
+
+TEST_F(SerialCLIRegistryTest, Rpc) {
+  Console console;
+  ASSERT_TRUE(SerialCLI_AttachRegistry(&console.cli, &registry));
+  ASSERT_TRUE(SerialCLI_SetMode(&console.cli, SERIAL_CLI_MODE_RPC));
+
+  char frame[64];
+  std::vector<const char *> argv = {"net", "show", "eth0"};
+  size_t length = encodeRpcRequest(&console.cli, frame, sizeof(frame), 1, argv);
+  SerialCLI_Read(&console.cli, frame, length);
+  while (SerialCLI_IsCommandPending(&console.cli)) {
+    SerialCLI_Process(&console.cli);
+  }
+  EXPECT_EQ(calls, (std::vector<std::string>{"show eth0"}));
+}
+
+#if SERIAL_CLI_ENABLE_METRICS
+
+TEST_F(SerialCLIRegistryTest, Metrics) {
+  std::vector<Console> consoles(2);
+  for (auto &console : consoles) {
+    ASSERT_TRUE(SerialCLI_AttachRegistry(&console.cli, &registry));
+  }
+  consoles[0].execute("version");
+  consoles[1].execute("version");
+
+  // The instances count calls of the shared commands together
+  SerialCLI_CommandMetrics metrics;
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&version, &metrics));
+  EXPECT_EQ(metrics.callCount, 2U);
+  consoles[0].execute("stats");
+  EXPECT_NE(consoles[0].output.find("  version            2"), std::string::npos) << consoles[0].output;
+  EXPECT_NE(consoles[0].output.find("    show             0"), std::string::npos) << consoles[0].output;
+
+  ASSERT_TRUE(SerialCLI_ResetMetrics(&consoles[1].cli));
+  ASSERT_TRUE(SerialCLI_GetCommandMetrics(&version, &metrics));
+  EXPECT_EQ(metrics.callCount, 0U);
+}
+
+#endif
@@ -0,0 +1,348 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_rpc.h"
+
+namespace {
+
+struct Response {
+  uint8_t type;
+  uint16_t requestId;
+  uint8_t status;
+  std::string data;
+};
+
+void echoCommand(SerialCLI *cli, int argc, const char **argv) {
+  for (int i = 0; i < argc; ++i) {
+    SerialCLI_WriteString(cli, "%s%s", (i > 0) ? " " : "", argv[i]);
+  }
+}
+
+void countCommand(SerialCLI *cli, int, const char **argv) {
+  int count = std::stoi(argv[1]);
+  for (int i = 0; i < count; ++i) {
+    SerialCLI_WriteString(cli, "%04d ", i);
+  }
+}
+
+void lengthCommand(SerialCLI *cli, int, const char **argv) { SerialCLI_WriteString(cli, "%zu", strlen(argv[1])); }
+
+void failCommand(SerialCLI *cli, int, const char **) { SerialCLI_FailCommand(cli); }
+
+void modeCommand(SerialCLI *cli, int, const char **argv) {
+  SerialCLI_SetMode(cli, (std::string(argv[1]) == "rpc") ? SERIAL_CLI_MODE_RPC : SERIAL_CLI_MODE_TEXT);
+}
+
+} // namespace
+
+class SerialCLIRpcTest : public SerialCLITest {
+public:
+  SerialCLI_CommandEntry commands[5]{};
+
+  std::string encode(uint16_t requestId, std::vector<const char *> argv) {
+    char frame[1024];
+    size_t length = encodeRpcRequest(&cli, frame, sizeof(frame), requestId, argv);
+    EXPECT_GT(length, 0U);
+    return std::string(frame, length);
+  }
+
+  // Splits the output at the frame delimiters
+  static std::vector<Response> decodeOutput() {
+    std::vector<Response> responses;
+    size_t start = 0;
+    for (size_t end = output.find('\0', start); end != std::string::npos;
+         start = end + 1, end = output.find('\0', start)) {
+      std::string frame = output.substr(start, end - start);
+      SerialCLI_RpcResponse response;
+      EXPECT_TRUE(SerialCLI_RpcDecodeResponse(frame.data(), frame.size(), &response));
+      responses.push_back(
+          {response.type, response.requestId, response.status, std::string(response.data, response.dataLength)});
+    }
+    output.clear();
+    return responses;
+  }
+
+  void read(const std::string &input) { SerialCLI_Read(&cli, input.data(), input.size()); }
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    const char *names[] = {"echo", "count", "length", "fail", "mode"};
+    SerialCLI_Command functions[] = {echoCommand, countCommand, lengthCommand, failCommand, modeCommand};
+    for (size_t i = 0; i < 5; ++i) {
+      commands[i].commandName = names[i];
+      commands[i].command = functions[i];
+      ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commands[i]));
+    }
+    ASSERT_TRUE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_RPC));
+    output.clear();
+  }
+};
+
+TEST_F(SerialCLIRpcTest, Request) {
+  read(encode(7, {"echo", "a", "", "b c"}));
+  EXPECT_TRUE(output.empty());
+  process();
+
+  auto responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 1U);
+  EXPECT_EQ(responses[0].type, SERIAL_CLI_RPC_RESULT);
+  EXPECT_EQ(responses[0].requestId, 7);
+  EXPECT_EQ(responses[0].status, SERIAL_CLI_RPC_STATUS_OK);
+  EXPECT_EQ(responses[0].data, "echo a  b c");
+}
+
+TEST_F(SerialCLIRpcTest, Pipelined) {
+  std::string input;
+  for (uint16_t id = 1; id <= 3; ++id) {
+    input += encode(id, {"echo", std::to_string(id * 11).c_str()});
+  }
+  read(input);
+  EXPECT_TRUE(SerialCLI_IsCommandPending(&cli));
+  process();
+
+  auto responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 3U);
+  for (uint16_t id = 1; id <= 3; ++id) {
+    EXPECT_EQ(responses[id - 1].requestId, id);
+    EXPECT_EQ(responses[id - 1].data, "echo " + std::to_string(id * 11));
+  }
+}
+
+TEST_F(SerialCLIRpcTest, OutputFrames) {
+  // Output exceeding the TX buffer is sent ahead in output frames
+  read(encode(9, {"count", "100"}));
+  process();
+
+  auto responses = decodeOutput();
+  ASSERT_GT(responses.size(), 1U);
+  std::string data;
+  for (size_t i = 0; i < responses.size(); ++i) {
+    EXPECT_EQ(responses[i].type, (i + 1 < responses.size()) ? SERIAL_CLI_RPC_OUTPUT : SERIAL_CLI_RPC_RESULT);
+    EXPECT_EQ(responses[i].requestId, 9);
+    data += responses[i].data;
+  }
+  EXPECT_EQ(data.size(), 500U);
+  EXPECT_EQ(data.substr(495), "0099 ");
+}
+
+TEST_F(SerialCLIRpcTest, LongArgument) {
+  // Runs of more than 254 non-zero bytes take several COBS blocks
+  std::string argument(300, 'x');
+  read(encode(1, {"length", argument.c_str()}));
+  process();
+
+  auto responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 1U);
+  EXPECT_EQ(responses[0].data, "300");
+}
+
+TEST_F(SerialCLIRpcTest, Errors) {
+  read(encode(1, {"missing"}));
+  read(encode(2, {"echo", "1", "2", "3", "4", "5", "6", "7", "8"}));
+
+  std::string corrupt = encode(3, {"echo", "x"});
+  corrupt[corrupt.size() - 3] ^= 0x20;
+  read(corrupt);
+
+  // The next frame is received normally after the corrupt one
+  read(encode(4, {"echo"}));
+  read(encode(5, {"fail"}));
+  process();
+
+  auto responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 5U);
+  EXPECT_EQ(responses[0].status, SERIAL_CLI_RPC_STATUS_UNKNOWN_COMMAND);
+  EXPECT_EQ(responses[1].status, SERIAL_CLI_RPC_STATUS_INVALID_ARGUMENTS);
+  EXPECT_EQ(responses[2].status, SERIAL_CLI_RPC_STATUS_CORRUPT_FRAME);
+  EXPECT_EQ(responses[3].status, SERIAL_CLI_RPC_STATUS_OK);
+  EXPECT_EQ(responses[3].requestId, 4);
+  EXPECT_EQ(responses[4].status, SERIAL_CLI_RPC_STATUS_COMMAND_FAILED);
+}
+
+TEST_F(SerialCLIRpcTest, OversizedFrame) {
+  std::string argument(SERIAL_CLI_INPUT_BUFFER_SIZE, 'x');
+  std::string input = encode(1, {"length", argument.c_str()}) + encode(2, {"echo"});
+  EXPECT_FALSE(SerialCLI_Read(&cli, input.data(), input.size()));
+  process();
+
+  auto responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 1U);
+  EXPECT_EQ(responses[0].requestId, 2);
+}
+
+TEST_F(SerialCLIRpcTest, ReadFromISR) {
+  std::string input = encode(5, {"echo", "isr"});
+  EXPECT_EQ(SerialCLI_ReadFromISR(&cli, input.data(), input.size()), input.size());
+  process();
+
+  auto responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 1U);
+  EXPECT_EQ(responses[0].data, "echo isr");
+}
+
+TEST_F(SerialCLIRpcTest, SwitchModes) {
+  // Leaving RPC mode completes the request and brings back the prompt
+  read(encode(6, {"mode", "text"}));
+  process();
+  size_t promptPosition = output.rfind(">> ");
+  ASSERT_NE(promptPosition, std::string::npos);
+  output.erase(promptPosition);
+  auto responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 1U);
+  EXPECT_EQ(responses[0].requestId, 6);
+
+  writeString("mode rpc\r");
+  process();
+  output.clear();
+
+  // No echo and no prompt in RPC mode
+  read(encode(8, {"echo"}));
+  process();
+  EXPECT_EQ(output.find(">>"), std::string::npos);
+  responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 1U);
+  EXPECT_EQ(responses[0].data, "echo");
+
+  // Output outside of a request is framed as well
+  SerialCLI_WriteString(&cli, "event");
+  SerialCLI_Flush(&cli);
+  responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 1U);
+  EXPECT_EQ(responses[0].type, SERIAL_CLI_RPC_NOTIFY);
+  EXPECT_EQ(responses[0].data, "event");
+
+  EXPECT_FALSE(SerialCLI_SetMode(nullptr, SERIAL_CLI_MODE_TEXT));
+}
+
+TEST_F(SerialCLIRpcTest, HashCollidingNames) {
+  // Both names share their FNV-1a hash, the command IDs do not depend on the names
+  SerialCLI_CommandEntry first{};
+  first.commandName = "glbvs";
+  first.command = echoCommand;
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &first));
+  SerialCLI_CommandEntry second{};
+  second.commandName = "yacxa";
+  second.command = echoCommand;
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &second));
+  EXPECT_EQ(second.commandId, first.commandId + 1);
+
+  // Shared commands are numbered apart from the ones of the instance
+  SerialCLI_CommandEntry shared{};
+  shared.commandName = "shared";
+  shared.command = echoCommand;
+  SerialCLI_Registry registry{};
+  ASSERT_TRUE(SerialCLI_InitRegistry(&registry));
+  ASSERT_TRUE(SerialCLI_RegistryAddCommand(&registry, &shared));
+  ASSERT_TRUE(SerialCLI_SealRegistry(&registry));
+  ASSERT_TRUE(SerialCLI_AttachRegistry(&cli, &registry));
+  EXPECT_NE(shared.commandId, commands[0].commandId);
+
+  read(encode(9, {"yacxa"}));
+  read(encode(10, {"glbvs"}));
+  read(encode(11, {"shared"}));
+  process();
+  auto responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 3U);
+  EXPECT_EQ(responses[0].data, "yacxa");
+  EXPECT_EQ(responses[1].data, "glbvs");
+  EXPECT_EQ(responses[2].data, "shared");
+  SerialCLI_AttachRegistry(&cli, nullptr);
+}
+
+TEST_F(SerialCLIRpcTest, ListCommands) {
+  char frame[32];
+  size_t length = SerialCLI_RpcEncodeRequest(frame, sizeof(frame), 3, SERIAL_CLI_RPC_LIST_COMMANDS, 0, nullptr);
+  read(std::string(frame, length));
+  process();
+
+  // Long lists arrive in several output frames
+  auto responses = decodeOutput();
+  ASSERT_GE(responses.size(), 1U);
+  std::string list;
+  for (const Response &response : responses) {
+    EXPECT_EQ(response.requestId, 3);
+    list += response.data;
+  }
+  EXPECT_EQ(responses.back().type, SERIAL_CLI_RPC_RESULT);
+  EXPECT_EQ(responses.back().status, SERIAL_CLI_RPC_STATUS_OK);
+  EXPECT_EQ(list.substr(0, 9), std::string("\0\0\0\0help", 9));
+
+  // The list names the command IDs the instance dispatches on
+  for (const char *name : {"help", "echo", "count", "length", "fail", "mode"}) {
+    uint32_t listedId = 0;
+    uint32_t commandId = 1;
+    EXPECT_TRUE(SerialCLI_RpcFindCommandId(list.data(), list.size(), name, &listedId)) << name;
+    EXPECT_TRUE(SerialCLI_RpcGetCommandId(&cli, name, &commandId));
+    EXPECT_EQ(listedId, commandId) << name;
+  }
+  uint32_t commandId = 0;
+  EXPECT_FALSE(SerialCLI_RpcFindCommandId(list.data(), list.size(), "ech", &commandId));
+  EXPECT_FALSE(SerialCLI_RpcGetCommandId(&cli, "ech", &commandId));
+
+  // The list request takes no arguments
+  const char *argv[] = {"x"};
+  length = SerialCLI_RpcEncodeRequest(frame, sizeof(frame), 4, SERIAL_CLI_RPC_LIST_COMMANDS, 1, argv);
+  read(std::string(frame, length));
+  process();
+  responses = decodeOutput();
+  ASSERT_EQ(responses.size(), 1U);
+  EXPECT_EQ(responses[0].status, SERIAL_CLI_RPC_STATUS_INVALID_ARGUMENTS);
+}
+
+TEST(SerialCLIRpc, Codec) {
+  char frame[16];
+  const char *argv[] = {"x"};
+  EXPECT_EQ(SerialCLI_RpcEncodeRequest(frame, 8, 1, 0, 1, argv), 0U);
+  EXPECT_EQ(SerialCLI_RpcEncodeRequest(frame, sizeof(frame), 1, 0, 1, nullptr), 0U);
+  EXPECT_EQ(SerialCLI_RpcEncodeRequest(frame, sizeof(frame), 1, 0, -1, argv), 0U);
+  EXPECT_EQ(SerialCLI_RpcEncodeRequest(nullptr, sizeof(frame), 1, 0, 1, argv), 0U);
+
+  size_t length = SerialCLI_RpcEncodeRequest(frame, sizeof(frame), 1, 0, 1, argv);
+  ASSERT_GT(length, 0U);
+  EXPECT_EQ(frame[length - 1], SERIAL_CLI_RPC_DELIMITER);
+  EXPECT_EQ(std::string(frame, length - 1).find('\0'), std::string::npos);
+
+  // Reference CRC-16/CCITT-FALSE, bit by bit
+  auto crc16 = [](const std::string &data) {
+    uint16_t crc = 0xFFFF;
+    for (char ch : data) {
+      crc ^= (uint16_t)((uint8_t)ch << 8);
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (uint16_t)((crc & 0x8000U) ? ((crc << 1) ^ 0x1021U) : (crc << 1));
+      }
+    }
+    return crc;
+  };
+  EXPECT_EQ(crc16("123456789"), 0x29B1);
+
+  // A response without zero bytes is a single COBS block
+  std::string decoded = std::string{SERIAL_CLI_RPC_RESULT, 0x01, 0x02, 0x03} + "123456789";
+  uint16_t crc = crc16(decoded);
+  decoded += {(char)(crc & 0xFFU), (char)(crc >> 8)};
+  ASSERT_EQ(decoded.find('\0'), std::string::npos);
+  std::string encoded = (char)(decoded.size() + 1) + decoded;
+
+  SerialCLI_RpcResponse response;
+  std::string received = encoded;
+  ASSERT_TRUE(SerialCLI_RpcDecodeResponse(received.data(), received.size(), &response));
+  EXPECT_EQ(response.type, SERIAL_CLI_RPC_RESULT);
+  EXPECT_EQ(response.requestId, 0x0201);
+  EXPECT_EQ(response.status, 3);
+  EXPECT_EQ(std::string(response.data, response.dataLength), "123456789");
+
+  received = encoded;
+  received[5] = '0';
+  EXPECT_FALSE(SerialCLI_RpcDecodeResponse(received.data(), received.size(), &response));
+
+  // A list entry without its terminator ends the list
+  const char list[] = {1, 0, 0, 0, 'a', '\0', 2, 0, 0, 0, 'b'};
+  uint32_t commandId = 0;
+  EXPECT_TRUE(SerialCLI_RpcFindCommandId(list, sizeof(list), "a", &commandId));
+  EXPECT_EQ(commandId, 1U);
+  EXPECT_FALSE(SerialCLI_RpcFindCommandId(list, sizeof(list), "b", &commandId));
+  EXPECT_FALSE(SerialCLI_RpcFindCommandId(nullptr, 1, "a", &commandId));
+}
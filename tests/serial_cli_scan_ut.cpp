@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "serial_cli.h"
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_parser.h"
+#include "serial_cli_scan.h"
+
+namespace {
+
+using Scanner = size_t (*)(const char *, size_t);
+
+std::string output;
+std::string executed;
+
+// Records the arguments of every call
+void recordCommand(SerialCLI *, int argc, const char **argv) {
+  for (int i = 0; i < argc; ++i) {
+    executed += argv[i];
+    executed += '|';
+  }
+  executed += '\n';
+}
+
+// Random bytes, biased towards the bytes the scanners look for
+std::string makeBytes(std::mt19937 &random, size_t length) {
+  static const char special[] = {'\0', '\t', '\n', '\v', '\f', '\r', ' ', '\"', 0x1F, 0x7F, (char)0x80, (char)0xFF};
+  std::string bytes(length, 'a');
+  for (char &ch : bytes) {
+    unsigned kind = random() % 8;
+    if (0 == kind) {
+      ch = special[random() % sizeof(special)];
+    } else if (1 == kind) {
+      ch = (char)(random() % 256);
+    } else {
+      ch = (char)('a' + (random() % 26));
+    }
+  }
+  return bytes;
+}
+
+// Random lines with runs of plain characters, quotes, line editing and line endings
+std::string makeInput(std::mt19937 &random, size_t pieceCount) {
+  static const char *const pieces[] = {"record", " ", "  ", "\t", "\"", "arg", "\x7f", "\b", "\r", "\n", "\r\n",
+                                       "\x03", "\x1b[D", "\x1b[C", "\x01", "\x05", "\x0b", "\x17", "\x1bOH", "\x07"};
+  std::string input;
+  for (size_t i = 0; i < pieceCount; ++i) {
+    if (0 == (random() % 64)) {
+      input.append(SERIAL_CLI_INPUT_BUFFER_SIZE - 8 + (random() % 16), 'x');
+      continue;
+    }
+    input += pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))];
+  }
+  return input;
+}
+
+} // namespace
+
+class SerialCLIScanTest : public ::testing::TestWithParam<SerialCLI_Mode> {
+public:
+  SerialCLI cli;
+  SerialCLITestStorage storage;
+  SerialCLI_CommandEntry recordEntry{};
+
+  // Output and executed arguments of the input read in chunks of at most chunkSize bytes. A chunk ends at
+  // every line ending and Ctrl+C, so the lines run in between like they do with one byte at a time.
+  std::pair<std::string, std::string> run(const std::string &input, size_t chunkSize) {
+    output.clear();
+    executed.clear();
+    EXPECT_TRUE(
+        initTestInstance(&cli, storage, [](void *, const char *str, size_t len) { output.append(str, len); }, nullptr));
+    recordEntry.commandName = "record";
+    recordEntry.command = recordCommand;
+    EXPECT_TRUE(SerialCLI_RegisterCommand(&cli, &recordEntry));
+    EXPECT_TRUE(SerialCLI_SetMode(&cli, GetParam()));
+
+    for (size_t i = 0; i < input.size();) {
+      size_t end = std::min(input.find_first_of("\r\n\x03", i), input.size() - 1) + 1;
+      size_t length = std::min(chunkSize, end - i);
+      SerialCLI_Read(&cli, &input[i], length);
+      i += length;
+      while (SerialCLI_IsCommandPending(&cli)) {
+        SerialCLI_Process(&cli);
+      }
+    }
+    SerialCLI_Deinit(&cli);
+    return {output, executed};
+  }
+};
+
+TEST(SerialCLIScan, ScannersMatchReference) {
+  std::mt19937 random(19);
+  const std::vector<std::pair<Scanner, Scanner>> scanners = {
+      {SerialCLI_ScanControl, SerialCLI_ScanControlScalar},
+      {SerialCLI_ScanControlSwar, SerialCLI_ScanControlScalar},
+      {SerialCLI_ScanDelimiter, SerialCLI_ScanDelimiterScalar},
+      {SerialCLI_ScanDelimiterSwar, SerialCLI_ScanDelimiterScalar},
+  };
+
+  // Every offset and length, so each match position meets every alignment
+  for (size_t round = 0; round < 64; ++round) {
+    const std::string bytes = makeBytes(random, 80);
+    for (size_t offset = 0; offset < 16; ++offset) {
+      for (size_t length = 0; (offset + length) <= bytes.size(); ++length) {
+        for (const auto &[scanner, reference] : scanners) {
+          ASSERT_EQ(scanner(&bytes[offset], length), reference(&bytes[offset], length))
+              << "round " << round << " offset " << offset << " length " << length;
+        }
+      }
+    }
+  }
+
+  // Long runs without a match
+  const std::string plain(1000, 'p');
+  EXPECT_EQ(SerialCLI_ScanControl(plain.data(), plain.size()), plain.size());
+  EXPECT_EQ(SerialCLI_ScanDelimiter(plain.data(), plain.size()), plain.size());
+  EXPECT_EQ(SerialCLI_ScanControl(nullptr, 0), 0U);
+}
+
+TEST(SerialCLIScan, ParserMatchesReference) {
+  std::mt19937 random(20);
+  SerialCLI cli;
+  SerialCLITestStorage storage;
+  ASSERT_TRUE(initTestInstance(&cli, storage, [](void *, const char *, size_t) {}, nullptr));
+
+  for (size_t round = 0; round < 20000; ++round) {
+    std::string line = makeBytes(random, random() % SERIAL_CLI_INPUT_BUFFER_SIZE);
+    std::string referenceLine = line;
+
+    const char *command = SerialCLI_ParseInput(&cli, line.data(), line.size());
+    std::vector<std::ptrdiff_t> tokens;
+    for (size_t i = 0; i < cli.tokenCount; ++i) {
+      tokens.push_back(cli.argv[i] - line.data());
+    }
+
+    const char *referenceCommand = SerialCLI_ParseInputReference(&cli, referenceLine.data(), referenceLine.size());
+    std::vector<std::ptrdiff_t> referenceTokens;
+    for (size_t i = 0; i < cli.tokenCount; ++i) {
+      referenceTokens.push_back(cli.argv[i] - referenceLine.data());
+    }
+
+    // The same arguments start at the same offsets of lines split the same way
+    ASSERT_EQ(NULL == command, NULL == referenceCommand) << "round " << round;
+    ASSERT_EQ(tokens, referenceTokens) << "round " << round;
+    ASSERT_EQ(line, referenceLine) << "round " << round;
+  }
+  SerialCLI_Deinit(&cli);
+}
+
+TEST_P(SerialCLIScanTest, ChunksMatchBytes) {
+  std::mt19937 random(21);
+  size_t executedCount = 0;
+  for (size_t round = 0; round < 200; ++round) {
+    const std::string input = makeInput(random, 64);
+    auto [referenceOutput, referenceExecuted] = run(input, 1);
+    executedCount += (size_t)std::count(referenceExecuted.begin(), referenceExecuted.end(), '\n');
+    for (size_t chunkSize : {2U, 7U, 64U, 4096U}) {
+      auto [chunkOutput, chunkExecuted] = run(input, chunkSize);
+      ASSERT_EQ(chunkOutput, referenceOutput) << "round " << round << " chunk " << chunkSize;
+      ASSERT_EQ(chunkExecuted, referenceExecuted) << "round " << round << " chunk " << chunkSize;
+    }
+  }
+  EXPECT_GT(executedCount, 20U);
+}
+
+INSTANTIATE_TEST_SUITE_P(Modes, SerialCLIScanTest, ::testing::Values(SERIAL_CLI_MODE_TEXT, SERIAL_CLI_MODE_BATCH));
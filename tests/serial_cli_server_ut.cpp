@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#include "serial_cli.h"
+#include "serial_cli_server.h"
+
+class SerialCLIServerTest : public ::testing::Test {
+public:
+  static constexpr size_t sessionCapacity = 4;
+
+  SerialCLI_Server server;
+  std::vector<SerialCLI_Session> sessions{sessionCapacity};
+  SerialCLI_CommandEntry whoami{};
+  SerialCLI_Registry registry{};
+  std::vector<int> clients;
+
+  // Replies with the index of the session running the command
+  static void whoamiCommand(SerialCLI *cli, int, const char **) {
+    auto *session = static_cast<SerialCLI_Session *>(SerialCLI_GetContext(cli));
+    SerialCLI_WriteString(cli, "session %zu\r\n", (size_t)(session - session->server->sessions));
+  }
+
+  int connectClient() {
+    int fds[2];
+    EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    if (nullptr == SerialCLI_ServerOpenSession(&server, fds[0])) {
+      close(fds[0]);
+    }
+    clients.push_back(fds[1]);
+    return fds[1];
+  }
+
+  static std::string readUntil(int fd, std::string_view expected) {
+    std::string received;
+    struct pollfd pollFd = {fd, POLLIN, 0};
+    while ((received.find(expected) == std::string::npos) && (poll(&pollFd, 1, 1000) > 0)) {
+      char buffer[256];
+      ssize_t length = read(fd, buffer, sizeof(buffer));
+      if (length <= 0) {
+        break;
+      }
+      received.append(buffer, (size_t)length);
+    }
+    return received;
+  }
+
+  static void send(int fd, std::string_view input) {
+    ASSERT_EQ(write(fd, input.data(), input.size()), (ssize_t)input.size());
+  }
+
+protected:
+  void SetUp() override {
+    whoami.command = whoamiCommand;
+    whoami.commandName = "whoami";
+    ASSERT_TRUE(SerialCLI_InitRegistry(&registry));
+    ASSERT_TRUE(SerialCLI_RegistryAddCommand(&registry, &whoami));
+    ASSERT_TRUE(SerialCLI_SealRegistry(&registry));
+    ASSERT_TRUE(SerialCLI_ServerInit(&server, sessions.data(), sessions.size(), &registry));
+  }
+
+  void TearDown() override {
+    SerialCLI_ServerClose(&server);
+    for (int fd : clients) {
+      close(fd);
+    }
+  }
+};
+
+TEST_F(SerialCLIServerTest, SessionsAreIndependent) {
+  int first = connectClient();
+  int second = connectClient();
+  EXPECT_EQ(server.sessionCount, 2U);
+
+  // Partial input of one session does not leak into the other
+  send(first, "who");
+  send(second, "whoami\r");
+  EXPECT_TRUE(SerialCLI_ServerPoll(&server, 1000));
+  EXPECT_NE(readUntil(second, "session 1").find("session 1"), std::string::npos);
+
+  send(first, "ami\r");
+  EXPECT_TRUE(SerialCLI_ServerPoll(&server, 1000));
+  EXPECT_NE(readUntil(first, "session 0").find("session 0"), std::string::npos);
+}
+
+TEST_F(SerialCLIServerTest, PoolExhaustion) {
+  for (size_t i = 0; i < sessionCapacity; ++i) {
+    connectClient();
+  }
+  EXPECT_EQ(server.sessionCount, sessionCapacity);
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  EXPECT_EQ(SerialCLI_ServerOpenSession(&server, fds[0]), nullptr);
+  close(fds[0]);
+  close(fds[1]);
+
+  // A client hanging up returns its session to the pool
+  close(clients.back());
+  clients.pop_back();
+  EXPECT_TRUE(SerialCLI_ServerPoll(&server, 1000));
+  EXPECT_EQ(server.sessionCount, sessionCapacity - 1);
+
+  int client = connectClient();
+  EXPECT_EQ(server.sessionCount, sessionCapacity);
+  send(client, "whoami\r");
+  EXPECT_TRUE(SerialCLI_ServerPoll(&server, 1000));
+  EXPECT_NE(readUntil(client, "session 3").find("session 3"), std::string::npos);
+}
+
+TEST_F(SerialCLIServerTest, ListenUnix) {
+  std::string path = "/tmp/serial_cli_server_ut." + std::to_string(getpid());
+  ASSERT_TRUE(SerialCLI_ServerListenUnix(&server, path.c_str()));
+
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+  int client = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_EQ(connect(client, (const struct sockaddr *)&address, sizeof(address)), 0);
+  clients.push_back(client);
+
+  EXPECT_TRUE(SerialCLI_ServerPoll(&server, 1000));
+  EXPECT_EQ(server.sessionCount, 1U);
+  EXPECT_NE(readUntil(client, ">>").find(">>"), std::string::npos);
+
+  send(client, "whoami\r");
+  EXPECT_TRUE(SerialCLI_ServerPoll(&server, 1000));
+  EXPECT_NE(readUntil(client, "session 0").find("session 0"), std::string::npos);
+
+  // Closing the server removes the socket file
+  SerialCLI_ServerClose(&server);
+  EXPECT_NE(access(path.c_str(), F_OK), 0);
+}
+
+TEST_F(SerialCLIServerTest, PTYSession) {
+  char slaveName[64];
+  ASSERT_NE(SerialCLI_ServerOpenPTY(&server, slaveName, sizeof(slaveName)), nullptr);
+
+  int slaveFd = open(slaveName, O_RDWR | O_NOCTTY);
+  ASSERT_GE(slaveFd, 0);
+  clients.push_back(slaveFd);
+  send(slaveFd, "whoami\r");
+  EXPECT_TRUE(SerialCLI_ServerPoll(&server, 1000));
+  EXPECT_NE(readUntil(slaveFd, "session 0").find("session 0"), std::string::npos);
+}
+
+TEST_F(SerialCLIServerTest, SlowClient) {
+  // A small socket buffer fills up after a few lines
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  int bufferSize = 4096;
+  ASSERT_EQ(setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)), 0);
+  ASSERT_NE(SerialCLI_ServerOpenSession(&server, fds[0]), nullptr);
+  int slow = fds[1];
+  clients.push_back(slow);
+  int fast = connectClient();
+
+  constexpr size_t lineCount = 2000;
+  std::string lines;
+  for (size_t i = 0; i < lineCount; ++i) {
+    lines += "whoami\r";
+  }
+  send(slow, lines);
+
+  // The other session is served while the slow client does not read
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(SerialCLI_ServerPoll(&server, 0));
+  }
+  EXPECT_EQ(server.sessionCount, 2U);
+  EXPECT_TRUE(SerialCLI_IsTxBlocked(&sessions[0].cli));
+  send(fast, "whoami\r");
+  EXPECT_TRUE(SerialCLI_ServerPoll(&server, 1000));
+  EXPECT_NE(readUntil(fast, "session 1").find("session 1"), std::string::npos);
+
+  // Reading the output lets the remaining lines run without losing any output
+  ASSERT_EQ(fcntl(slow, F_SETFL, O_NONBLOCK), 0);
+  std::string received;
+  size_t answerCount = 0;
+  for (int i = 0; (i < 10000) && (answerCount < lineCount); ++i) {
+    EXPECT_TRUE(SerialCLI_ServerPoll(&server, 10));
+    char buffer[4096];
+    ssize_t length = read(slow, buffer, sizeof(buffer));
+    if (length > 0) {
+      received.append(buffer, (size_t)length);
+    }
+    for (size_t position = received.find("session 0"); position != std::string::npos;
+         position = received.find("session 0")) {
+      ++answerCount;
+      received.erase(0, position + 1);
+    }
+  }
+  EXPECT_EQ(answerCount, lineCount);
+  EXPECT_EQ(sessions[0].cli.txDropped, 0U);
+}
+
+TEST_F(SerialCLIServerTest, Callbacks) {
+  static size_t openCount = 0;
+  static size_t closeCount = 0;
+  openCount = 0;
+  closeCount = 0;
+  ASSERT_TRUE(SerialCLI_ServerSetCallbacks(
+      &server, [](void *, SerialCLI_Session *) { ++openCount; }, [](void *, SerialCLI_Session *) { ++closeCount; },
+      nullptr));
+
+  connectClient();
+  EXPECT_EQ(openCount, 1U);
+  SerialCLI_ServerClose(&server);
+  EXPECT_EQ(closeCount, 1U);
+}
+
+TEST(SerialCLIServer, InvalidArguments) {
+  SerialCLI_Server server;
+  SerialCLI_Session session;
+  SerialCLI_Registry registry{};
+
+  EXPECT_FALSE(SerialCLI_ServerInit(nullptr, &session, 1, nullptr));
+  EXPECT_FALSE(SerialCLI_ServerInit(&server, nullptr, 1, nullptr));
+  EXPECT_FALSE(SerialCLI_ServerInit(&server, &session, 0, nullptr));
+
+  // The sessions read the registry from the loop and the workers, it must not change any more
+  ASSERT_TRUE(SerialCLI_InitRegistry(&registry));
+  EXPECT_FALSE(SerialCLI_ServerInit(&server, &session, 1, &registry));
+  EXPECT_EQ(SerialCLI_ServerOpenSession(nullptr, 0), nullptr);
+  EXPECT_FALSE(SerialCLI_ServerPoll(nullptr, 0));
+  EXPECT_FALSE(SerialCLI_ServerStop(nullptr));
+}
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "serial_cli_commands.h"
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_rpc.h"
+
+#if SERIAL_CLI_ENABLE_STATIC_COMMANDS
+
+namespace {
+
+std::vector<std::string> calls;
+
+// Records the arguments the command was called with
+void recordCommand(SerialCLI *, int argc, const char **argv) {
+  std::string call;
+  for (int i = 0; i < argc; ++i) {
+    call += (i > 0) ? " " : "";
+    call += argv[i];
+  }
+  calls.push_back(call);
+}
+
+// Fails when called with an argument
+void checkCommand(SerialCLI *cli, int argc, const char **argv) {
+  if (argc > 1) {
+    SerialCLI_FailCommand(cli);
+    return;
+  }
+  recordCommand(cli, argc, argv);
+}
+
+void noopCommand(SerialCLI *, int, const char **) {}
+
+} // namespace
+
+// Defined out of order, the linker sorts the table
+SERIAL_CLI_COMMAND(uptime, recordCommand, "Uptime");
+SERIAL_CLI_COMMAND(fw_crc, checkCommand, "CRC");
+
+class SerialCLIStaticTest : public SerialCLITest {
+public:
+  SerialCLI_CommandEntry fwUpdate{};
+
+  void execute(const std::string &line) {
+    writeString(line + "\r");
+    process();
+  }
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    calls.clear();
+    fwUpdate.commandName = "fw_update";
+    fwUpdate.commandDescription = "Updates the firmware";
+    fwUpdate.command = noopCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &fwUpdate));
+  }
+};
+
+TEST_F(SerialCLIStaticTest, Table) {
+  size_t count = 0;
+  const SerialCLI_StaticCommand *commands = SerialCLI_GetStaticCommands(&count);
+  ASSERT_EQ(count, 2U);
+  EXPECT_STREQ(commands[0].commandName, "fw_crc");
+  EXPECT_STREQ(commands[1].commandName, "uptime");
+  EXPECT_TRUE(SerialCLI_CheckStaticCommands());
+  EXPECT_TRUE(SerialCLI_IsStaticCommand(&commands[1]));
+  EXPECT_FALSE(SerialCLI_IsStaticCommand(&commands[2]));
+  EXPECT_FALSE(SerialCLI_IsStaticCommand(&fwUpdate));
+
+  // Only full names are found
+  EXPECT_EQ(SerialCLI_FindStaticCommand("uptime", 6), &commands[1]);
+  EXPECT_EQ(SerialCLI_FindStaticCommand("uptimes", 6), &commands[1]);
+  EXPECT_EQ(SerialCLI_FindStaticCommand("fw_", 3), nullptr);
+  EXPECT_EQ(SerialCLI_FindStaticCommand("fw_crcs", 7), nullptr);
+  EXPECT_EQ(SerialCLI_FindStaticCommand("", 0), nullptr);
+  EXPECT_EQ(SerialCLI_SearchStaticCommands(nullptr, 0, "uptime", 6), nullptr);
+
+  // The command IDs index the table
+  EXPECT_EQ(SerialCLI_GetStaticCommandById(SerialCLI_GetStaticCommandId(&commands[1])), &commands[1]);
+  EXPECT_EQ(SerialCLI_GetStaticCommandById(SERIAL_CLI_STATIC_COMMAND_ID + 2), nullptr);
+  EXPECT_EQ(SerialCLI_GetStaticCommandById(SERIAL_CLI_STATIC_COMMAND_ID - 1), nullptr);
+}
+
+TEST_F(SerialCLIStaticTest, Dispatch) {
+  std::vector<SerialCLI_LineStatus> statuses;
+  SerialCLI_SetLineResultCallback(
+      &cli,
+      [](void *context, SerialCLI_LineStatus status) {
+        static_cast<std::vector<SerialCLI_LineStatus> *>(context)->push_back(status);
+      },
+      &statuses);
+
+  execute("uptime -s 2");
+  execute("fw_crc");
+  execute("fw_crc app");
+  execute("fw");
+  EXPECT_EQ(calls, (std::vector<std::string>{"uptime -s 2", "fw_crc"}));
+  EXPECT_EQ(statuses, (std::vector<SerialCLI_LineStatus>{SERIAL_CLI_LINE_OK, SERIAL_CLI_LINE_OK,
+                                                         SERIAL_CLI_LINE_COMMAND_FAILED,
+                                                         SERIAL_CLI_LINE_UNKNOWN_COMMAND}));
+
+  // Registered commands must not reuse the names
+  SerialCLI_CommandEntry duplicate{};
+  duplicate.commandName = "uptime";
+  duplicate.command = noopCommand;
+  EXPECT_FALSE(SerialCLI_RegisterCommand(&cli, &duplicate));
+}
+
+TEST_F(SerialCLIStaticTest, Help) {
+  // The static commands follow the registered ones
+  execute("help");
+  EXPECT_NE(output.find("  fw_update - Updates the firmware\r\n  fw_crc - CRC\r\n  uptime - Uptime\r\n"),
+            std::string::npos)
+      << output;
+
+  output.clear();
+  execute("help uptime");
+  EXPECT_NE(output.find("  uptime - Uptime\r\n"), std::string::npos) << output;
+  EXPECT_EQ(output.find("fw_"), std::string::npos);
+  output.clear();
+  execute("help uptime now");
+  EXPECT_NE(output.find("Usage: help [group ...]"), std::string::npos);
+}
+
+TEST_F(SerialCLIStaticTest, TabCompletion) {
+  writeString("up\t\r");
+  process();
+  EXPECT_EQ(calls, (std::vector<std::string>{"uptime"}));
+
+  // Registered and static candidates are completed together
+  output.clear();
+  writeString("fw\t");
+  EXPECT_EQ(output, "fw_");
+  writeString("\t");
+  EXPECT_NE(output.find("fw_update  fw_crc  "), std::string::npos) << output;
+  writeString("c\t\r");
+  process();
+  EXPECT_EQ(calls.back(), "fw_crc");
+}
+
+TEST_F(SerialCLIStaticTest, Rpc) {
+  ASSERT_TRUE(SerialCLI_SetMode(&cli, SERIAL_CLI_MODE_RPC));
+
+  char frame[64];
+  std::vector<const char *> argv = {"uptime", "-s"};
+  size_t length = encodeRpcRequest(&cli, frame, sizeof(frame), 1, argv);
+  SerialCLI_Read(&cli, frame, length);
+  process();
+  EXPECT_EQ(calls, (std::vector<std::string>{"uptime -s"}));
+
+  // The list ends with the static commands in table order
+  output.clear();
+  length = SerialCLI_RpcEncodeRequest(frame, sizeof(frame), 2, SERIAL_CLI_RPC_LIST_COMMANDS, 0, nullptr);
+  SerialCLI_Read(&cli, frame, length);
+  process();
+  SerialCLI_RpcResponse response;
+  ASSERT_TRUE(SerialCLI_RpcDecodeResponse(output.data(), output.find('\0'), &response));
+  EXPECT_EQ(response.type, SERIAL_CLI_RPC_RESULT);
+  uint32_t commandId = 0;
+  ASSERT_TRUE(SerialCLI_RpcFindCommandId(response.data, response.dataLength, "uptime", &commandId));
+  EXPECT_EQ(commandId, SERIAL_CLI_STATIC_COMMAND_ID + 1);
+  std::string tail = std::string(response.data, response.dataLength).substr(response.dataLength - 7);
+  EXPECT_EQ(tail, std::string("uptime", 7));
+}
+
+#if SERIAL_CLI_ENABLE_METRICS
+
+TEST_F(SerialCLIStaticTest, Metrics) {
+  ASSERT_TRUE(SerialCLI_ResetMetrics(&cli));
+  execute("uptime");
+  execute("uptime");
+
+  // The static commands are listed after the registered ones
+  output.clear();
+  execute("stats");
+  EXPECT_NE(output.find("  fw_update          0"), std::string::npos) << output;
+  EXPECT_NE(output.find("  uptime             2"), std::string::npos) << output;
+  EXPECT_LT(output.find("  fw_update "), output.find("  fw_crc "));
+
+  ASSERT_TRUE(SerialCLI_ResetMetrics(&cli));
+  output.clear();
+  execute("stats");
+  EXPECT_NE(output.find("  uptime             0"), std::string::npos) << output;
+}
+
+#endif
+
+#else
+
+TEST(SerialCLIStatic, CompiledOut) {
+  size_t count = 1;
+  EXPECT_EQ(SerialCLI_GetStaticCommands(&count), nullptr);
+  EXPECT_EQ(count, 0U);
+  EXPECT_TRUE(SerialCLI_CheckStaticCommands());
+}
+
+#endif
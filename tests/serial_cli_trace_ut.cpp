@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "serial_cli_fixture.hpp"
+#include "serial_cli_rpc.h"
+#include "serial_cli_trace.h"
+#include "serial_cli_trace_json.hpp"
+
+namespace {
+
+uint32_t now = 0;
+
+uint32_t readClock(void *) { return now++; }
+
+void writeCommand(SerialCLI *cli, int, const char **) { SerialCLI_WriteString(cli, "written\r\n"); }
+
+} // namespace
+
+class SerialCLITraceTest : public SerialCLITest {
+public:
+  SerialCLI_CommandEntry commandEntry{};
+  SerialCLI_TraceRecord ring[64];
+
+  std::vector<SerialCLI_TraceRecord> dump() {
+    std::vector<SerialCLI_TraceRecord> records(std::size(ring));
+    records.resize(SerialCLI_TraceDump(records.data(), records.size()));
+    return records;
+  }
+
+protected:
+  void SetUp() override {
+    SerialCLITest::SetUp();
+    commandEntry.commandName = "write";
+    commandEntry.command = writeCommand;
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+  }
+
+  void TearDown() override {
+    SerialCLI_TraceStop();
+    SerialCLITest::TearDown();
+  }
+};
+
+#if SERIAL_CLI_ENABLE_TRACE
+
+TEST_F(SerialCLITraceTest, HotPath) {
+  EXPECT_FALSE(SerialCLI_TraceStart(nullptr, std::size(ring), readClock, nullptr));
+  EXPECT_FALSE(SerialCLI_TraceStart(ring, 48, readClock, nullptr));
+  EXPECT_FALSE(SerialCLI_TraceStart(ring, std::size(ring), nullptr, nullptr));
+  ASSERT_TRUE(SerialCLI_TraceStart(ring, std::size(ring), readClock, nullptr));
+
+  std::string input = "write\r";
+  SerialCLI_Read(&cli, input.data(), input.size());
+  SerialCLI_Process(&cli);
+  EXPECT_TRUE(SerialCLI_TraceStop());
+  EXPECT_FALSE(SerialCLI_TraceStop());
+
+  // Nothing is recorded once stopped
+  SerialCLI_Read(&cli, input.data(), input.size());
+
+  std::vector<SerialCLI_TraceRecord> records = dump();
+  std::vector<uint16_t> events;
+  for (const SerialCLI_TraceRecord &record : records) {
+    events.push_back(record.event);
+  }
+  std::vector<uint16_t> expected = {
+      SERIAL_CLI_TRACE_READ_BEGIN,  SERIAL_CLI_TRACE_READ_END,      SERIAL_CLI_TRACE_PARSE_BEGIN,
+      SERIAL_CLI_TRACE_PARSE_END,   SERIAL_CLI_TRACE_COMMAND_BEGIN, SERIAL_CLI_TRACE_WRITE,
+      SERIAL_CLI_TRACE_COMMAND_END, SERIAL_CLI_TRACE_PROMPT,      SERIAL_CLI_TRACE_WRITE,
+  };
+  ASSERT_EQ(events, expected);
+  EXPECT_EQ(records[0].payload, input.size());
+  EXPECT_EQ(records[1].payload, 1U);
+  EXPECT_EQ(records[3].payload, 1U);
+  uint32_t commandId = 0;
+  ASSERT_TRUE(SerialCLI_RpcGetCommandId(&cli, "write", &commandId));
+  EXPECT_EQ(records[4].payload, commandId);
+  EXPECT_EQ(records[5].payload, 9U);
+  EXPECT_EQ(records[6].payload, (uint32_t)SERIAL_CLI_LINE_OK);
+  for (size_t i = 1; i < records.size(); ++i) {
+    EXPECT_GT(records[i].timestamp, records[i - 1].timestamp);
+  }
+  EXPECT_NE(cli.traceInstance, 0U);
+  for (const SerialCLI_TraceRecord &record : records) {
+    EXPECT_EQ(record.instance, cli.traceInstance);
+  }
+}
+
+TEST_F(SerialCLITraceTest, RingWrapsAround) {
+  ASSERT_TRUE(SerialCLI_TraceStart(ring, 8, readClock, nullptr));
+  for (int i = 0; i < 10; ++i) {
+    SerialCLI_Read(&cli, "x", 1);
+  }
+  SerialCLI_TraceStop();
+
+  // The newest records are kept oldest first
+  std::vector<SerialCLI_TraceRecord> records = dump();
+  ASSERT_EQ(records.size(), 8U);
+  for (size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(records[i].sequence, 12 + i);
+  }
+  EXPECT_EQ(SerialCLI_TraceDump(nullptr, 8), 0U);
+  EXPECT_EQ(SerialCLI_TraceDump(ring, 3), 3U);
+}
+
+TEST_F(SerialCLITraceTest, ConcurrentWriters) {
+  ASSERT_TRUE(SerialCLI_TraceStart(ring, std::size(ring), [](void *) -> uint32_t { return 0; }, nullptr));
+
+  // Every instance traces from its own thread into the shared ring
+  constexpr size_t threadCount = 4;
+  std::vector<std::thread> threads;
+  std::vector<uint32_t> tags(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads.emplace_back([&tag = tags[i]] {
+      SerialCLI instance;
+      SerialCLITestStorage storage;
+      initTestInstance(&instance, storage, [](void *, const char *, size_t) {}, nullptr);
+      tag = instance.traceInstance;
+      for (int j = 0; j < 10000; ++j) {
+        SerialCLI_Read(&instance, "x", 1);
+      }
+      SerialCLI_Deinit(&instance);
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  SerialCLI_TraceStop();
+
+  std::vector<SerialCLI_TraceRecord> records = dump();
+  ASSERT_EQ(records.size(), std::size(ring));
+  for (size_t i = 1; i < records.size(); ++i) {
+    EXPECT_EQ((uint16_t)(records[i].sequence - records[i - 1].sequence), 1U);
+  }
+
+  // Each instance tags its records with its own tag
+  std::sort(tags.begin(), tags.end());
+  EXPECT_EQ(std::unique(tags.begin(), tags.end()), tags.end());
+  for (const SerialCLI_TraceRecord &record : records) {
+    EXPECT_TRUE(std::binary_search(tags.begin(), tags.end(), record.instance));
+  }
+}
+
+#else
+
+TEST_F(SerialCLITraceTest, CompiledOut) {
+  EXPECT_FALSE(SerialCLI_TraceStart(ring, std::size(ring), readClock, nullptr));
+  EXPECT_FALSE(SerialCLI_TraceStop());
+  EXPECT_EQ(SerialCLI_TraceDump(ring, std::size(ring)), 0U);
+}
+
+#endif
+
+TEST(SerialCLITraceJson, ChromeTrace) {
+  // The clock wraps around between the first two records
+  std::string dump = std::string("\xfe\xff\xff\xff\x01\x00\x00\x00\x05\x00\x00\x00\x01\x00\x00\x00", 16) +
+                     std::string("\x08\x00\x00\x00\x02\x00\x01\x00\x01\x00\x00\x00\x01\x00\x00\x00", 16) +
+                     "\x01\x02";
+  std::vector<SerialCLI_TraceRecord> records = serial_cli::decodeTraceDump(dump);
+  ASSERT_EQ(records.size(), 2U);
+  EXPECT_EQ(records[0].timestamp, 0xFFFFFFFEU);
+  EXPECT_EQ(records[1].sequence, 1U);
+  EXPECT_EQ(records[1].instance, 1U);
+
+  records.insert(records.begin(), {0xFFFFFFF0U, SERIAL_CLI_TRACE_COMMAND_END, 0, 0, 1});
+  records.push_back({9, SERIAL_CLI_TRACE_COMMAND_BEGIN, 2, 0xABCDU, 1});
+  records.push_back({9, SERIAL_CLI_TRACE_WRITE, 3, 4, 1});
+
+  // The end whose begin was overwritten is left out
+  EXPECT_EQ(serial_cli::toChromeTrace(records),
+            "{\"traceEvents\":["
+            "{\"name\":\"read\",\"cat\":\"serial_cli\",\"ph\":\"B\",\"ts\":14,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"length\":5}},"
+            "{\"name\":\"read\",\"cat\":\"serial_cli\",\"ph\":\"E\",\"ts\":24,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"queuedLines\":1}},"
+            "{\"name\":\"command\",\"cat\":\"serial_cli\",\"ph\":\"B\",\"ts\":25,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"commandId\":\"0x0000abcd\"}},"
+            "{\"name\":\"write\",\"cat\":\"serial_cli\",\"ph\":\"i\",\"ts\":25,\"pid\":1,\"tid\":1,\"s\":\"t\","
+            "\"args\":{\"length\":4}}]}\n");
+}
+
+TEST(SerialCLITraceJson, InterleavedInstances) {
+  // The slices of two instances overlap without nesting
+  std::vector<SerialCLI_TraceRecord> records = {
+      {0, SERIAL_CLI_TRACE_COMMAND_BEGIN, 0, 7, 1},
+      {1, SERIAL_CLI_TRACE_PARSE_BEGIN, 1, 3, 2},
+      {2, SERIAL_CLI_TRACE_COMMAND_END, 2, 0, 1},
+      {3, SERIAL_CLI_TRACE_PARSE_END, 3, 1, 2},
+  };
+
+  EXPECT_EQ(serial_cli::toChromeTrace(records),
+            "{\"traceEvents\":["
+            "{\"name\":\"command\",\"cat\":\"serial_cli\",\"ph\":\"B\",\"ts\":0,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"commandId\":\"0x00000007\"}},"
+            "{\"name\":\"parse\",\"cat\":\"serial_cli\",\"ph\":\"B\",\"ts\":1,\"pid\":1,\"tid\":2,"
+            "\"args\":{\"length\":3}},"
+            "{\"name\":\"command\",\"cat\":\"serial_cli\",\"ph\":\"E\",\"ts\":2,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"status\":0}},"
+            "{\"name\":\"parse\",\"cat\":\"serial_cli\",\"ph\":\"E\",\"ts\":3,\"pid\":1,\"tid\":2,"
+            "\"args\":{\"arguments\":1}}]}\n");
+}
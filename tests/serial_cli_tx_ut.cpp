@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+
+#include "serial_cli.h"
+#include "serial_cli.hpp"
+#include "serial_cli_fixture.hpp"
+
+namespace {
+
+// Transport taking at most budget bytes until it is given more
+struct Transport {
+  std::string received;
+  size_t budget = SIZE_MAX;
+  size_t callCount = 0;
+};
+
+size_t transportWrite(void *context, const char *str, size_t len) {
+  auto *transport = static_cast<Transport *>(context);
+  size_t accepted = std::min(len, transport->budget);
+  transport->received.append(str, accepted);
+  transport->budget -= accepted;
+  ++transport->callCount;
+  return accepted;
+}
+
+std::string blockingOutput;
+
+// Writes a line of 100 bytes per argument
+void fillCommand(SerialCLI *cli, int argc, const char **) {
+  for (int i = 0; i < argc; ++i) {
+    SerialCLI_WriteString(cli, "%s\r\n", std::string(98, 'f').c_str());
+  }
+}
+
+} // namespace
+
+class SerialCLITxTest : public ::testing::Test {
+public:
+  SerialCLI cli;
+  SerialCLITestStorage storage;
+  Transport transport;
+  char txRing[256];
+  SerialCLI_CommandEntry commands[24]{};
+  std::string names[24];
+
+  void init(size_t txRingSize) {
+    ASSERT_TRUE(SerialCLI_InitNonBlocking(&cli, storage.get(), transportWrite, &transport, txRing, txRingSize));
+    registerCommands(&cli);
+  }
+
+  void registerCommands(SerialCLI *instance) {
+    for (size_t i = 0; i < (sizeof(commands) / sizeof(commands[0])); ++i) {
+      names[i] = "command" + std::to_string(i);
+      commands[i].commandName = names[i].c_str();
+      commands[i].commandDescription = "Does what command number i does";
+      commands[i].command = fillCommand;
+      ASSERT_TRUE(SerialCLI_RegisterCommand(instance, &commands[i]));
+    }
+  }
+
+  void read(std::string_view input) { SerialCLI_Read(&cli, input.data(), input.size()); }
+
+  // Output of the same input on a blocking instance
+  std::string getBlockingOutput(std::string_view input) {
+    SerialCLI reference;
+    SerialCLITestStorage referenceStorage;
+    blockingOutput.clear();
+    EXPECT_TRUE(initTestInstance(
+        &reference, referenceStorage, [](void *, const char *str, size_t len) { blockingOutput.append(str, len); },
+        nullptr));
+    registerCommands(&reference);
+    SerialCLI_Read(&reference, input.data(), input.size());
+    while (SerialCLI_IsCommandPending(&reference)) {
+      SerialCLI_Process(&reference);
+    }
+    std::string result = blockingOutput;
+    SerialCLI_Deinit(&reference);
+    return result;
+  }
+
+protected:
+  void TearDown() override { SerialCLI_Deinit(&cli); }
+};
+
+TEST_F(SerialCLITxTest, InitNonBlocking) {
+  EXPECT_FALSE(SerialCLI_InitNonBlocking(nullptr, storage.get(), transportWrite, &transport, txRing, sizeof(txRing)));
+  EXPECT_FALSE(SerialCLI_InitNonBlocking(&cli, storage.get(), nullptr, &transport, txRing, sizeof(txRing)));
+  EXPECT_FALSE(SerialCLI_InitNonBlocking(&cli, storage.get(), transportWrite, &transport, nullptr, sizeof(txRing)));
+
+  // The ring must take a full TX buffer
+  EXPECT_FALSE(SerialCLI_InitNonBlocking(&cli, storage.get(), transportWrite, &transport, txRing,
+                                         SERIAL_CLI_TX_BUFFER_SIZE - 1));
+  ASSERT_TRUE(
+      SerialCLI_InitNonBlocking(&cli, storage.get(), transportWrite, &transport, txRing, SERIAL_CLI_TX_BUFFER_SIZE));
+  EXPECT_EQ(transport.received, "\r\n>> ");
+  EXPECT_EQ(SerialCLI_GetTxSpace(&cli), (size_t)SERIAL_CLI_TX_BUFFER_SIZE);
+
+  // Blocking instances have no limit
+  SerialCLI blocking;
+  SerialCLITestStorage blockingStorage;
+  ASSERT_TRUE(initTestInstance(&blocking, blockingStorage, [](void *, const char *, size_t) {}, nullptr));
+  EXPECT_EQ(SerialCLI_GetTxSpace(&blocking), SIZE_MAX);
+  EXPECT_FALSE(SerialCLI_IsTxBlocked(&blocking));
+  EXPECT_TRUE(SerialCLI_TxReady(&blocking));
+  EXPECT_EQ(SerialCLI_GetTxSpace(nullptr), 0U);
+  EXPECT_FALSE(SerialCLI_TxReady(nullptr));
+}
+
+TEST_F(SerialCLITxTest, PartialWritesAreKept) {
+  transport.budget = 0;
+  init(sizeof(txRing));
+  read("command1\r");
+  EXPECT_EQ(SerialCLI_GetTxPending(&cli), 5U + 8U);
+
+  // Whatever the transport takes, the output arrives in order
+  SerialCLI_Process(&cli);
+  EXPECT_FALSE(SerialCLI_IsCommandPending(&cli));
+  for (size_t budget = 1; !SerialCLI_TxReady(&cli); ++budget) {
+    transport.budget = budget;
+  }
+
+  EXPECT_EQ(transport.received, getBlockingOutput("command1\r"));
+  EXPECT_EQ(cli.txDropped, 0U);
+}
+
+TEST_F(SerialCLITxTest, FullRingDrops) {
+  transport.budget = 0;
+  init(160);
+  read("command1 a b\rcommand2\r");
+  SerialCLI_Process(&cli);
+  SerialCLI_Process(&cli);
+
+  // The second line waits, the output beyond the ring of the first one is dropped
+  std::string expected = getBlockingOutput("command1 a b\rcommand2\r").substr(0, 160);
+  EXPECT_EQ(SerialCLI_GetTxPending(&cli), 160U);
+  EXPECT_GT(cli.txDropped, 0U);
+  EXPECT_TRUE(SerialCLI_IsTxBlocked(&cli));
+  EXPECT_TRUE(SerialCLI_IsCommandPending(&cli));
+
+  transport.budget = SIZE_MAX;
+  EXPECT_TRUE(SerialCLI_TxReady(&cli));
+  EXPECT_EQ(transport.received, expected);
+  EXPECT_FALSE(SerialCLI_IsTxBlocked(&cli));
+}
+
+TEST_F(SerialCLITxTest, LinesWaitForRoom) {
+  transport.budget = 0;
+  init(sizeof(txRing));
+  read("command1\rcommand2\rcommand3\r");
+
+  // A line runs only while the ring takes a full TX buffer
+  SerialCLI_Process(&cli);
+  EXPECT_EQ(cli.queuedLines, 2U);
+  EXPECT_TRUE(SerialCLI_IsTxBlocked(&cli));
+  SerialCLI_Process(&cli);
+  EXPECT_EQ(cli.queuedLines, 2U);
+
+  // The transport taking the output lets the lines run
+  transport.budget = SIZE_MAX;
+  EXPECT_TRUE(SerialCLI_TxReady(&cli));
+  SerialCLI_Process(&cli);
+  SerialCLI_Process(&cli);
+  EXPECT_EQ(cli.queuedLines, 0U);
+  EXPECT_EQ(transport.received, getBlockingOutput("command1\rcommand2\rcommand3\r"));
+  EXPECT_EQ(cli.txDropped, 0U);
+}
+
+TEST_F(SerialCLITxTest, HelpStreams) {
+  transport.budget = 0;
+  init(160);
+  read("help\r");
+  SerialCLI_Process(&cli);
+  EXPECT_TRUE(SerialCLI_IsCommandRunning(&cli));
+
+  // The commands are listed as fast as the transport takes them, without dropping any
+  size_t processCount = 1;
+  while (SerialCLI_IsCommandRunning(&cli) || !SerialCLI_TxReady(&cli)) {
+    transport.budget = 16;
+    SerialCLI_Process(&cli);
+    ++processCount;
+  }
+  EXPECT_GT(processCount, 24U);
+  EXPECT_EQ(transport.received, getBlockingOutput("help\r"));
+  EXPECT_EQ(cli.txDropped, 0U);
+
+  // A blocking instance lists them at once
+  EXPECT_GT(blockingOutput.size(), 24U * 40U);
+}
+
+TEST(SerialCLITx, CppTemplate) {
+  Transport transport;
+  transport.budget = 5;
+  serial_cli::Cli<4, 16, 32, 0, 64> smallCli(transportWrite, &transport);
+  ASSERT_TRUE(smallCli.isInitialized());
+  EXPECT_EQ(transport.received, "\r\n>> ");
+  EXPECT_EQ(smallCli.getTxSpace(), 64U);
+
+  std::string input = "help\r";
+  smallCli.read(input.data(), input.size());
+  smallCli.process();
+  EXPECT_FALSE(smallCli.txReady());
+  transport.budget = SIZE_MAX;
+  EXPECT_TRUE(smallCli.txReady());
+  EXPECT_FALSE(smallCli.isTxBlocked());
+  EXPECT_EQ(transport.received.substr(0, 11), "\r\n>> help\r\n");
+}
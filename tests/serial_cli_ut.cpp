@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "serial_cli.h"
 #include "serial_cli_fixture.hpp"
 
@@ -11,7 +15,53 @@ TEST(SerialCli, Init) {
   ASSERT_FALSE(SerialCLI_Init(nullptr, nullptr));
   ASSERT_FALSE(SerialCLI_Init(&cli, nullptr));
   ASSERT_FALSE(SerialCLI_Init(nullptr, write));
-  ASSERT_TRUE(SerialCLI_Init(&cli, write));
+  // Without the embedded buffers an instance needs caller provided storage
+  ASSERT_EQ(SerialCLI_Init(&cli, write), SERIAL_CLI_EMBEDDED_STORAGE != 0);
+}
+
+TEST(SerialCli, InitWithContext) {
+  SerialCLI first;
+  SerialCLI second;
+  std::string firstOutput;
+  std::string secondOutput;
+  auto write = [](void *context, const char *str, size_t len) -> void {
+    static_cast<std::string *>(context)->append(str, len);
+  };
+
+  ASSERT_FALSE(SerialCLI_InitWithContext(nullptr, write, &firstOutput));
+  ASSERT_FALSE(SerialCLI_InitWithContext(&first, nullptr, &firstOutput));
+  ASSERT_EQ(SerialCLI_InitWithContext(&first, write, &firstOutput), SERIAL_CLI_EMBEDDED_STORAGE != 0);
+  SerialCLITestStorage firstStorage;
+  SerialCLITestStorage secondStorage;
+  ASSERT_TRUE(initTestInstance(&first, firstStorage, write, &firstOutput));
+  ASSERT_TRUE(initTestInstance(&second, secondStorage, write, &secondOutput));
+  EXPECT_EQ(SerialCLI_GetContext(&first), &firstOutput);
+  EXPECT_EQ(SerialCLI_GetContext(&second), &secondOutput);
+  EXPECT_EQ(SerialCLI_GetContext(nullptr), nullptr);
+
+  // One callback serves both instances, the context tells them apart
+  firstOutput.clear();
+  secondOutput.clear();
+  SerialCLI_WriteString(&first, "first");
+  SerialCLI_WriteString(&second, "second");
+  SerialCLI_Flush(&first);
+  SerialCLI_Flush(&second);
+  EXPECT_EQ(firstOutput, "first");
+  EXPECT_EQ(secondOutput, "second");
+
+  // Output larger than the TX buffer bypasses it
+  std::string longOutput(SERIAL_CLI_OUTPUT_BUFFER_SIZE - 1, 'x');
+  firstOutput.clear();
+  SerialCLI_WriteString(&first, "%s", longOutput.c_str());
+  SerialCLI_WriteString(&first, "%s", longOutput.c_str());
+  SerialCLI_Flush(&first);
+  EXPECT_EQ(firstOutput, longOutput + longOutput);
+
+#if SERIAL_CLI_EMBEDDED_STORAGE
+  // A plain write callback drops the context
+  ASSERT_TRUE(SerialCLI_Init(&first, [](const char *, size_t) -> void {}));
+  EXPECT_EQ(SerialCLI_GetContext(&first), nullptr);
+#endif
 }
 
 TEST_F(SerialCLITest, CommandRegistration) {
@@ -53,12 +103,12 @@ TEST_F(SerialCLITest, processCommand) {
   TestInput testInputs[] = {
       {"tset\r", false},       {"test\r", true},       {" test\r", true},
       {"  test\r", true},      {" test\r", true},      {"test\r\n", true},
-      {"test\n", false},       {"test", false},        {"\rtest", false},
-      {"\rtest\r", false},     {"\ntest", false},      {"\ntest\r", true},
-      {"\r\ntest", false},     {"\r\ntest\r", false},  {"\r\n", false},
+      {"test\n", true},        {"test", false},        {"\rtest", false},
+      {"\rtest\r", true},      {"\ntest", false},      {"\ntest\r", true},
+      {"\r\ntest", false},     {"\r\ntest\r", true},   {"\r\n", false},
       {"\r", false},           {"\n", false},          {"test\r arg", true},
       {"test\r test\r", true}, {"test\r\n arg", true}, {"test\r\n test\r\n", true},
-      {"test\n arg", false},
+      {"test\n arg", true},
   };
 
   for (const auto &testInput : testInputs) {
@@ -211,13 +261,318 @@ TEST_F(SerialCLITest, ExceedingArgumentBuffer) {
   process();
   EXPECT_TRUE(isCommandExecuted) << "Input: " << testInput;
 
-  // Test exceeding the maximum argument length
+  // Arguments share the input buffer, a single argument may use all of it
   testInput = "test ";
   testInput.append(SERIAL_CLI_COMMAND_MAX_ARG_LENGTH + 10, 'a');
   testInput += "\r";
 
+  isCommandExecuted = false;
+  writeString(testInput);
+  process();
+  EXPECT_TRUE(isCommandExecuted) << "Input: " << testInput;
+
+  // Test exceeding the input buffer
+  testInput = "test ";
+  testInput.append(SERIAL_CLI_INPUT_BUFFER_SIZE, 'a');
+  testInput += "\r";
+
   isCommandExecuted = false;
   writeString(testInput);
   process();
   EXPECT_FALSE(isCommandExecuted) << "Input: " << testInput;
 }
+
+TEST_F(SerialCLITest, ArgumentsSplitInPlace) {
+  static std::vector<std::string> arguments;
+  static bool isArgvTerminated = false;
+
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *, int argc, const char **argv) -> void {
+    arguments.assign(argv, argv + argc);
+    isArgvTerminated = (nullptr == argv[argc]);
+  };
+  commandEntry.commandName = "test";
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+
+  struct TestInput {
+    std::string input;
+    std::vector<std::string> expectedArguments;
+  };
+
+  TestInput testInputs[] = {
+      {"test\r", {"test"}},
+      {"  test   a  b \r", {"test", "a", "b"}},
+      {"test \"\" x\r", {"test", "", "x"}},
+      {"test \"a b\"c\r", {"test", "a b", "c"}},
+      {"test a\"b c\"\r", {"test", "a", "b c"}},
+      {"test \"unterminated arg\r", {"test", "unterminated arg"}},
+  };
+
+  for (const auto &testInput : testInputs) {
+    arguments.clear();
+    isArgvTerminated = false;
+    writeString(testInput.input);
+    process();
+
+    EXPECT_EQ(arguments, testInput.expectedArguments) << "Input: " << testInput.input;
+    EXPECT_TRUE(isArgvTerminated) << "Input: " << testInput.input;
+  }
+}
+
+TEST_F(SerialCLITest, DuplicateCommandName) {
+  auto handler = [](SerialCLI *, int, const char **) -> void {};
+
+  SerialCLI_CommandEntry entry1{};
+  entry1.command = handler;
+  entry1.commandName = "test";
+
+  SerialCLI_CommandEntry entry2{};
+  entry2.command = handler;
+  entry2.commandName = "test";
+
+  SerialCLI_CommandEntry helpEntry{};
+  helpEntry.command = handler;
+  helpEntry.commandName = "help";
+
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &entry1));
+  ASSERT_FALSE(SerialCLI_RegisterCommand(&cli, &entry2)) << "Command names must be unique";
+  ASSERT_FALSE(SerialCLI_RegisterCommand(&cli, &helpEntry)) << "Built-in help must not be shadowed";
+}
+
+TEST_F(SerialCLITest, ManyCommands) {
+  constexpr size_t commandCount = 200;
+  static size_t executedIdx = 0;
+
+  std::vector<std::string> names(commandCount);
+  std::vector<SerialCLI_CommandEntry> entries(commandCount);
+  for (size_t i = 0; i < commandCount; ++i) {
+    names[i] = "cmd" + std::to_string(i);
+    entries[i] = {};
+    entries[i].command = [](SerialCLI *, int, const char **argv) -> void {
+      executedIdx = std::stoul(std::string(argv[0]).substr(3));
+    };
+    entries[i].commandName = names[i].c_str();
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &entries[i]));
+  }
+
+  for (size_t i = 0; i < commandCount; ++i) {
+    executedIdx = commandCount;
+    writeString(names[i] + "\r");
+    process();
+    EXPECT_EQ(executedIdx, i) << "Command: " << names[i];
+  }
+}
+
+TEST_F(SerialCLITest, TabCompletion) {
+  static std::string executed;
+
+  auto handler = [](SerialCLI *, int, const char **argv) -> void { executed = argv[0]; };
+  const char *names[] = {"set", "setup", "settings", "status"};
+  SerialCLI_CommandEntry entries[std::size(names)]{};
+  for (size_t i = 0; i < std::size(names); ++i) {
+    entries[i].command = handler;
+    entries[i].commandName = names[i];
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &entries[i]));
+  }
+
+  // Unique completion appends a space
+  writeString("statu\t\r");
+  process();
+  EXPECT_EQ(executed, "status");
+
+  // Longest common prefix is filled in
+  output.clear();
+  writeString("se\t");
+  EXPECT_EQ(output, "set");
+
+  // Second TAB lists the candidates
+  output.clear();
+  writeString("\t");
+  EXPECT_NE(output.find("set  settings  setup"), std::string::npos) << output;
+
+  writeString("u\t\r");
+  process();
+  EXPECT_EQ(executed, "setup");
+
+  // No match leaves the input untouched
+  output.clear();
+  writeString("x\t\t");
+  EXPECT_EQ(output, "x");
+}
+
+TEST_F(SerialCLITest, BurstInput) {
+  static size_t executedCount = 0;
+  static std::vector<std::string> executedArgs;
+
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *, int argc, const char **argv) -> void {
+    ++executedCount;
+    executedArgs.emplace_back(argc > 1 ? argv[1] : "");
+  };
+  commandEntry.commandName = "test";
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+
+  // CR, LF and CR LF line endings in a single chunk
+  executedArgs.clear();
+  std::string input = "test 1\rtest 2\ntest 3\r\ntest 4\r";
+  ASSERT_TRUE(SerialCLI_Read(&cli, input.data(), input.size()));
+  process();
+  EXPECT_EQ(executedArgs, (std::vector<std::string>{"1", "2", "3", "4"}));
+
+  // CR LF split across two chunks
+  executedArgs.clear();
+  ASSERT_TRUE(SerialCLI_Read(&cli, "test 5\r", 7));
+  ASSERT_TRUE(SerialCLI_Read(&cli, "\ntest 6\r", 8));
+  process();
+  EXPECT_EQ(executedArgs, (std::vector<std::string>{"5", "6"}));
+
+  // A DMA sized chunk holding many commands, drained one command per call
+  std::string dmaChunk;
+  while (dmaChunk.size() + strlen("test\r") <= 512) {
+    dmaChunk += "test\r";
+  }
+  size_t lineCount = dmaChunk.size() / strlen("test\r");
+  executedCount = 0;
+  ASSERT_TRUE(SerialCLI_Read(&cli, dmaChunk.data(), dmaChunk.size()));
+  for (size_t i = 0; i < lineCount; ++i) {
+    EXPECT_EQ(executedCount, i);
+    EXPECT_TRUE(SerialCLI_IsCommandPending(&cli));
+    SerialCLI_Process(&cli);
+  }
+  EXPECT_EQ(executedCount, lineCount);
+  EXPECT_FALSE(SerialCLI_IsCommandPending(&cli));
+
+  // A partial line is not pending
+  ASSERT_TRUE(SerialCLI_Read(&cli, "test", 4));
+  EXPECT_FALSE(SerialCLI_IsCommandPending(&cli));
+  EXPECT_FALSE(SerialCLI_IsCommandPending(nullptr));
+}
+
+TEST_F(SerialCLITest, LineQueueOverflow) {
+  static size_t executedCount = 0;
+
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *, int, const char **) -> void { ++executedCount; };
+  commandEntry.commandName = "test";
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+
+  // More lines than fit into the input buffer are reported and dropped
+  std::string input;
+  for (size_t i = 0; i < SERIAL_CLI_INPUT_BUFFER_SIZE; ++i) {
+    input += "test\r";
+  }
+  executedCount = 0;
+  EXPECT_FALSE(SerialCLI_Read(&cli, input.data(), input.size()));
+  for (size_t i = 0; i < SERIAL_CLI_INPUT_BUFFER_SIZE; ++i) {
+    SerialCLI_Process(&cli);
+  }
+  EXPECT_GT(executedCount, 0U);
+  EXPECT_LT(executedCount, SERIAL_CLI_INPUT_BUFFER_SIZE);
+
+  // An overlong line is dropped up to its line ending, the next line still runs
+  input = std::string(SERIAL_CLI_INPUT_BUFFER_SIZE, 'a') + "\rtest\r";
+  executedCount = 0;
+  EXPECT_FALSE(SerialCLI_Read(&cli, input.data(), input.size()));
+  process();
+  EXPECT_EQ(executedCount, 1U);
+}
+
+TEST_F(SerialCLITest, OutputCoalescing) {
+  constexpr size_t commandCount = 200;
+
+  std::vector<std::string> names(commandCount);
+  std::vector<SerialCLI_CommandEntry> entries(commandCount);
+  for (size_t i = 0; i < commandCount; ++i) {
+    names[i] = "cmd" + std::to_string(i);
+    entries[i] = {};
+    entries[i].command = [](SerialCLI *, int, const char **) -> void {};
+    entries[i].commandName = names[i].c_str();
+    entries[i].commandDescription = "Description.";
+    ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &entries[i]));
+  }
+
+  std::string help = "help\r";
+  ASSERT_TRUE(SerialCLI_Read(&cli, help.data(), help.size()));
+  output.clear();
+  writeCount = 0;
+  process();
+
+  EXPECT_NE(output.find("cmd199 - Description.\r\n"), std::string::npos);
+  // Every write but the last hands over a full TX buffer, whatever else the binary defines for help to list
+  EXPECT_LE(writeCount, (output.size() / SERIAL_CLI_TX_BUFFER_SIZE) + 1) << "Output must be coalesced";
+}
+
+TEST_F(SerialCLITest, FlushPolicy) {
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *cli, int, const char **) -> void {
+    SerialCLI_WriteString(cli, "line 1\r\n");
+    SerialCLI_WriteString(cli, "line 2");
+  };
+  commandEntry.commandName = "test";
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+
+  // Explicit flush only
+  ASSERT_TRUE(SerialCLI_SetFlushPolicy(&cli, SERIAL_CLI_FLUSH_EXPLICIT, 0));
+  output.clear();
+  writeCount = 0;
+  writeString("test\r");
+  process();
+  EXPECT_EQ(writeCount, 0U);
+  ASSERT_TRUE(SerialCLI_Flush(&cli));
+  EXPECT_EQ(writeCount, 1U);
+  EXPECT_NE(output.find("line 1\r\nline 2"), std::string::npos);
+
+  // Newline flush keeps the echo of an incomplete line buffered
+  ASSERT_TRUE(SerialCLI_SetFlushPolicy(&cli, SERIAL_CLI_FLUSH_ON_NEWLINE, 0));
+  output.clear();
+  writeCount = 0;
+  writeString("test");
+  EXPECT_EQ(writeCount, 0U);
+  writeString("\r");
+  SerialCLI_Process(&cli);
+  EXPECT_EQ(writeCount, 3U) << "One write per line";
+  EXPECT_EQ(output.rfind("test\r\nline 1\r\nline 2\r\n", 0), 0U) << output;
+
+  // High-water flush
+  ASSERT_TRUE(SerialCLI_Flush(&cli));
+  ASSERT_TRUE(SerialCLI_SetFlushPolicy(&cli, SERIAL_CLI_FLUSH_ON_HIGH_WATER, 8));
+  writeCount = 0;
+  writeString("1234567");
+  EXPECT_EQ(writeCount, 0U);
+  writeString("8");
+  EXPECT_EQ(writeCount, 1U);
+
+  EXPECT_FALSE(SerialCLI_SetFlushPolicy(&cli, SERIAL_CLI_FLUSH_ON_HIGH_WATER, SERIAL_CLI_TX_BUFFER_SIZE + 1));
+  EXPECT_FALSE(SerialCLI_Flush(nullptr));
+}
+
+TEST_F(SerialCLITest, Monitor) {
+  SerialCLI_CommandEntry commandEntry{};
+  commandEntry.command = [](SerialCLI *cli, int, const char **) -> void { SerialCLI_WriteString(cli, "done\r\n"); };
+  commandEntry.commandName = "test";
+  ASSERT_TRUE(SerialCLI_RegisterCommand(&cli, &commandEntry));
+
+  // Input and output, indexed by the direction
+  std::string monitored[2];
+  ASSERT_TRUE(SerialCLI_SetMonitor(
+      &cli,
+      [](void *context, SerialCLI_MonitorDirection direction, const char *data, size_t length) {
+        static_cast<std::string *>(context)[direction].append(data, length);
+      },
+      monitored));
+
+  // The monitor sees the input chunks and everything the write callback receives
+  output.clear();
+  std::string line = "test\r";
+  ASSERT_TRUE(SerialCLI_Read(&cli, line.data(), line.size()));
+  process();
+  EXPECT_EQ(monitored[SERIAL_CLI_MONITOR_INPUT], line);
+  EXPECT_EQ(monitored[SERIAL_CLI_MONITOR_OUTPUT], output);
+  EXPECT_NE(output.find("done\r\n"), std::string::npos);
+
+  ASSERT_TRUE(SerialCLI_SetMonitor(&cli, nullptr, nullptr));
+  writeString("test\r");
+  process();
+  EXPECT_EQ(monitored[SERIAL_CLI_MONITOR_INPUT], line);
+  EXPECT_FALSE(SerialCLI_SetMonitor(nullptr, nullptr, nullptr));
+}
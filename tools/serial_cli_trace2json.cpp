@@ -0,0 +1,41 @@
+// Converts a dump of the trace ring into Chrome trace JSON.
+//
+// The dump holds the records of SerialCLI_TraceDump as they lie in memory on a
+// little-endian target. Open the JSON in chrome://tracing or ui.perfetto.dev.
+//
+// Usage: serial_cli_trace2json <dump> [output.json]
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "serial_cli_trace_json.hpp"
+
+int main(int argc, char **argv) {
+  if ((argc < 2) || (argc > 3)) {
+    std::fprintf(stderr, "Usage: %s <dump> [output.json]\n", argv[0]);
+    return 2;
+  }
+
+  std::ifstream input(argv[1], std::ios::binary);
+  if (!input) {
+    std::fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+  std::string dump((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+  std::string json = serial_cli::toChromeTrace(serial_cli::decodeTraceDump(dump));
+  if (argc < 3) {
+    std::fputs(json.c_str(), stdout);
+    return 0;
+  }
+
+  std::ofstream output(argv[2], std::ios::binary);
+  output << json;
+  if (!output) {
+    std::fprintf(stderr, "Cannot write %s\n", argv[2]);
+    return 1;
+  }
+  return 0;
+}
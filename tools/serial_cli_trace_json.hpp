@@ -0,0 +1,119 @@
+#ifndef SERIAL_CLI_TRACE_JSON_HPP
+#define SERIAL_CLI_TRACE_JSON_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "serial_cli_trace.h"
+
+namespace serial_cli {
+
+namespace trace_json {
+
+struct EventFormat {
+  const char *name;
+  char phase;           // 'B' begins a slice, 'E' ends it, 'i' is an instant
+  const char *argument; // Name of the payload
+};
+
+inline EventFormat getEventFormat(uint16_t event) {
+  switch (event) {
+  case SERIAL_CLI_TRACE_READ_BEGIN:
+    return {"read", 'B', "length"};
+  case SERIAL_CLI_TRACE_READ_END:
+    return {"read", 'E', "queuedLines"};
+  case SERIAL_CLI_TRACE_PARSE_BEGIN:
+    return {"parse", 'B', "length"};
+  case SERIAL_CLI_TRACE_PARSE_END:
+    return {"parse", 'E', "arguments"};
+  case SERIAL_CLI_TRACE_COMMAND_BEGIN:
+    return {"command", 'B', "commandId"};
+  case SERIAL_CLI_TRACE_COMMAND_END:
+    return {"command", 'E', "status"};
+  case SERIAL_CLI_TRACE_WRITE:
+    return {"write", 'i', "length"};
+  case SERIAL_CLI_TRACE_PROMPT:
+    return {"prompt", 'i', "queuedLines"};
+  default:
+    return {"unknown", 'i', "payload"};
+  }
+}
+
+inline uint32_t readUint32(const unsigned char *data) {
+  return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+inline uint16_t readUint16(const unsigned char *data) { return (uint16_t)(data[0] | (data[1] << 8)); }
+
+} // namespace trace_json
+
+/**
+ * Decodes a dump of @ref SerialCLI_TraceDump records in the little-endian layout.
+ *
+ * A partial record at the end is ignored.
+ */
+inline std::vector<SerialCLI_TraceRecord> decodeTraceDump(const std::string &dump) {
+  constexpr size_t recordSize = 16;
+  std::vector<SerialCLI_TraceRecord> records;
+  records.reserve(dump.size() / recordSize);
+  for (size_t offset = 0; (offset + recordSize) <= dump.size(); offset += recordSize) {
+    auto *data = reinterpret_cast<const unsigned char *>(&dump[offset]);
+    records.push_back({trace_json::readUint32(data), trace_json::readUint16(&data[4]),
+                       trace_json::readUint16(&data[6]), trace_json::readUint32(&data[8]),
+                       trace_json::readUint32(&data[12])});
+  }
+  return records;
+}
+
+/**
+ * Converts records, oldest first, into Chrome trace JSON.
+ *
+ * Timestamps are unwrapped and start at 0. Every instance tag becomes a
+ * thread whose slices nest on their own. Ends whose begin was overwritten
+ * in the ring are left out.
+ */
+inline std::string toChromeTrace(const std::vector<SerialCLI_TraceRecord> &records) {
+  std::string json = "{\"traceEvents\":[";
+  uint64_t time = 0;
+  uint32_t lastTimestamp = records.empty() ? 0 : records.front().timestamp;
+  std::map<uint32_t, std::vector<std::string>> openSlices;
+  bool isFirst = true;
+
+  for (const SerialCLI_TraceRecord &record : records) {
+    time += (uint32_t)(record.timestamp - lastTimestamp);
+    lastTimestamp = record.timestamp;
+
+    trace_json::EventFormat format = trace_json::getEventFormat(record.event);
+    std::vector<std::string> &instanceSlices = openSlices[record.instance];
+    if ('B' == format.phase) {
+      instanceSlices.emplace_back(format.name);
+    } else if ('E' == format.phase) {
+      if (instanceSlices.empty() || (instanceSlices.back() != format.name)) {
+        continue;
+      }
+      instanceSlices.pop_back();
+    }
+
+    char event[256];
+    const char *valueFormat = (SERIAL_CLI_TRACE_COMMAND_BEGIN == record.event) ? "\"0x%08lx\"" : "%lu";
+    char value[16];
+    std::snprintf(value, sizeof(value), valueFormat, (unsigned long)record.payload);
+    std::snprintf(event, sizeof(event),
+                  "%s{\"name\":\"%s\",\"cat\":\"serial_cli\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%lu,"
+                  "%s\"args\":{\"%s\":%s}}",
+                  isFirst ? "" : ",", format.name, format.phase, (unsigned long long)time,
+                  (unsigned long)record.instance, ('i' == format.phase) ? "\"s\":\"t\"," : "", format.argument, value);
+    json += event;
+    isFirst = false;
+  }
+
+  json += "]}\n";
+  return json;
+}
+
+} // namespace serial_cli
+
+#endif // SERIAL_CLI_TRACE_JSON_HPP